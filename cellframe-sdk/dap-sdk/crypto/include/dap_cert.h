@@ -56,6 +56,9 @@ typedef struct dap_cert {
     dap_binary_tree_t * metadata;
 } dap_cert_t;
 
+// Certificates indexed by hash of their serialized public keys
+typedef struct dap_cert_pkey_index_item dap_cert_pkey_index_t;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -88,6 +91,11 @@ dap_sign_t * dap_cert_sign(dap_cert_t * a_cert, const void * a_data, size_t a_da
 
 int dap_cert_compare_with_sign (dap_cert_t * a_cert,const dap_sign_t * a_sign);
 
+dap_cert_pkey_index_t *dap_cert_pkey_index_new(dap_cert_t **a_certs, size_t a_certs_count);
+dap_cert_t *dap_cert_pkey_index_find(dap_cert_pkey_index_t *a_index, const dap_sign_t *a_sign);
+size_t dap_cert_pkey_index_count_signers(dap_cert_pkey_index_t *a_index, dap_sign_t **a_signs, size_t a_signs_count);
+void dap_cert_pkey_index_delete(dap_cert_pkey_index_t *a_index);
+
 
 size_t dap_cert_sign_output_size(dap_cert_t * a_cert, size_t a_size_wished);
 
@@ -61,6 +61,16 @@ typedef struct dap_cert_folder
     UT_hash_handle hh;
 } dap_cert_folder_t;
 
+struct dap_cert_pkey_index_item
+{
+    dap_chain_hash_fast_t pkey_hash;
+    dap_sign_type_t sign_type;
+    uint8_t *pkey; // Serialized public key
+    size_t pkey_size;
+    dap_cert_t *cert;
+    UT_hash_handle hh;
+};
+
 typedef struct dap_cert_pvt
 {
     dap_sign_item_t *signs;
@@ -460,7 +470,108 @@ int dap_cert_compare_with_sign (dap_cert_t * a_cert,const dap_sign_t * a_sign)
         return -3; // Wrong sign type
 }
 
+/**
+ * @brief dap_cert_pkey_index_new
+ * @details Serializes certificates public keys once, so sign owner is found with one hash lookup
+ * instead of dap_cert_compare_with_sign() for every certificate
+ * @param a_certs certificates array
+ * @param a_certs_count certificates count
+ * @return index, NULL if there are no certificates with keys. Free it with dap_cert_pkey_index_delete()
+ */
+dap_cert_pkey_index_t *dap_cert_pkey_index_new(dap_cert_t **a_certs, size_t a_certs_count)
+{
+    dap_cert_pkey_index_t *l_index = NULL;
+    for (size_t i = 0; i < a_certs_count; i++) {
+        if (!a_certs[i] || !a_certs[i]->enc_key)
+            continue;
+        size_t l_pkey_size = 0;
+        uint8_t *l_pkey = dap_enc_key_serealize_pub_key(a_certs[i]->enc_key, &l_pkey_size);
+        if (!l_pkey || !l_pkey_size) {
+            log_it(L_WARNING, "Can't serialize public key of cert \"%s\"", a_certs[i]->name);
+            DAP_DEL_Z(l_pkey);
+            continue;
+        }
+        dap_chain_hash_fast_t l_pkey_hash;
+        dap_hash_fast(l_pkey, l_pkey_size, &l_pkey_hash);
+        dap_cert_pkey_index_t *l_item = NULL;
+        HASH_FIND(hh, l_index, &l_pkey_hash, sizeof(l_pkey_hash), l_item);
+        if (l_item) { // The same key in several certs
+            DAP_DELETE(l_pkey);
+            continue;
+        }
+        l_item = DAP_NEW_Z(dap_cert_pkey_index_t);
+        l_item->pkey_hash = l_pkey_hash;
+        l_item->sign_type = dap_sign_type_from_key_type(a_certs[i]->enc_key->type);
+        l_item->pkey = l_pkey;
+        l_item->pkey_size = l_pkey_size;
+        l_item->cert = a_certs[i];
+        HASH_ADD(hh, l_index, pkey_hash, sizeof(l_item->pkey_hash), l_item);
+    }
+    return l_index;
+}
 
+/**
+ * @brief dap_cert_pkey_index_find
+ * @param a_index certificates index
+ * @param a_sign sign with public key inside its bounds
+ * @return certificate the sign is made with, NULL if it's not in index
+ */
+dap_cert_t *dap_cert_pkey_index_find(dap_cert_pkey_index_t *a_index, const dap_sign_t *a_sign)
+{
+    if (!a_index || !a_sign || !a_sign->header.sign_pkey_size)
+        return NULL;
+    dap_chain_hash_fast_t l_pkey_hash;
+    dap_hash_fast(a_sign->pkey_n_sign, a_sign->header.sign_pkey_size, &l_pkey_hash);
+    dap_cert_pkey_index_t *l_item = NULL;
+    HASH_FIND(hh, a_index, &l_pkey_hash, sizeof(l_pkey_hash), l_item);
+    if (!l_item || l_item->sign_type.type != a_sign->header.type.type
+            || l_item->pkey_size != a_sign->header.sign_pkey_size
+            || memcmp(l_item->pkey, a_sign->pkey_n_sign, l_item->pkey_size))
+        return NULL;
+    return l_item->cert;
+}
+
+/**
+ * @brief dap_cert_pkey_index_count_signers
+ * @details Every certificate is counted once, so repeated signatures don't add up to the signers quorum
+ * @param a_index certificates index
+ * @param a_signs signs with public keys inside their bounds
+ * @param a_signs_count signs count
+ * @return number of distinct certificates from index the signs are made with
+ */
+size_t dap_cert_pkey_index_count_signers(dap_cert_pkey_index_t *a_index, dap_sign_t **a_signs, size_t a_signs_count)
+{
+    if (!a_index || !a_signs || !a_signs_count)
+        return 0;
+    dap_cert_t **l_signers = DAP_NEW_Z_SIZE(dap_cert_t *, a_signs_count * sizeof(dap_cert_t *));
+    size_t l_ret = 0;
+    for (size_t i = 0; i < a_signs_count; i++) {
+        dap_cert_t *l_cert = dap_cert_pkey_index_find(a_index, a_signs[i]);
+        if (!l_cert)
+            continue;
+        size_t j = 0;
+        while (j < l_ret && l_signers[j] != l_cert)
+            j++;
+        if (j == l_ret)
+            l_signers[l_ret++] = l_cert;
+    }
+    DAP_DELETE(l_signers);
+    return l_ret;
+}
+
+/**
+ * @brief dap_cert_pkey_index_delete
+ * @param a_index certificates index, certificates themselves aren't deleted
+ */
+void dap_cert_pkey_index_delete(dap_cert_pkey_index_t *a_index)
+{
+    dap_cert_pkey_index_t *l_item, *l_tmp;
+    HASH_ITER(hh, a_index, l_item, l_tmp) {
+        HASH_DEL(a_index, l_item);
+        DAP_DELETE(l_item->pkey);
+        DAP_DELETE(l_item);
+    }
+}
 
 /**
  * @brief Certificates signatures chain size
@@ -111,14 +111,15 @@ size_t dap_enc_iaes256_cbc_decrypt_fast(struct dap_enc_key * a_key, const void *
     void *data = buf_out;
     const void *cdata = a_in;
     size_t count_block, count32_word;
+    uint32_t cblock[block_in32_size];
     for(count_block = 0; count_block < (a_in_size/IAES_BLOCK_SIZE); count_block++){
-
-        AES256_dec_cernelT((uint32_t *)cdata + count_block*block_in32_size,
-                           (uint32_t *)data + count_block*block_in32_size, round_decrypt_key);
+        // Ciphertext block is kept aside for feedback, so buf_out may be the same as a_in
+        memcpy(&cblock[0], (uint32_t *)cdata + count_block*block_in32_size, IAES_BLOCK_SIZE);
+        AES256_dec_cernelT(cblock, (uint32_t *)data + count_block*block_in32_size, round_decrypt_key);
 
         for (count32_word = 0; count32_word < block_in32_size; count32_word++)
             *((uint32_t *)data + count_block * block_in32_size + count32_word) ^= feedback[count32_word];
-        memcpy(&feedback[0], (uint32_t *)cdata + count_block*block_in32_size, IAES_BLOCK_SIZE);
+        memcpy(&feedback[0], &cblock[0], IAES_BLOCK_SIZE);
     }
 //    for(int i = 0; i < 16; ++i)
 //    {printf("%.2x ", ((uint8_t*)data)[i]);}
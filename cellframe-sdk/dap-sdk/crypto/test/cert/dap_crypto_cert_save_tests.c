@@ -42,6 +42,74 @@ static void test_cert_memory_file(dap_enc_key_type_t a_key_type)
   dap_pass_msg("Save and load cert in file successfully");
 }
 
+static void test_cert_pkey_index(dap_enc_key_type_t a_key_type)
+{
+  const char l_data[] = "pkey index test data";
+  dap_cert_t *l_certs[2] = {
+      dap_cert_generate_mem("index 1", a_key_type),
+      dap_cert_generate_mem("index 2", a_key_type)
+  };
+  dap_cert_t *l_cert_other = dap_cert_generate_mem("index 3", a_key_type);
+  dap_assert_PIF(l_certs[0] && l_certs[1] && l_cert_other, "Fail create cert");
+
+  dap_cert_pkey_index_t *l_index = dap_cert_pkey_index_new(l_certs, 2);
+  dap_assert_PIF(l_index, "Fail create pkey index");
+
+  dap_sign_t *l_sign = dap_cert_sign(l_certs[1], l_data, sizeof(l_data), 0);
+  dap_assert_PIF(dap_cert_pkey_index_find(l_index, l_sign) == l_certs[1], "Find cert by sign");
+  DAP_DELETE(l_sign);
+
+  l_sign = dap_cert_sign(l_cert_other, l_data, sizeof(l_data), 0);
+  dap_assert_PIF(!dap_cert_pkey_index_find(l_index, l_sign), "Foreign sign is not found");
+  DAP_DELETE(l_sign);
+
+  dap_cert_pkey_index_delete(l_index);
+  dap_cert_delete(l_certs[0]);
+  dap_cert_delete(l_certs[1]);
+  dap_cert_delete(l_cert_other);
+
+  dap_pass_msg("Find cert by sign in pkey index successfully");
+}
+
+static void test_cert_pkey_index_signers(dap_enc_key_type_t a_key_type)
+{
+  const char l_data[] = "pkey index signers test data";
+  const size_t l_signers_required = 2;
+  dap_cert_t *l_certs[2] = {
+      dap_cert_generate_mem("signers 1", a_key_type),
+      dap_cert_generate_mem("signers 2", a_key_type)
+  };
+  dap_cert_t *l_cert_other = dap_cert_generate_mem("signers 3", a_key_type);
+  dap_assert_PIF(l_certs[0] && l_certs[1] && l_cert_other, "Fail create cert");
+  dap_cert_pkey_index_t *l_index = dap_cert_pkey_index_new(l_certs, 2);
+  dap_assert_PIF(l_index, "Fail create pkey index");
+
+  dap_sign_t *l_sign_1 = dap_cert_sign(l_certs[0], l_data, sizeof(l_data), 0),
+             *l_sign_2 = dap_cert_sign(l_certs[1], l_data, sizeof(l_data), 0),
+             *l_sign_other = dap_cert_sign(l_cert_other, l_data, sizeof(l_data), 0);
+  dap_assert_PIF(l_sign_1 && l_sign_2 && l_sign_other, "Fail sign data");
+
+  dap_sign_t *l_signs_repeated[] = { l_sign_1, l_sign_1, l_sign_1 };
+  dap_assert_PIF(dap_cert_pkey_index_count_signers(l_index, l_signs_repeated, 3) < l_signers_required,
+                 "Repeated sign is rejected");
+  dap_sign_t *l_signs_foreign[] = { l_sign_1, l_sign_other };
+  dap_assert_PIF(dap_cert_pkey_index_count_signers(l_index, l_signs_foreign, 2) < l_signers_required,
+                 "Foreign sign is rejected");
+  dap_sign_t *l_signs_distinct[] = { l_sign_2, l_sign_1, l_sign_2 };
+  dap_assert_PIF(dap_cert_pkey_index_count_signers(l_index, l_signs_distinct, 3) == l_signers_required,
+                 "Distinct signs are accepted");
+
+  DAP_DELETE(l_sign_1);
+  DAP_DELETE(l_sign_2);
+  DAP_DELETE(l_sign_other);
+  dap_cert_pkey_index_delete(l_index);
+  dap_cert_delete(l_certs[0]);
+  dap_cert_delete(l_certs[1]);
+  dap_cert_delete(l_cert_other);
+
+  dap_pass_msg("Count distinct signers in pkey index successfully");
+}
+
 void init_test_case()
 {
     dap_enc_key_init();
@@ -62,5 +130,8 @@ void dap_crypto_cert_save_tests_run(void)
     test_cert_memory_file(DAP_ENC_KEY_TYPE_SIG_PICNIC);
     test_cert_memory_file(DAP_ENC_KEY_TYPE_SIG_DILITHIUM);
 
+    test_cert_pkey_index(DAP_ENC_KEY_TYPE_SIG_DILITHIUM);
+    test_cert_pkey_index_signers(DAP_ENC_KEY_TYPE_SIG_DILITHIUM);
+
     cleanup_test_case();
 }
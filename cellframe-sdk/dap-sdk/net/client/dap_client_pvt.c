@@ -71,6 +71,7 @@
 #include "dap_stream_ch_proc.h"
 #include "dap_stream_ch_pkt.h"
 #include "dap_stream_pkt.h"
+#include "dap_stream_compress.h"
 #include "dap_http_client.h"
 
 #define LOG_TAG "dap_client_pvt"
@@ -428,9 +429,11 @@ static bool s_stage_status_after(dap_client_pvt_t * a_client_pvt)
                         l_suburl = dap_strdup_printf("stream_ctl,channels=%s",
                                                      a_client_pvt->active_channels);
                     }else{
-                        l_suburl = dap_strdup_printf("channels=%s,enc_type=%d,enc_key_size=%d,enc_headers=%d",
+                        int l_compress = !dap_stream_compress_enabled() ? DAP_STREAM_COMPRESS_NONE
+                                       : dap_stream_compress_dict_id() ? DAP_STREAM_COMPRESS_ZSTD_DICT : DAP_STREAM_COMPRESS_ZSTD;
+                        l_suburl = dap_strdup_printf("channels=%s,enc_type=%d,enc_key_size=%d,enc_headers=%d,compress=%d,compress_dict=%u",
                                                      a_client_pvt->active_channels,a_client_pvt->session_key_type,
-                                                     a_client_pvt->session_key_block_size,0 );
+                                                     a_client_pvt->session_key_block_size,0, l_compress, dap_stream_compress_dict_id());
                     }
                     if(s_debug_more)
                         log_it(L_DEBUG, "Prepared enc request for streaming");
@@ -499,6 +502,7 @@ static bool s_stage_status_after(dap_client_pvt_t * a_client_pvt)
 
                     // new added, whether it is necessary?
                     a_client_pvt->stream->session->key = a_client_pvt->stream_key;
+                    a_client_pvt->stream->session->compress_type = a_client_pvt->stream_compress_type;
                     a_client_pvt->stream_worker = DAP_STREAM_WORKER(l_worker);
                     a_client_pvt->stream->stream_worker = a_client_pvt->stream_worker;
 
@@ -1097,9 +1101,10 @@ static void s_stream_ctl_response(dap_client_t * a_client, void * a_data, size_t
         uint32_t l_remote_protocol_version;
         dap_enc_key_type_t l_enc_type = l_client_pvt->session_key_type;
         int l_enc_headers = 0;
+        int l_compress = DAP_STREAM_COMPRESS_NONE;
 
-        l_arg_count = sscanf(l_response_str, "%25s %4096s %u %d %d"
-                , l_stream_id, l_stream_key, &l_remote_protocol_version, &l_enc_type, &l_enc_headers);
+        l_arg_count = sscanf(l_response_str, "%25s %4096s %u %d %d %d"
+                , l_stream_id, l_stream_key, &l_remote_protocol_version, &l_enc_type, &l_enc_headers, &l_compress);
         if(l_arg_count < 2) {
             log_it(L_WARNING, "STREAM_CTL Need at least 2 arguments in reply (got %d)", l_arg_count);
             l_client_pvt->last_error = ERROR_STREAM_CTL_ERROR_RESPONSE_FORMAT;
@@ -1130,6 +1135,10 @@ static void s_stream_ctl_response(dap_client_t * a_client, void * a_data, size_t
                                 32);
 
                 l_client_pvt->is_encrypted_headers = l_enc_headers;
+                l_client_pvt->stream_compress_type = l_arg_count > 5 && dap_stream_compress_enabled()
+                        ? (uint8_t)l_compress : DAP_STREAM_COMPRESS_NONE;
+                if (l_client_pvt->stream_compress_type != DAP_STREAM_COMPRESS_NONE)
+                    log_it(L_DEBUG, "Stream compression %d is negotiated", l_compress);
 
                 if(l_client_pvt->stage == STAGE_STREAM_CTL) { // We are on the right stage
                     l_client_pvt->stage_status = STAGE_STATUS_DONE;
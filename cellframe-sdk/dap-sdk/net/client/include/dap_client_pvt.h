@@ -57,6 +57,7 @@ typedef struct dap_client_internal
     dap_enc_key_t * session_key_open; // Open assymetric keys exchange
     dap_enc_key_t * session_key; // Symmetric private key for session encryption
     dap_enc_key_t * stream_key; // Stream private key for stream encryption
+    uint8_t stream_compress_type; // Stream compression negotiated with uplink
     char stream_id[25];
     dap_cert_t *auth_cert;
 
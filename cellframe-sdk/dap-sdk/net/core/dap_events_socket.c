@@ -85,6 +85,7 @@ typedef cpuset_t cpu_set_t; // Adopt BSD CPU setstructure to POSIX variant
 
 #include "dap_timerfd.h"
 #include "dap_events_socket.h"
+#include "dap_worker_uring.h"
 
 #define LOG_TAG "dap_events_socket"
 
@@ -103,10 +104,184 @@ struct queue_ptr_input_pvt{
 };
 #define PVT_QUEUE_PTR_INPUT(a) ( (struct queue_ptr_input_pvt*) (a)->_pvt )
 
+#ifdef DAP_EVENTS_CAPS_QUEUE_RING
+/**
+ * Bounded lock-free ring of pointers, any thread pushes and the queue owner pops. Every cell sequence
+ * tells whose turn is it: equal to position - cell is free for producer, position + 1 - it's ready for consumer.
+ * Consumer is woken through eventfd only when it could be sleeping, the flag is dropped before every drain.
+ * Ring is referenced by the queue and by each of its inputs, it's freed with the last of them
+ */
+struct dap_events_socket_queue_ring {
+    atomic_size_t tail;                         // Next position to push, producers race for it
+    byte_t tail_pad[64 - sizeof(atomic_size_t)];
+    size_t head;                                // Next position to pop, consumer only
+    atomic_bool signalled;                      // Eventfd is already written and not consumed
+    atomic_uint refs;                           // Queue and its inputs
+    byte_t head_pad[64 - sizeof(size_t) - sizeof(atomic_bool) - sizeof(atomic_uint)];
+    struct {
+        atomic_size_t seq;
+        void *ptr;
+    } cells[DAP_QUEUE_RING_SIZE];
+};
+
+static struct dap_events_socket_queue_ring *s_queue_ring_new()
+{
+    struct dap_events_socket_queue_ring *l_ring = DAP_NEW_Z(struct dap_events_socket_queue_ring);
+    if (!l_ring)
+        return NULL;
+    for (size_t i = 0; i < DAP_QUEUE_RING_SIZE; i++)
+        atomic_init(&l_ring->cells[i].seq, i);
+    atomic_init(&l_ring->refs, 1);
+    return l_ring;
+}
+
+static struct dap_events_socket_queue_ring *s_queue_ring_ref(struct dap_events_socket_queue_ring *a_ring)
+{
+    atomic_fetch_add(&a_ring->refs, 1);
+    return a_ring;
+}
+
+static void s_queue_ring_unref(struct dap_events_socket_queue_ring *a_ring)
+{
+    if (a_ring && atomic_fetch_sub(&a_ring->refs, 1) == 1)
+        DAP_DELETE(a_ring);
+}
+
+static bool s_queue_ring_push(struct dap_events_socket_queue_ring *a_ring, void *a_ptr)
+{
+    size_t l_pos = atomic_load_explicit(&a_ring->tail, memory_order_relaxed);
+    for (;;) {
+        size_t l_seq = atomic_load_explicit(&a_ring->cells[l_pos & (DAP_QUEUE_RING_SIZE - 1)].seq, memory_order_acquire);
+        intptr_t l_diff = (intptr_t)l_seq - (intptr_t)l_pos;
+        if (!l_diff) {
+            if (atomic_compare_exchange_weak_explicit(&a_ring->tail, &l_pos, l_pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+                break;
+        } else if (l_diff < 0)
+            return false; // Full, consumer is one round behind
+        else
+            l_pos = atomic_load_explicit(&a_ring->tail, memory_order_relaxed);
+    }
+    a_ring->cells[l_pos & (DAP_QUEUE_RING_SIZE - 1)].ptr = a_ptr;
+    atomic_store_explicit(&a_ring->cells[l_pos & (DAP_QUEUE_RING_SIZE - 1)].seq, l_pos + 1, memory_order_release);
+    return true;
+}
+
+static bool s_queue_ring_pop(struct dap_events_socket_queue_ring *a_ring, void **a_ptr)
+{
+    size_t l_idx = a_ring->head & (DAP_QUEUE_RING_SIZE - 1);
+    if (atomic_load_explicit(&a_ring->cells[l_idx].seq, memory_order_acquire) != a_ring->head + 1)
+        return false;
+    *a_ptr = a_ring->cells[l_idx].ptr;
+    atomic_store_explicit(&a_ring->cells[l_idx].seq, a_ring->head + DAP_QUEUE_RING_SIZE, memory_order_release);
+    a_ring->head++;
+    return true;
+}
+
+static void s_queue_ring_wakeup(dap_events_socket_t *a_es)
+{
+    if (!atomic_exchange(&a_es->queue_ring->signalled, true))
+        eventfd_write(a_es->fd, 1);
+}
+
+/**
+ * @brief dap_events_socket_queue_ptr_send_batch Push pointers to queue ring with one wakeup for all
+ * @param a_es Queue or its input
+ * @param a_ptrs Pointers array, could be unaligned
+ * @param a_count
+ * @return Number of pointers pushed, less than a_count if ring is full
+ */
+size_t dap_events_socket_queue_ptr_send_batch(dap_events_socket_t *a_es, const void *a_ptrs, size_t a_count)
+{
+    size_t l_pushed = 0;
+    for (void *l_ptr; l_pushed < a_count; l_pushed++) {
+        memcpy(&l_ptr, (const byte_t *)a_ptrs + l_pushed * sizeof(void *), sizeof(void *));
+        if (!s_queue_ring_push(a_es->queue_ring, l_ptr))
+            break;
+    }
+    if (l_pushed)
+        s_queue_ring_wakeup(a_es);
+    return l_pushed;
+}
+#endif
+
 static bool s_debug_reactor = false;
 static uint64_t s_delayed_ops_timeout_ms = 5000;
 bool s_remove_and_delete_unsafe_delayed_delete_callback(void * a_arg);
 
+// Capacities of pooled esocket buffers, one byte more is allocated for the string terminator
+static const size_t s_buf_classes[DAP_EVENTS_SOCKET_BUF_CLASSES] = {
+    4096 - 1, 16384 - 1, 65536 - 1, DAP_EVENTS_SOCKET_BUF, DAP_EVENTS_SOCKET_BUF_LIMIT / 2, DAP_EVENTS_SOCKET_BUF_LIMIT
+};
+
+/**
+ * @brief s_buf_alloc Take buffer from the current worker pool or allocate it if there is no one
+ * @param a_es
+ * @param a_size Minimal capacity, it's rounded up to the size class
+ * @param a_size_max Capacity of returned buffer
+ * @return
+ */
+static byte_t *s_buf_alloc(dap_events_socket_t *a_es, size_t a_size, size_t *a_size_max)
+{
+    size_t i = 0;
+    while (i < DAP_EVENTS_SOCKET_BUF_CLASSES - 1 && s_buf_classes[i] < a_size)
+        i++;
+    *a_size_max = s_buf_classes[i];
+    dap_worker_t *l_worker = dap_events_get_current_worker(a_es->events ? a_es->events : dap_events_get_default());
+    byte_t *l_buf = l_worker ? l_worker->buf_pool[i] : NULL;
+    if (l_buf) {
+        l_worker->buf_pool[i] = *(byte_t **)l_buf;
+        l_worker->buf_pool_count[i]--;
+    } else
+        l_buf = DAP_NEW_SIZE(byte_t, *a_size_max + 1);
+    if (l_buf)
+        *l_buf = 0;
+    return l_buf;
+}
+
+/**
+ * @brief s_buf_free Return buffer to the current worker pool or free it if pool is full or there is no worker
+ * @param a_es
+ * @param a_buf
+ * @param a_size_max Buffer capacity
+ */
+static void s_buf_free(dap_events_socket_t *a_es, byte_t *a_buf, size_t a_size_max)
+{
+    if (!a_buf)
+        return;
+    dap_worker_t *l_worker = dap_events_get_current_worker(a_es->events ? a_es->events : dap_events_get_default());
+    for (size_t i = 0; l_worker && i < DAP_EVENTS_SOCKET_BUF_CLASSES; i++) {
+        if (s_buf_classes[i] != a_size_max)
+            continue;
+        if ((l_worker->buf_pool_count[i] + 1) * (a_size_max + 1) > DAP_EVENTS_SOCKET_BUF_POOL_MAX)
+            break;
+        *(byte_t **)a_buf = l_worker->buf_pool[i];
+        l_worker->buf_pool[i] = a_buf;
+        l_worker->buf_pool_count[i]++;
+        return;
+    }
+    DAP_DELETE(a_buf);
+}
+
+/**
+ * @brief s_buf_rewind Move data back to the start of buffer memory, freeing the space of consumed bytes
+ * @param a_buf
+ * @param a_size Data size
+ * @param a_size_max
+ * @param a_offset
+ */
+static void s_buf_rewind(byte_t **a_buf, size_t a_size, size_t *a_size_max, size_t *a_offset)
+{
+    if (!*a_offset)
+        return;
+    byte_t *l_base = *a_buf - *a_offset;
+    if (a_size)
+        memmove(l_base, *a_buf, a_size);
+    *a_buf = l_base;
+    *a_size_max += *a_offset;
+    *a_offset = 0;
+}
+
 
 
 /**
@@ -188,11 +363,8 @@ dap_events_socket_t *dap_events_socket_wrap_no_add( dap_events_t *a_events,
         memcpy(&l_ret->callbacks, a_callbacks, sizeof(l_ret->callbacks) );
     l_ret->flags = DAP_SOCK_READY_TO_READ;
 
-    l_ret->buf_in_size_max = DAP_EVENTS_SOCKET_BUF;
-    l_ret->buf_out_size_max = DAP_EVENTS_SOCKET_BUF;
-
-    l_ret->buf_in     = a_callbacks->timer_callback ? NULL : DAP_NEW_Z_SIZE(byte_t, l_ret->buf_in_size_max + 1);
-    l_ret->buf_out    = a_callbacks->timer_callback ? NULL : DAP_NEW_Z_SIZE(byte_t, l_ret->buf_out_size_max + 1);
+    // Buffers are taken from the worker pool on first i/o
+    l_ret->buf_pooled = !a_callbacks->timer_callback;
     l_ret->buf_in_size = l_ret->buf_out_size = 0;
     #if defined(DAP_EVENTS_CAPS_EPOLL)
     l_ret->ev_base_flags = EPOLLERR | EPOLLRDHUP | EPOLLHUP;
@@ -506,6 +678,18 @@ dap_events_socket_t * dap_events_socket_queue_ptr_create_input(dap_events_socket
     assert(l_es->mqd);
 #elif defined (DAP_EVENTS_CAPS_QUEUE_PIPE2) || defined (DAP_EVENTS_CAPS_QUEUE_PIPE)
     l_es->fd = a_es->fd2;
+#elif defined (DAP_EVENTS_CAPS_QUEUE_RING)
+    // Own descriptor to poll for write and to close, it's always writable
+    l_es->fd = dup(a_es->fd);
+    if (l_es->fd == -1) {
+        log_it(L_CRITICAL, "Can't duplicate queue eventfd, errno %d", errno);
+        DAP_DEL_Z(l_es->buf_in);
+        DAP_DEL_Z(l_es->buf_out);
+        DAP_DELETE(l_es);
+        return NULL;
+    }
+    l_es->pipe_out = a_es;
+    l_es->queue_ring = s_queue_ring_ref(a_es->queue_ring);
 #elif defined DAP_EVENTS_CAPS_MSMQ
     l_es->mqh       = a_es->mqh;
     l_es->mqh_recv  = a_es->mqh_recv;
@@ -676,6 +860,17 @@ dap_events_socket_t * s_create_type_queue_ptr(dap_worker_t * a_w, dap_events_soc
         l_mq_last_number++;
     }
     assert(l_es->mqd);
+#elif defined (DAP_EVENTS_CAPS_QUEUE_RING)
+    l_es->fd = eventfd(0, EFD_NONBLOCK);
+    l_es->queue_ring = l_es->fd == -1 ? NULL : s_queue_ring_new();
+    if (!l_es->queue_ring) {
+        log_it(L_CRITICAL, "Can't create queue ring, errno %d", errno);
+        if (l_es->fd != -1)
+            close(l_es->fd);
+        DAP_DELETE(l_es->buf_in);
+        DAP_DELETE(l_es);
+        return NULL;
+    }
 #elif defined DAP_EVENTS_CAPS_MSMQ
     l_es->socket        = socket(AF_INET, SOCK_DGRAM, 0);
 
@@ -851,6 +1046,18 @@ int dap_events_socket_queue_proc_input_unsafe(dap_events_socket_t * a_esocket)
                 return -1;
             }
             a_esocket->callbacks.queue_ptr_callback (a_esocket, l_queue_ptr);
+#elif defined (DAP_EVENTS_CAPS_QUEUE_RING)
+            eventfd_t l_value;
+            eventfd_read(a_esocket->fd, &l_value);
+            atomic_exchange(&a_esocket->queue_ring->signalled, false);
+            // Drain up to the ring length, the rest is for the next loop to not starve other esockets
+            size_t l_count = 0;
+            while (l_count < DAP_QUEUE_RING_SIZE && s_queue_ring_pop(a_esocket->queue_ring, &l_queue_ptr)) {
+                a_esocket->callbacks.queue_ptr_callback(a_esocket, l_queue_ptr);
+                l_count++;
+            }
+            if (l_count == DAP_QUEUE_RING_SIZE)
+                s_queue_ring_wakeup(a_esocket);
 #elif defined DAP_EVENTS_CAPS_MSMQ
             DWORD l_mp_id = 0;
             MQMSGPROPS    l_mps;
@@ -1100,6 +1307,7 @@ typedef struct dap_events_socket_buf_item
     void *arg;
 } dap_events_socket_buf_item_t;
 
+#ifndef DAP_EVENTS_CAPS_QUEUE_RING
 /**
  *  Waits on the socket
  *  return 0: timeout, 1: may send data, -1 error
@@ -1142,6 +1350,7 @@ static int wait_send_socket(SOCKET a_sockfd, long timeout_ms)
 
     return -1;
 }
+#endif
 
 /**
  * @brief dap_events_socket_buf_thread
@@ -1156,6 +1365,15 @@ static void *dap_events_socket_buf_thread(void *arg)
     }
     int l_res = 0;
     int l_count = 0;
+#ifdef DAP_EVENTS_CAPS_QUEUE_RING
+    // Nothing to wait on for ring space, so retry it each millisecond during the same 15 minutes
+    for (l_count = 0; l_count < 900000; l_count++) {
+        if (dap_events_socket_queue_ptr_send_batch(l_item->es, &l_item->arg, 1))
+            break;
+        usleep(1000);
+    }
+    l_res = l_count < 900000 ? 0 : -1;
+#else
     while(l_res < 1 && l_count < 3) {
     // wait max 5 min
 #ifdef DAP_OS_WINDOWS
@@ -1170,6 +1388,7 @@ static void *dap_events_socket_buf_thread(void *arg)
         }
         l_count++;
     }
+#endif
     if(l_res != 0)
         log_it(L_WARNING, "Lost data bulk in events socket buf thread");
 
@@ -1271,6 +1490,13 @@ int dap_events_socket_queue_ptr_send( dap_events_socket_t * a_es, void* a_arg)
         l_ret = sizeof (a_arg);
     else if (l_ret >0)
         l_ret = -l_ret;
+#elif defined (DAP_EVENTS_CAPS_QUEUE_RING)
+    if (dap_events_socket_queue_ptr_send_batch(a_es, &a_arg, 1)) {
+        l_ret = sizeof(a_arg);
+    } else {
+        l_ret = -1;
+        l_errno = EAGAIN;
+    }
 #elif defined (DAP_EVENTS_CAPS_QUEUE_POSIX)
     struct timespec l_timeout;
     clock_gettime(CLOCK_REALTIME, &l_timeout);
@@ -1476,9 +1702,7 @@ dap_events_socket_t * dap_events_socket_wrap2( dap_server_t *a_server, struct da
     l_es->server = a_server;
     l_es->uuid = dap_uuid_generate_uint64();
     memcpy(&l_es->callbacks,a_callbacks, sizeof ( l_es->callbacks) );
-    l_es->buf_out_size_max = l_es->buf_in_size_max = DAP_EVENTS_SOCKET_BUF;
-    l_es->buf_in = a_callbacks->timer_callback ? NULL : DAP_NEW_Z_SIZE(byte_t, l_es->buf_in_size_max+1);
-    l_es->buf_out = a_callbacks->timer_callback ? NULL : DAP_NEW_Z_SIZE(byte_t, l_es->buf_out_size_max+1);
+    l_es->buf_pooled = !a_callbacks->timer_callback;
     l_es->buf_in_size = l_es->buf_out_size = 0;
     l_es->flags = DAP_SOCK_READY_TO_READ;
     l_es->last_time_active = l_es->last_ping_request = time( NULL );
@@ -1518,6 +1742,9 @@ void dap_events_socket_worker_poll_update_unsafe(dap_events_socket_t * a_esocket
         if( a_esocket->flags & DAP_SOCK_READY_TO_WRITE || a_esocket->flags &DAP_SOCK_CONNECTING )
             events |= EPOLLOUT;
 
+        // Level-triggered registration stays armed, so there is nothing to modify if events are the same
+        if (a_esocket->ev.events == (uint32_t)events && !(events & EPOLLONESHOT))
+            return;
         a_esocket->ev.events = events;
 
         if( a_esocket->worker){
@@ -1677,14 +1904,14 @@ void dap_events_socket_set_writable_unsafe( dap_events_socket_t *a_esocket, bool
 
     if ( a_is_ready ) {
         a_esocket->flags |= DAP_SOCK_READY_TO_WRITE;
-#ifdef DAP_EVENTS_CAPS_EPOLL
+#ifdef DAP_EVENTS_CAPS_WEPOLL
         if (a_esocket->type == DESCRIPTOR_TYPE_QUEUE)
             a_esocket->ev_base_flags |= EPOLLONESHOT;
 #endif
     }
     else {
         a_esocket->flags ^= DAP_SOCK_READY_TO_WRITE;
-#ifdef DAP_EVENTS_CAPS_EPOLL
+#ifdef DAP_EVENTS_CAPS_WEPOLL
         if (a_esocket->type == DESCRIPTOR_TYPE_QUEUE)
             a_esocket->ev_base_flags ^= EPOLLONESHOT;
 #endif
@@ -1832,8 +2059,20 @@ void dap_events_socket_delete_unsafe( dap_events_socket_t * a_esocket , bool a_p
         DAP_DEL_Z(a_esocket->_inheritor)
 
     DAP_DEL_Z(a_esocket->_pvt)
-    DAP_DEL_Z(a_esocket->buf_in)
-    DAP_DEL_Z(a_esocket->buf_out)
+#ifdef DAP_EVENTS_CAPS_QUEUE_RING
+    s_queue_ring_unref(a_esocket->queue_ring);
+    a_esocket->queue_ring = NULL;
+#endif
+    s_buf_rewind(&a_esocket->buf_in, 0, &a_esocket->buf_in_size_max, &a_esocket->buf_in_offset);
+    s_buf_rewind(&a_esocket->buf_out, 0, &a_esocket->buf_out_size_max, &a_esocket->buf_out_offset);
+    if (a_esocket->buf_pooled) {
+        s_buf_free(a_esocket, a_esocket->buf_in, a_esocket->buf_in_size_max);
+        s_buf_free(a_esocket, a_esocket->buf_out, a_esocket->buf_out_size_max);
+        a_esocket->buf_in = a_esocket->buf_out = NULL;
+    } else {
+        DAP_DEL_Z(a_esocket->buf_in)
+        DAP_DEL_Z(a_esocket->buf_out)
+    }
     DAP_DEL_Z(a_esocket->remote_addr_str)
 
     DAP_DEL_Z( a_esocket )
@@ -1865,6 +2104,14 @@ void dap_events_socket_remove_from_worker_unsafe( dap_events_socket_t *a_es, dap
                 a_worker->epoll_fd, l_errbuf, l_errno);
     } //else
       //  log_it( L_DEBUG,"Removed epoll's event from dap_worker #%u", a_worker->id );
+    // Its events may be still selected and waiting for processing on this worker
+    for (int i = 0; i < a_worker->epoll_events_count; i++)
+        if (a_worker->epoll_events[i].data.ptr == a_es)
+            a_worker->epoll_events[i].data.ptr = NULL;
+#ifdef DAP_EVENTS_CAPS_IO_URING
+    if (a_worker->uring)
+        dap_worker_uring_forget(a_worker->uring, a_es);
+#endif
 #elif defined(DAP_EVENTS_CAPS_KQUEUE)
     if (a_es->socket != -1 && a_es->type != DESCRIPTOR_TYPE_TIMER){
         struct kevent * l_event = &a_es->kqueue_event;
@@ -2111,6 +2358,131 @@ size_t dap_events_socket_write_f_mt(dap_worker_t * a_w,dap_events_socket_uuid_t
     return l_data_size;
 }
 
+/**
+ * @brief dap_events_socket_buf_in_reserve_unsafe Prepare input buffer of pooled esocket for reading
+ * @details Takes buffer from the worker pool if there is no one, or grows it if it's full
+ * @param a_es
+ */
+void dap_events_socket_buf_in_reserve_unsafe(dap_events_socket_t *a_es)
+{
+    if (a_es->buf_in && (!a_es->buf_in_size || a_es->buf_in_size >= a_es->buf_in_size_max))
+        s_buf_rewind(&a_es->buf_in, a_es->buf_in_size, &a_es->buf_in_size_max, &a_es->buf_in_offset);
+    if (!a_es->buf_pooled)
+        return;
+    if (!a_es->buf_in) {
+        // Datagrams are cut by the buffer size, so they need the whole buffer at once
+        size_t l_size = a_es->type == DESCRIPTOR_TYPE_SOCKET_UDP || a_es->type == DESCRIPTOR_TYPE_FILE
+                ? DAP_EVENTS_SOCKET_BUF : a_es->buf_in_size_max;
+        a_es->buf_in = s_buf_alloc(a_es, l_size, &a_es->buf_in_size_max);
+        a_es->buf_in_size = 0;
+    } else if (a_es->buf_in_size >= a_es->buf_in_size_max && a_es->buf_in_size_max < DAP_EVENTS_SOCKET_BUF) {
+        size_t l_size_max;
+        byte_t *l_buf = s_buf_alloc(a_es, a_es->buf_in_size_max + 1, &l_size_max);
+        if (!l_buf)
+            return;
+        memcpy(l_buf, a_es->buf_in, a_es->buf_in_size);
+        s_buf_free(a_es, a_es->buf_in, a_es->buf_in_size_max);
+        a_es->buf_in = l_buf;
+        a_es->buf_in_size_max = l_size_max;
+    }
+}
+
+/**
+ * @brief dap_events_socket_buf_out_reserve_unsafe Make output buffer of pooled esocket able to hold a_size bytes
+ * @param a_es
+ * @param a_size Whole size of output data, with what is already in buffer
+ * @return false if a_size exceeds DAP_EVENTS_SOCKET_BUF_LIMIT or there is no memory
+ */
+bool dap_events_socket_buf_out_reserve_unsafe(dap_events_socket_t *a_es, size_t a_size)
+{
+    if (a_es->buf_out && a_size > a_es->buf_out_size_max)
+        s_buf_rewind(&a_es->buf_out, a_es->buf_out_size, &a_es->buf_out_size_max, &a_es->buf_out_offset);
+    if (!a_es->buf_pooled)
+        return a_es->buf_out && a_size <= a_es->buf_out_size_max;
+    if (a_size > DAP_EVENTS_SOCKET_BUF_LIMIT)
+        return false;
+    if (a_es->buf_out && a_size <= a_es->buf_out_size_max)
+        return true;
+    size_t l_size_max;
+    byte_t *l_buf = s_buf_alloc(a_es, a_size, &l_size_max);
+    if (!l_buf)
+        return false;
+    if (a_es->buf_out) {
+        memcpy(l_buf, a_es->buf_out, a_es->buf_out_size);
+        s_buf_free(a_es, a_es->buf_out, a_es->buf_out_size_max);
+    } else
+        a_es->buf_out_size = 0;
+    a_es->buf_out = l_buf;
+    a_es->buf_out_size_max = l_size_max;
+    return true;
+}
+
+/**
+ * @brief dap_events_socket_buf_release_unsafe Return drained buffers of pooled esocket to the worker pool
+ * @details Capacity is kept, so next buffer is taken from the same size class
+ * @param a_es
+ */
+void dap_events_socket_buf_release_unsafe(dap_events_socket_t *a_es)
+{
+    if (!a_es->buf_pooled)
+        return;
+    if (a_es->buf_in && !a_es->buf_in_size) {
+        s_buf_rewind(&a_es->buf_in, 0, &a_es->buf_in_size_max, &a_es->buf_in_offset);
+        s_buf_free(a_es, a_es->buf_in, a_es->buf_in_size_max);
+        a_es->buf_in = NULL;
+    }
+    if (a_es->buf_out && !a_es->buf_out_size) {
+        s_buf_rewind(&a_es->buf_out, 0, &a_es->buf_out_size_max, &a_es->buf_out_offset);
+        s_buf_free(a_es, a_es->buf_out, a_es->buf_out_size_max);
+        a_es->buf_out = NULL;
+    }
+}
+
+/**
+ * @brief dap_events_socket_write_reserve_unsafe Get free tail of output buffer able to hold a_size bytes
+ * @details Data placed there is sent only after dap_events_socket_write_commit_unsafe(), so callers
+ * can build output in place instead of preparing it aside and copying with dap_events_socket_write_unsafe()
+ * @param a_es Esocket instance
+ * @param a_size Size of data to be placed
+ * @return Pointer right after the data already buffered, or NULL if buffer can't grow that much
+ */
+void *dap_events_socket_write_reserve_unsafe(dap_events_socket_t *a_es, size_t a_size)
+{
+    size_t l_size_required = a_es->buf_out_size + a_size;
+    if (l_size_required > DAP_EVENTS_SOCKET_BUF_LIMIT) {
+        log_it(L_ERROR, "Write esocket buffer overflow size=%zu/max=%zu", l_size_required, (size_t)DAP_EVENTS_SOCKET_BUF_LIMIT);
+        return NULL;
+    }
+    if (l_size_required > a_es->buf_out_size_max
+            && !dap_events_socket_buf_out_reserve_unsafe(a_es, l_size_required)) {
+        if (a_es->buf_pooled)
+            return NULL;
+        size_t l_new_size = a_es->buf_out_size_max ? a_es->buf_out_size_max : DAP_EVENTS_SOCKET_BUF;
+        while (l_new_size < l_size_required)
+            l_new_size *= 2;
+        if (l_new_size > DAP_EVENTS_SOCKET_BUF_LIMIT)
+            l_new_size = DAP_EVENTS_SOCKET_BUF_LIMIT;
+        byte_t *l_buf = DAP_REALLOC(a_es->buf_out, l_new_size);
+        if (!l_buf)
+            return NULL;
+        a_es->buf_out = l_buf;
+        a_es->buf_out_size_max = l_new_size;
+    }
+    return a_es->buf_out + a_es->buf_out_size;
+}
+
+/**
+ * @brief dap_events_socket_write_commit_unsafe Append data placed by caller into reserved tail of output buffer
+ * @param a_es Esocket instance
+ * @param a_size Size of data really placed, not more than was reserved
+ */
+void dap_events_socket_write_commit_unsafe(dap_events_socket_t *a_es, size_t a_size)
+{
+    assert(a_es->buf_out_size + a_size <= a_es->buf_out_size_max);
+    a_es->buf_out_size += a_size;
+    dap_events_socket_set_writable_unsafe(a_es, true);
+}
+
 /**
  * @brief dap_events_socket_write Write data to the client
  * @param a_es Esocket instance
@@ -2120,7 +2492,13 @@ size_t dap_events_socket_write_f_mt(dap_worker_t * a_w,dap_events_socket_uuid_t
  */
 size_t dap_events_socket_write_unsafe(dap_events_socket_t *a_es, const void * a_data, size_t a_data_size)
 {
-    if (a_es->buf_out_size + a_data_size > a_es->buf_out_size_max) {
+    if (a_es->buf_pooled) {
+        if (!dap_events_socket_buf_out_reserve_unsafe(a_es, a_es->buf_out_size + a_data_size)) {
+            log_it(L_ERROR, "Write esocket buffer overflow size=%zu/max=%zu", a_es->buf_out_size + a_data_size, (size_t)DAP_EVENTS_SOCKET_BUF_LIMIT);
+            return 0;
+        }
+    } else if (a_es->buf_out_size + a_data_size > a_es->buf_out_size_max
+               && !dap_events_socket_buf_out_reserve_unsafe(a_es, a_es->buf_out_size + a_data_size)) {
         if (a_es->buf_out_size_max + a_data_size > DAP_EVENTS_SOCKET_BUF_LIMIT) {
             log_it(L_ERROR, "Write esocket buffer overflow size=%zu/max=%zu", a_es->buf_out_size_max, (size_t)DAP_EVENTS_SOCKET_BUF_LIMIT);
             return 0;
@@ -2147,6 +2525,14 @@ size_t dap_events_socket_write_unsafe(dap_events_socket_t *a_es, const void * a_
  */
 size_t dap_events_socket_write_f_unsafe(dap_events_socket_t *a_es, const char * a_format,...)
 {
+    if (a_es->buf_pooled) {
+        va_list l_ap;
+        va_start(l_ap, a_format);
+        int l_len = dap_vsnprintf(NULL, 0, a_format, l_ap);
+        va_end(l_ap);
+        if (l_len > 0 && !dap_events_socket_buf_out_reserve_unsafe(a_es, a_es->buf_out_size + l_len + 1))
+            dap_events_socket_buf_out_reserve_unsafe(a_es, DAP_EVENTS_SOCKET_BUF_LIMIT);
+    }
     size_t l_max_data_size = a_es->buf_out_size_max - a_es->buf_out_size;
     if (! l_max_data_size)
         return 0;
@@ -2177,36 +2563,55 @@ size_t dap_events_socket_write_f_unsafe(dap_events_socket_t *a_es, const char *
  */
 size_t dap_events_socket_pop_from_buf_in(dap_events_socket_t *a_es, void *a_data, size_t a_data_size)
 {
-    if(a_data_size<a_es->buf_in_size){
-        memcpy(a_data,a_es->buf_in,a_data_size);
-        memmove(a_data,a_es->buf_in+a_data_size,a_es->buf_in_size-a_data_size);
-    }else{
-        if(a_data_size>a_es->buf_in_size)
-            a_data_size=a_es->buf_in_size;
-        memcpy(a_data,a_es->buf_in,a_data_size);
-    }
-    a_es->buf_in_size-=a_data_size;
+    if(a_data_size>a_es->buf_in_size)
+        a_data_size=a_es->buf_in_size;
+    memcpy(a_data,a_es->buf_in,a_data_size);
+    dap_events_socket_shrink_buf_in(a_es, a_data_size);
     return a_data_size;
 }
 
 
 /**
- * @brief dap_events_socket_shrink_client_buf_in Shrink input buffer (shift it left)
+ * @brief dap_events_socket_shrink_client_buf_in Shrink input buffer (drop consumed data from its start)
+ * @details Data isn't moved, buffer start is advanced. Space before it is reused when buffer is drained
+ *          or when there is no room left at its end
  * @param cl Client instance
- * @param shrink_size Size on wich we shrink the buffer with shifting it left
+ * @param shrink_size Size of consumed data
  */
 void dap_events_socket_shrink_buf_in(dap_events_socket_t * cl, size_t shrink_size)
 {
     if((shrink_size==0)||(cl->buf_in_size==0) ){
         return;
     }else if(cl->buf_in_size>shrink_size){
-        size_t buf_size=cl->buf_in_size-shrink_size;
-        uint8_t* tmp = cl->buf_in + shrink_size;
-        memmove(cl->buf_in,tmp,buf_size);
-        cl->buf_in_size=buf_size;
+        cl->buf_in += shrink_size;
+        cl->buf_in_offset += shrink_size;
+        cl->buf_in_size_max -= shrink_size;
+        cl->buf_in_size -= shrink_size;
     }else{
         //log_it(WARNING,"Shrinking size of input buffer on amount bigger than actual buffer's size");
         cl->buf_in_size=0;
+        s_buf_rewind(&cl->buf_in, 0, &cl->buf_in_size_max, &cl->buf_in_offset);
     }
 
 }
+
+/**
+ * @brief dap_events_socket_shrink_buf_out Drop sent data from the start of output buffer
+ * @details Same as dap_events_socket_shrink_buf_in(), data isn't moved
+ * @param a_es
+ * @param a_shrink_size Size of sent data
+ */
+void dap_events_socket_shrink_buf_out(dap_events_socket_t * a_es, size_t a_shrink_size)
+{
+    if (!a_shrink_size || !a_es->buf_out_size)
+        return;
+    if (a_es->buf_out_size > a_shrink_size) {
+        a_es->buf_out += a_shrink_size;
+        a_es->buf_out_offset += a_shrink_size;
+        a_es->buf_out_size_max -= a_shrink_size;
+        a_es->buf_out_size -= a_shrink_size;
+    } else {
+        a_es->buf_out_size = 0;
+        s_buf_rewind(&a_es->buf_out, 0, &a_es->buf_out_size_max, &a_es->buf_out_offset);
+    }
+}
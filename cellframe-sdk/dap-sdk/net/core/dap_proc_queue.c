@@ -24,12 +24,16 @@
 #include "dap_worker.h"
 #include "dap_proc_queue.h"
 #include "dap_proc_thread.h"
+#include "utlist.h"
 #define LOG_TAG "dap_proc_queue"
 
+#define DAP_PROC_QUEUE_ITEMS_FREE_MAX 1024 // Free items kept for reuse by every queue
 
 typedef struct dap_proc_queue_msg{
     dap_proc_queue_callback_t callback;
     void * callback_arg;
+    dap_proc_queue_priority_t priority;
+    bool ordered;
     bool signal_kill;
 } dap_proc_queue_msg_t;
 
@@ -44,6 +48,7 @@ dap_proc_queue_t * dap_proc_queue_create(dap_proc_thread_t * a_thread)
 {
     dap_proc_queue_t * l_queue = DAP_NEW_Z(dap_proc_queue_t); if (!l_queue) return NULL;
     l_queue->proc_thread = a_thread;
+    pthread_mutex_init(&l_queue->items_mutex, NULL);
     l_queue->esocket = dap_events_socket_create_type_queue_ptr_unsafe(NULL,s_queue_esocket_callback);
     l_queue->esocket->proc_thread = a_thread;
     l_queue->esocket->_inheritor = l_queue;
@@ -73,28 +78,25 @@ static void s_queue_esocket_callback( dap_events_socket_t * a_es, void * a_msg)
     assert(l_msg);
     // We have callback to add in list
     if (l_msg->callback) {
-        dap_proc_queue_item_t * l_item = DAP_NEW_Z(dap_proc_queue_item_t);
-        if (! l_item){
+        pthread_mutex_lock(&l_queue->items_mutex);
+        dap_proc_queue_item_t * l_item = l_queue->items_free;
+        if (l_item) {
+            LL_DELETE(l_queue->items_free, l_item);
+            l_queue->items_free_count--;
+        }
+        pthread_mutex_unlock(&l_queue->items_mutex);
+        if (!l_item && !(l_item = DAP_NEW(dap_proc_queue_item_t))) {
             log_it(L_CRITICAL,"Can't allocate memory for callback item, exiting");
             DAP_DELETE(l_msg);
             return;
         }
-        l_item->callback = l_msg->callback;
-        l_item->callback_arg = l_msg->callback_arg;
-
-        if ( l_queue->item_last)
-            l_queue->item_last->prev = l_item;
-
-        l_item->next=l_queue->item_last ;
-        l_queue->item_last = l_item;
-
-        if( l_queue->item_first == NULL){
-            //log_it( L_DEBUG, "Added callback %p/%p in proc thread %u callback queue: first in list", l_msg->callback,l_msg->callback_arg, l_queue->proc_thread->cpu_id);
-            l_queue->item_first = l_item;
-        }//else
-        //    log_it( L_DEBUG, "Added callback %p/%p in proc thread %u callback queue: last in list", l_msg->callback,l_msg->callback_arg, l_queue->proc_thread->cpu_id);
-
-        // Add on top so after call this callback will be executed first
+        *l_item = (dap_proc_queue_item_t) {
+            .callback       = l_msg->callback,
+            .callback_arg   = l_msg->callback_arg,
+            .priority       = l_msg->priority < DAP_PROC_PRI_COUNT ? l_msg->priority : DAP_PROC_PRI_NORMAL,
+            .ordered        = l_msg->ordered
+        };
+        dap_proc_queue_item_push(l_queue, l_item);
         dap_events_socket_event_signal(l_queue->proc_thread->proc_event,1);
     }
     if (l_msg->signal_kill){ // Say to kill this object and delete its inherior dap_proc_queue_t
@@ -103,6 +105,88 @@ static void s_queue_esocket_callback( dap_events_socket_t * a_es, void * a_msg)
     DAP_DELETE(l_msg);
 }
 
+/**
+ * @brief dap_proc_queue_item_push Put item in the end of its priority list
+ * @param a_queue
+ * @param a_item
+ */
+void dap_proc_queue_item_push(dap_proc_queue_t *a_queue, dap_proc_queue_item_t *a_item)
+{
+    pthread_mutex_lock(&a_queue->items_mutex);
+    DL_APPEND(a_queue->items[a_item->priority], a_item);
+    a_queue->proc_thread->proc_queue_size++;
+    pthread_mutex_unlock(&a_queue->items_mutex);
+}
+
+/**
+ * @brief dap_proc_queue_item_pop Take the first item of priority list to call it, push it back if it's not finished
+ * @param a_queue
+ * @param a_priority
+ * @return Item or NULL if list is empty
+ */
+dap_proc_queue_item_t *dap_proc_queue_item_pop(dap_proc_queue_t *a_queue, dap_proc_queue_priority_t a_priority)
+{
+    pthread_mutex_lock(&a_queue->items_mutex);
+    dap_proc_queue_item_t *l_item = a_queue->items[a_priority];
+    if (l_item) {
+        DL_DELETE(a_queue->items[a_priority], l_item);
+        a_queue->proc_thread->proc_queue_size--;
+    }
+    pthread_mutex_unlock(&a_queue->items_mutex);
+    return l_item;
+}
+
+/**
+ * @brief dap_proc_queue_item_done Return finished item to the freelist
+ * @param a_queue
+ * @param a_item
+ */
+void dap_proc_queue_item_done(dap_proc_queue_t *a_queue, dap_proc_queue_item_t *a_item)
+{
+    pthread_mutex_lock(&a_queue->items_mutex);
+    if (a_queue->items_free_count < DAP_PROC_QUEUE_ITEMS_FREE_MAX) {
+        LL_PREPEND(a_queue->items_free, a_item);
+        a_queue->items_free_count++;
+        a_item = NULL;
+    }
+    pthread_mutex_unlock(&a_queue->items_mutex);
+    DAP_DEL_Z(a_item);
+}
+
+/**
+ * @brief dap_proc_queue_steal Move items never called before from the tails of one queue lists to another queue.
+ * Ordered items stay where they are, they must not overtake or run in parallel with the earlier items of their session
+ * @param a_queue_from
+ * @param a_queue_to
+ * @param a_count Maximum items to move, lower priorities are taken first
+ * @return Number of items moved
+ */
+size_t dap_proc_queue_steal(dap_proc_queue_t *a_queue_from, dap_proc_queue_t *a_queue_to, size_t a_count)
+{
+    dap_proc_queue_item_t *l_stolen = NULL, *l_item, *l_tmp;
+    size_t l_stolen_count = 0;
+    pthread_mutex_lock(&a_queue_from->items_mutex);
+    for (int i = DAP_PROC_PRI_LOW; i < DAP_PROC_PRI_COUNT && l_stolen_count < a_count; i++) {
+        for (l_item = a_queue_from->items[i] ? a_queue_from->items[i]->prev : NULL; l_item && l_stolen_count < a_count; l_item = l_tmp) {
+            l_tmp = l_item == a_queue_from->items[i] ? NULL : l_item->prev;
+            if (l_item->started || l_item->ordered)
+                continue;
+            DL_DELETE(a_queue_from->items[i], l_item);
+            DL_APPEND(l_stolen, l_item);
+            l_stolen_count++;
+        }
+    }
+    a_queue_from->proc_thread->proc_queue_size -= l_stolen_count;
+    pthread_mutex_unlock(&a_queue_from->items_mutex);
+    if (!l_stolen_count)
+        return 0;
+    DL_FOREACH_SAFE(l_stolen, l_item, l_tmp) {
+        DL_DELETE(l_stolen, l_item);
+        dap_proc_queue_item_push(a_queue_to, l_item);
+    }
+    return l_stolen_count;
+}
+
 /**
  * @brief dap_proc_queue_add_callback
  * @param a_worker
@@ -110,10 +194,26 @@ static void s_queue_esocket_callback( dap_events_socket_t * a_es, void * a_msg)
  * @param a_callback_arg
  */
 void dap_proc_queue_add_callback(dap_worker_t * a_worker,dap_proc_queue_callback_t a_callback, void * a_callback_arg)
+{
+    dap_proc_queue_add_callback_ext(a_worker, a_callback, a_callback_arg, DAP_PROC_PRI_NORMAL, false);
+}
+
+/**
+ * @brief dap_proc_queue_add_callback_ext
+ * @param a_worker
+ * @param a_callback
+ * @param a_callback_arg
+ * @param a_priority
+ * @param a_ordered Item is never stolen by other proc threads
+ */
+void dap_proc_queue_add_callback_ext(dap_worker_t * a_worker, dap_proc_queue_callback_t a_callback, void * a_callback_arg,
+                                     dap_proc_queue_priority_t a_priority, bool a_ordered)
 {
     dap_proc_queue_msg_t * l_msg = DAP_NEW_Z(dap_proc_queue_msg_t); if (!l_msg) return;
     l_msg->callback = a_callback;
     l_msg->callback_arg = a_callback_arg;
+    l_msg->priority = a_priority;
+    l_msg->ordered = a_ordered;
     dap_events_socket_queue_ptr_send( a_worker->proc_queue->esocket , l_msg );
 }
 
@@ -124,13 +224,27 @@ void dap_proc_queue_add_callback(dap_worker_t * a_worker,dap_proc_queue_callback
  * @param a_callback_arg
  */
 void dap_proc_queue_add_callback_inter( dap_events_socket_t * a_es_input, dap_proc_queue_callback_t a_callback, void * a_callback_arg)
+{
+    dap_proc_queue_add_callback_inter_ext(a_es_input, a_callback, a_callback_arg, DAP_PROC_PRI_NORMAL, false);
+}
+
+/**
+ * @brief dap_proc_queue_add_callback_inter_ext
+ * @param a_es_input
+ * @param a_callback
+ * @param a_callback_arg
+ * @param a_priority
+ * @param a_ordered Item is never stolen by other proc threads
+ */
+void dap_proc_queue_add_callback_inter_ext(dap_events_socket_t * a_es_input, dap_proc_queue_callback_t a_callback, void * a_callback_arg,
+                                           dap_proc_queue_priority_t a_priority, bool a_ordered)
 {
     dap_proc_queue_msg_t * l_msg = DAP_NEW_Z(dap_proc_queue_msg_t); if (!l_msg) return;
     l_msg->callback = a_callback;
     l_msg->callback_arg = a_callback_arg;
+    l_msg->priority = a_priority;
+    l_msg->ordered = a_ordered;
     //log_it( L_DEBUG, "Sent inter callback %p/%p to queue input", l_msg->callback,l_msg->callback_arg);
 
     dap_events_socket_queue_ptr_send_to_input( a_es_input , l_msg );
 }
-
-
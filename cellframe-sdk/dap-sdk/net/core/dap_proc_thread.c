@@ -55,11 +55,14 @@ typedef cpuset_t cpu_set_t; // Adopt BSD CPU setstructure to POSIX variant
 #include "dap_events.h"
 #include "dap_events_socket.h"
 #include "dap_proc_thread.h"
+#include "dap_timerfd.h"
 
 #define LOG_TAG "dap_proc_thread"
 
 static size_t s_threads_count = 0;
 static bool s_debug_reactor = false;
+static uint64_t s_time_slice_ms = 20; // Proc event callback gives control back to the thread loop after it
+static bool s_work_stealing = true;
 static dap_proc_thread_t * s_threads = NULL;
 static void * s_proc_thread_function(void * a_arg);
 static void s_event_exit_callback( dap_events_socket_t * a_es, uint64_t a_flags);
@@ -73,6 +76,8 @@ int dap_proc_thread_init(uint32_t a_threads_count){
     s_threads_count = a_threads_count ? a_threads_count : dap_get_cpu_count( );
     s_threads = DAP_NEW_Z_SIZE(dap_proc_thread_t, sizeof (dap_proc_thread_t)* s_threads_count);
     s_debug_reactor = g_config? dap_config_get_item_bool_default(g_config,"general","debug_reactor",false) : false;
+    s_time_slice_ms = g_config? dap_config_get_item_uint32_default(g_config,"general","proc_time_slice_ms",s_time_slice_ms) : s_time_slice_ms;
+    s_work_stealing = g_config? dap_config_get_item_bool_default(g_config,"general","proc_work_stealing",true) : true;
     for (size_t i = 0; i < s_threads_count; i++ ){
 
         s_threads[i].cpu_id = i;
@@ -143,8 +148,52 @@ dap_proc_thread_t * dap_proc_thread_get_auto()
 
 }
 
+static inline uint64_t s_now_ms()
+{
+    struct timespec l_ts;
+    clock_gettime(CLOCK_MONOTONIC, &l_ts);
+    return (uint64_t)l_ts.tv_sec * 1000 + l_ts.tv_nsec / 1000000;
+}
+
+/**
+ * @brief s_proc_thread_steal Take half of not started items from the most loaded proc thread
+ * @param a_thread
+ * @return Number of items taken
+ */
+static size_t s_proc_thread_steal(dap_proc_thread_t * a_thread)
+{
+    dap_proc_thread_t * l_victim = NULL;
+    unsigned l_size_max = 1;
+    for (size_t i = 0; i < s_threads_count; i++) {
+        unsigned l_size = s_threads[i].proc_queue_size;
+        if (&s_threads[i] != a_thread && s_threads[i].proc_queue && l_size > l_size_max) {
+            l_size_max = l_size;
+            l_victim = &s_threads[i];
+        }
+    }
+    size_t l_stolen = l_victim ? dap_proc_queue_steal(l_victim->proc_queue, a_thread->proc_queue, l_size_max / 2) : 0;
+    if (l_stolen && s_debug_reactor)
+        log_it(L_DEBUG, "Proc thread #%u took %zu items from proc thread #%u", a_thread->cpu_id, l_stolen, l_victim->cpu_id);
+    return l_stolen;
+}
+
+/**
+ * @brief s_proc_thread_wake_idle Wake up one proc thread having nothing to do to steal our items
+ * @param a_thread
+ */
+static void s_proc_thread_wake_idle(dap_proc_thread_t * a_thread)
+{
+    for (size_t i = 0; i < s_threads_count; i++) {
+        if (&s_threads[i] != a_thread && s_threads[i].proc_event && !s_threads[i].proc_queue_size) {
+            dap_events_socket_event_signal(s_threads[i].proc_event, 1);
+            return;
+        }
+    }
+}
+
 /**
- * @brief s_proc_event_callback
+ * @brief s_proc_event_callback Call queued items for one time slice, higher priorities first.
+ * Every priority with items gets at least one call per slice, so the low ones are slowed down but not starved
  * @param a_esocket
  * @param a_value
  */
@@ -154,48 +203,29 @@ static void s_proc_event_callback(dap_events_socket_t * a_esocket, uint64_t a_va
     if(s_debug_reactor)
         log_it(L_DEBUG, "--> Proc event callback start");
     dap_proc_thread_t * l_thread = (dap_proc_thread_t *) a_esocket->_inheritor;
-    dap_proc_queue_item_t * l_item = l_thread->proc_queue->item_first;
-    dap_proc_queue_item_t * l_item_old = NULL;
-    bool l_is_anybody_for_repeat=false;
-    while(l_item){
-        if(s_debug_reactor)
-            log_it(L_INFO, "Proc event callback: %p/%p", l_item->callback, l_item->callback_arg);
-        bool l_is_finished = l_item->callback(l_thread, l_item->callback_arg);
-        if (l_is_finished){
-            if ( l_item->prev ){
-                l_item->prev->next = l_item_old;
-            }
-            if(l_item_old){
-                l_item_old->prev = l_item->prev;
-
-                if ( ! l_item->prev ) { // We deleted tail
-                    l_thread->proc_queue->item_last = l_item_old;
-                }
-
-                DAP_DELETE(l_item);
-                l_item = l_item_old->prev;
-            }else{
-                l_thread->proc_queue->item_first = l_item->prev;
-                if ( l_item->prev){
-                    l_item->prev->next = NULL; // Prev if it was - now its NULL
-                }else
-                    l_thread->proc_queue->item_last = NULL; // NULL last item
-
-                DAP_DELETE(l_item);
-                l_item = l_thread->proc_queue->item_first;
-            }
-            if(s_debug_reactor)
-                log_it(L_DEBUG, "Proc event finished");
-        }else{
+    dap_proc_queue_t * l_queue = l_thread->proc_queue;
+    if (s_work_stealing && !l_thread->proc_queue_size)
+        s_proc_thread_steal(l_thread);
+    uint64_t l_deadline = s_now_ms() + s_time_slice_ms;
+    for (int l_priority = DAP_PROC_PRI_HIGH; l_priority >= DAP_PROC_PRI_LOW; l_priority--) {
+        for (bool l_first = true; l_first || s_now_ms() < l_deadline; l_first = false) {
+            dap_proc_queue_item_t * l_item = dap_proc_queue_item_pop(l_queue, l_priority);
+            if (!l_item)
+                break;
+            l_item->started = true;
             if(s_debug_reactor)
-                log_it(L_DEBUG, "Proc event not finished");
-            l_item_old = l_item;
-            l_item=l_item->prev;
+                log_it(L_INFO, "Proc event callback: %p/%p priority %d", l_item->callback, l_item->callback_arg, l_priority);
+            if (l_item->callback(l_thread, l_item->callback_arg))
+                dap_proc_queue_item_done(l_queue, l_item);
+            else
+                dap_proc_queue_item_push(l_queue, l_item);
         }
-        l_is_anybody_for_repeat = !l_is_finished;
     }
-    if(l_is_anybody_for_repeat) // Arm event if we have smth to proc again
-        dap_events_socket_event_signal(a_esocket,1);
+    if (l_thread->proc_queue_size) { // Arm event if we have smth to proc again
+        dap_events_socket_event_signal(a_esocket, 1);
+        if (s_work_stealing && l_thread->proc_queue_size > 1)
+            s_proc_thread_wake_idle(l_thread);
+    }
     if(s_debug_reactor)
         log_it(L_DEBUG, "<-- Proc event callback end");
 }
@@ -230,9 +260,10 @@ int dap_proc_thread_assign_esocket_unsafe(dap_proc_thread_t * a_thread, dap_even
         a_thread->esockets =DAP_REALLOC(a_thread->esockets, a_thread->poll_count_max * sizeof(*a_thread->esockets));
     }
 
-    a_thread->poll[a_thread->poll_count].fd = a_thread->proc_queue->esocket->fd;
-    a_thread->poll[a_thread->poll_count].events = a_thread->proc_queue->esocket->poll_base_flags;
-    a_thread->esockets[a_thread->poll_count] = a_thread->proc_queue->esocket;
+    a_esocket->poll_index = a_thread->poll_count;
+    a_thread->poll[a_thread->poll_count].fd = a_esocket->fd;
+    a_thread->poll[a_thread->poll_count].events = a_esocket->poll_base_flags;
+    a_thread->esockets[a_thread->poll_count] = a_esocket;
     a_thread->poll_count++;
 #elif defined (DAP_EVENTS_CAPS_KQUEUE)
 /*    u_short l_flags = a_esocket->kqueue_base_flags;
@@ -436,7 +467,7 @@ static void * s_proc_thread_function(void * a_arg)
 #ifdef DAP_OS_WINDOWS
 		errno = WSAGetLastError();    	
 #endif
-        log_it(L_CRITICAL, "Can't add proc queue %zu on epoll ctl, error %d", l_thread->proc_queue->esocket->socket, errno);
+        log_it(L_CRITICAL, "Can't add proc queue %"DAP_FORMAT_SOCKET" on epoll ctl, error %d", l_thread->proc_queue->esocket->socket, errno);
         return NULL;
     }
 
@@ -571,6 +602,12 @@ static void * s_proc_thread_function(void * a_arg)
 #error "Unimplemented poll events analog for this platform"
 #endif
 
+#ifdef DAP_OS_LINUX
+    l_thread->timer_wheel = dap_timerfd_wheel_new();
+    if (l_thread->timer_wheel)
+        dap_proc_thread_assign_esocket_unsafe(l_thread, l_thread->timer_wheel->esocket);
+#endif
+
     //We've started!
     pthread_mutex_lock(&l_thread->started_mutex);
     pthread_mutex_unlock(&l_thread->started_mutex);
@@ -618,7 +655,7 @@ static void * s_proc_thread_function(void * a_arg)
             l_cur = (dap_events_socket_t *) l_epoll_events[n].data.ptr;
             uint32_t l_cur_events = l_epoll_events[n].events;
             l_flag_hup = l_cur_events & EPOLLHUP;
-            l_flag_rdhup = l_cur_events & EPOLLHUP;
+            l_flag_rdhup = l_cur_events & EPOLLRDHUP;
             l_flag_write = l_cur_events & EPOLLOUT;
             l_flag_read = l_cur_events & EPOLLIN;
             l_flag_error = l_cur_events & EPOLLERR;
@@ -719,6 +756,13 @@ static void * s_proc_thread_function(void * a_arg)
                     case DESCRIPTOR_TYPE_EVENT:
                         dap_events_socket_event_proc_input_unsafe (l_cur);
                         break;
+#ifdef DAP_OS_LINUX
+                    case DESCRIPTOR_TYPE_TIMER:{
+                        uint64_t l_val;
+                        if (read(l_cur->fd, &l_val, sizeof(l_val)) == sizeof(l_val) && l_cur->callbacks.timer_callback)
+                            l_cur->callbacks.timer_callback(l_cur);
+                    } break;
+#endif
 
                     default:
                         log_it(L_ERROR, "Unprocessed descriptor type accepted in proc thread loop");
@@ -768,6 +812,9 @@ static void * s_proc_thread_function(void * a_arg)
 
                                     break;
                                 }
+                                #elif defined (DAP_EVENTS_CAPS_QUEUE_RING)
+                                    l_bytes_sent = dap_events_socket_queue_ptr_send_batch(l_cur, l_cur->buf_out,
+                                                                        l_cur->buf_out_size / sizeof(void *)) * sizeof(void *);
                                 #elif defined (DAP_EVENTS_CAPS_QUEUE_MQUEUE)
                                     char * l_ptr = (char *) l_cur->buf_out;
                                     void *l_ptr_in;
@@ -820,12 +867,9 @@ static void * s_proc_thread_function(void * a_arg)
                     l_errno = errno;
 
                     if(l_bytes_sent>0){
-                        l_cur->buf_out_size -= l_bytes_sent;
+                        dap_events_socket_shrink_buf_out(l_cur, l_bytes_sent);
                         //log_it(L_DEBUG,"Sent %zd bytes out, left %zd in buf out", l_bytes_sent, l_cur->buf_out);
-                        if (l_cur->buf_out_size ){ // Shrink output buffer
-
-                            memmove(l_cur->buf_out, l_cur->buf_out+l_bytes_sent, l_cur->buf_out_size );
-                        }else{
+                        if (!l_cur->buf_out_size ){
 #ifndef DAP_EVENTS_CAPS_KQUEUE
                             l_cur->flags ^= DAP_SOCK_READY_TO_WRITE;
                             dap_proc_thread_esocket_update_poll_flags(l_thread, l_cur);
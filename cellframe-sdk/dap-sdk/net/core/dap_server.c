@@ -304,8 +304,8 @@ static int s_server_run(dap_server_t * a_server, dap_events_socket_callbacks_t *
             // Prepare for multi thread listening
             l_es->ev_base_flags = EPOLLIN;
 #ifdef EPOLLEXCLUSIVE
-            // if we have poll exclusive
-            l_es->ev_base_flags |= EPOLLET | EPOLLEXCLUSIVE;
+            // if we have poll exclusive. Level-triggered, as only one connection is accepted per event
+            l_es->ev_base_flags |= EPOLLEXCLUSIVE;
 #endif
             l_es->_inheritor = a_server;
             pthread_mutex_lock(&a_server->started_mutex);
@@ -39,9 +39,206 @@
 #include "dap_worker.h"
 #include "dap_events_socket.h"
 #include "dap_timerfd.h"
+#include "utlist.h"
 
 #define LOG_TAG "dap_timerfd"
+
+#ifndef DAP_OS_LINUX
 static void s_es_callback_timer(struct dap_events_socket *a_event_sock);
+#else
+static void s_es_callback_wheel(struct dap_events_socket *a_event_sock);
+
+static inline uint64_t s_now_ms()
+{
+    struct timespec l_ts;
+    clock_gettime(CLOCK_MONOTONIC, &l_ts);
+    return (uint64_t)l_ts.tv_sec * 1000 + l_ts.tv_nsec / 1000000;
+}
+
+/**
+ * @brief dap_timerfd_wheel_new Create timing wheel with its timerfd esocket, not added anywhere yet
+ * @return
+ */
+dap_timerfd_wheel_t *dap_timerfd_wheel_new(void)
+{
+    int l_tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+    if (l_tfd == -1) {
+        log_it(L_ERROR, "Can't create timing wheel: timerfd_create() errno=%d", errno);
+        return NULL;
+    }
+    dap_timerfd_wheel_t *l_wheel = DAP_NEW_Z(dap_timerfd_wheel_t);
+    dap_events_socket_callbacks_t l_s_callbacks = { .timer_callback = s_es_callback_wheel };
+    l_wheel->esocket = dap_events_socket_wrap_no_add(dap_events_get_default(), l_tfd, &l_s_callbacks);
+    l_wheel->esocket->type = DESCRIPTOR_TYPE_TIMER;
+    l_wheel->esocket->_inheritor = l_wheel;
+    pthread_mutex_init(&l_wheel->mutex, NULL);
+    l_wheel->tick = s_now_ms();
+    return l_wheel;
+}
+
+/**
+ * @brief s_wheel_slot_find Find the first used slot from a_start, circularly
+ * @return Distance from a_start to it or -1 if level is empty
+ */
+static int s_wheel_slot_find(const uint64_t *a_used, unsigned a_start)
+{
+    const unsigned l_words = DAP_TIMERFD_WHEEL_SLOTS / 64;
+    for (unsigned i = 0; i <= l_words; i++) {
+        unsigned l_word = ((a_start >> 6) + i) % l_words;
+        uint64_t l_bits = a_used[l_word];
+        if (i == 0)
+            l_bits &= ~0ULL << (a_start & 63);
+        else if (i == l_words)
+            l_bits &= ~(~0ULL << (a_start & 63));
+        if (l_bits)
+            return (l_word * 64 + __builtin_ctzll(l_bits) - a_start) & (DAP_TIMERFD_WHEEL_SLOTS - 1);
+    }
+    return -1;
+}
+
+/**
+ * @brief s_wheel_next Find the nearest tick with timers to fire or to cascade down
+ * @return Tick or UINT64_MAX if wheel is empty
+ */
+static uint64_t s_wheel_next(dap_timerfd_wheel_t *a_wheel)
+{
+    uint64_t l_next = UINT64_MAX;
+    for (unsigned l = 0; l < DAP_TIMERFD_WHEEL_LEVELS; l++) {
+        uint64_t l_pos = a_wheel->tick >> (8 * l);
+        // Current slot of upper levels is already cascaded, it holds timers of the next round only
+        if (l)
+            l_pos++;
+        int l_dist = s_wheel_slot_find(a_wheel->slots_used[l], l_pos & (DAP_TIMERFD_WHEEL_SLOTS - 1));
+        if (l_dist < 0)
+            continue;
+        uint64_t l_tick = (l_pos + l_dist) << (8 * l);
+        if (l_tick < l_next)
+            l_next = l_tick;
+    }
+    return l_next;
+}
+
+static void s_wheel_insert(dap_timerfd_wheel_t *a_wheel, dap_timerfd_t *a_timerfd)
+{
+    if (a_timerfd->expire_ms < a_wheel->tick)
+        a_timerfd->expire_ms = a_wheel->tick;
+    uint64_t l_delta = a_timerfd->expire_ms - a_wheel->tick, l_expire = a_timerfd->expire_ms;
+    unsigned l_level = 0;
+    while (l_level < DAP_TIMERFD_WHEEL_LEVELS - 1 && l_delta >> (8 * (l_level + 1)))
+        l_level++;
+    if (l_delta >> (8 * DAP_TIMERFD_WHEEL_LEVELS)) // Out of the wheel range, will be cascaded again on its top
+        l_expire = a_wheel->tick + (1ULL << (8 * DAP_TIMERFD_WHEEL_LEVELS)) - 1;
+    unsigned l_idx = (l_expire >> (8 * l_level)) & (DAP_TIMERFD_WHEEL_SLOTS - 1);
+    a_timerfd->slot = &a_wheel->slots[l_level][l_idx];
+    DL_APPEND(*a_timerfd->slot, a_timerfd);
+    a_wheel->slots_used[l_level][l_idx >> 6] |= 1ULL << (l_idx & 63);
+}
+
+static void s_wheel_remove(dap_timerfd_wheel_t *a_wheel, dap_timerfd_t *a_timerfd)
+{
+    DL_DELETE(*a_timerfd->slot, a_timerfd);
+    if (!*a_timerfd->slot) {
+        size_t l_slot = a_timerfd->slot - &a_wheel->slots[0][0];
+        a_wheel->slots_used[l_slot / DAP_TIMERFD_WHEEL_SLOTS][(l_slot % DAP_TIMERFD_WHEEL_SLOTS) >> 6] &= ~(1ULL << (l_slot & 63));
+    }
+    a_timerfd->slot = NULL;
+}
+
+/**
+ * @brief s_wheel_detach Take the whole slot list out of wheel
+ */
+static dap_timerfd_t *s_wheel_detach(dap_timerfd_wheel_t *a_wheel, unsigned a_level, unsigned a_idx)
+{
+    dap_timerfd_t *l_list = a_wheel->slots[a_level][a_idx];
+    a_wheel->slots[a_level][a_idx] = NULL;
+    a_wheel->slots_used[a_level][a_idx >> 6] &= ~(1ULL << (a_idx & 63));
+    return l_list;
+}
+
+/**
+ * @brief s_wheel_arm Set timerfd on the nearest tick of the wheel. Call it with wheel locked
+ */
+static void s_wheel_arm(dap_timerfd_wheel_t *a_wheel)
+{
+    uint64_t l_next = s_wheel_next(a_wheel);
+    if (l_next == UINT64_MAX)
+        l_next = 0;
+    if (l_next == a_wheel->armed)
+        return;
+    struct itimerspec l_ts = { .it_value = { .tv_sec = l_next / 1000, .tv_nsec = (l_next % 1000) * 1000000 } };
+    if (timerfd_settime(a_wheel->esocket->fd, TFD_TIMER_ABSTIME, &l_ts, NULL) < 0)
+        log_it(L_WARNING, "Can't arm timing wheel: timerfd_settime() errno=%d", errno);
+    else
+        a_wheel->armed = l_next;
+}
+
+/**
+ * @brief s_wheel_add Put timer into the wheel with expiration after its timeout from now
+ */
+static void s_wheel_add(dap_timerfd_wheel_t *a_wheel, dap_timerfd_t *a_timerfd)
+{
+    pthread_mutex_lock(&a_wheel->mutex);
+    a_timerfd->wheel = a_wheel;
+    a_timerfd->expire_ms = s_now_ms() + a_timerfd->timeout_ms;
+    s_wheel_insert(a_wheel, a_timerfd);
+    s_wheel_arm(a_wheel);
+    pthread_mutex_unlock(&a_wheel->mutex);
+}
+
+/**
+ * @brief s_es_callback_wheel Advance the wheel up to now, firing expired timers with the lock released
+ * @param a_event_sock
+ */
+static void s_es_callback_wheel(struct dap_events_socket *a_event_sock)
+{
+    dap_timerfd_wheel_t *l_wheel = a_event_sock->_inheritor;
+    uint64_t l_now = s_now_ms();
+    pthread_mutex_lock(&l_wheel->mutex);
+    l_wheel->armed = 0;
+    while (l_wheel->tick <= l_now) {
+        uint64_t l_tick = s_wheel_next(l_wheel);
+        if (l_tick > l_now) {
+            l_wheel->tick = l_now + 1;
+            break;
+        }
+        l_wheel->tick = l_tick;
+        // Cascade upper levels whose slot starts on this tick, from the top down
+        for (unsigned l = DAP_TIMERFD_WHEEL_LEVELS - 1; l; l--) {
+            if (l_tick & ((1ULL << (8 * l)) - 1))
+                continue;
+            dap_timerfd_t *l_list = s_wheel_detach(l_wheel, l, (l_tick >> (8 * l)) & (DAP_TIMERFD_WHEEL_SLOTS - 1)),
+                    *l_timerfd, *l_tmp;
+            DL_FOREACH_SAFE(l_list, l_timerfd, l_tmp) {
+                DL_DELETE(l_list, l_timerfd);
+                s_wheel_insert(l_wheel, l_timerfd);
+            }
+        }
+        dap_timerfd_t *l_expired = s_wheel_detach(l_wheel, 0, l_tick & (DAP_TIMERFD_WHEEL_SLOTS - 1)), *l_timerfd, *l_tmp;
+        l_wheel->tick = l_tick + 1;
+        DL_FOREACH(l_expired, l_timerfd) {
+            l_timerfd->slot = NULL;
+            l_timerfd->running = true;
+        }
+        DL_FOREACH_SAFE(l_expired, l_timerfd, l_tmp) {
+            DL_DELETE(l_expired, l_timerfd);
+            bool l_repeat = false;
+            if (!l_timerfd->deleted) {
+                pthread_mutex_unlock(&l_wheel->mutex);
+                l_repeat = l_timerfd->callback && l_timerfd->callback(l_timerfd->callback_arg);
+                pthread_mutex_lock(&l_wheel->mutex);
+            }
+            l_timerfd->running = false;
+            if (l_repeat && !l_timerfd->deleted) {
+                l_timerfd->expire_ms = s_now_ms() + l_timerfd->timeout_ms;
+                s_wheel_insert(l_wheel, l_timerfd);
+            } else
+                DAP_DELETE(l_timerfd);
+        }
+    }
+    s_wheel_arm(l_wheel);
+    pthread_mutex_unlock(&l_wheel->mutex);
+}
+#endif
 
 #ifdef DAP_OS_WINDOWS
     static HANDLE hTimerQueue = NULL;
@@ -105,10 +302,17 @@ void __stdcall TimerRoutine(void* arg, BOOLEAN flag) {
  */
 dap_timerfd_t* dap_timerfd_start_on_worker(dap_worker_t * a_worker, uint64_t a_timeout_ms, dap_timerfd_callback_t a_callback, void *a_callback_arg)
 {
+#ifdef DAP_OS_LINUX
+    dap_timerfd_t* l_timerfd = a_worker && a_worker->timer_wheel ? dap_timerfd_create(a_timeout_ms, a_callback, a_callback_arg) : NULL;
+    if(l_timerfd){
+        l_timerfd->worker = a_worker;
+        s_wheel_add(a_worker->timer_wheel, l_timerfd);
+#else
     dap_timerfd_t* l_timerfd = dap_timerfd_create( a_timeout_ms, a_callback, a_callback_arg);
     if(l_timerfd){
         dap_worker_add_events_socket(l_timerfd->events_socket, a_worker);
         l_timerfd->worker = a_worker;
+#endif
         return l_timerfd;
     }else{
         log_it(L_CRITICAL,"Can't create timer");
@@ -126,7 +330,19 @@ dap_timerfd_t* dap_timerfd_start_on_worker(dap_worker_t * a_worker, uint64_t a_t
  */
 dap_timerfd_t* dap_timerfd_start_on_proc_thread(dap_proc_thread_t * a_proc_thread, uint64_t a_timeout_ms, dap_timerfd_callback_t a_callback, void *a_callback_arg)
 {
+#ifdef DAP_OS_LINUX
+    if (!a_proc_thread || !a_proc_thread->timer_wheel) {
+        log_it(L_CRITICAL, "Can't create timer, proc thread has no timing wheel");
+        return NULL;
+    }
+#endif
     dap_timerfd_t* l_timerfd = dap_timerfd_create( a_timeout_ms, a_callback, a_callback_arg);
+#ifdef DAP_OS_LINUX
+    if (l_timerfd) {
+        l_timerfd->proc_thread = a_proc_thread;
+        s_wheel_add(a_proc_thread->timer_wheel, l_timerfd);
+    }
+#endif
     return l_timerfd;
 }
 
@@ -139,6 +355,17 @@ dap_timerfd_t* dap_timerfd_start_on_proc_thread(dap_proc_thread_t * a_proc_threa
  */
 dap_timerfd_t* dap_timerfd_create(uint64_t a_timeout_ms, dap_timerfd_callback_t a_callback, void *a_callback_arg)
 {
+#ifdef DAP_OS_LINUX
+    // Timer lives in the wheel of thread it's started on, nothing to create here
+    dap_timerfd_t *l_timerfd = DAP_NEW_Z(dap_timerfd_t);
+    if(!l_timerfd)
+        return NULL;
+    l_timerfd->timeout_ms       = a_timeout_ms;
+    l_timerfd->callback         = a_callback;
+    l_timerfd->callback_arg     = a_callback_arg;
+    l_timerfd->tfd              = -1;
+    return l_timerfd;
+#else
     dap_timerfd_t *l_timerfd = DAP_NEW(dap_timerfd_t);
     if(!l_timerfd)
         return NULL;
@@ -160,28 +387,7 @@ dap_timerfd_t* dap_timerfd_create(uint64_t a_timeout_ms, dap_timerfd_callback_t
     l_timerfd->events_socket    = l_events_socket;
     l_timerfd->esocket_uuid = l_events_socket->uuid;
     
-#if defined DAP_OS_LINUX
-    struct itimerspec l_ts;
-    int l_tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
-    if(l_tfd == -1) {
-        log_it(L_WARNING, "dap_timerfd_start() failed: timerfd_create() errno=%d\n", errno);
-        DAP_DELETE(l_timerfd);
-        return NULL;
-    }
-    // repeat never
-    l_ts.it_interval.tv_sec = 0;
-    l_ts.it_interval.tv_nsec = 0;
-    // timeout for timer
-    l_ts.it_value.tv_sec = a_timeout_ms / 1000;
-    l_ts.it_value.tv_nsec = (a_timeout_ms % 1000) * 1000000;
-    if(timerfd_settime(l_tfd, 0, &l_ts, NULL) < 0) {
-        log_it(L_WARNING, "dap_timerfd_start() failed: timerfd_settime() errno=%d\n", errno);
-        close(l_tfd);
-        DAP_DELETE(l_timerfd);
-        return NULL;
-    }
-    l_events_socket->socket = l_tfd;
-#elif defined (DAP_OS_BSD)
+#if defined (DAP_OS_BSD)
     l_events_socket->kqueue_base_flags = EV_ONESHOT;
     l_events_socket->kqueue_base_filter = EVFILT_TIMER;
     l_events_socket->socket = arc4random();
@@ -246,29 +452,20 @@ dap_timerfd_t* dap_timerfd_create(uint64_t a_timeout_ms, dap_timerfd_callback_t
     l_events_socket->socket = l_tfd;
 #endif
     
-#if defined (DAP_OS_LINUX) || defined (DAP_OS_WINDOWS)    
+#if defined (DAP_OS_WINDOWS)
     l_timerfd->tfd              = l_tfd;
 #endif
 //#ifdef DAP_OS_WINDOWS
     //l_timerfd->th               = l_th;
 //#endif
     return l_timerfd;
+#endif
 }
 
+#ifndef DAP_OS_LINUX
 static void s_timerfd_reset(dap_timerfd_t *a_timerfd, dap_events_socket_t *a_event_sock)
 {
-#if defined DAP_OS_LINUX
-    struct itimerspec l_ts;
-    // repeat never
-    l_ts.it_interval.tv_sec = 0;
-    l_ts.it_interval.tv_nsec = 0;
-    // timeout for timer
-    l_ts.it_value.tv_sec = a_timerfd->timeout_ms / 1000;
-    l_ts.it_value.tv_nsec = (a_timerfd->timeout_ms % 1000) * 1000000;
-    if(timerfd_settime(a_timerfd->tfd, 0, &l_ts, NULL) < 0) {
-        log_it(L_WARNING, "Reset timerfd failed: timerfd_settime() errno=%d\n", errno);
-    }
-#elif defined (DAP_OS_BSD)
+#if defined (DAP_OS_BSD)
     dap_worker_add_events_socket_unsafe(a_event_sock,a_event_sock->worker);
 //struct kevent * l_event = &a_event_sock->kqueue_event;
 //EV_SET(l_event, 0, a_event_sock->kqueue_base_filter, a_event_sock->kqueue_base_flags,a_event_sock->kqueue_base_fflags,a_event_sock->kqueue_data,a_event_sock);
@@ -303,6 +500,7 @@ static void s_es_callback_timer(struct dap_events_socket *a_event_sock)
         l_timerfd->events_socket->flags |= DAP_SOCK_SIGNAL_CLOSE;
     }
 }
+#endif
 
 /**
  * @brief dap_timerfd_reset
@@ -312,6 +510,20 @@ void dap_timerfd_reset(dap_timerfd_t *a_timerfd)
 {
     if (!a_timerfd)
         return;
+#ifdef DAP_OS_LINUX
+    dap_timerfd_wheel_t *l_wheel = a_timerfd->wheel;
+    if (!l_wheel)
+        return;
+    pthread_mutex_lock(&l_wheel->mutex);
+    // Running timer will be rescheduled by its callback result
+    if (a_timerfd->slot) {
+        s_wheel_remove(l_wheel, a_timerfd);
+        a_timerfd->expire_ms = s_now_ms() + a_timerfd->timeout_ms;
+        s_wheel_insert(l_wheel, a_timerfd);
+        s_wheel_arm(l_wheel);
+    }
+    pthread_mutex_unlock(&l_wheel->mutex);
+#else
     dap_events_socket_t *l_sock = NULL;
     if (a_timerfd->worker)
         l_sock = dap_worker_esocket_find_uuid(a_timerfd->worker, a_timerfd->esocket_uuid);
@@ -319,6 +531,7 @@ void dap_timerfd_reset(dap_timerfd_t *a_timerfd)
         l_sock = a_timerfd->events_socket;
     if (l_sock)
         s_timerfd_reset(a_timerfd, l_sock);
+#endif
 }
 
 /**
@@ -327,10 +540,27 @@ void dap_timerfd_reset(dap_timerfd_t *a_timerfd)
  */
 void dap_timerfd_delete(dap_timerfd_t *a_timerfd)
 {
+#ifdef DAP_OS_LINUX
+    dap_timerfd_wheel_t *l_wheel = a_timerfd->wheel;
+    if (!l_wheel) {
+        DAP_DELETE(a_timerfd);
+        return;
+    }
+    pthread_mutex_lock(&l_wheel->mutex);
+    if (a_timerfd->running)
+        a_timerfd->deleted = true;
+    else {
+        if (a_timerfd->slot)
+            s_wheel_remove(l_wheel, a_timerfd);
+        DAP_DELETE(a_timerfd);
+    }
+    pthread_mutex_unlock(&l_wheel->mutex);
+#else
     #ifdef _WIN32
         DeleteTimerQueueTimer(hTimerQueue, (HANDLE)a_timerfd->th, NULL);
     #endif
 
     if (a_timerfd->events_socket->worker)
         dap_events_socket_remove_and_delete_mt(a_timerfd->events_socket->worker, a_timerfd->esocket_uuid);
+#endif
 }
@@ -53,6 +53,7 @@
 #include "dap_events.h"
 #include "dap_enc_base64.h"
 #include "dap_proc_queue.h"
+#include "dap_worker_uring.h"
 
 #ifndef DAP_NET_CLIENT_NO_SSL
 #include <wolfssl/options.h>
@@ -63,6 +64,9 @@
 
 static time_t s_connection_timeout = 60;    // seconds
 static bool s_debug_reactor=false;
+#ifdef DAP_EVENTS_CAPS_IO_URING
+static bool s_io_uring = true;
+#endif
 
 static bool s_socket_all_check_activity( void * a_arg);
 static void s_queue_add_es_callback( dap_events_socket_t * a_es, void * a_arg);
@@ -84,6 +88,9 @@ int dap_worker_init( size_t a_conn_timeout )
       s_connection_timeout = a_conn_timeout;
 
     s_debug_reactor = g_config? dap_config_get_item_bool_default(g_config,"general","debug_reactor",false) : false;
+#ifdef DAP_EVENTS_CAPS_IO_URING
+    s_io_uring = g_config? dap_config_get_item_bool_default(g_config,"general","io_uring",true) : true;
+#endif
 #ifdef DAP_OS_UNIX
     struct rlimit l_fdlimit;
     if (getrlimit(RLIMIT_NOFILE, &l_fdlimit))
@@ -126,8 +133,12 @@ void *dap_worker_thread(void *arg)
 #endif
 
 #ifdef DAP_EVENTS_CAPS_EPOLL
-    struct epoll_event l_epoll_events[ DAP_EVENTS_SOCKET_MAX]= {{0}};
+    l_worker->epoll_events = DAP_NEW_Z_SIZE(struct epoll_event, DAP_EVENTS_SOCKET_MAX * sizeof(struct epoll_event));
     log_it(L_INFO, "Worker #%d started with epoll fd %"DAP_FORMAT_HANDLE" and assigned to dedicated CPU unit", l_worker->id, l_worker->epoll_fd);
+#ifdef DAP_EVENTS_CAPS_IO_URING
+    if (s_io_uring && !(l_worker->uring = dap_worker_uring_new()))
+        log_it(L_WARNING, "Worker #%d does socket i/o without io_uring", l_worker->id);
+#endif
 #elif defined(DAP_EVENTS_CAPS_KQUEUE)
     l_worker->kqueue_fd = kqueue();
         if (l_worker->kqueue_fd == -1 ){
@@ -162,9 +173,17 @@ void *dap_worker_thread(void *arg)
     l_worker->queue_callback    = dap_events_socket_create_type_queue_ptr_unsafe(l_worker, s_queue_callback_callback);
     l_worker->event_exit        = dap_events_socket_create_type_event_unsafe(l_worker, s_event_exit_callback);
     
+#ifdef DAP_OS_LINUX
+    l_worker->timer_wheel = dap_timerfd_wheel_new();
+    if (l_worker->timer_wheel)
+        dap_worker_add_events_socket_unsafe(l_worker->timer_wheel->esocket, l_worker);
+    l_worker->timer_check_activity = dap_timerfd_start_on_worker(l_worker, s_connection_timeout * 1000 / 2,
+                                                                 s_socket_all_check_activity, l_worker);
+#else
     l_worker->timer_check_activity = dap_timerfd_create(s_connection_timeout * 1000 / 2,
                                                         s_socket_all_check_activity, l_worker);
     dap_worker_add_events_socket_unsafe(  l_worker->timer_check_activity->events_socket, l_worker);
+#endif
     pthread_mutex_lock(&l_worker->started_mutex);
     pthread_cond_broadcast(&l_worker->started_cond);
     pthread_mutex_unlock(&l_worker->started_mutex);
@@ -173,8 +192,15 @@ void *dap_worker_thread(void *arg)
 	int l_selected_sockets;
 	size_t l_sockets_max;
 #ifdef DAP_EVENTS_CAPS_EPOLL
-        l_selected_sockets = epoll_wait(l_worker->epoll_fd, l_epoll_events, DAP_EVENTS_SOCKET_MAX, -1);
+        l_worker->epoll_events_count = 0;
+        l_selected_sockets = epoll_wait(l_worker->epoll_fd, l_worker->epoll_events, DAP_EVENTS_SOCKET_MAX, -1);
         l_sockets_max = l_selected_sockets;
+        if (l_selected_sockets > 0)
+            l_worker->epoll_events_count = l_selected_sockets;
+#ifdef DAP_EVENTS_CAPS_IO_URING
+        if (l_worker->uring)
+            dap_worker_uring_recv_prefetch(l_worker->uring, l_worker->epoll_events, l_selected_sockets);
+#endif
 #elif defined(DAP_EVENTS_CAPS_POLL)
         l_selected_sockets = poll(l_worker->poll, l_worker->poll_count, -1);
         l_sockets_max = l_worker->poll_count;
@@ -204,8 +230,8 @@ void *dap_worker_thread(void *arg)
         for(size_t n = 0; n < l_sockets_max; n++) {
             bool l_flag_hup, l_flag_rdhup, l_flag_read, l_flag_write, l_flag_error, l_flag_nval, l_flag_msg, l_flag_pri;
 #ifdef DAP_EVENTS_CAPS_EPOLL
-            l_cur = (dap_events_socket_t *) l_epoll_events[n].data.ptr;
-            uint32_t l_cur_flags = l_epoll_events[n].events;
+            l_cur = (dap_events_socket_t *) l_worker->epoll_events[n].data.ptr;
+            uint32_t l_cur_flags = l_worker->epoll_events[n].events;
             l_flag_hup      = l_cur_flags & EPOLLHUP;
             l_flag_rdhup    = l_cur_flags & EPOLLRDHUP;
             l_flag_write    = l_cur_flags & EPOLLOUT;
@@ -278,6 +304,10 @@ void *dap_worker_thread(void *arg)
 
 #else
 #error "Unimplemented fetch esocket after poll"
+#endif
+#ifdef DAP_EVENTS_CAPS_EPOLL
+            if (!l_cur) // Removed while processing previous events of this selection
+                continue;
 #endif
             if(!l_cur || (l_cur->worker && l_cur->worker != l_worker)) {
                 log_it(L_WARNING, "dap_events_socket was destroyed earlier");
@@ -373,6 +403,7 @@ void *dap_worker_thread(void *arg)
             if(l_flag_read) {
 
                 //log_it(L_DEBUG, "Comes connection with type %d", l_cur->type);
+                dap_events_socket_buf_in_reserve_unsafe(l_cur);
                 if(l_cur->buf_in_size_max && l_cur->buf_in_size >= l_cur->buf_in_size_max ) {
                     log_it(L_WARNING, "Buffer is full when there is smth to read. Its dropped! esocket %p (%"DAP_FORMAT_SOCKET")", l_cur, l_cur->socket);
                     l_cur->buf_in_size = 0;
@@ -396,6 +427,10 @@ void *dap_worker_thread(void *arg)
                     case DESCRIPTOR_TYPE_SOCKET_LOCAL_CLIENT:
                     case DESCRIPTOR_TYPE_SOCKET_CLIENT:
                         l_must_read_smth = true;
+#ifdef DAP_EVENTS_CAPS_IO_URING
+                        if (l_worker->uring && dap_worker_uring_recv_result(l_worker->uring, n, l_cur, &l_bytes_read, &l_errno))
+                            break;
+#endif
                         l_bytes_read = recv(l_cur->fd, (char *) (l_cur->buf_in + l_cur->buf_in_size),
                                             l_cur->buf_in_size_max - l_cur->buf_in_size, 0);
 #ifdef DAP_OS_WINDOWS
@@ -451,7 +486,6 @@ void *dap_worker_thread(void *arg)
                                 }
                             }
 #else
-                            fcntl( l_remote_socket, F_SETFL, O_NONBLOCK);
                             int l_errno = errno;
                             if ( l_remote_socket == INVALID_SOCKET ){
                                 if( l_errno == EAGAIN || l_errno == EWOULDBLOCK){// Everything is good, we'll receive ACCEPT on next poll
@@ -463,6 +497,7 @@ void *dap_worker_thread(void *arg)
                                     break;
                                 }
                             }
+                            fcntl( l_remote_socket, F_SETFL, O_NONBLOCK);
 #endif
                             l_cur->callbacks.accept_callback(l_cur,l_remote_socket,&l_remote_addr);
                         }else
@@ -503,6 +538,8 @@ void *dap_worker_thread(void *arg)
                             l_cur->last_time_active = l_cur_time;
                         }
                         l_cur->buf_in_size += l_bytes_read;
+                        if (l_cur->buf_in_size == l_cur->buf_in_size_max)
+                            dap_events_socket_buf_in_reserve_unsafe(l_cur); // Read filled the buffer, let it grow for the next one
                         if(s_debug_reactor)
                             log_it(L_DEBUG, "Received %d bytes for fd %d ", l_bytes_read, l_cur->fd);
                         if(l_cur->callbacks.read_callback){
@@ -654,6 +691,11 @@ void *dap_worker_thread(void *arg)
 
                     switch (l_cur->type){
                         case DESCRIPTOR_TYPE_SOCKET_CLIENT: {
+#ifdef DAP_EVENTS_CAPS_IO_URING
+                            // Sent with the whole selection output after the loop
+                            if (l_worker->uring && dap_worker_uring_send_add(l_worker->uring, l_cur))
+                                break;
+#endif
                             l_bytes_sent = send(l_cur->socket, (const char *)l_cur->buf_out,
                                                 l_cur->buf_out_size, MSG_DONTWAIT | MSG_NOSIGNAL);
 #ifdef DAP_OS_WINDOWS
@@ -723,6 +765,14 @@ void *dap_worker_thread(void *arg)
                                      dap_events_socket_set_writable_unsafe(l_cur,false);
 
                                  }
+#elif defined (DAP_EVENTS_CAPS_QUEUE_RING)
+                                // Whole batch gathered by input goes at once
+                                l_bytes_sent = dap_events_socket_queue_ptr_send_batch(l_cur, l_cur->buf_out,
+                                                                    l_cur->buf_out_size / sizeof(void *)) * sizeof(void *);
+                                if (!l_bytes_sent) {
+                                    l_bytes_sent = -1;
+                                    l_errno = EAGAIN;
+                                }
 #elif defined (DAP_EVENTS_CAPS_QUEUE_MQUEUE)
                                 l_bytes_sent = mq_send(l_cur->mqd , (const char *)l_cur->buf_out,sizeof (void*),0);
                                 if(l_bytes_sent == 0)
@@ -790,10 +840,7 @@ void *dap_worker_thread(void *arg)
                         //log_it(L_DEBUG, "Output: %u from %u bytes are sent ", l_bytes_sent,l_cur->buf_out_size);
                         if (l_bytes_sent) {
                             if ( l_bytes_sent <= (ssize_t) l_cur->buf_out_size ){
-                                l_cur->buf_out_size -= l_bytes_sent;
-                                if (l_cur->buf_out_size ) {
-                                    memmove(l_cur->buf_out, &l_cur->buf_out[l_bytes_sent], l_cur->buf_out_size);
-                                }
+                                dap_events_socket_shrink_buf_out(l_cur, l_bytes_sent);
                             }else{
                                 log_it(L_ERROR, "Wrong bytes sent, %zd more then was in buffer %zd",l_bytes_sent, l_cur->buf_out_size);
                                 l_cur->buf_out_size = 0;
@@ -805,6 +852,7 @@ void *dap_worker_thread(void *arg)
             if (l_cur->buf_out_size) {
                 dap_events_socket_set_writable_unsafe(l_cur,true);
             }
+            dap_events_socket_buf_release_unsafe(l_cur);
 
             if (l_cur->flags & DAP_SOCK_SIGNAL_CLOSE)
             {
@@ -814,11 +862,11 @@ void *dap_worker_thread(void *arg)
                            l_cur->remote_addr_str ? l_cur->remote_addr_str : "", l_cur->socket, l_cur, l_cur->uuid,
                                l_cur->type, l_tn);
 
+#ifndef DAP_EVENTS_CAPS_EPOLL
+                    // epoll reports every descriptor once per wait and its selection is cleaned on remove
                     for(size_t nn=n+1; nn<l_sockets_max; nn++){ // Check for current selection if it has event duplication
                         dap_events_socket_t *l_es_selected = NULL;
-#ifdef DAP_EVENTS_CAPS_EPOLL
-                        l_es_selected = (dap_events_socket_t *) l_epoll_events[nn].data.ptr;
-#elif defined ( DAP_EVENTS_CAPS_POLL)
+#if defined ( DAP_EVENTS_CAPS_POLL)
                         l_es_selected = l_worker->poll_esocket[nn];
 #elif defined (DAP_EVENTS_CAPS_KQUEUE)
                         struct kevent * l_kevent_selected = &l_worker->kqueue_events_selected[n];
@@ -840,6 +888,7 @@ void *dap_worker_thread(void *arg)
                                   // Here we expect thats event duplicates goes together in it. If not - we lose some events between.
                         }
                     }
+#endif
                     //dap_events_socket_remove_and_delete_unsafe( l_cur, false);
                     dap_events_remove_and_delete_socket_unsafe(dap_events_get_default(), l_cur, false);
 #ifdef DAP_EVENTS_CAPS_KQUEUE
@@ -855,10 +904,18 @@ void *dap_worker_thread(void *arg)
 
             if( l_worker->signal_exit){
                 log_it(L_ATT,"Worker :%u finished", l_worker->id);
+#ifdef DAP_EVENTS_CAPS_IO_URING
+                dap_worker_uring_delete(l_worker->uring);
+                l_worker->uring = NULL;
+#endif
                 return NULL;
             }
 
         }
+#ifdef DAP_EVENTS_CAPS_IO_URING
+        if (l_worker->uring)
+            dap_worker_uring_send_flush(l_worker->uring);
+#endif
 #ifdef DAP_EVENTS_CAPS_POLL
         /***********************************************************/
         /* If the compress_array flag was turned on, we need       */
@@ -1180,7 +1237,7 @@ int dap_worker_add_events_socket_unsafe( dap_events_socket_t * a_esocket, dap_wo
         a_esocket->ev.events = a_esocket->ev_base_flags ;
         if(a_esocket->flags & DAP_SOCK_READY_TO_READ )
             a_esocket->ev.events |= EPOLLIN;
-        if(a_esocket->flags & DAP_SOCK_READY_TO_WRITE )
+        if( (a_esocket->flags & DAP_SOCK_READY_TO_WRITE) || (a_esocket->flags & DAP_SOCK_CONNECTING) )
             a_esocket->ev.events |= EPOLLOUT;
         a_esocket->ev.data.ptr = a_esocket;
         return epoll_ctl(a_worker->epoll_fd, EPOLL_CTL_ADD, a_esocket->socket, &a_esocket->ev);
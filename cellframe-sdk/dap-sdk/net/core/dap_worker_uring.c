@@ -0,0 +1,360 @@
+/*
+ * Authors:
+ * Dmitriy A. Gearasimov <gerasimov.dmitriy@demlabs.net>
+ * DeM Labs Ltd.   https://demlabs.net
+ * Copyright  (c) 2021
+ * All rights reserved.
+
+ This file is part of DAP SDK the open source project
+
+    DAP SDK is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    DAP SDK is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with any DAP SDK based project.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "dap_common.h"
+#include "dap_worker_uring.h"
+
+#ifdef DAP_EVENTS_CAPS_IO_URING
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#define LOG_TAG "dap_worker_uring"
+
+#define DAP_WORKER_URING_ENTRIES 256
+
+typedef void (*s_uring_complete_t)(dap_worker_uring_t *a_uring, uint64_t a_user_data, int32_t a_res);
+
+struct dap_worker_uring {
+    int fd;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned sq_entries;
+    struct io_uring_sqe *sqes;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_cqe *cqes;
+    void *sq_ring, *cq_ring;
+    size_t sq_ring_size, cq_ring_size, sqes_size;
+    unsigned queued;                // SQEs prepared since the last submit
+
+    // Reads of the current selection, by its index
+    dap_events_socket_t **recv_es;
+    int32_t *recv_res;
+    size_t recv_count;
+
+    // Writes queued while processing the current selection
+    dap_events_socket_t **send_es;
+    size_t send_count;
+};
+
+/**
+ * @brief s_uring_op_supported
+ * @param a_probe
+ * @param a_op
+ * @return
+ */
+static bool s_uring_op_supported(struct io_uring_probe *a_probe, uint8_t a_op)
+{
+    return a_op <= a_probe->last_op && (a_probe->ops[a_op].flags & IO_URING_OP_SUPPORTED);
+}
+
+/**
+ * @brief dap_worker_uring_new
+ * @return Ring or NULL if kernel has no io_uring with socket ops, worker does plain syscalls then
+ */
+dap_worker_uring_t *dap_worker_uring_new(void)
+{
+    struct io_uring_params l_params = { };
+    int l_fd = syscall(__NR_io_uring_setup, DAP_WORKER_URING_ENTRIES, &l_params);
+    if (l_fd < 0) {
+        log_it(L_INFO, "No io_uring available: \"%s\" (%d)", strerror(errno), errno);
+        return NULL;
+    }
+    size_t l_probe_size = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe *l_probe = DAP_NEW_Z_SIZE(struct io_uring_probe, l_probe_size);
+    bool l_supported = !syscall(__NR_io_uring_register, l_fd, IORING_REGISTER_PROBE, l_probe, 256)
+            && s_uring_op_supported(l_probe, IORING_OP_RECV) && s_uring_op_supported(l_probe, IORING_OP_SEND);
+    DAP_DELETE(l_probe);
+    if (!l_supported) {
+        log_it(L_INFO, "io_uring has no socket send and recv ops");
+        close(l_fd);
+        return NULL;
+    }
+    dap_worker_uring_t *l_uring = DAP_NEW_Z(dap_worker_uring_t);
+    l_uring->fd = l_fd;
+    l_uring->sq_ring_size = l_params.sq_off.array + l_params.sq_entries * sizeof(unsigned);
+    l_uring->cq_ring_size = l_params.cq_off.cqes + l_params.cq_entries * sizeof(struct io_uring_cqe);
+    if (l_params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (l_uring->cq_ring_size > l_uring->sq_ring_size)
+            l_uring->sq_ring_size = l_uring->cq_ring_size;
+        l_uring->cq_ring_size = l_uring->sq_ring_size;
+    }
+    l_uring->sq_ring = mmap(NULL, l_uring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                            l_fd, IORING_OFF_SQ_RING);
+    l_uring->cq_ring = l_params.features & IORING_FEAT_SINGLE_MMAP ? l_uring->sq_ring
+            : mmap(NULL, l_uring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, l_fd, IORING_OFF_CQ_RING);
+    l_uring->sqes_size = l_params.sq_entries * sizeof(struct io_uring_sqe);
+    l_uring->sqes = mmap(NULL, l_uring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         l_fd, IORING_OFF_SQES);
+    if (l_uring->sq_ring == MAP_FAILED || l_uring->cq_ring == MAP_FAILED || l_uring->sqes == MAP_FAILED) {
+        log_it(L_ERROR, "Can't map io_uring: \"%s\" (%d)", strerror(errno), errno);
+        dap_worker_uring_delete(l_uring);
+        return NULL;
+    }
+    uint8_t *l_sq = l_uring->sq_ring, *l_cq = l_uring->cq_ring;
+    l_uring->sq_head = (unsigned *)(l_sq + l_params.sq_off.head);
+    l_uring->sq_tail = (unsigned *)(l_sq + l_params.sq_off.tail);
+    l_uring->sq_mask = (unsigned *)(l_sq + l_params.sq_off.ring_mask);
+    l_uring->sq_array = (unsigned *)(l_sq + l_params.sq_off.array);
+    l_uring->sq_entries = l_params.sq_entries;
+    l_uring->cq_head = (unsigned *)(l_cq + l_params.cq_off.head);
+    l_uring->cq_tail = (unsigned *)(l_cq + l_params.cq_off.tail);
+    l_uring->cq_mask = (unsigned *)(l_cq + l_params.cq_off.ring_mask);
+    l_uring->cqes = (struct io_uring_cqe *)(l_cq + l_params.cq_off.cqes);
+
+    l_uring->recv_es = DAP_NEW_Z_SIZE(dap_events_socket_t *, DAP_EVENTS_SOCKET_MAX * sizeof(dap_events_socket_t *));
+    l_uring->recv_res = DAP_NEW_Z_SIZE(int32_t, DAP_EVENTS_SOCKET_MAX * sizeof(int32_t));
+    l_uring->send_es = DAP_NEW_Z_SIZE(dap_events_socket_t *, DAP_EVENTS_SOCKET_MAX * sizeof(dap_events_socket_t *));
+    return l_uring;
+}
+
+/**
+ * @brief dap_worker_uring_delete
+ * @param a_uring
+ */
+void dap_worker_uring_delete(dap_worker_uring_t *a_uring)
+{
+    if (!a_uring)
+        return;
+    if (a_uring->sqes && a_uring->sqes != MAP_FAILED)
+        munmap(a_uring->sqes, a_uring->sqes_size);
+    if (a_uring->cq_ring && a_uring->cq_ring != MAP_FAILED && a_uring->cq_ring != a_uring->sq_ring)
+        munmap(a_uring->cq_ring, a_uring->cq_ring_size);
+    if (a_uring->sq_ring && a_uring->sq_ring != MAP_FAILED)
+        munmap(a_uring->sq_ring, a_uring->sq_ring_size);
+    close(a_uring->fd);
+    DAP_DEL_Z(a_uring->recv_es);
+    DAP_DEL_Z(a_uring->recv_res);
+    DAP_DEL_Z(a_uring->send_es);
+    DAP_DELETE(a_uring);
+}
+
+/**
+ * @brief s_uring_run Submit prepared SQEs and process all their completions
+ * @param a_uring
+ * @param a_callback
+ */
+static void s_uring_run(dap_worker_uring_t *a_uring, s_uring_complete_t a_callback)
+{
+    unsigned l_to_submit = a_uring->queued, l_inflight = a_uring->queued;
+    a_uring->queued = 0;
+    while (l_inflight) {
+        int l_ret = syscall(__NR_io_uring_enter, a_uring->fd, l_to_submit, l_inflight, IORING_ENTER_GETEVENTS, NULL, 0);
+        if (l_ret < 0) {
+            if (errno == EINTR)
+                continue;
+            log_it(L_CRITICAL, "io_uring_enter() error \"%s\" (%d)", strerror(errno), errno);
+            abort();    // Submitted operations point into esockets, they can't be left behind
+        }
+        if (l_ret > (int)l_to_submit)
+            l_ret = l_to_submit;
+        l_to_submit -= l_ret;
+        unsigned l_head = *a_uring->cq_head, l_tail = __atomic_load_n(a_uring->cq_tail, __ATOMIC_ACQUIRE);
+        for ( ; l_head != l_tail; l_head++, l_inflight--) {
+            struct io_uring_cqe *l_cqe = &a_uring->cqes[l_head & *a_uring->cq_mask];
+            a_callback(a_uring, l_cqe->user_data, l_cqe->res);
+        }
+        __atomic_store_n(a_uring->cq_head, l_head, __ATOMIC_RELEASE);
+    }
+}
+
+/**
+ * @brief s_uring_sqe_get
+ * @param a_uring
+ * @param a_callback Completion callback for already prepared SQEs, if ring is full they are run
+ * @return
+ */
+static struct io_uring_sqe *s_uring_sqe_get(dap_worker_uring_t *a_uring, s_uring_complete_t a_callback)
+{
+    if (a_uring->queued == a_uring->sq_entries)
+        s_uring_run(a_uring, a_callback);
+    unsigned l_tail = *a_uring->sq_tail, l_index = l_tail & *a_uring->sq_mask;
+    struct io_uring_sqe *l_sqe = &a_uring->sqes[l_index];
+    memset(l_sqe, 0, sizeof(*l_sqe));
+    a_uring->sq_array[l_index] = l_index;
+    a_uring->queued++;
+    return l_sqe;
+}
+
+/**
+ * @brief s_uring_sqe_commit
+ * @param a_uring
+ */
+static inline void s_uring_sqe_commit(dap_worker_uring_t *a_uring)
+{
+    __atomic_store_n(a_uring->sq_tail, *a_uring->sq_tail + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief s_recv_complete
+ * @param a_uring
+ * @param a_user_data
+ * @param a_res
+ */
+static void s_recv_complete(dap_worker_uring_t *a_uring, uint64_t a_user_data, int32_t a_res)
+{
+    a_uring->recv_res[a_user_data] = a_res;
+}
+
+/**
+ * @brief dap_worker_uring_recv_prefetch Read all sockets with input in the selection
+ * @param a_uring
+ * @param a_events
+ * @param a_events_count
+ */
+void dap_worker_uring_recv_prefetch(dap_worker_uring_t *a_uring, struct epoll_event *a_events, int a_events_count)
+{
+    a_uring->recv_count = a_events_count > 0 ? a_events_count : 0;
+    for (size_t i = 0; i < a_uring->recv_count; i++) {
+        dap_events_socket_t *l_es = a_events[i].data.ptr;
+        a_uring->recv_es[i] = NULL;
+        // Hangups and errors are checked before read, leave them for the main loop
+        if (!l_es || !(a_events[i].events & EPOLLIN) || (a_events[i].events & (EPOLLHUP | EPOLLERR)))
+            continue;
+        if (l_es->type != DESCRIPTOR_TYPE_SOCKET_CLIENT && l_es->type != DESCRIPTOR_TYPE_SOCKET_LOCAL_CLIENT)
+            continue;
+        dap_events_socket_buf_in_reserve_unsafe(l_es);
+        if (!l_es->buf_in || l_es->buf_in_size >= l_es->buf_in_size_max)
+            continue;
+        struct io_uring_sqe *l_sqe = s_uring_sqe_get(a_uring, s_recv_complete);
+        l_sqe->opcode = IORING_OP_RECV;
+        l_sqe->fd = l_es->fd;
+        l_sqe->addr = (uintptr_t)(l_es->buf_in + l_es->buf_in_size);
+        l_sqe->len = l_es->buf_in_size_max - l_es->buf_in_size;
+        l_sqe->msg_flags = MSG_DONTWAIT;
+        l_sqe->user_data = i;
+        s_uring_sqe_commit(a_uring);
+        a_uring->recv_es[i] = l_es;
+    }
+    s_uring_run(a_uring, s_recv_complete);
+}
+
+/**
+ * @brief dap_worker_uring_recv_result Take the prefetched read result instead of recv() call
+ * @param a_uring
+ * @param a_index Index of esocket in the selection
+ * @param a_es
+ * @param a_bytes_read
+ * @param a_errno
+ * @return false if there was no read for this esocket
+ */
+bool dap_worker_uring_recv_result(dap_worker_uring_t *a_uring, size_t a_index, dap_events_socket_t *a_es,
+                                  int32_t *a_bytes_read, int *a_errno)
+{
+    if (a_index >= a_uring->recv_count || a_uring->recv_es[a_index] != a_es)
+        return false;
+    a_uring->recv_es[a_index] = NULL;
+    int32_t l_res = a_uring->recv_res[a_index];
+    *a_bytes_read = l_res < 0 ? -1 : l_res;
+    *a_errno = l_res < 0 ? -l_res : 0;
+    return true;
+}
+
+/**
+ * @brief dap_worker_uring_send_add Queue esocket output to be sent after the selection processing
+ * @param a_uring
+ * @param a_es
+ * @return false if there is no room, output should be sent right now then
+ */
+bool dap_worker_uring_send_add(dap_worker_uring_t *a_uring, dap_events_socket_t *a_es)
+{
+    if (a_uring->send_count == DAP_EVENTS_SOCKET_MAX)
+        return false;
+    a_uring->send_es[a_uring->send_count++] = a_es;
+    return true;
+}
+
+/**
+ * @brief s_send_complete
+ * @param a_uring
+ * @param a_user_data
+ * @param a_res
+ */
+static void s_send_complete(dap_worker_uring_t *a_uring, uint64_t a_user_data, int32_t a_res)
+{
+    dap_events_socket_t *l_es = a_uring->send_es[a_user_data];
+    if (a_res < 0) {
+        if (a_res != -EAGAIN) {
+            log_it(L_ERROR, "Some error occured in send(): %s (code %d)", strerror(-a_res), -a_res);
+            if (!l_es->no_close)
+                l_es->flags |= DAP_SOCK_SIGNAL_CLOSE;
+            l_es->buf_out_size = 0;
+        }
+    } else if ((size_t)a_res <= l_es->buf_out_size) {
+        dap_events_socket_shrink_buf_out(l_es, a_res);
+    } else {
+        log_it(L_ERROR, "Wrong bytes sent, %d more then was in buffer %zu", a_res, l_es->buf_out_size);
+        l_es->buf_out_size = 0;
+    }
+    // The rest and the close signal are processed on the next write event
+    if (l_es->buf_out_size || (l_es->flags & DAP_SOCK_SIGNAL_CLOSE))
+        dap_events_socket_set_writable_unsafe(l_es, true);
+    dap_events_socket_buf_release_unsafe(l_es);
+}
+
+/**
+ * @brief dap_worker_uring_send_flush Send output of all queued esockets
+ * @param a_uring
+ */
+void dap_worker_uring_send_flush(dap_worker_uring_t *a_uring)
+{
+    for (size_t i = 0; i < a_uring->send_count; i++) {
+        dap_events_socket_t *l_es = a_uring->send_es[i];
+        if (!l_es || !l_es->buf_out_size)
+            continue;
+        struct io_uring_sqe *l_sqe = s_uring_sqe_get(a_uring, s_send_complete);
+        l_sqe->opcode = IORING_OP_SEND;
+        l_sqe->fd = l_es->fd;
+        l_sqe->addr = (uintptr_t)l_es->buf_out;
+        l_sqe->len = l_es->buf_out_size;
+        l_sqe->msg_flags = MSG_DONTWAIT | MSG_NOSIGNAL;
+        l_sqe->user_data = i;
+        s_uring_sqe_commit(a_uring);
+    }
+    s_uring_run(a_uring, s_send_complete);
+    a_uring->send_count = 0;
+}
+
+/**
+ * @brief dap_worker_uring_forget Drop esocket removed from the worker out of current batches
+ * @param a_uring
+ * @param a_es
+ */
+void dap_worker_uring_forget(dap_worker_uring_t *a_uring, dap_events_socket_t *a_es)
+{
+    for (size_t i = 0; i < a_uring->recv_count; i++)
+        if (a_uring->recv_es[i] == a_es) {
+            // Data is already in the buffer, keep it for the new owner if esocket is reassigned
+            if (a_uring->recv_res[i] > 0)
+                a_es->buf_in_size += a_uring->recv_res[i];
+            a_uring->recv_es[i] = NULL;
+        }
+    for (size_t i = 0; i < a_uring->send_count; i++)
+        if (a_uring->send_es[i] == a_es)
+            a_uring->send_es[i] = NULL;
+}
+
+#endif
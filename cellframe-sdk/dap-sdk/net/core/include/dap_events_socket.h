@@ -51,11 +51,26 @@ typedef int SOCKET;
 #include <sys/eventfd.h>
 #include <unistd.h>
 #elif defined(DAP_OS_LINUX)
-    //#define DAP_EVENTS_CAPS_EPOLL
+    // Build with DAP_EVENTS_LINUX_POLL to get back poll() reactor
+    #ifdef DAP_EVENTS_LINUX_POLL
     #define DAP_EVENTS_CAPS_POLL
+    #else
+    #define DAP_EVENTS_CAPS_EPOLL
+    // Batched socket reads and writes over io_uring, switched off at runtime with general.io_uring=false
+    #if defined(__has_include) && !defined(DAP_EVENTS_NO_IO_URING)
+    #if __has_include(<linux/io_uring.h>)
+    #define DAP_EVENTS_CAPS_IO_URING
+    #endif
+    #endif
+    #endif
     #define DAP_EVENTS_CAPS_PIPE_POSIX
     //#define DAP_EVENTS_CAPS_QUEUE_PIPE2
+    // Build with DAP_EVENTS_LINUX_MQUEUE to get back POSIX message queues for pointer queues
+    #ifdef DAP_EVENTS_LINUX_MQUEUE
     #define DAP_EVENTS_CAPS_QUEUE_MQUEUE
+    #else
+    #define DAP_EVENTS_CAPS_QUEUE_RING
+    #endif
     #define DAP_EVENTS_CAPS_EVENT_EVENTFD
     #include <netinet/in.h>
     #include <sys/eventfd.h>
@@ -150,7 +165,10 @@ typedef struct dap_events_socket_callbacks {
 
 #define DAP_EVENTS_SOCKET_BUF       100000
 #define DAP_EVENTS_SOCKET_BUF_LIMIT 500000
+#define DAP_EVENTS_SOCKET_BUF_CLASSES   6                   // Size classes of pooled buffers, from 4 KB to DAP_EVENTS_SOCKET_BUF_LIMIT
+#define DAP_EVENTS_SOCKET_BUF_POOL_MAX  (4 * 1024 * 1024)   // Free bytes kept by worker for every size class
 #define DAP_QUEUE_MAX_MSGS          8
+#define DAP_QUEUE_RING_SIZE         1024                // Pointers in queue ring, power of 2
 
 typedef enum {
     DESCRIPTOR_TYPE_SOCKET_CLIENT = 0,
@@ -209,6 +227,7 @@ typedef struct dap_events_socket {
     // Flags. TODO  - rework in bool fields
     uint32_t  flags;
     bool no_close;
+    bool buf_pooled; // buf_in and buf_out are taken from the worker pool on demand and returned when drained
     atomic_bool is_initalized;
     bool was_reassigned; // Was reassigment at least once
 
@@ -218,7 +237,8 @@ typedef struct dap_events_socket {
         //uint8_t buf_in[DAP_EVENTS_SOCKET_BUF+1]; // Internal buffer for input data
         //char buf_in_str[DAP_EVENTS_SOCKET_BUF+1];
     byte_t  *buf_in;
-    size_t buf_in_size_max; //  size of alloced buffer
+    size_t buf_in_size_max; //  size of alloced buffer, counted from buf_in
+    size_t buf_in_offset; // Consumed bytes before buf_in, they are reused when buffer is drained or its end is reached
         //char    *buf_in_str;
     size_t buf_in_size; // size of data that is in the input buffer
 
@@ -227,8 +247,12 @@ typedef struct dap_events_socket {
     //byte_t buf_out[DAP_EVENTS_SOCKET_BUF+1]; // Internal buffer for output data
     byte_t *buf_out;
     size_t buf_out_size; // size of data that is in the output buffer
-    size_t buf_out_size_max; // max size of data
+    size_t buf_out_size_max; // max size of data, counted from buf_out
+    size_t buf_out_offset; // Sent bytes before buf_out, they are reused when buffer is drained or its end is reached
     dap_events_socket_t * pipe_out; // Pipe socket with data for output
+#ifdef DAP_EVENTS_CAPS_QUEUE_RING
+    struct dap_events_socket_queue_ring * queue_ring; // Shared by queue and its inputs, freed with the last of them
+#endif
 
     // Stored string representation
     //char hostaddr[1024]; // Address
@@ -326,6 +350,9 @@ dap_events_socket_t * dap_events_socket_create_type_pipe_mt(dap_worker_t * a_w,
 dap_events_socket_t * dap_events_socket_queue_ptr_create_input(dap_events_socket_t* a_es);
 int dap_events_socket_queue_ptr_send_to_input( dap_events_socket_t * a_es, void* a_arg);
 int dap_events_socket_queue_ptr_send( dap_events_socket_t * a_es, void* a_arg);
+#ifdef DAP_EVENTS_CAPS_QUEUE_RING
+size_t dap_events_socket_queue_ptr_send_batch(dap_events_socket_t *a_es, const void *a_ptrs, size_t a_count);
+#endif
 
 
 int dap_events_socket_event_signal( dap_events_socket_t * a_es, uint64_t a_value);
@@ -346,6 +373,10 @@ void dap_events_socket_reassign_between_workers_unsafe(dap_events_socket_t * a_e
 
 size_t dap_events_socket_pop_from_buf_in(dap_events_socket_t *sc, void * data, size_t data_size);
 
+void dap_events_socket_buf_in_reserve_unsafe(dap_events_socket_t *a_es);
+bool dap_events_socket_buf_out_reserve_unsafe(dap_events_socket_t *a_es, size_t a_size);
+void dap_events_socket_buf_release_unsafe(dap_events_socket_t *a_es);
+
 // Non-MT functions
 dap_events_socket_t * dap_worker_esocket_find_uuid(dap_worker_t * a_worker, dap_events_socket_uuid_t a_es_uuid);
 
@@ -356,6 +387,8 @@ void dap_events_socket_worker_poll_update_unsafe(dap_events_socket_t * a_esocket
 
 size_t dap_events_socket_write_unsafe(dap_events_socket_t *sc, const void * data, size_t data_size);
 size_t dap_events_socket_write_f_unsafe(dap_events_socket_t *sc, const char * format,...);
+void *dap_events_socket_write_reserve_unsafe(dap_events_socket_t *a_es, size_t a_size);
+void dap_events_socket_write_commit_unsafe(dap_events_socket_t *a_es, size_t a_size);
 
 // MT variants less
 void dap_events_socket_set_readable_mt(dap_worker_t * a_w, dap_events_socket_uuid_t a_es_uuid, bool a_is_ready);
@@ -378,6 +411,7 @@ void dap_events_socket_descriptor_close(dap_events_socket_t *a_socket);
 
 void dap_events_socket_remove_from_worker_unsafe( dap_events_socket_t *a_es, dap_worker_t * a_worker);
 void dap_events_socket_shrink_buf_in(dap_events_socket_t * cl, size_t shrink_size);
+void dap_events_socket_shrink_buf_out(dap_events_socket_t * a_es, size_t a_shrink_size);
 
 #ifdef DAP_OS_WINDOWS
 DAP_STATIC_INLINE int dap_recvfrom(SOCKET s, void* buf_in, size_t buf_size) {
@@ -29,9 +29,19 @@ typedef bool (*dap_proc_queue_callback_t)(dap_proc_thread_t*,void* ); // Callbac
                                                                       // we want to stop callback execution and
                                                                       // not to go on next loop
 
+typedef enum dap_proc_queue_priority {
+    DAP_PROC_PRI_LOW = 0,   // Long background jobs like GDB sync
+    DAP_PROC_PRI_NORMAL,
+    DAP_PROC_PRI_HIGH,
+    DAP_PROC_PRI_COUNT
+} dap_proc_queue_priority_t;
+
 typedef struct dap_proc_queue_item{
     dap_proc_queue_callback_t callback;
     void *callback_arg;
+    dap_proc_queue_priority_t priority;
+    bool started; // Was called at least once, such items are never stolen by other threads
+    bool ordered; // Must be called in the queue order with other items of its session, never stolen
     struct dap_proc_queue_item * next;
     struct dap_proc_queue_item * prev;
 } dap_proc_queue_item_t;
@@ -39,8 +49,10 @@ typedef struct dap_proc_queue_item{
 typedef struct dap_proc_queue{
     dap_proc_thread_t * proc_thread;
     dap_events_socket_t *esocket;
-    dap_proc_queue_item_t * item_last;
-    dap_proc_queue_item_t * item_first;
+    pthread_mutex_t items_mutex; // Items could be stolen by other proc threads
+    dap_proc_queue_item_t * items[DAP_PROC_PRI_COUNT]; // Round-robin lists by priority
+    dap_proc_queue_item_t * items_free; // Freelist of items
+    size_t items_free_count;
 } dap_proc_queue_t;
 
 dap_proc_queue_t * dap_proc_queue_create(dap_proc_thread_t * a_thread);
@@ -48,4 +60,12 @@ dap_proc_queue_t * dap_proc_queue_create(dap_proc_thread_t * a_thread);
 void dap_proc_queue_delete(dap_proc_queue_t * a_queue);
 void dap_proc_queue_add_callback(dap_worker_t * a_worker, dap_proc_queue_callback_t a_callback, void * a_callback_arg);
 void dap_proc_queue_add_callback_inter( dap_events_socket_t * a_es_input, dap_proc_queue_callback_t a_callback, void * a_callback_arg);
+void dap_proc_queue_add_callback_ext(dap_worker_t * a_worker, dap_proc_queue_callback_t a_callback, void * a_callback_arg,
+                                     dap_proc_queue_priority_t a_priority, bool a_ordered);
+void dap_proc_queue_add_callback_inter_ext(dap_events_socket_t * a_es_input, dap_proc_queue_callback_t a_callback, void * a_callback_arg,
+                                           dap_proc_queue_priority_t a_priority, bool a_ordered);
 
+dap_proc_queue_item_t *dap_proc_queue_item_pop(dap_proc_queue_t *a_queue, dap_proc_queue_priority_t a_priority);
+void dap_proc_queue_item_push(dap_proc_queue_t *a_queue, dap_proc_queue_item_t *a_item);
+void dap_proc_queue_item_done(dap_proc_queue_t *a_queue, dap_proc_queue_item_t *a_item);
+size_t dap_proc_queue_steal(dap_proc_queue_t *a_queue_from, dap_proc_queue_t *a_queue_to, size_t a_count);
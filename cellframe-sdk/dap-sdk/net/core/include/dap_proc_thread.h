@@ -47,6 +47,8 @@ typedef struct dap_proc_thread{
 
     dap_events_socket_t * event_exit;
 
+    dap_timerfd_wheel_t * timer_wheel; // Timers started on proc thread
+
 
 #ifdef DAP_EVENTS_CAPS_EPOLL
     EPOLL_HANDLE epoll_ctl;
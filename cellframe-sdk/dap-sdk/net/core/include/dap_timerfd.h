@@ -45,6 +45,12 @@
 typedef bool (*dap_timerfd_callback_t)(void* ); // Callback for timer. If return true,
                                                 // it will be called after next timeout
 
+#ifdef DAP_OS_LINUX
+#define DAP_TIMERFD_WHEEL_LEVELS    4   // Levels of 2^8 slots each cover timeouts up to 2^32 ms
+#define DAP_TIMERFD_WHEEL_SLOTS     256
+#endif
+typedef struct dap_timerfd_wheel dap_timerfd_wheel_t;
+
 typedef struct dap_timerfd {
     uint64_t timeout_ms;
 #ifdef DAP_OS_WINDOWS
@@ -59,12 +65,37 @@ typedef struct dap_timerfd {
     dap_events_socket_uuid_t esocket_uuid;
     dap_timerfd_callback_t callback;
     void *callback_arg;
+#ifdef DAP_OS_LINUX
+    dap_timerfd_wheel_t *wheel;     // Owner thread wheel, NULL if timer is not started
+    uint64_t expire_ms;             // Monotonic clock tick to fire on
+    struct dap_timerfd **slot;      // Wheel slot list the timer is linked in, NULL if it isn't
+    struct dap_timerfd *prev, *next;
+    bool running;                   // Callback is executing or about to be
+    bool deleted;                   // Deleted while running, free it after
+#endif
 #ifdef DAP_OS_WINDOWS
     HANDLE th;
     SOCKET pipe_in;
 #endif
 } dap_timerfd_t;
 
+#ifdef DAP_OS_LINUX
+/**
+ * Hierarchical timing wheel of a worker or proc thread. All its timers share one timerfd esocket,
+ * which is armed on the nearest tick having something to fire or cascade. Tick is one millisecond
+ */
+struct dap_timerfd_wheel {
+    dap_events_socket_t *esocket;
+    pthread_mutex_t mutex;          // Timers could be started, reset and deleted from any thread
+    uint64_t tick;                  // Next tick to process
+    uint64_t armed;                 // Tick the timerfd is set on, 0 if disarmed
+    dap_timerfd_t *slots[DAP_TIMERFD_WHEEL_LEVELS][DAP_TIMERFD_WHEEL_SLOTS];
+    uint64_t slots_used[DAP_TIMERFD_WHEEL_LEVELS][DAP_TIMERFD_WHEEL_SLOTS / 64];
+};
+
+dap_timerfd_wheel_t *dap_timerfd_wheel_new(void);
+#endif
+
 int dap_timerfd_init();
 dap_timerfd_t* dap_timerfd_create(uint64_t a_timeout_ms, dap_timerfd_callback_t a_callback, void *a_callback_arg);
 dap_timerfd_t* dap_timerfd_start(uint64_t a_timeout_ms, dap_timerfd_callback_t a_callback, void *callback_arg);
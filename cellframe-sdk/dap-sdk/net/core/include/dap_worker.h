@@ -29,7 +29,11 @@
 
 
 typedef struct dap_proc_queue dap_proc_queue_t;
+#ifdef DAP_EVENTS_CAPS_IO_URING
+typedef struct dap_worker_uring dap_worker_uring_t;
+#endif
 typedef struct dap_timerfd dap_timerfd_t;
+typedef struct dap_timerfd_wheel dap_timerfd_wheel_t;
 typedef struct dap_worker
 {
     uint32_t id;
@@ -61,13 +65,23 @@ typedef struct dap_worker
 
     dap_events_socket_t * queue_callback; // Queue for pure callback on worker
 
+    dap_timerfd_wheel_t * timer_wheel; // All timers started on worker, NULL where timers have own esockets
     dap_timerfd_t * timer_check_activity;
+
+    // Free esocket buffers by size class, linked through their first bytes. Used only from the worker thread
+    byte_t * buf_pool[DAP_EVENTS_SOCKET_BUF_CLASSES];
+    size_t buf_pool_count[DAP_EVENTS_SOCKET_BUF_CLASSES];
 #if defined DAP_EVENTS_CAPS_MSMQ
     HANDLE msmq_events[MAXIMUM_WAIT_OBJECTS];
 #endif
 
 #if defined DAP_EVENTS_CAPS_EPOLL
     EPOLL_HANDLE epoll_fd;
+    struct epoll_event * epoll_events; // Events selected by the last epoll_wait(), removed esockets are zeroed here
+    int epoll_events_count;
+#ifdef DAP_EVENTS_CAPS_IO_URING
+    dap_worker_uring_t * uring; // Batched socket i/o, NULL if io_uring is unavailable or switched off
+#endif
 #elif defined ( DAP_EVENTS_CAPS_POLL)
     int poll_fd;
     struct pollfd * poll;
@@ -0,0 +1,48 @@
+/*
+ * Authors:
+ * Dmitriy A. Gearasimov <gerasimov.dmitriy@demlabs.net>
+ * DeM Labs Ltd.   https://demlabs.net
+ * Copyright  (c) 2021
+ * All rights reserved.
+
+ This file is part of DAP SDK the open source project
+
+    DAP SDK is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    DAP SDK is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with any DAP SDK based project.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include "dap_events_socket.h"
+
+#ifdef DAP_EVENTS_CAPS_IO_URING
+
+typedef struct dap_worker_uring dap_worker_uring_t;
+
+/**
+ * Submission ring of the worker. Socket reads of one epoll selection are done before its processing
+ * and socket writes queued while processing it are flushed after, each batch with one syscall.
+ * Operations are non-blocking, so every batch is complete when the call returns
+ */
+dap_worker_uring_t *dap_worker_uring_new(void);
+void dap_worker_uring_delete(dap_worker_uring_t *a_uring);
+
+void dap_worker_uring_recv_prefetch(dap_worker_uring_t *a_uring, struct epoll_event *a_events, int a_events_count);
+bool dap_worker_uring_recv_result(dap_worker_uring_t *a_uring, size_t a_index, dap_events_socket_t *a_es,
+                                  int32_t *a_bytes_read, int *a_errno);
+
+bool dap_worker_uring_send_add(dap_worker_uring_t *a_uring, dap_events_socket_t *a_es);
+void dap_worker_uring_send_flush(dap_worker_uring_t *a_uring);
+
+void dap_worker_uring_forget(dap_worker_uring_t *a_uring, dap_events_socket_t *a_es);
+
+#endif
@@ -295,7 +295,12 @@ void dap_http_folder_data_write(dap_http_client_t * cl_ht, void * arg)
 {
     (void) arg;
     dap_http_file_t * cl_ht_file= DAP_HTTP_FILE(cl_ht);
-    cl_ht->esocket->buf_out_size=fread(cl_ht->esocket->buf_out, 1, cl_ht->esocket->buf_out_size_max + 1, cl_ht_file->fd);
+    if (!dap_events_socket_buf_out_reserve_unsafe(cl_ht->esocket, DAP_EVENTS_SOCKET_BUF)) {
+        log_it(L_ERROR, "Can't get output buffer to send file %s", cl_ht_file->local_path);
+        cl_ht->esocket->flags |= DAP_SOCK_SIGNAL_CLOSE;
+        return;
+    }
+    cl_ht->esocket->buf_out_size=fread(cl_ht->esocket->buf_out, 1, cl_ht->esocket->buf_out_size_max, cl_ht_file->fd);
     cl_ht_file->position+=cl_ht->esocket->buf_out_size;
     dap_events_socket_set_writable_unsafe(cl_ht->esocket, true);
 
@@ -52,6 +52,7 @@ struct dap_stream_session {
     time_t time_created;
 
     uint8_t enc_type;
+    uint8_t compress_type; // dap_stream_compress_type_t negotiated for the session
     int32_t protocol_version;
 
     char *service_key;// auth string
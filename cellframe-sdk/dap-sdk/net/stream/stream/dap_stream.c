@@ -46,6 +46,7 @@
 #include "dap_stream_ch_proc.h"
 #include "dap_stream_ch_pkt.h"
 #include "dap_stream_session.h"
+#include "dap_stream_compress.h"
 #include "dap_events_socket.h"
 
 #include "dap_http.h"
@@ -55,9 +56,15 @@
 #include "dap_client_pvt.h"
 
 #define LOG_TAG "dap_stream"
-#define HEADER_WITH_SIZE_FIELD 12  //This count of bytes enough for allocate memory for stream packet
+#define DAP_STREAM_PKT_BATCH_MAX 64 // Channel packets passed to channels at once
 
-static void s_stream_proc_pkt_in(dap_stream_t * a_stream);
+typedef struct stream_pkt_batch {
+    dap_stream_ch_pkt_t *pkts[DAP_STREAM_PKT_BATCH_MAX];
+    size_t count;
+    size_t arena_used; // Bytes of stream pkt_cache used by packets those can't be decrypted in place
+} stream_pkt_batch_t;
+
+static void s_stream_proc_pkt_in(dap_stream_t * a_stream, dap_stream_pkt_t *a_pkt, stream_pkt_batch_t *a_batch);
 
 // Callbacks for HTTP client
 static void s_http_client_headers_read(dap_http_client_t * a_http_client, void * a_arg); // Prepare stream when all headers are read
@@ -89,7 +96,7 @@ static bool s_debug = false;
 
 bool dap_stream_get_dump_packet_headers(){ return  s_dump_packet_headers; }
 
-static bool s_detect_loose_packet(dap_stream_t * a_stream);
+static bool s_detect_loose_packet(dap_stream_t * a_stream, dap_stream_ch_pkt_t *a_ch_pkt);
 
 dap_enc_key_type_t s_stream_get_preferred_encryption_type = DAP_ENC_KEY_TYPE_IAES;
 
@@ -126,6 +133,7 @@ int dap_stream_init(dap_config_t * a_config)
     s_dap_stream_load_preferred_encryption_type(a_config);
     s_dump_packet_headers = dap_config_get_item_bool_default(g_config,"general","debug_dump_stream_headers",false);
     s_debug = dap_config_get_item_bool_default(g_config,"stream","debug",false);
+    dap_stream_compress_init(a_config);
     log_it(L_NOTICE,"Init streaming module");
 
     return 0;
@@ -136,6 +144,7 @@ int dap_stream_init(dap_config_t * a_config)
  */
 void dap_stream_deinit()
 {
+    dap_stream_compress_deinit();
     dap_stream_ch_deinit( );
 }
 
@@ -613,231 +622,104 @@ void dap_stream_set_ready_to_write(dap_stream_t * a_stream,bool a_is_ready)
 }
 
 /**
- * @brief dap_stream_data_proc_read
+ * @brief s_stream_batch_flush Pass decrypted channel packets of the batch to their channels
  * @param a_stream
- * @return
+ * @param a_batch
  */
-size_t dap_stream_data_proc_read (dap_stream_t *a_stream)
+static void s_stream_batch_flush(dap_stream_t *a_stream, stream_pkt_batch_t *a_batch)
 {
-    bool found_sig=false;
-    dap_stream_pkt_t * pkt=NULL;
-
-    if (!a_stream || !a_stream->esocket)
-        return 0;
-
-    char *l_buf_in = (char*)a_stream->esocket->buf_in ;
-    size_t buf_in_size = a_stream->esocket->buf_in_size ;
-    byte_t *proc_data = (byte_t *)l_buf_in;//a_stream->conn->buf_in;
-    bool proc_data_defrag=false; // We are or not in defrag buffer
-    size_t read_bytes_to=0;
-    size_t bytes_left_to_read = buf_in_size;//a_stream->conn->buf_in_size;
-    // Process prebuffered packets or glue defragmented data with the current input
-
-    pkt = a_stream->pkt_buf_in;
-
-    if ( pkt ) { // Packet signature detected
-        if(a_stream->pkt_buf_in_data_size < sizeof(dap_stream_pkt_hdr_t))
-        {
-            //At first read header
-            dap_stream_pkt_t* check_pkt = dap_stream_pkt_detect( proc_data , sizeof(dap_stream_pkt_hdr_t) - a_stream->pkt_buf_in_data_size);
-            if(check_pkt){
-                // Got duplication of packet header several times
-                log_it(L_DEBUG, "Drop incorrect header part");
-                a_stream->pkt_buf_in = NULL;
-                a_stream->pkt_buf_in_data_size=0;
-                return 0;
-            }
-            if(sizeof(dap_stream_pkt_hdr_t) - a_stream->pkt_buf_in_data_size > bytes_left_to_read)
-                read_bytes_to = bytes_left_to_read;
-            else
-                read_bytes_to = sizeof(dap_stream_pkt_hdr_t) - a_stream->pkt_buf_in_data_size;
-            memcpy((uint8_t*)a_stream->pkt_buf_in+a_stream->pkt_buf_in_data_size,proc_data,read_bytes_to);
-            bytes_left_to_read-=read_bytes_to;
-            a_stream->pkt_buf_in_data_size += read_bytes_to;
-            proc_data += read_bytes_to;
-            read_bytes_to = 0;
-        }
-
-        if  ((pkt->hdr.size + sizeof(dap_stream_pkt_hdr_t) -a_stream->pkt_buf_in_data_size) < bytes_left_to_read ) { // Looks the all packet is present in buffer
-            read_bytes_to=(a_stream->pkt_buf_in->hdr.size + sizeof(dap_stream_pkt_hdr_t) -a_stream->pkt_buf_in_data_size);
-        }else{
-            read_bytes_to=bytes_left_to_read;
-        }
-        if (a_stream->pkt_buf_in_data_size + read_bytes_to > a_stream->pkt_buf_in_size_expected) {
-            a_stream->pkt_buf_in_size_expected = a_stream->pkt_buf_in_data_size + read_bytes_to;
-            a_stream->pkt_buf_in = (dap_stream_pkt_t *)DAP_REALLOC(a_stream->pkt_buf_in, a_stream->pkt_buf_in_size_expected);
-        }
-        memcpy((uint8_t*)a_stream->pkt_buf_in+a_stream->pkt_buf_in_data_size,proc_data,read_bytes_to);
-        a_stream->pkt_buf_in_data_size+=read_bytes_to;
-        bytes_left_to_read-=read_bytes_to;
-        //log_it(L_DEBUG, "Prefilled packet buffer on %u bytes", read_bytes_to);
-        read_bytes_to=0;
-        if(a_stream->pkt_buf_in_data_size>=(a_stream->pkt_buf_in->hdr.size + sizeof(dap_stream_pkt_hdr_t)) ){ // If we have all the packet in packet buffer
-            if(a_stream->pkt_buf_in_data_size > a_stream->pkt_buf_in->hdr.size + sizeof(dap_stream_pkt_hdr_t)){ // If we have little more data then we need for packet buffer
-                log_it(L_WARNING,"Prefilled packet buffer has %zu bytes more than we need, it's lost",a_stream->pkt_buf_in_data_size-a_stream->pkt_buf_in->hdr.size);
-                DAP_DEL_Z(a_stream->pkt_buf_in);
-                a_stream->pkt_buf_in_data_size = 0;
-            }
-            else{
-                s_stream_proc_pkt_in(a_stream);
-            }
-        }
-        proc_data = (uint8_t *)(l_buf_in + buf_in_size - bytes_left_to_read);//proc_data=(a_stream->conn->buf_in + a_stream->conn->buf_in_size - bytes_left_to_read);
-
-    }else if( a_stream->buf_defrag_size>0){ // If smth is present in defrag buffer - we glue everything together in it
-        if( bytes_left_to_read  > 0){ // If there is smth to process in input buffer
-            read_bytes_to=bytes_left_to_read;
-            if( (read_bytes_to + a_stream->buf_defrag_size) > sizeof(a_stream->buf_defrag)   ){
-                //log_it(L_WARNING,"Defrag buffer is overfilled, drop that" );
-                if(read_bytes_to>sizeof(a_stream->buf_defrag))
-                    read_bytes_to=sizeof(a_stream->buf_defrag);
-                a_stream->buf_defrag_size=0;
-            }
-            //log_it(L_DEBUG,"Glue together defrag %u bytes and current %u bytes", a_stream->buf_defrag_size, read_bytes_to);
-            memcpy(a_stream->buf_defrag+a_stream->buf_defrag_size,proc_data,read_bytes_to );
-            bytes_left_to_read=a_stream->buf_defrag_size+read_bytes_to; // Then we have to read em all
-            read_bytes_to=0;
-        }else{
-            bytes_left_to_read=a_stream->buf_defrag_size;
-            //log_it(L_DEBUG,"Nothing to glue with defrag buffer, going to process just that (%u bytes)", bytes_left_to_read);
-        }
-        //log_it(L_WARNING,"Switch to defrag buffer");
-        proc_data=a_stream->buf_defrag;
-        proc_data_defrag=true;
-    }//else
-     //   log_it(DEBUG,"No prefill or defrag buffer, process directly buf_in");
-    // Now lets see how many packets we have in buffer now
-    while ( (pkt = dap_stream_pkt_detect( proc_data , bytes_left_to_read)) ){
-        if(pkt->hdr.size > STREAM_PKT_SIZE_MAX ){
-            //log_it(L_ERROR, "stream_pkt_detect() Too big packet size %u",
-            //       pkt->hdr.size);
-            bytes_left_to_read=0;
-            break;
-        }
-
-        size_t pkt_offset=( ((uint8_t*)pkt)- proc_data );
-        bytes_left_to_read -= pkt_offset ;
-        found_sig=true;
-
-        //dap_stream_pkt_t *temp_pkt = dap_stream_pkt_detect( (uint8_t*)pkt + 1 ,pkt->hdr.size+sizeof(stream_pkt_hdr_t) );
-        size_t l_pkt_size = pkt->hdr.size + sizeof(dap_stream_pkt_hdr_t);
-        if(bytes_left_to_read >= sizeof (dap_stream_pkt_t)){
-            if (bytes_left_to_read < l_pkt_size) { // Is all the packet in da buf?
-                read_bytes_to=bytes_left_to_read;
-            }else{
-                read_bytes_to = l_pkt_size;
+    dap_stream_ch_t *l_ch = NULL;
+    for (size_t i = 0; i < a_batch->count; i++) {
+        dap_stream_ch_pkt_t *l_ch_pkt = a_batch->pkts[i];
+        s_detect_loose_packet(a_stream, l_ch_pkt);
+
+        // Find channel, small packets of one channel usually go in a row
+        if (!l_ch || !l_ch->proc || l_ch->proc->id != l_ch_pkt->hdr.id) {
+            l_ch = NULL;
+            for (size_t j = 0; j < a_stream->channel_count; j++) {
+                if (a_stream->channel[j]->proc && a_stream->channel[j]->proc->id == l_ch_pkt->hdr.id) {
+                    l_ch = a_stream->channel[j];
+                    break;
+                }
             }
         }
 
-        //log_it(L_DEBUG, "Detected packet signature pkt->hdr.size=%u read_bytes_to=%u bytes_left_to_read=%u pkt_offset=%u"
-        //      ,pkt->hdr.size, read_bytes_to, bytes_left_to_read,pkt_offset);
-        if(read_bytes_to > HEADER_WITH_SIZE_FIELD){ // If we have size field, we can allocate memory
-            a_stream->pkt_buf_in_size_expected = l_pkt_size;
-            a_stream->pkt_buf_in = DAP_NEW_SIZE(struct dap_stream_pkt, l_pkt_size);
-            if (read_bytes_to > l_pkt_size) {
-                //log_it(L_WARNING,"For some strange reasons we have read_bytes_to=%u is bigger than expected pkt length(%u bytes). Dropped %u bytes",
-                //       pkt->hdr.size+sizeof(stream_pkt_hdr_t),read_bytes_to- pkt->hdr.size+sizeof(stream_pkt_hdr_t));
-                read_bytes_to = l_pkt_size;
-            }
-            if(read_bytes_to>bytes_left_to_read){
-                //log_it(L_WARNING,"For some strange reasons we have read_bytes_to=%u is bigger that's left in input buffer (%u bytes). Dropped %u bytes",
-                //       read_bytes_to,bytes_left_to_read);
-                read_bytes_to=bytes_left_to_read;
-            }
-            memcpy(a_stream->pkt_buf_in,pkt,read_bytes_to);
-            proc_data+=(read_bytes_to + pkt_offset);
-            bytes_left_to_read-=read_bytes_to;
-            a_stream->pkt_buf_in_data_size=(read_bytes_to);
-            if(a_stream->pkt_buf_in_data_size==l_pkt_size){
-            //    log_it(INFO,"All the packet is present in da buffer (hdr.size=%u read_bytes_to=%u buf_in_size=%u)"
-            //           ,sid->pkt_buf_in->hdr.size,read_bytes_to,sid->conn->buf_in_size);
-                s_stream_proc_pkt_in(a_stream);
-            }else if(a_stream->pkt_buf_in_data_size>l_pkt_size){
-                //log_it(L_WARNING,"Input: packet buffer has %u bytes more than we need, they're lost",a_stream->pkt_buf_in_data_size-pkt->hdr.size);
-            }else{
-                //log_it(L_DEBUG,"Input: Not all stream packet in input (hdr.size=%u read_bytes_to=%u)",a_stream->pkt_buf_in->hdr.size,read_bytes_to);
+        if(l_ch){
+            l_ch->stat.bytes_read+=l_ch_pkt->hdr.size;
+            if(l_ch->proc && l_ch->proc->packet_in_callback){
+                if ( s_dump_packet_headers ){
+                    log_it(L_INFO,"Income channel packet: id='%c' size=%u type=0x%02X seq_id=0x%016"DAP_UINT64_FORMAT_X" enc_type=0x%02X",(char) l_ch_pkt->hdr.id,
+                        l_ch_pkt->hdr.size, l_ch_pkt->hdr.type, l_ch_pkt->hdr.seq_id , l_ch_pkt->hdr.enc_type);
+                }
+                l_ch->proc->packet_in_callback(l_ch,l_ch_pkt);
             }
-        }else{
-            break;
-        }
-    }
-    /*if(!found_sig){
-        log_it(L_DEBUG,"Input: Not found signature in the incomming data ( client->buf_in_size = %u   *ret = %u )",
-               sh->client->buf_in_size, *ret);
-    }*/
-    if(bytes_left_to_read>0){
-        if(proc_data_defrag){
-            memmove(a_stream->buf_defrag, proc_data, bytes_left_to_read);
-            a_stream->buf_defrag_size=bytes_left_to_read;
-            //log_it(L_INFO,"Fragment of %u bytes shifted in the begining the defrag buffer",bytes_left_to_read);
-        }else{
-            memcpy(a_stream->buf_defrag, proc_data, bytes_left_to_read);
-            a_stream->buf_defrag_size=bytes_left_to_read;
-            //log_it(L_INFO,"Fragment of %u bytes stored in defrag buffer",bytes_left_to_read);
+        } else{
+            log_it(L_WARNING, "Input: unprocessed channel packet id '%c'",(char) l_ch_pkt->hdr.id );
         }
-    }else if(proc_data_defrag){
-        a_stream->buf_defrag_size=0;
     }
-
-    return buf_in_size;//a_stream->conn->buf_in_size;
+    a_batch->count = 0;
+    a_batch->arena_used = 0;
 }
 
 /**
- * @brief stream_proc_pkt_in
- * @param sid
+ * @brief s_stream_proc_pkt_in Process one complete stream packet
+ * @details Data packets are decrypted and collected into the batch, others are processed at once
+ * after the batch collected before them
+ * @param a_stream
+ * @param a_pkt
+ * @param a_batch
  */
-static void s_stream_proc_pkt_in(dap_stream_t * a_stream)
+static void s_stream_proc_pkt_in(dap_stream_t * a_stream, dap_stream_pkt_t *a_pkt, stream_pkt_batch_t *a_batch)
 {
     a_stream->is_active = true;
-    dap_stream_pkt_t * l_pkt = a_stream->pkt_buf_in;
-    size_t l_pkt_size = a_stream->pkt_buf_in_data_size;
-    a_stream->pkt_buf_in=NULL;
-    a_stream->pkt_buf_in_data_size=0;
-
-    switch (l_pkt->hdr.type) {
-    case STREAM_PKT_TYPE_DATA_PACKET: {
-        dap_stream_ch_pkt_t * l_ch_pkt = (dap_stream_ch_pkt_t *) a_stream->pkt_cache;
-
-        size_t l_dec_pkt_size = dap_stream_pkt_read_unsafe(a_stream, l_pkt, l_ch_pkt, sizeof(a_stream->pkt_cache));
+    if (a_pkt->hdr.type != STREAM_PKT_TYPE_DATA_PACKET && a_pkt->hdr.type != STREAM_PKT_TYPE_DATA_PACKET_COMPRESSED)
+        s_stream_batch_flush(a_stream, a_batch);
+
+    switch (a_pkt->hdr.type) {
+    case STREAM_PKT_TYPE_DATA_PACKET:
+    case STREAM_PKT_TYPE_DATA_PACKET_COMPRESSED: {
+        bool l_compressed = a_pkt->hdr.type == STREAM_PKT_TYPE_DATA_PACKET_COMPRESSED;
+        if (a_batch->count == DAP_STREAM_PKT_BATCH_MAX || a_batch->arena_used + a_pkt->hdr.size > sizeof(a_stream->pkt_cache))
+            s_stream_batch_flush(a_stream, a_batch);
+        // Compressed data is decrypted into the arena end, it's decompressed to the arena beginning then
+        byte_t *l_dec_buf = l_compressed ? a_stream->pkt_cache + sizeof(a_stream->pkt_cache) - a_pkt->hdr.size
+                                         : a_stream->pkt_cache + a_batch->arena_used;
+        size_t l_dec_buf_size = l_compressed ? a_pkt->hdr.size : sizeof(a_stream->pkt_cache) - a_batch->arena_used;
+        size_t l_dec_pkt_size = 0;
+        byte_t *l_dec = dap_stream_pkt_decrypt_unsafe(a_stream, a_pkt, l_dec_buf, l_dec_buf_size, &l_dec_pkt_size);
         if (l_dec_pkt_size == 0) {
-            log_it(L_WARNING, "Input: can't decode packet size=%zu",l_pkt_size);
-            DAP_DELETE(l_pkt);
-            return;
-        }
-        if (l_dec_pkt_size != l_ch_pkt->hdr.size + sizeof(l_ch_pkt->hdr)) {
-            log_it(L_WARNING, "Input: decoded packet has bad size = %u, decoded size = %zu", l_ch_pkt->hdr.size, l_dec_pkt_size);
-            DAP_DELETE(l_pkt);
+            log_it(L_WARNING, "Input: can't decode packet size=%zu", a_pkt->hdr.size + sizeof(a_pkt->hdr));
             return;
         }
-
-        s_detect_loose_packet(a_stream);
-
-        // Find channel
-        dap_stream_ch_t * l_ch = NULL;
-        for(size_t i=0;i<a_stream->channel_count;i++){
-            if(a_stream->channel[i]->proc){
-                if(a_stream->channel[i]->proc->id == l_ch_pkt->hdr.id ){
-                    l_ch=a_stream->channel[i];
-                }
+        if (l_compressed) {
+            size_t l_dec_buf_free = (l_dec == l_dec_buf ? (size_t)(l_dec_buf - a_stream->pkt_cache) : sizeof(a_stream->pkt_cache));
+            size_t l_decompressed_size = dap_stream_decompress_size(l_dec, l_dec_pkt_size);
+            if (a_batch->arena_used + l_decompressed_size > l_dec_buf_free)
+                s_stream_batch_flush(a_stream, a_batch);
+            if (!l_decompressed_size || l_decompressed_size > l_dec_buf_free) {
+                log_it(L_WARNING, "Input: bad decompressed packet size %zu", l_decompressed_size);
+                return;
             }
-        }
-
-        if(l_ch){
-            l_ch->stat.bytes_read+=l_ch_pkt->hdr.size;
-            if(l_ch->proc && l_ch->proc->packet_in_callback){
-                if ( s_dump_packet_headers ){
-                    log_it(L_INFO,"Income channel packet: id='%c' size=%u type=0x%02X seq_id=0x%016"DAP_UINT64_FORMAT_X" enc_type=0x%02X",(char) l_ch_pkt->hdr.id,
-                        l_ch_pkt->hdr.size, l_ch_pkt->hdr.type, l_ch_pkt->hdr.seq_id , l_ch_pkt->hdr.enc_type);
-                }
-                l_ch->proc->packet_in_callback(l_ch,l_ch_pkt);
+            l_dec_pkt_size = dap_stream_decompress(l_dec, l_dec_pkt_size, a_stream->pkt_cache + a_batch->arena_used,
+                                                   l_dec_buf_free - a_batch->arena_used);
+            if (!l_dec_pkt_size) {
+                log_it(L_WARNING, "Input: can't decompress packet size=%zu", a_pkt->hdr.size + sizeof(a_pkt->hdr));
+                return;
             }
-        } else{
-            log_it(L_WARNING, "Input: unprocessed channel packet id '%c'",(char) l_ch_pkt->hdr.id );
+            l_dec = a_stream->pkt_cache + a_batch->arena_used;
+        }
+        dap_stream_ch_pkt_t *l_ch_pkt = (dap_stream_ch_pkt_t *)l_dec;
+        if (l_dec_pkt_size < sizeof(l_ch_pkt->hdr) || l_dec_pkt_size != l_ch_pkt->hdr.size + sizeof(l_ch_pkt->hdr)) {
+            log_it(L_WARNING, "Input: decoded packet has bad size = %u, decoded size = %zu", l_ch_pkt->hdr.size, l_dec_pkt_size);
+            return;
         }
+        if (l_dec != a_pkt->data)
+            a_batch->arena_used += l_dec_pkt_size;
+        a_batch->pkts[a_batch->count++] = l_ch_pkt;
     } break;
     case STREAM_PKT_TYPE_SERVICE_PACKET: {
         stream_srv_pkt_t * srv_pkt = DAP_NEW(stream_srv_pkt_t);
-        memcpy(srv_pkt, l_pkt->data,sizeof(stream_srv_pkt_t));
+        memcpy(srv_pkt, a_pkt->data,sizeof(stream_srv_pkt_t));
         uint32_t session_id = srv_pkt->session_id;
         check_session(session_id,a_stream->esocket);
         DAP_DELETE(srv_pkt);
@@ -856,18 +738,111 @@ static void s_stream_proc_pkt_in(dap_stream_t * a_stream)
     default:
         log_it(L_WARNING, "Unknown header type");
     }
+}
+
+/**
+ * @brief s_stream_pkts_proc Process all complete stream packets of the data in one pass
+ * @param a_stream
+ * @param a_data
+ * @param a_data_size
+ * @param a_batch
+ * @return Number of processed bytes, the rest is the beginning of the next packet
+ */
+static size_t s_stream_pkts_proc(dap_stream_t *a_stream, byte_t *a_data, size_t a_data_size, stream_pkt_batch_t *a_batch)
+{
+    size_t l_pos = 0;
+    while (l_pos < a_data_size) {
+        size_t l_left = a_data_size - l_pos;
+        dap_stream_pkt_t *l_pkt = (dap_stream_pkt_t *)(a_data + l_pos);
+        if (memcmp(l_pkt->hdr.sig, c_dap_stream_sig, MIN(l_left, sizeof(l_pkt->hdr.sig)))) {
+            // Packets go back to back, so signature is searched only to get in sync again
+            byte_t *l_sig = a_data + l_pos + 1, *l_end = a_data + a_data_size;
+            while ((l_sig = memchr(l_sig, c_dap_stream_sig[0], l_end - l_sig))
+                   && memcmp(l_sig, c_dap_stream_sig, MIN((size_t)(l_end - l_sig), sizeof(c_dap_stream_sig))))
+                l_sig++;
+            if (!l_sig)
+                return a_data_size;
+            l_pos = l_sig - a_data;
+            continue;
+        }
+        if (l_left < sizeof(l_pkt->hdr))
+            break;
+        if (l_pkt->hdr.size > STREAM_PKT_SIZE_MAX) {
+            log_it(L_ERROR, "Too big packet size %u", l_pkt->hdr.size);
+            l_pos++;
+            continue;
+        }
+        size_t l_pkt_size = sizeof(l_pkt->hdr) + l_pkt->hdr.size;
+        if (l_left < l_pkt_size)
+            break;
+        s_stream_proc_pkt_in(a_stream, l_pkt, a_batch);
+        l_pos += l_pkt_size;
+    }
+    return l_pos;
+}
 
-    DAP_DELETE(l_pkt);
+/**
+ * @brief dap_stream_data_proc_read
+ * @details Input buffer is parsed in one pass, channel packets are decrypted into stream arena or right
+ * in place and passed to channels by batches. Beginning of the packet left unfinished is kept in defrag buffer
+ * @param a_stream
+ * @return Number of bytes taken from input buffer
+ */
+size_t dap_stream_data_proc_read (dap_stream_t *a_stream)
+{
+    if (!a_stream || !a_stream->esocket)
+        return 0;
+
+    byte_t *l_buf_in = a_stream->esocket->buf_in;
+    size_t l_buf_in_size = a_stream->esocket->buf_in_size;
+    size_t l_buf_in_used = 0;
+    stream_pkt_batch_t l_batch = { .count = 0, .arena_used = 0 };
+
+    // Complete the packet split between reads, copying only its missing part
+    while (a_stream->buf_defrag_size) {
+        dap_stream_pkt_t *l_pkt = (dap_stream_pkt_t *)a_stream->buf_defrag;
+        size_t l_pkt_size = sizeof(l_pkt->hdr);
+        if (a_stream->buf_defrag_size >= sizeof(l_pkt->hdr)) {
+            if (memcmp(l_pkt->hdr.sig, c_dap_stream_sig, sizeof(l_pkt->hdr.sig)) || l_pkt->hdr.size > STREAM_PKT_SIZE_MAX) {
+                // Kept bytes weren't a packet beginning, look for it in the input from the start
+                a_stream->buf_defrag_size = 0;
+                l_buf_in_used = 0;
+                break;
+            }
+            l_pkt_size += l_pkt->hdr.size;
+            if (a_stream->buf_defrag_size == l_pkt_size) {
+                s_stream_proc_pkt_in(a_stream, l_pkt, &l_batch);
+                a_stream->buf_defrag_size = 0;
+                break;
+            }
+        }
+        if (l_buf_in_used == l_buf_in_size)
+            return l_buf_in_size;
+        size_t l_copy = MIN(l_pkt_size - a_stream->buf_defrag_size, l_buf_in_size - l_buf_in_used);
+        memcpy(a_stream->buf_defrag + a_stream->buf_defrag_size, l_buf_in + l_buf_in_used, l_copy);
+        a_stream->buf_defrag_size += l_copy;
+        l_buf_in_used += l_copy;
+    }
+
+    l_buf_in_used += s_stream_pkts_proc(a_stream, l_buf_in + l_buf_in_used, l_buf_in_size - l_buf_in_used, &l_batch);
+    s_stream_batch_flush(a_stream, &l_batch);
+
+    if (l_buf_in_used < l_buf_in_size) {
+        memcpy(a_stream->buf_defrag, l_buf_in + l_buf_in_used, l_buf_in_size - l_buf_in_used);
+        a_stream->buf_defrag_size = l_buf_in_size - l_buf_in_used;
+    }
+    return l_buf_in_size;
 }
 
 /**
  * @brief _detect_loose_packet
  * @param a_stream
+ * @param a_ch_pkt
  * @return
  */
-static bool s_detect_loose_packet(dap_stream_t * a_stream)
+static bool s_detect_loose_packet(dap_stream_t * a_stream, dap_stream_ch_pkt_t *a_ch_pkt)
 {
-    dap_stream_ch_pkt_t * l_ch_pkt = (dap_stream_ch_pkt_t *) a_stream->pkt_cache;
+    dap_stream_ch_pkt_t * l_ch_pkt = a_ch_pkt;
 
     int l_count_loosed_packets = l_ch_pkt->hdr.seq_id - (a_stream->client_last_seq_id_packet + 1);
     if(l_count_loosed_packets > 0)
@@ -0,0 +1,231 @@
+/*
+ * Authors:
+ * Dmitriy A. Gearasimov <gerasimov.dmitriy@demlabs.net>
+ * DeM Labs Ltd.   https://demlabs.net
+ * Copyright  (c) 2021
+ * All rights reserved.
+
+ This file is part of DAP SDK the open source project
+
+    DAP SDK is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    DAP SDK is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with any DAP SDK based project.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <string.h>
+
+#include "dap_common.h"
+#include "dap_config.h"
+#include "dap_file_utils.h"
+#include "dap_stream_ch_pkt.h"
+#include "dap_stream_compress.h"
+
+#ifdef DAP_STREAM_ZSTD
+#include <zstd.h>
+#endif
+
+#define LOG_TAG "dap_stream_compress"
+
+static bool s_enabled = false;
+static size_t s_threshold = 256; // Smaller packets are sent as is
+static int s_level = 1;
+static bool s_dict_channels[256] = {}; // Channel ids those packets are compressed with dictionary
+
+#ifdef DAP_STREAM_ZSTD
+static uint32_t s_dict_id = 0;
+static ZSTD_CDict *s_cdict = NULL;
+static ZSTD_DDict *s_ddict = NULL;
+
+// Streams are served by worker threads, so each thread has its own contexts
+static __thread ZSTD_CCtx *s_cctx = NULL;
+static __thread ZSTD_DCtx *s_dctx = NULL;
+#endif
+
+/**
+ * @brief dap_stream_compress_init Read compression settings from [stream] section
+ * @param a_config
+ * @return Always zero, compression is just off if it can't be set up
+ */
+int dap_stream_compress_init(dap_config_t *a_config)
+{
+    s_enabled = dap_config_get_item_bool_default(a_config, "stream", "compress", false);
+    if (!s_enabled)
+        return 0;
+#ifndef DAP_STREAM_ZSTD
+    log_it(L_WARNING, "Built without zstd, stream compression is off");
+    s_enabled = false;
+#else
+    s_threshold = dap_config_get_item_uint32_default(a_config, "stream", "compress_threshold", 256);
+    s_level = dap_config_get_item_int32_default(a_config, "stream", "compress_level", 1);
+    const char *l_dict_channels = dap_config_get_item_str_default(a_config, "stream", "compress_dict_channels", "C");
+    for (const char *l_ch_id = l_dict_channels; *l_ch_id; l_ch_id++)
+        s_dict_channels[(uint8_t)*l_ch_id] = true;
+
+    const char *l_dict_path = dap_config_get_item_str(a_config, "stream", "compress_dict");
+    if (l_dict_path) {
+        char *l_dict = NULL;
+        size_t l_dict_size = 0;
+        if (!dap_file_get_contents(l_dict_path, &l_dict, &l_dict_size))
+            log_it(L_ERROR, "Can't read stream compression dictionary %s", l_dict_path);
+        else if (!(s_dict_id = ZSTD_getDictID_fromDict(l_dict, l_dict_size)))
+            log_it(L_ERROR, "%s isn't zstd dictionary, it should be trained with \"zstd --train\"", l_dict_path);
+        else {
+            s_cdict = ZSTD_createCDict(l_dict, l_dict_size, s_level);
+            s_ddict = ZSTD_createDDict(l_dict, l_dict_size);
+            if (!s_cdict || !s_ddict) {
+                log_it(L_ERROR, "Can't load stream compression dictionary %s", l_dict_path);
+                dap_stream_compress_deinit();
+                s_enabled = true;
+            }
+        }
+        DAP_DEL_Z(l_dict);
+    }
+    log_it(L_NOTICE, "Stream compression is on, level %d, packets from %zu bytes, dictionary id %u",
+           s_level, s_threshold, s_dict_id);
+#endif
+    return 0;
+}
+
+/**
+ * @brief dap_stream_compress_deinit
+ */
+void dap_stream_compress_deinit()
+{
+    s_enabled = false;
+#ifdef DAP_STREAM_ZSTD
+    ZSTD_freeCDict(s_cdict);
+    ZSTD_freeDDict(s_ddict);
+    s_cdict = NULL;
+    s_ddict = NULL;
+    s_dict_id = 0;
+#endif
+}
+
+/**
+ * @brief dap_stream_compress_enabled
+ * @return true if compression is offered to the remote side
+ */
+bool dap_stream_compress_enabled()
+{
+    return s_enabled;
+}
+
+/**
+ * @brief dap_stream_compress_dict_id
+ * @return Id of loaded dictionary, zero if there is no one
+ */
+uint32_t dap_stream_compress_dict_id()
+{
+#ifdef DAP_STREAM_ZSTD
+    return s_dict_id;
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @brief dap_stream_compress_negotiate Choose session compression from what the remote side offers
+ * @param a_remote_type Best compression type remote side supports
+ * @param a_remote_dict_id Its dictionary id, dictionary is used only if both sides have the same one
+ * @return
+ */
+dap_stream_compress_type_t dap_stream_compress_negotiate(int a_remote_type, uint32_t a_remote_dict_id)
+{
+    if (!s_enabled || a_remote_type <= DAP_STREAM_COMPRESS_NONE)
+        return DAP_STREAM_COMPRESS_NONE;
+    if (a_remote_type >= DAP_STREAM_COMPRESS_ZSTD_DICT && a_remote_dict_id && a_remote_dict_id == dap_stream_compress_dict_id())
+        return DAP_STREAM_COMPRESS_ZSTD_DICT;
+    return DAP_STREAM_COMPRESS_ZSTD;
+}
+
+/**
+ * @brief dap_stream_compress Compress channel packet
+ * @param a_type Session compression type
+ * @param a_data Channel packet with header
+ * @param a_data_size
+ * @param a_buf_out
+ * @param a_buf_out_size
+ * @return Compressed size, zero if packet should go as is: it's too small, isn't compressed well or on error
+ */
+size_t dap_stream_compress(dap_stream_compress_type_t a_type, const void *a_data, size_t a_data_size, void *a_buf_out, size_t a_buf_out_size)
+{
+#ifdef DAP_STREAM_ZSTD
+    if (a_type == DAP_STREAM_COMPRESS_NONE || a_data_size < s_threshold || a_data_size < sizeof(dap_stream_ch_pkt_hdr_t)
+            || ZSTD_compressBound(a_data_size) > a_buf_out_size)
+        return 0;
+    if (!s_cctx && !(s_cctx = ZSTD_createCCtx()))
+        return 0;
+    const dap_stream_ch_pkt_hdr_t *l_ch_pkt_hdr = a_data;
+    size_t l_ret = a_type == DAP_STREAM_COMPRESS_ZSTD_DICT && s_cdict && s_dict_channels[l_ch_pkt_hdr->id]
+            ? ZSTD_compress_usingCDict(s_cctx, a_buf_out, a_buf_out_size, a_data, a_data_size, s_cdict)
+            : ZSTD_compressCCtx(s_cctx, a_buf_out, a_buf_out_size, a_data, a_data_size, s_level);
+    if (ZSTD_isError(l_ret)) {
+        log_it(L_ERROR, "Can't compress stream packet: %s", ZSTD_getErrorName(l_ret));
+        return 0;
+    }
+    return l_ret < a_data_size ? l_ret : 0;
+#else
+    UNUSED(a_type); UNUSED(a_data); UNUSED(a_data_size); UNUSED(a_buf_out); UNUSED(a_buf_out_size);
+    return 0;
+#endif
+}
+
+/**
+ * @brief dap_stream_decompress_size
+ * @param a_data Compressed packet
+ * @param a_data_size
+ * @return Size of decompressed packet, zero if it's unknown
+ */
+size_t dap_stream_decompress_size(const void *a_data, size_t a_data_size)
+{
+#ifdef DAP_STREAM_ZSTD
+    unsigned long long l_size = ZSTD_getFrameContentSize(a_data, a_data_size);
+    return l_size == ZSTD_CONTENTSIZE_UNKNOWN || l_size == ZSTD_CONTENTSIZE_ERROR ? 0 : (size_t)l_size;
+#else
+    UNUSED(a_data); UNUSED(a_data_size);
+    return 0;
+#endif
+}
+
+/**
+ * @brief dap_stream_decompress Decompress channel packet
+ * @param a_data Compressed packet
+ * @param a_data_size
+ * @param a_buf_out
+ * @param a_buf_out_size
+ * @return Decompressed size, zero on error
+ */
+size_t dap_stream_decompress(const void *a_data, size_t a_data_size, void *a_buf_out, size_t a_buf_out_size)
+{
+#ifdef DAP_STREAM_ZSTD
+    if (!s_dctx && !(s_dctx = ZSTD_createDCtx()))
+        return 0;
+    size_t l_ret;
+    uint32_t l_dict_id = ZSTD_getDictID_fromFrame(a_data, a_data_size);
+    if (l_dict_id) {
+        if (l_dict_id != s_dict_id) {
+            log_it(L_WARNING, "Stream packet is compressed with unknown dictionary %u", l_dict_id);
+            return 0;
+        }
+        l_ret = ZSTD_decompress_usingDDict(s_dctx, a_buf_out, a_buf_out_size, a_data, a_data_size, s_ddict);
+    } else
+        l_ret = ZSTD_decompressDCtx(s_dctx, a_buf_out, a_buf_out_size, a_data, a_data_size);
+    if (ZSTD_isError(l_ret)) {
+        log_it(L_WARNING, "Can't decompress stream packet: %s", ZSTD_getErrorName(l_ret));
+        return 0;
+    }
+    return l_ret;
+#else
+    UNUSED(a_data); UNUSED(a_data_size); UNUSED(a_buf_out); UNUSED(a_buf_out_size);
+    log_it(L_WARNING, "Built without zstd, can't decompress stream packet");
+    return 0;
+#endif
+}
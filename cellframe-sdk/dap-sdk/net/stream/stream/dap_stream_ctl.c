@@ -49,6 +49,7 @@
 
 #include "dap_stream_session.h"
 #include "dap_stream_ctl.h"
+#include "dap_stream_compress.h"
 #include "http_status_code.h"
 #include "dap_enc_ks.h"
 
@@ -122,6 +123,8 @@ void s_proc(struct dap_http_simple *a_http_simple, void * a_arg)
         dap_enc_key_type_t l_enc_type = s_socket_forward_key.type;
         size_t l_enc_key_size = 32;
         int l_enc_headers = 0;
+        int l_compress = DAP_STREAM_COMPRESS_NONE;
+        uint32_t l_compress_dict_id = 0;
         bool l_is_legacy=true;
         char * l_tok_tmp = l_dg->url_path;
         char * l_tok = strtok_r(l_dg->url_path, ",",&l_tok_tmp)   ;
@@ -147,6 +150,10 @@ void s_proc(struct dap_http_simple *a_http_simple, void * a_arg)
                 }else if(strcmp(l_subtok_name,"enc_headers")==0){
                     l_enc_headers = atoi(l_subtok_value);
                     //log_it(L_DEBUG,"Param: enc_headers=%d",l_enc_headers);
+                }else if(strcmp(l_subtok_name,"compress")==0){
+                    l_compress = atoi(l_subtok_value);
+                }else if(strcmp(l_subtok_name,"compress_dict")==0){
+                    l_compress_dict_id = (uint32_t)strtoul(l_subtok_value, NULL, 10);
                 }
             }
             l_tok = strtok_r(NULL, ",",&l_tok_tmp)   ;
@@ -162,6 +169,7 @@ void s_proc(struct dap_http_simple *a_http_simple, void * a_arg)
         if(l_new_session){
             ss = dap_stream_session_pure_new();
             strncpy(ss->active_channels, l_channels_str, l_channels_str_size);
+            ss->compress_type = l_is_legacy ? DAP_STREAM_COMPRESS_NONE : dap_stream_compress_negotiate(l_compress, l_compress_dict_id);
             char *key_str = calloc(1, KEX_KEY_STR_SIZE+1);
             dap_random_string_fill(key_str, KEX_KEY_STR_SIZE);
             ss->key = dap_enc_key_new_generate( l_enc_type, key_str, KEX_KEY_STR_SIZE,
@@ -179,7 +187,8 @@ void s_proc(struct dap_http_simple *a_http_simple, void * a_arg)
             if (l_is_legacy)
                 enc_http_reply_f(l_dg,"%u %s",ss->id, key_str);
             else
-                enc_http_reply_f(l_dg,"%u %s %u %d %d",ss->id, key_str, DAP_PROTOCOL_VERSION, l_enc_type, l_enc_headers);
+                enc_http_reply_f(l_dg,"%u %s %u %d %d %d",ss->id, key_str, DAP_PROTOCOL_VERSION, l_enc_type, l_enc_headers,
+                                 ss->compress_type);
             *return_code = Http_Status_OK;
 
             log_it(L_INFO," New stream session %u initialized",ss->id);
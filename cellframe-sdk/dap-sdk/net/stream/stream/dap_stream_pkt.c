@@ -52,6 +52,7 @@
 #include "dap_stream_ch.h"
 #include "dap_stream_ch_pkt.h"
 #include "dap_stream_ch_proc.h"
+#include "dap_stream_compress.h"
 
 #include "dap_enc_iaes.h"
 
@@ -125,6 +126,30 @@ size_t dap_stream_pkt_read_unsafe( dap_stream_t * a_stream, dap_stream_pkt_t * a
     return ds;
 }
 
+/**
+ * @brief dap_stream_pkt_decrypt_unsafe Decrypt packet body
+ * @details Stream ciphers and IAES decrypt right over the ciphertext, then a_buf_out is not touched
+ * @param a_stream
+ * @param a_pkt Whole packet, its body may be overwritten
+ * @param a_buf_out Buffer for ciphers those can't decrypt in place
+ * @param a_buf_out_size
+ * @param a_dec_size Decrypted size, zero on error
+ * @return Pointer to decrypted data, it's a_pkt->data or a_buf_out
+ */
+void *dap_stream_pkt_decrypt_unsafe(dap_stream_t *a_stream, dap_stream_pkt_t *a_pkt, void *a_buf_out, size_t a_buf_out_size,
+                                    size_t *a_dec_size)
+{
+    dap_enc_key_t *l_key = a_stream->session->key;
+    switch (l_key->type) {
+    case DAP_ENC_KEY_TYPE_IAES:
+    case DAP_ENC_KEY_TYPE_SALSA2012:
+        *a_dec_size = l_key->dec_na(l_key, a_pkt->data, a_pkt->hdr.size, a_pkt->data, a_pkt->hdr.size);
+        return a_pkt->data;
+    default:
+        *a_dec_size = l_key->dec_na(l_key, a_pkt->data, a_pkt->hdr.size, a_buf_out, a_buf_out_size);
+        return a_buf_out;
+    }
+}
 
 #define DAP_STREAM_CH_PKT_ENCRYPTION_OVERHEAD 200 //in fact is's about 2*16+15 for OAES
 
@@ -139,29 +164,39 @@ size_t dap_stream_pkt_read_unsafe( dap_stream_t * a_stream, dap_stream_pkt_t * a
 size_t dap_stream_pkt_write_unsafe(dap_stream_t * a_stream, const void * a_data, size_t a_data_size)
 {
     a_stream->is_active = true;
-    size_t ret=0;
-    dap_stream_pkt_hdr_t pkt_hdr;
-
-    uint8_t * l_buf_allocated = NULL;
-    uint8_t * l_buf_selected = a_stream->buf;
-    size_t  l_buf_size_required = a_data_size + DAP_STREAM_CH_PKT_ENCRYPTION_OVERHEAD;
-    
-    if(l_buf_size_required > sizeof(a_stream->buf) ){
-        l_buf_allocated = DAP_NEW_SIZE(uint8_t, l_buf_size_required);
-        l_buf_selected = l_buf_allocated;
+    uint8_t l_pkt_type = STREAM_PKT_TYPE_DATA_PACKET;
+    if (a_stream->session->compress_type != DAP_STREAM_COMPRESS_NONE) {
+        size_t l_compressed_size = dap_stream_compress(a_stream->session->compress_type, a_data, a_data_size,
+                                                       a_stream->buf, sizeof(a_stream->buf));
+        if (l_compressed_size) {
+            a_data = a_stream->buf;
+            a_data_size = l_compressed_size;
+            l_pkt_type = STREAM_PKT_TYPE_DATA_PACKET_COMPRESSED;
+        }
     }
+    size_t  l_buf_size_required = a_data_size + DAP_STREAM_CH_PKT_ENCRYPTION_OVERHEAD;
 
-    memset(&pkt_hdr,0,sizeof(pkt_hdr));
-    memcpy(pkt_hdr.sig,c_dap_stream_sig,sizeof(pkt_hdr.sig));
-
-    pkt_hdr.size =(uint32_t) dap_enc_code( a_stream->session->key, a_data,a_data_size,l_buf_selected, l_buf_size_required, DAP_ENC_DATA_TYPE_RAW);
-
-    ret+=dap_events_socket_write_unsafe(a_stream->esocket,&pkt_hdr,sizeof(pkt_hdr));
-    ret+=dap_events_socket_write_unsafe(a_stream->esocket,l_buf_selected,pkt_hdr.size);
+    // Packet is built right in the esocket output buffer: header and body encrypted behind it go out as one piece
+    byte_t *l_buf = dap_events_socket_write_reserve_unsafe(a_stream->esocket, sizeof(dap_stream_pkt_hdr_t) + l_buf_size_required);
+    if (!l_buf) {
+        log_it(L_ERROR, "No space in esocket output buffer for stream packet of %zu bytes", a_data_size);
+        return 0;
+    }
+    dap_stream_pkt_hdr_t *l_pkt_hdr = (dap_stream_pkt_hdr_t *)l_buf;
+    memset(l_pkt_hdr, 0, sizeof(*l_pkt_hdr));
+    memcpy(l_pkt_hdr->sig, c_dap_stream_sig, sizeof(l_pkt_hdr->sig));
+    l_pkt_hdr->type = l_pkt_type;
+
+    size_t l_enc_size = dap_enc_code(a_stream->session->key, a_data, a_data_size, l_buf + sizeof(*l_pkt_hdr),
+                                     l_buf_size_required, DAP_ENC_DATA_TYPE_RAW);
+    if (!l_enc_size) {
+        log_it(L_ERROR, "Can't encrypt stream packet of %zu bytes", a_data_size);
+        return 0;
+    }
+    l_pkt_hdr->size = (uint32_t)l_enc_size;
 
-    if(l_buf_allocated)
-        DAP_DELETE(l_buf_allocated);
-    return ret;
+    dap_events_socket_write_commit_unsafe(a_stream->esocket, sizeof(*l_pkt_hdr) + l_enc_size);
+    return sizeof(*l_pkt_hdr) + l_enc_size;
 }
 
 /**
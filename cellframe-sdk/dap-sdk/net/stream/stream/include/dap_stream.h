@@ -65,15 +65,12 @@ typedef struct dap_stream {
     bool is_client_to_uplink ;
 
     struct dap_stream_pkt * in_pkt;
-    struct dap_stream_pkt *pkt_buf_in;
-    size_t pkt_buf_in_data_size;
-    size_t pkt_buf_in_size_expected;
 
-    uint8_t buf_defrag[STREAM_BUF_SIZE_MAX];
+    uint8_t buf_defrag[STREAM_BUF_SIZE_MAX]; // Beginning of the packet split between reads
     uint64_t buf_defrag_size;
 
     uint8_t buf[STREAM_BUF_SIZE_MAX];
-    uint8_t pkt_cache[STREAM_BUF_SIZE_MAX];
+    uint8_t pkt_cache[STREAM_BUF_SIZE_MAX]; // Arena for decrypted channel packets of one input batch
 
     dap_stream_ch_t *channel[255]; // TODO reduce channels to 16 to economy memory
     size_t channel_count;
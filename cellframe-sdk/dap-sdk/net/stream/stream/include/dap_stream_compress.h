@@ -0,0 +1,45 @@
+/*
+ * Authors:
+ * Dmitriy A. Gearasimov <gerasimov.dmitriy@demlabs.net>
+ * DeM Labs Ltd.   https://demlabs.net
+ * Copyright  (c) 2021
+ * All rights reserved.
+
+ This file is part of DAP SDK the open source project
+
+    DAP SDK is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    DAP SDK is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with any DAP SDK based project.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "dap_config.h"
+
+// Compression of stream packet data, negotiated per session in stream_ctl request
+typedef enum dap_stream_compress_type {
+    DAP_STREAM_COMPRESS_NONE = 0,
+    DAP_STREAM_COMPRESS_ZSTD,       // zstd on fast level
+    DAP_STREAM_COMPRESS_ZSTD_DICT   // the same, with shared dictionary for channels set in config
+} dap_stream_compress_type_t;
+
+int dap_stream_compress_init(dap_config_t *a_config);
+void dap_stream_compress_deinit();
+
+bool dap_stream_compress_enabled();
+uint32_t dap_stream_compress_dict_id();
+dap_stream_compress_type_t dap_stream_compress_negotiate(int a_remote_type, uint32_t a_remote_dict_id);
+
+size_t dap_stream_compress(dap_stream_compress_type_t a_type, const void *a_data, size_t a_data_size, void *a_buf_out, size_t a_buf_out_size);
+size_t dap_stream_decompress(const void *a_data, size_t a_data_size, void *a_buf_out, size_t a_buf_out_size);
+size_t dap_stream_decompress_size(const void *a_data, size_t a_data_size);
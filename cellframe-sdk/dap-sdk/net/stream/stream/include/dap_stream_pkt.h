@@ -27,6 +27,7 @@
 typedef struct dap_stream dap_stream_t;
 typedef struct dap_stream_session dap_stream_session_t;
 #define STREAM_PKT_TYPE_DATA_PACKET 0x00
+#define STREAM_PKT_TYPE_DATA_PACKET_COMPRESSED 0x01 // Sent only if session compression is negotiated
 #define STREAM_PKT_TYPE_SERVICE_PACKET 0xff
 #define STREAM_PKT_TYPE_KEEPALIVE   0x11
 #define STREAM_PKT_TYPE_ALIVE       0x12
@@ -56,6 +57,8 @@ extern const uint8_t c_dap_stream_sig[8];
 dap_stream_pkt_t * dap_stream_pkt_detect(void * a_data, size_t data_size);
 
 size_t dap_stream_pkt_read_unsafe(dap_stream_t * a_stream, dap_stream_pkt_t * a_pkt, void * a_buf_out, size_t a_buf_out_size);
+void *dap_stream_pkt_decrypt_unsafe(dap_stream_t *a_stream, dap_stream_pkt_t *a_pkt, void *a_buf_out, size_t a_buf_out_size,
+                                    size_t *a_dec_size);
 
 size_t dap_stream_pkt_write_unsafe(dap_stream_t * a_stream, const void * data, size_t a_data_size);
 size_t dap_stream_pkt_write_mt (dap_worker_t * a_w, dap_events_socket_uuid_t a_es_uuid, dap_enc_key_t *a_key, const void * data, size_t a_data_size);
@@ -55,6 +55,23 @@ typedef struct dap_chain_item {
    UT_hash_handle hh;
 } dap_chain_item_t;
 
+/**
+  * @struct dap_chain_atom_iter_snapshot
+  * @brief Walks atoms stored in the cell in order they were written, up to the atoms count at iterator creation.
+  * Stored atoms stay mapped while the cell lives, so no chain lock is held between the calls.
+  * Cell is looked up by id on every step and the snapshot is over once the cell file is rewritten
+  */
+typedef struct dap_chain_atom_iter_snapshot {
+    dap_chain_cell_id_t cell_id;
+    uint64_t generation;                // cell generation the sequence numbers belong to
+    uint64_t seq;                       // sequence number of the current atom in the cell
+    uint64_t count;                     // atoms count in the cell when iterator was created
+    dap_chain_hash_fast_t hash;         // current atom hash, cur_hash points here
+    dap_chain_atom_iter_t *chain_iter;  // chain's own iterator when there is no cell to walk
+} dap_chain_atom_iter_snapshot_t;
+
+#define ITER_SNAPSHOT(a) ((dap_chain_atom_iter_snapshot_t *)(a)->_inheritor)
+
 static pthread_rwlock_t s_chain_items_rwlock = PTHREAD_RWLOCK_INITIALIZER;
 static dap_chain_item_t * s_chain_items = NULL;
 
@@ -217,6 +234,139 @@ dap_chain_atom_ptr_t dap_chain_get_atom_by_hash(dap_chain_t * a_chain, dap_chain
     return l_ret;
 }
 
+/**
+ * @brief s_atom_iter_snapshot_set
+ * make atom with given sequence number current
+ * @param a_iter snapshot iterator
+ * @param a_seq atom sequence number in the cell
+ * @param a_atom_size[out] atom size
+ * @return atom or NULL if the snapshot is over
+ */
+static dap_chain_atom_ptr_t s_atom_iter_snapshot_set(dap_chain_atom_iter_t *a_iter, uint64_t a_seq, size_t *a_atom_size)
+{
+    dap_chain_atom_iter_snapshot_t *l_snapshot = ITER_SNAPSHOT(a_iter);
+    dap_chain_cell_atom_pos_t l_pos = { };
+    l_snapshot->seq = a_seq;
+    a_iter->cur = NULL;
+    if (a_seq < l_snapshot->count) {
+        a_iter->cur = dap_chain_cell_atom_get_by_seq(dap_chain_cell_find_by_id(a_iter->chain, l_snapshot->cell_id),
+                                                     l_snapshot->generation, a_seq, &l_pos, &l_snapshot->hash);
+        if (!a_iter->cur)
+            log_it(L_WARNING, "Cell 0x%016"DAP_UINT64_FORMAT_X" of chain \"%s\" is rewritten or closed, atoms snapshot is over",
+                   l_snapshot->cell_id.uint64, a_iter->chain->name);
+    }
+    a_iter->cur_size = a_iter->cur ? l_pos.size : 0;
+    a_iter->cur_hash = a_iter->cur ? &l_snapshot->hash : NULL;
+    if (a_atom_size)
+        *a_atom_size = a_iter->cur_size;
+    return a_iter->cur;
+}
+
+/**
+ * @brief s_atom_iter_snapshot_pull
+ * take current atom from chain's own iterator
+ * @param a_iter snapshot iterator
+ * @param a_atom_size[out] atom size
+ * @return atom or NULL if the chain is over
+ */
+static dap_chain_atom_ptr_t s_atom_iter_snapshot_pull(dap_chain_atom_iter_t *a_iter, size_t *a_atom_size)
+{
+    dap_chain_atom_iter_t *l_chain_iter = ITER_SNAPSHOT(a_iter)->chain_iter;
+    a_iter->cur = l_chain_iter->cur;
+    a_iter->cur_size = l_chain_iter->cur ? l_chain_iter->cur_size : 0;
+    a_iter->cur_hash = l_chain_iter->cur ? l_chain_iter->cur_hash : NULL;
+    if (a_atom_size)
+        *a_atom_size = a_iter->cur_size;
+    return a_iter->cur;
+}
+
+/**
+ * @brief dap_chain_atom_iter_snapshot_create
+ * create iterator over atoms stored in the cell. It sees only atoms stored before its creation,
+ * but is cheap to create and to advance, so it suits long sync sessions. Chain without
+ * file storage is walked with its own iterator instead
+ * @param a_chain dap_chain_t object
+ * @param a_cell_id cell to walk
+ * @return iterator positioned on the first atom, NULL if the chain has cells but not this one
+ */
+dap_chain_atom_iter_t *dap_chain_atom_iter_snapshot_create(dap_chain_t *a_chain, dap_chain_cell_id_t a_cell_id)
+{
+    dap_chain_cell_t *l_cell = dap_chain_cell_find_by_id(a_chain, a_cell_id);
+    if (!l_cell && a_chain->cells) {
+        log_it(L_WARNING, "No cell 0x%016"DAP_UINT64_FORMAT_X" in chain \"%s\"", a_cell_id.uint64, a_chain->name);
+        return NULL;
+    }
+    dap_chain_atom_iter_t *l_iter = DAP_NEW_Z(dap_chain_atom_iter_t);
+    dap_chain_atom_iter_snapshot_t *l_snapshot = DAP_NEW_Z(dap_chain_atom_iter_snapshot_t);
+    l_iter->chain = a_chain;
+    l_iter->_inheritor = l_snapshot;
+    l_snapshot->cell_id = a_cell_id;
+    if (l_cell) {
+        l_snapshot->count = dap_chain_cell_atoms_count(l_cell, &l_snapshot->generation);
+        s_atom_iter_snapshot_set(l_iter, 0, NULL);
+    } else {
+        l_snapshot->chain_iter = a_chain->callback_atom_iter_create(a_chain);
+        a_chain->callback_atom_iter_get_first(l_snapshot->chain_iter, NULL);
+        s_atom_iter_snapshot_pull(l_iter, NULL);
+    }
+    return l_iter;
+}
+
+/**
+ * @brief dap_chain_atom_iter_snapshot_get_next
+ * @param a_iter snapshot iterator
+ * @param a_atom_size[out] atom size
+ * @return next atom or NULL if the snapshot is over
+ */
+dap_chain_atom_ptr_t dap_chain_atom_iter_snapshot_get_next(dap_chain_atom_iter_t *a_iter, size_t *a_atom_size)
+{
+    dap_chain_atom_iter_snapshot_t *l_snapshot = ITER_SNAPSHOT(a_iter);
+    if (l_snapshot->chain_iter) {
+        a_iter->chain->callback_atom_iter_get_next(l_snapshot->chain_iter, NULL);
+        return s_atom_iter_snapshot_pull(a_iter, a_atom_size);
+    }
+    return s_atom_iter_snapshot_set(a_iter, a_iter->cur ? l_snapshot->seq + 1 : l_snapshot->count, a_atom_size);
+}
+
+/**
+ * @brief dap_chain_atom_iter_snapshot_find_by_hash
+ * move iterator to the atom with given hash, iteration goes on from it
+ * @param a_iter snapshot iterator
+ * @param a_atom_hash atom hash
+ * @param a_atom_size[out] atom size
+ * @return atom or NULL if it's not in the snapshot, iterator position is kept then
+ */
+dap_chain_atom_ptr_t dap_chain_atom_iter_snapshot_find_by_hash(dap_chain_atom_iter_t *a_iter, dap_chain_hash_fast_t *a_atom_hash,
+                                                               size_t *a_atom_size)
+{
+    dap_chain_atom_iter_snapshot_t *l_snapshot = ITER_SNAPSHOT(a_iter);
+    if (l_snapshot->chain_iter) {
+        if (!a_iter->chain->callback_atom_find_by_hash(l_snapshot->chain_iter, a_atom_hash, NULL))
+            return NULL;
+        return s_atom_iter_snapshot_pull(a_iter, a_atom_size);
+    }
+    dap_chain_cell_t *l_cell = dap_chain_cell_find_by_id(a_iter->chain, l_snapshot->cell_id);
+    dap_chain_cell_atom_pos_t l_pos;
+    if (!l_cell || dap_chain_cell_atom_pos_by_hash(l_cell, a_atom_hash, &l_pos) || l_pos.seq >= l_snapshot->count)
+        return NULL;
+    return s_atom_iter_snapshot_set(a_iter, l_pos.seq, a_atom_size);
+}
+
+/**
+ * @brief dap_chain_atom_iter_snapshot_delete
+ * @param a_iter snapshot iterator
+ */
+void dap_chain_atom_iter_snapshot_delete(dap_chain_atom_iter_t *a_iter)
+{
+    if (!a_iter)
+        return;
+    dap_chain_atom_iter_snapshot_t *l_snapshot = ITER_SNAPSHOT(a_iter);
+    if (l_snapshot->chain_iter)
+        a_iter->chain->callback_atom_iter_delete(l_snapshot->chain_iter);
+    DAP_DELETE(l_snapshot);
+    DAP_DELETE(a_iter);
+}
+
 /**
  * @brief dap_chain_find_by_id
  * @param a_chain_net_id
@@ -23,13 +23,29 @@
 */
 #include "uthash.h"
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include <time.h>
+#include <errno.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/uio.h>
+#endif
+#include "utlist.h"
+#ifdef DAP_CHAIN_CELL_ZSTD
+#include <zstd.h>
+#endif
 #include "dap_common.h"
 #include "dap_config.h"
 #include "dap_strfuncs.h"
+#include "dap_hash.h"
 #include "dap_chain.h"
 #include "dap_chain_cell.h"
 #include "dap_chain_cs.h"
 #include "dap_chain_pvt.h"
+#include "dap_chain_ledger.h"
+#include "dap_chain_datum_tx.h"
 
 #define LOG_TAG "dap_chain_cell"
 
@@ -40,6 +56,39 @@
 #define DAP_CHAIN_CELL_FILE_TYPE_RAW 0
 #define DAP_CHAIN_CELL_FILE_TYPE_COMPRESSED 1
 
+// Compressed cell file consists of frames, each one holds a group of atoms in raw cell file records
+#define DAP_CHAIN_CELL_FRAME_SIGNATURE 0x5c1e0f7a
+#define DAP_CHAIN_CELL_FRAME_CODEC_NONE 0
+#define DAP_CHAIN_CELL_FRAME_CODEC_ZSTD 1
+// Raw data size to collect before compressing it into a frame
+#define DAP_CHAIN_CELL_FRAME_RAW_SIZE (1024 * 1024)
+// Appended atoms go to the open tail of unpacked frames, it's repacked into one frame at any of these limits
+#define DAP_CHAIN_CELL_TAIL_RAW_SIZE (256 * 1024)
+#define DAP_CHAIN_CELL_TAIL_ATOMS 1024
+#define DAP_CHAIN_CELL_TAIL_SIGNATURE 0x9d2a61c4e07bf358
+#define DAP_CHAIN_CELL_TAIL_SUFFIX ".tail"
+
+#define DAP_CHAIN_CELL_INDEX_VERSION 1
+#define DAP_CHAIN_CELL_INDEX_SIGNATURE 0x3e1bd5a07c62f4d9
+#define DAP_CHAIN_CELL_INDEX_SUFFIX ".idx"
+#define DAP_CHAIN_CELL_TMP_SUFFIX ".tmp"
+
+// Atoms per one task of parallel loader
+#define DAP_CHAIN_CELL_LOAD_CHUNK 64
+// How many chunks loader threads may go ahead of atoms applying, per thread
+#define DAP_CHAIN_CELL_LOAD_AHEAD 4
+// Atoms per one writev() call, two iovecs per atom and one for frame header must fit IOV_MAX
+#define DAP_CHAIN_CELL_APPEND_IOV_ATOMS 511
+// Appended atoms are mapped by windows of this size, so one mapping serves many appends
+#define DAP_CHAIN_CELL_MAP_WINDOW (16 * 1024 * 1024)
+
+#ifdef _WIN32
+struct iovec {
+    void *iov_base;
+    size_t iov_len;
+};
+#endif
+
 /**
   * @struct dap_chain_cell_file_header
   */
@@ -53,6 +102,111 @@ typedef struct dap_chain_cell_file_header
     dap_chain_cell_id_t cell_id;
 } DAP_ALIGN_PACKED dap_chain_cell_file_header_t;
 
+/**
+  * @struct dap_chain_cell_frame_header
+  * @brief Header of a frame in compressed cell file, followed by data_size bytes of frame data.
+  * Unpacked frames placed one by one after the file header make up the raw cell file image
+  */
+typedef struct dap_chain_cell_frame_header
+{
+    uint32_t signature;
+    uint8_t codec;
+    uint32_t atoms_count;
+    uint64_t raw_size;
+    uint64_t data_size;
+} DAP_ALIGN_PACKED dap_chain_cell_frame_header_t;
+
+/**
+  * @struct dap_chain_cell_tail_header
+  * @brief Header of the tail redo file, followed by the frame which replaces frames of compressed cell file
+  * from offset to end. It's written before the cell file is touched, so interrupted repacking is finished on open
+  */
+typedef struct dap_chain_cell_tail_header
+{
+    uint64_t signature;
+    uint64_t offset;
+    uint64_t end;
+} DAP_ALIGN_PACKED dap_chain_cell_tail_header_t;
+
+/**
+  * @struct dap_chain_cell_index_header
+  * @brief Header of the sidecar index file, followed by one record per atom in the cell file order
+  */
+typedef struct dap_chain_cell_index_header
+{
+    uint64_t signature;
+    uint32_t version;
+    dap_chain_cell_id_t cell_id;
+} DAP_ALIGN_PACKED dap_chain_cell_index_header_t;
+
+typedef struct dap_chain_cell_index_record
+{
+    dap_chain_hash_fast_t hash;
+    uint64_t offset;
+    uint64_t size;
+} DAP_ALIGN_PACKED dap_chain_cell_index_record_t;
+
+typedef struct dap_chain_cell_index_item {
+    dap_chain_hash_fast_t hash;
+    dap_chain_cell_atom_pos_t pos;
+    UT_hash_handle hh;
+} dap_chain_cell_index_item_t;
+
+/**
+  * @struct dap_chain_cell_map
+  * @brief Mapped cell file or unpacked part of compressed one. Loaded atoms point inside,
+  * so mappings live as long as the cell
+  */
+typedef struct dap_chain_cell_map {
+    uint8_t *addr;
+    size_t size;        // valid data size
+    size_t len;         // mapped length, tail window goes past the file end
+    uint64_t offset;    // offset of addr in the raw cell file image
+    bool heap;          // addr is allocated, not mapped
+    bool tail;          // shared window over the cell file tail, grows with appends
+    struct dap_chain_cell_map *next;
+} dap_chain_cell_map_t;
+
+/**
+  * @struct dap_chain_cell_load_ctx
+  * @brief State shared by loader threads, which prepare atoms in chunks, and the thread applying them in order
+  */
+typedef struct dap_chain_cell_load_ctx {
+    dap_chain_t *chain;
+    dap_chain_cell_t *cell;
+    uint8_t *base;
+    uint64_t atoms_count;
+    uint64_t chunks_count;
+    uint64_t chunk_next;        // next chunk to be taken by loader thread
+    uint64_t chunk_applying;    // chunk which atoms are being added to the chain now
+    uint64_t chunks_ahead;
+    bool *chunks_ready;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+} dap_chain_cell_load_ctx_t;
+
+/**
+  * @struct dap_chain_cell_append
+  * @brief Atom waiting in the append queue, lives on the stack of the thread appending it
+  */
+typedef struct dap_chain_cell_append {
+    const void *atom;
+    size_t atom_size;
+    dap_chain_hash_fast_t hash;
+    ssize_t ret;
+    bool done;
+    struct dap_chain_cell_append *prev, *next;
+} dap_chain_cell_append_t;
+
+static uint32_t s_load_threads = 1;
+// Data sync after so many appended atoms and/or milliseconds, 0 is off
+static uint32_t s_sync_atoms = 0;
+static uint32_t s_sync_period_ms = 0;
+// Cell files format for new and rewritten cells
+static bool s_cell_compress = false;
+static int s_cell_compress_level = 3;
+// Source of cell generations, so a cell recreated at the same address doesn't repeat the old one
+static atomic_uint_fast64_t s_cell_generation = 0;
 
 /**
  * @brief dap_chain_cell_init
@@ -62,9 +216,677 @@ typedef struct dap_chain_cell_file_header
 int dap_chain_cell_init(void)
 {
     //s_cells_path = dap_config_get_item_str(g_config,"resources","cells_storage");
+    s_load_threads = g_config ? dap_config_get_item_uint32_default(g_config, "chain", "load_threads", 0) : 1;
+    if (!s_load_threads) {
+#ifdef _WIN32
+        SYSTEM_INFO l_sysinfo;
+        GetSystemInfo(&l_sysinfo);
+        s_load_threads = l_sysinfo.dwNumberOfProcessors;
+#else
+        long l_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        s_load_threads = l_cpus > 0 ? (uint32_t)l_cpus : 1;
+#endif
+    }
+    if (g_config) {
+        s_sync_atoms = dap_config_get_item_uint32_default(g_config, "chain", "sync_atoms", 0);
+        s_sync_period_ms = dap_config_get_item_uint32_default(g_config, "chain", "sync_period_ms", 0);
+        s_cell_compress = dap_config_get_item_bool_default(g_config, "chain", "cell_compress", false);
+        s_cell_compress_level = dap_config_get_item_int32_default(g_config, "chain", "cell_compress_level", 3);
+    }
+#ifndef DAP_CHAIN_CELL_ZSTD
+    if (s_cell_compress) {
+        log_it(L_WARNING, "Built without zstd, cell files compression is off");
+        s_cell_compress = false;
+    }
+#endif
     return  0;
 }
 
+/**
+ * @brief s_time_ms
+ * @return monotonic time in milliseconds
+ */
+static uint64_t s_time_ms(void)
+{
+    struct timespec l_ts;
+    clock_gettime(CLOCK_MONOTONIC, &l_ts);
+    return (uint64_t)l_ts.tv_sec * 1000 + (uint64_t)l_ts.tv_nsec / 1000000;
+}
+
+/**
+ * @brief s_cell_fd_writev
+ * write all the buffers, continuing after short writes
+ * @param a_fd file descriptor
+ * @param a_iov buffers, changed while writing
+ * @param a_iov_count buffers count
+ * @return 0 if ok
+ */
+static int s_cell_fd_writev(int a_fd, struct iovec *a_iov, int a_iov_count)
+{
+#ifdef _WIN32
+    for (int i = 0; i < a_iov_count; i++) {
+        for (size_t l_done = 0; l_done < a_iov[i].iov_len; ) {
+            int l_wrote = write(a_fd, (uint8_t *)a_iov[i].iov_base + l_done, a_iov[i].iov_len - l_done);
+            if (l_wrote <= 0)
+                return -1;
+            l_done += l_wrote;
+        }
+    }
+#else
+    while (a_iov_count) {
+        ssize_t l_wrote = writev(a_fd, a_iov, a_iov_count);
+        if (l_wrote < 0 && errno == EINTR)
+            continue;
+        if (l_wrote <= 0)
+            return -1;
+        while (a_iov_count && (size_t)l_wrote >= a_iov->iov_len) {
+            l_wrote -= a_iov->iov_len;
+            a_iov++;
+            a_iov_count--;
+        }
+        if (a_iov_count) {
+            a_iov->iov_base = (uint8_t *)a_iov->iov_base + l_wrote;
+            a_iov->iov_len -= l_wrote;
+        }
+    }
+#endif
+    return 0;
+}
+
+/**
+ * @brief s_cell_fd_sync
+ * flush file data to the storage device
+ * @param a_fd file descriptor
+ * @return 0 if ok
+ */
+static int s_cell_fd_sync(int a_fd)
+{
+#if defined(_WIN32)
+    return _commit(a_fd);
+#elif defined(__APPLE__)
+    return fsync(a_fd);
+#else
+    return fdatasync(a_fd);
+#endif
+}
+
+/**
+ * @brief s_cell_map_file
+ * map whole cell file into memory, copy-on-write so atom callbacks may touch the data
+ * @param a_fd cell file descriptor
+ * @param a_size file size
+ * @return mapping or NULL if error
+ */
+static dap_chain_cell_map_t *s_cell_map_file(int a_fd, size_t a_size)
+{
+    if (!a_size)
+        return NULL;
+#ifdef _WIN32
+    // No mmap, read the file at once: still one allocation for all the atoms
+    uint8_t *l_addr = DAP_NEW_SIZE(uint8_t, a_size);
+    if (!l_addr || lseek(a_fd, 0, SEEK_SET) != 0 || read(a_fd, l_addr, a_size) != (ssize_t)a_size) {
+        DAP_DEL_Z(l_addr);
+        return NULL;
+    }
+#else
+    uint8_t *l_addr = mmap(NULL, a_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, a_fd, 0);
+    if (l_addr == MAP_FAILED)
+        return NULL;
+    madvise(l_addr, a_size, MADV_SEQUENTIAL);
+#endif
+    dap_chain_cell_map_t *l_map = DAP_NEW_Z(dap_chain_cell_map_t);
+    l_map->addr = l_addr;
+    l_map->size = l_map->len = a_size;
+    return l_map;
+}
+
+/**
+ * @brief s_cell_map_delete
+ * @param a_map mapping
+ */
+static void s_cell_map_delete(dap_chain_cell_map_t *a_map)
+{
+#ifdef _WIN32
+    DAP_DELETE(a_map->addr);
+#else
+    if (a_map->heap)
+        DAP_DELETE(a_map->addr);
+    else
+        munmap(a_map->addr, a_map->len);
+#endif
+    DAP_DELETE(a_map);
+}
+
+/**
+ * @brief s_cell_frame_unpack
+ * @param a_frame frame header followed by frame data
+ * @param a_dst buffer for a_frame->raw_size bytes of unpacked data
+ * @return 0 if ok
+ */
+static int s_cell_frame_unpack(const dap_chain_cell_frame_header_t *a_frame, uint8_t *a_dst)
+{
+    const uint8_t *l_src = (const uint8_t *)(a_frame + 1);
+    switch (a_frame->codec) {
+    case DAP_CHAIN_CELL_FRAME_CODEC_NONE:
+        memcpy(a_dst, l_src, a_frame->raw_size);
+        return 0;
+#ifdef DAP_CHAIN_CELL_ZSTD
+    case DAP_CHAIN_CELL_FRAME_CODEC_ZSTD: {
+        size_t l_size = ZSTD_decompress(a_dst, a_frame->raw_size, l_src, a_frame->data_size);
+        return !ZSTD_isError(l_size) && l_size == a_frame->raw_size ? 0 : -1;
+    }
+#endif
+    default:
+        log_it(L_ERROR, "Unsupported cell frame codec %u", a_frame->codec);
+        return -2;
+    }
+}
+
+/**
+ * @brief s_cell_frames_unpack
+ * unpack frames of compressed cell file into the raw cell file image
+ * @param a_data compressed cell file data
+ * @param a_size compressed cell file size
+ * @param a_hdr_size size of the file header before the frames, it's copied as is; zero for the file tail
+ * @param a_valid_size[out] size of the data part with valid frames
+ * @return allocated image or NULL if error
+ */
+static dap_chain_cell_map_t *s_cell_frames_unpack(const uint8_t *a_data, size_t a_size, size_t a_hdr_size, uint64_t *a_valid_size)
+{
+    // Frame headers make up the frame index, walk through it before unpacking anything
+    uint64_t l_offset = a_hdr_size, l_raw_size = l_offset;
+    while (l_offset + sizeof(dap_chain_cell_frame_header_t) <= a_size) {
+        const dap_chain_cell_frame_header_t *l_frame = (const dap_chain_cell_frame_header_t *)(a_data + l_offset);
+        if (l_frame->signature != DAP_CHAIN_CELL_FRAME_SIGNATURE
+                || l_frame->data_size > a_size - l_offset - sizeof(dap_chain_cell_frame_header_t)
+                || (l_frame->codec == DAP_CHAIN_CELL_FRAME_CODEC_NONE && l_frame->data_size != l_frame->raw_size))
+            break;
+        l_raw_size += l_frame->raw_size;
+        l_offset += sizeof(dap_chain_cell_frame_header_t) + l_frame->data_size;
+    }
+    uint64_t l_valid_size = l_offset;
+    uint8_t *l_image = l_raw_size ? DAP_NEW_SIZE(uint8_t, l_raw_size) : NULL;
+    if (!l_image)
+        return NULL;
+    memcpy(l_image, a_data, a_hdr_size);
+    uint64_t l_raw_offset = a_hdr_size;
+    for (l_offset = a_hdr_size; l_offset < l_valid_size; ) {
+        const dap_chain_cell_frame_header_t *l_frame = (const dap_chain_cell_frame_header_t *)(a_data + l_offset);
+        if (s_cell_frame_unpack(l_frame, l_image + l_raw_offset)) {
+            log_it(L_ERROR, "Can't unpack cell frame at offset %"DAP_UINT64_FORMAT_U, l_offset);
+            l_valid_size = l_offset;
+            break;
+        }
+        l_raw_offset += l_frame->raw_size;
+        l_offset += sizeof(dap_chain_cell_frame_header_t) + l_frame->data_size;
+    }
+    *a_valid_size = l_valid_size;
+    dap_chain_cell_map_t *l_map = DAP_NEW_Z(dap_chain_cell_map_t);
+    l_map->addr = l_image;
+    l_map->size = l_map->len = l_raw_offset;
+    l_map->heap = true;
+    return l_map;
+}
+
+/**
+ * @brief s_cell_map_unpack
+ * take the storage type from the mapped cell file header, compressed file is replaced with its raw image
+ * @param a_cell dap_chain_cell_t object
+ * @param a_map mapping of the whole cell file, it's deleted if the file is compressed
+ * @return mapping with raw cell file data or NULL if error
+ */
+static dap_chain_cell_map_t *s_cell_map_unpack(dap_chain_cell_t *a_cell, dap_chain_cell_map_t *a_map)
+{
+    dap_chain_cell_file_header_t *l_hdr = (dap_chain_cell_file_header_t *)a_map->addr;
+    if (a_map->size < sizeof(*l_hdr) || l_hdr->signature != DAP_CHAIN_CELL_FILE_SIGNATURE)
+        return a_map;
+    a_cell->file_storage_type = l_hdr->type;
+    a_cell->frames_end = a_map->size;
+    if (l_hdr->type != DAP_CHAIN_CELL_FILE_TYPE_COMPRESSED)
+        return a_map;
+    dap_chain_cell_map_t *l_image = s_cell_frames_unpack(a_map->addr, a_map->size, sizeof(*l_hdr), &a_cell->frames_end);
+    a_cell->frames_mapped = a_cell->frames_end;
+    s_cell_map_delete(a_map);
+    return l_image;
+}
+
+/**
+ * @brief s_cell_map_add
+ * map current cell file and make it the newest mapping, compressed file is unpacked
+ * @param a_cell dap_chain_cell_t object
+ * @param a_fd cell file descriptor
+ * @return the mapping or NULL if error
+ */
+static dap_chain_cell_map_t *s_cell_map_add(dap_chain_cell_t *a_cell, int a_fd)
+{
+    struct stat l_st;
+    if (fstat(a_fd, &l_st))
+        return NULL;
+    dap_chain_cell_map_t *l_map = s_cell_map_file(a_fd, (size_t)l_st.st_size);
+    if (l_map)
+        l_map = s_cell_map_unpack(a_cell, l_map);
+    if (l_map) {
+        l_map->next = a_cell->maps;
+        a_cell->maps = l_map;
+    }
+    return l_map;
+}
+
+/**
+ * @brief s_cell_map_find
+ * find mapping with the whole atom inside
+ * @param a_cell dap_chain_cell_t object
+ * @param a_pos atom position
+ * @return pointer to the atom or NULL if it's not mapped
+ */
+static uint8_t *s_cell_map_find(dap_chain_cell_t *a_cell, const dap_chain_cell_atom_pos_t *a_pos)
+{
+    for (dap_chain_cell_map_t *l_map = a_cell->maps; l_map; l_map = l_map->next) {
+        if (a_pos->offset >= l_map->offset && a_pos->offset + a_pos->size <= l_map->offset + l_map->size)
+            return l_map->addr + (a_pos->offset - l_map->offset);
+        if (!l_map->offset)
+            break;  // mapping from the file start, older ones are its prefixes
+    }
+    return NULL;
+}
+
+/**
+ * @brief s_cell_unmap_all
+ * @param a_cell dap_chain_cell_t object
+ */
+static void s_cell_unmap_all(dap_chain_cell_t *a_cell)
+{
+    dap_chain_cell_map_t *l_map = a_cell->maps;
+    while (l_map) {
+        dap_chain_cell_map_t *l_next = l_map->next;
+        s_cell_map_delete(l_map);
+        l_map = l_next;
+    }
+    a_cell->maps = NULL;
+}
+
+/**
+ * @brief s_cell_file_path
+ * @param a_cell dap_chain_cell_t object
+ * @param a_suffix suffix added to the cell file name or NULL
+ * @return full path, must be freed
+ */
+static char *s_cell_file_path(dap_chain_cell_t *a_cell, const char *a_suffix)
+{
+    return dap_strdup_printf("%s/%s%s", DAP_CHAIN_PVT(a_cell->chain)->file_storage_dir,
+                             a_cell->file_storage_path, a_suffix ? a_suffix : "");
+}
+
+/**
+ * @brief s_cell_map_frames
+ * unpack frames appended to compressed cell file after the last unpacked one
+ * @param a_cell dap_chain_cell_t object
+ * @param a_fd compressed cell file descriptor
+ * @return 0 if something new is unpacked
+ */
+static int s_cell_map_frames(dap_chain_cell_t *a_cell, int a_fd)
+{
+    uint64_t l_start = MAX(a_cell->frames_mapped, sizeof(dap_chain_cell_file_header_t));
+    if (a_cell->frames_end <= l_start)
+        return -2;
+    size_t l_size = a_cell->frames_end - l_start;
+    uint8_t *l_data = DAP_NEW_SIZE(uint8_t, l_size);
+    if (!l_data || lseek(a_fd, (off_t)l_start, SEEK_SET) != (off_t)l_start
+            || read(a_fd, l_data, l_size) != (ssize_t)l_size) {
+        log_it(L_ERROR, "Can't read frames of cell 0x%016"DAP_UINT64_FORMAT_X", errno %d", a_cell->id.uint64, errno);
+        DAP_DEL_Z(l_data);
+        return -3;
+    }
+    uint64_t l_valid_size = 0;
+    dap_chain_cell_map_t *l_map = s_cell_frames_unpack(l_data, l_size, 0, &l_valid_size);
+    DAP_DELETE(l_data);
+    if (!l_map)
+        return -4;
+    l_map->offset = a_cell->maps ? a_cell->maps->offset + a_cell->maps->size : sizeof(dap_chain_cell_file_header_t);
+    a_cell->frames_mapped = l_start + l_valid_size;
+    l_map->next = a_cell->maps;
+    a_cell->maps = l_map;
+    return 0;
+}
+
+/**
+ * @brief s_cell_tail_redo
+ * finish repacking of compressed cell file tail if it was interrupted, see s_cell_tail_pack()
+ * @param a_file_path cell file path
+ */
+static void s_cell_tail_redo(const char *a_file_path)
+{
+    char *l_redo_path = dap_strdup_printf("%s"DAP_CHAIN_CELL_TAIL_SUFFIX, a_file_path);
+    int l_redo_fd = open(l_redo_path, O_RDONLY);
+    if (l_redo_fd < 0) {
+        DAP_DELETE(l_redo_path);
+        return;
+    }
+    struct stat l_st;
+    dap_chain_cell_tail_header_t l_hdr;
+    dap_chain_cell_frame_header_t *l_frame = NULL;
+    size_t l_frame_size = 0;
+    if (!fstat(l_redo_fd, &l_st) && (size_t)l_st.st_size > sizeof(l_hdr) + sizeof(*l_frame)
+            && read(l_redo_fd, &l_hdr, sizeof(l_hdr)) == sizeof(l_hdr)
+            && l_hdr.signature == DAP_CHAIN_CELL_TAIL_SIGNATURE) {
+        l_frame_size = (size_t)l_st.st_size - sizeof(l_hdr);
+        l_frame = DAP_NEW_SIZE(dap_chain_cell_frame_header_t, l_frame_size);
+        // Torn redo file means the cell file wasn't touched yet
+        if (l_frame && (read(l_redo_fd, l_frame, l_frame_size) != (ssize_t)l_frame_size
+                || l_frame->signature != DAP_CHAIN_CELL_FRAME_SIGNATURE
+                || sizeof(*l_frame) + l_frame->data_size != l_frame_size))
+            DAP_DEL_Z(l_frame);
+    }
+    close(l_redo_fd);
+    int l_fd = l_frame ? open(a_file_path, O_RDWR) : -1;
+    if (l_fd >= 0) {
+        // Cell file has the old tail yet or it's torn by repacking, otherwise repacking is done
+        if (!fstat(l_fd, &l_st) && (uint64_t)l_st.st_size == l_hdr.end) {
+            log_it(L_WARNING, "Finish interrupted repacking of cell file \"%s\" tail", a_file_path);
+            struct iovec l_iov = { .iov_base = l_frame, .iov_len = l_frame_size };
+            if (lseek(l_fd, (off_t)l_hdr.offset, SEEK_SET) != (off_t)l_hdr.offset || s_cell_fd_writev(l_fd, &l_iov, 1)
+                    || ftruncate(l_fd, (off_t)(l_hdr.offset + l_frame_size)) || s_cell_fd_sync(l_fd)) {
+                log_it(L_ERROR, "Can't repack tail of cell file \"%s\", errno %d", a_file_path, errno);
+                close(l_fd);
+                DAP_DELETE(l_frame);
+                DAP_DELETE(l_redo_path);
+                return;
+            }
+        }
+        close(l_fd);
+    }
+    DAP_DEL_Z(l_frame);
+    remove(l_redo_path);
+    DAP_DELETE(l_redo_path);
+}
+
+#ifndef _WIN32
+/**
+ * @brief s_cell_map_tail_fresh
+ * check the page of tail mapping where appended data starts. If an atom in it was written to,
+ * the page is a private copy which doesn't see data appended after that, so the tail must be mapped anew
+ * @param a_map tail mapping
+ * @param a_fd cell file descriptor
+ * @param a_file_size cell file size
+ * @return true if the mapping may be extended up to the file end
+ */
+static bool s_cell_map_tail_fresh(dap_chain_cell_map_t *a_map, int a_fd, uint64_t a_file_size)
+{
+    uint64_t l_page = (uint64_t)sysconf(_SC_PAGESIZE), l_end = a_map->offset + a_map->size;
+    if (!(l_end % l_page))
+        return true;
+    size_t l_len = MIN(l_page - l_end % l_page, a_file_size - l_end);
+    uint8_t *l_buf = DAP_NEW_SIZE(uint8_t, l_len);
+    bool l_ret = l_buf && lseek(a_fd, (off_t)l_end, SEEK_SET) == (off_t)l_end
+            && read(a_fd, l_buf, l_len) == (ssize_t)l_len && !memcmp(a_map->addr + a_map->size, l_buf, l_len);
+    DAP_DEL_Z(l_buf);
+    return l_ret;
+}
+#endif
+
+/**
+ * @brief s_cell_map_tail_fd
+ * @param a_cell dap_chain_cell_t object
+ * @param a_fd cell file descriptor
+ * @return 0 if something new is mapped
+ */
+static int s_cell_map_tail_fd(dap_chain_cell_t *a_cell, int a_fd)
+{
+    if (a_cell->file_storage_type == DAP_CHAIN_CELL_FILE_TYPE_COMPRESSED)
+        return s_cell_map_frames(a_cell, a_fd);
+    struct stat l_st;
+    if (fstat(a_fd, &l_st))
+        return -1;
+    uint64_t l_file_size = (uint64_t)l_st.st_size;
+    dap_chain_cell_map_t *l_last = a_cell->maps;
+    uint64_t l_mapped_end = l_last ? l_last->offset + l_last->size : 0;
+    if (l_file_size <= l_mapped_end)
+        return -2;
+#ifndef _WIN32
+    if (l_last && l_last->tail && l_last->offset + l_last->len >= l_file_size
+            && s_cell_map_tail_fresh(l_last, a_fd, l_file_size)) {
+        // Untouched pages of private mapping see appended data, pages past the old end were never touched
+        l_last->size = l_file_size - l_last->offset;
+        return 0;
+    }
+#endif
+    dap_chain_cell_map_t *l_map = DAP_NEW_Z(dap_chain_cell_map_t);
+#ifdef _WIN32
+    l_map->offset = l_mapped_end;
+    l_map->size = l_map->len = l_file_size - l_mapped_end;
+    l_map->addr = DAP_NEW_SIZE(uint8_t, l_map->size);
+    l_map->heap = true;
+    if (!l_map->addr || lseek(a_fd, (off_t)l_map->offset, SEEK_SET) != (off_t)l_map->offset
+            || read(a_fd, l_map->addr, l_map->size) != (ssize_t)l_map->size) {
+        DAP_DEL_Z(l_map->addr);
+        DAP_DELETE(l_map);
+        return -3;
+    }
+#else
+    uint64_t l_page = (uint64_t)sysconf(_SC_PAGESIZE);
+    l_map->offset = l_mapped_end - l_mapped_end % l_page;
+    l_map->size = l_file_size - l_map->offset;
+    l_map->len = MAX(l_map->size, DAP_CHAIN_CELL_MAP_WINDOW);
+    l_map->len += (l_page - l_map->len % l_page) % l_page;
+    // Same copy-on-write contract as for the loaded file, so any atom may be touched by its users
+    l_map->addr = mmap(NULL, l_map->len, PROT_READ | PROT_WRITE, MAP_PRIVATE, a_fd, (off_t)l_map->offset);
+    if (l_map->addr == MAP_FAILED) {
+        log_it(L_ERROR, "Can't map tail of cell 0x%016"DAP_UINT64_FORMAT_X", errno %d", a_cell->id.uint64, errno);
+        DAP_DELETE(l_map);
+        return -3;
+    }
+    l_map->tail = true;
+#endif
+    l_map->next = a_cell->maps;
+    a_cell->maps = l_map;
+    return 0;
+}
+
+/**
+ * @brief s_cell_map_tail
+ * make atoms appended after the newest mapping reachable. Raw cell file tail is mapped with a window
+ * going past the file end, next appends inside the window just extend the same mapping.
+ * Frames appended to compressed cell file are unpacked all at once
+ * @param a_cell dap_chain_cell_t object
+ * @return 0 if something new is mapped
+ */
+static int s_cell_map_tail(dap_chain_cell_t *a_cell)
+{
+    if (a_cell->file_storage)
+        return s_cell_map_tail_fd(a_cell, fileno(a_cell->file_storage));
+    // Cell is closed after writing, mapping outlives the descriptor
+    char *l_file_path = s_cell_file_path(a_cell, NULL);
+    int l_fd = open(l_file_path, O_RDONLY);
+    DAP_DELETE(l_file_path);
+    if (l_fd < 0)
+        return -1;
+    int l_ret = s_cell_map_tail_fd(a_cell, l_fd);
+    close(l_fd);
+    return l_ret;
+}
+
+/**
+ * @brief s_cell_index_clear
+ * drop in-memory index
+ * @param a_cell dap_chain_cell_t object
+ */
+static void s_cell_index_clear(dap_chain_cell_t *a_cell)
+{
+    dap_chain_cell_index_item_t *l_item, *l_tmp;
+    HASH_ITER(hh, a_cell->atoms_index, l_item, l_tmp) {
+        HASH_DEL(a_cell->atoms_index, l_item);
+        DAP_DELETE(l_item);
+    }
+    DAP_DEL_Z(a_cell->atoms);
+    a_cell->atoms_count = 0;
+    a_cell->atoms_size = 0;
+}
+
+/**
+ * @brief s_cell_index_add
+ * add atom position to in-memory index, sequence number is the next one
+ * @param a_cell dap_chain_cell_t object
+ * @param a_hash atom hash
+ * @param a_offset offset of atom data in the cell file
+ * @param a_size atom size
+ */
+static void s_cell_index_add(dap_chain_cell_t *a_cell, dap_chain_hash_fast_t *a_hash, uint64_t a_offset, uint64_t a_size)
+{
+    if (a_cell->atoms_count == a_cell->atoms_size) {
+        a_cell->atoms_size = a_cell->atoms_size ? a_cell->atoms_size * 2 : 256;
+        a_cell->atoms = DAP_REALLOC(a_cell->atoms, a_cell->atoms_size * sizeof(dap_chain_cell_index_item_t *));
+    }
+    dap_chain_cell_index_item_t *l_item = DAP_NEW_Z(dap_chain_cell_index_item_t);
+    l_item->hash = *a_hash;
+    l_item->pos.seq = a_cell->atoms_count;
+    l_item->pos.offset = a_offset;
+    l_item->pos.size = a_size;
+    a_cell->atoms[a_cell->atoms_count++] = l_item;
+    dap_chain_cell_index_item_t *l_dup = NULL;
+    HASH_FIND(hh, a_cell->atoms_index, a_hash, sizeof(*a_hash), l_dup);
+    if (!l_dup) // the first copy of the atom wins
+        HASH_ADD(hh, a_cell->atoms_index, hash, sizeof(l_item->hash), l_item);
+}
+
+/**
+ * @brief s_cell_index_write_header
+ * @param a_cell dap_chain_cell_t object
+ * @param a_file index file, must be empty
+ * @return 0 if ok
+ */
+static int s_cell_index_write_header(dap_chain_cell_t *a_cell, FILE *a_file)
+{
+    dap_chain_cell_index_header_t l_hdr = {
+        .signature = DAP_CHAIN_CELL_INDEX_SIGNATURE,
+        .version = DAP_CHAIN_CELL_INDEX_VERSION,
+        .cell_id = a_cell->id
+    };
+    return fwrite(&l_hdr, 1, sizeof(l_hdr), a_file) == sizeof(l_hdr) ? 0 : -1;
+}
+
+/**
+ * @brief s_cell_index_write_record
+ * @param a_file index file
+ * @param a_hash atom hash
+ * @param a_offset offset of atom data in the cell file
+ * @param a_size atom size
+ * @return 0 if ok
+ */
+static int s_cell_index_write_record(FILE *a_file, dap_chain_hash_fast_t *a_hash, uint64_t a_offset, uint64_t a_size)
+{
+    dap_chain_cell_index_record_t l_rec = { .hash = *a_hash, .offset = a_offset, .size = a_size };
+    return fwrite(&l_rec, 1, sizeof(l_rec), a_file) == sizeof(l_rec) ? 0 : -1;
+}
+
+/**
+ * @brief s_cell_index_load
+ * read sidecar index and validate it against the mapped cell file:
+ * records must go one by one with matching atom size prefixes up to the end of the file
+ * @param a_cell dap_chain_cell_t object with the cell file mapped
+ * @return 0 if index is loaded, <0 if it's absent or invalid
+ */
+static int s_cell_index_load(dap_chain_cell_t *a_cell)
+{
+    char *l_path = s_cell_file_path(a_cell, DAP_CHAIN_CELL_INDEX_SUFFIX);
+    FILE *l_f = fopen(l_path, "rb");
+    DAP_DELETE(l_path);
+    if (!l_f)
+        return -1;
+    int l_ret = 0;
+    dap_chain_cell_index_header_t l_hdr = { 0 };
+    if (fread(&l_hdr, 1, sizeof(l_hdr), l_f) != sizeof(l_hdr)
+            || l_hdr.signature != DAP_CHAIN_CELL_INDEX_SIGNATURE
+            || l_hdr.version != DAP_CHAIN_CELL_INDEX_VERSION
+            || l_hdr.cell_id.uint64 != a_cell->id.uint64) {
+        fclose(l_f);
+        return -2;
+    }
+    uint8_t *l_data = a_cell->maps->addr;
+    uint64_t l_file_size = a_cell->maps->size;
+    uint64_t l_offset = sizeof(dap_chain_cell_file_header_t);
+    dap_chain_cell_index_record_t l_rec;
+    while (fread(&l_rec, 1, sizeof(l_rec), l_f) == sizeof(l_rec)) {
+        if (l_rec.offset != l_offset + sizeof(size_t) || !l_rec.size
+                || l_rec.offset + l_rec.size > l_file_size
+                || *(size_t *)(l_data + l_offset) != l_rec.size) {
+            l_ret = -3;
+            break;
+        }
+        s_cell_index_add(a_cell, &l_rec.hash, l_rec.offset, l_rec.size);
+        l_offset = l_rec.offset + l_rec.size;
+    }
+    if (!l_ret && (l_offset != l_file_size || !feof(l_f)))
+        l_ret = -4;
+    fclose(l_f);
+    if (l_ret)
+        s_cell_index_clear(a_cell);
+    return l_ret;
+}
+
+/**
+ * @brief s_cell_index_rebuild
+ * scan mapped cell file and write sidecar index from scratch
+ * @param a_cell dap_chain_cell_t object with the cell file mapped
+ * @return 0 if the whole file is indexed, -1 or -2 if the last atom is torn, -3 if the file is corrupted
+ * (valid atoms are still indexed)
+ */
+static int s_cell_index_rebuild(dap_chain_cell_t *a_cell)
+{
+    s_cell_index_clear(a_cell);
+    char *l_path = s_cell_file_path(a_cell, DAP_CHAIN_CELL_INDEX_SUFFIX);
+    FILE *l_f = fopen(l_path, "w+b");
+    DAP_DELETE(l_path);
+    if (l_f && s_cell_index_write_header(a_cell, l_f)) {
+        fclose(l_f);
+        l_f = NULL;
+    }
+    int l_ret = 0;
+    uint8_t *l_data = a_cell->maps ? a_cell->maps->addr : NULL;
+    uint64_t l_file_size = a_cell->maps ? a_cell->maps->size : 0;
+    uint64_t l_offset = sizeof(dap_chain_cell_file_header_t);
+    while (l_offset < l_file_size) {
+        if (l_offset + sizeof(size_t) > l_file_size) {
+            l_ret = -1;
+            break;
+        }
+        size_t l_el_size = *(size_t *)(l_data + l_offset);
+        l_offset += sizeof(size_t);
+        if (!l_el_size) {
+            l_ret = -3;
+            break;
+        }
+        if (l_offset + l_el_size > l_file_size) {
+            l_ret = -2;
+            break;
+        }
+        dap_chain_hash_fast_t l_hash;
+        dap_hash_fast(l_data + l_offset, l_el_size, &l_hash);
+        s_cell_index_add(a_cell, &l_hash, l_offset, l_el_size);
+        if (l_f)
+            s_cell_index_write_record(l_f, &l_hash, l_offset, l_el_size);
+        l_offset += l_el_size;
+    }
+    if (l_f) {
+        fflush(l_f);
+        a_cell->file_index = l_f;
+    } else
+        log_it(L_WARNING, "Can't write index for cell 0x%016"DAP_UINT64_FORMAT_X, a_cell->id.uint64);
+    return l_ret;
+}
+
+/**
+ * @brief s_cell_valid_end
+ * @param a_cell dap_chain_cell_t object
+ * @return offset just after the last indexed atom
+ */
+static uint64_t s_cell_valid_end(dap_chain_cell_t *a_cell)
+{
+    if (!a_cell->atoms_count)
+        return sizeof(dap_chain_cell_file_header_t);
+    dap_chain_cell_atom_pos_t *l_pos = &a_cell->atoms[a_cell->atoms_count - 1]->pos;
+    return l_pos->offset + l_pos->size;
+}
+
 /**
  * @brief dap_chain_cell_find_by_id
  * get dap_chain_cell_t object by cell (shard) id
@@ -96,7 +918,11 @@ dap_chain_cell_t * dap_chain_cell_create_fill(dap_chain_t * a_chain, dap_chain_c
     l_cell->chain = a_chain;
     l_cell->id.uint64 = a_cell_id.uint64;
     l_cell->file_storage_path = dap_strdup_printf("%0"DAP_UINT64_FORMAT_x".dchaincell", l_cell->id.uint64);
+    l_cell->file_storage_type = s_cell_compress ? DAP_CHAIN_CELL_FILE_TYPE_COMPRESSED : DAP_CHAIN_CELL_FILE_TYPE_RAW;
+    l_cell->generation = atomic_fetch_add(&s_cell_generation, 1) + 1;
     pthread_rwlock_init(&l_cell->storage_rwlock, NULL);
+    pthread_mutex_init(&l_cell->append_mutex, NULL);
+    pthread_cond_init(&l_cell->append_cond, NULL);
     pthread_rwlock_wrlock(&a_chain->cell_rwlock);
     HASH_ADD(hh, a_chain->cells, id, sizeof(dap_chain_cell_id_t), l_cell);
     pthread_rwlock_unlock(&a_chain->cell_rwlock);
@@ -120,7 +946,7 @@ dap_chain_cell_t * dap_chain_cell_create_fill2(dap_chain_t * a_chain, const char
 
 /**
  * @brief
- * close a_cell->file_storage file object
+ * close a_cell->file_storage and a_cell->file_index file objects
  * @param a_cell dap_chain_cell_t object
  */
 void dap_chain_cell_close(dap_chain_cell_t *a_cell)
@@ -128,8 +954,17 @@ void dap_chain_cell_close(dap_chain_cell_t *a_cell)
     if(!a_cell)
         return;
     if(a_cell->file_storage) {
+        if (a_cell->unsynced_count && (s_sync_atoms || s_sync_period_ms))
+            s_cell_fd_sync(fileno(a_cell->file_storage));
+        a_cell->unsynced_count = 0;
         fclose(a_cell->file_storage);
         a_cell->file_storage = NULL;
+        // File may be replaced or truncated before it's opened again
+        a_cell->tail_start = 0;
+    }
+    if(a_cell->file_index) {
+        fclose(a_cell->file_index);
+        a_cell->file_index = NULL;
     }
 }
 
@@ -155,14 +990,138 @@ void dap_chain_cell_delete(dap_chain_cell_t *a_cell)
         pthread_rwlock_unlock(&a_cell->chain->cell_rwlock);
     }
     a_cell->chain = NULL;
+    s_cell_index_clear(a_cell);
+    s_cell_unmap_all(a_cell);
     DAP_DEL_Z(a_cell->file_storage_path)
     pthread_rwlock_destroy(&a_cell->storage_rwlock);
+    pthread_mutex_destroy(&a_cell->append_mutex);
+    pthread_cond_destroy(&a_cell->append_cond);
     DAP_DEL_Z(a_cell);
 }
 
+/**
+ * @brief s_cell_load_prepare_atom
+ * do the stateless part of atom processing: parse its datums and verify signatures of its txs
+ * @param a_chain dap_chain_t object
+ * @param a_atom atom in the mapped cell file
+ * @param a_atom_size atom size
+ */
+static void s_cell_load_prepare_atom(dap_chain_t *a_chain, dap_chain_atom_ptr_t a_atom, size_t a_atom_size)
+{
+    size_t l_datums_count = 0;
+    dap_chain_datum_t **l_datums = a_chain->callback_atom_get_datums(a_atom, a_atom_size, &l_datums_count);
+    for (size_t i = 0; l_datums && i < l_datums_count; i++) {
+        if (l_datums[i] && l_datums[i]->header.type_id == DAP_CHAIN_DATUM_TX)
+            dap_chain_ledger_tx_sign_preverify(a_chain->ledger, (dap_chain_datum_tx_t *)l_datums[i]->data);
+    }
+    DAP_DEL_Z(l_datums);
+}
+
+/**
+ * @brief s_cell_load_thread
+ * loader thread, takes chunks of atoms one by one and prepares them
+ * @param a_arg dap_chain_cell_load_ctx_t object
+ * @return
+ */
+static void *s_cell_load_thread(void *a_arg)
+{
+    dap_chain_cell_load_ctx_t *l_ctx = (dap_chain_cell_load_ctx_t *)a_arg;
+    while (true) {
+        pthread_mutex_lock(&l_ctx->mutex);
+        // Don't go too far ahead, prepared results are waiting in memory
+        while (l_ctx->chunk_next < l_ctx->chunks_count &&
+               l_ctx->chunk_next >= l_ctx->chunk_applying + l_ctx->chunks_ahead)
+            pthread_cond_wait(&l_ctx->cond, &l_ctx->mutex);
+        if (l_ctx->chunk_next >= l_ctx->chunks_count) {
+            pthread_mutex_unlock(&l_ctx->mutex);
+            break;
+        }
+        uint64_t l_chunk = l_ctx->chunk_next++;
+        pthread_mutex_unlock(&l_ctx->mutex);
+        uint64_t l_seq_end = MIN((l_chunk + 1) * DAP_CHAIN_CELL_LOAD_CHUNK, l_ctx->atoms_count);
+        for (uint64_t i = l_chunk * DAP_CHAIN_CELL_LOAD_CHUNK; i < l_seq_end; i++) {
+            dap_chain_cell_atom_pos_t l_pos;
+            if (!dap_chain_cell_atom_pos_by_seq(l_ctx->cell, i, &l_pos))
+                s_cell_load_prepare_atom(l_ctx->chain, l_ctx->base + l_pos.offset, l_pos.size);
+        }
+        pthread_mutex_lock(&l_ctx->mutex);
+        l_ctx->chunks_ready[l_chunk] = true;
+        pthread_cond_broadcast(&l_ctx->cond);
+        pthread_mutex_unlock(&l_ctx->mutex);
+    }
+    return NULL;
+}
+
+/**
+ * @brief s_cell_load_atoms
+ * pass atoms from the mapped cell file to the chain in the file order.
+ * If there are several loader threads, datums parsing and tx signatures verification are done
+ * by them in parallel ahead of the ordered atoms adding
+ * @param a_chain dap_chain_t object
+ * @param a_cell dap_chain_cell_t object
+ * @param a_base address of the mapping with atoms
+ * @param a_atoms_count atoms count
+ */
+static void s_cell_load_atoms(dap_chain_t *a_chain, dap_chain_cell_t *a_cell, uint8_t *a_base, uint64_t a_atoms_count)
+{
+    uint32_t l_threads_count = (uint32_t)MIN((uint64_t)s_load_threads, a_atoms_count / DAP_CHAIN_CELL_LOAD_CHUNK);
+    if (l_threads_count < 2 || !a_chain->ledger || !a_chain->callback_atom_get_datums) {
+        for (uint64_t i = 0; i < a_atoms_count; i++) {
+            dap_chain_cell_atom_pos_t l_pos;
+            dap_chain_cell_atom_pos_by_seq(a_cell, i, &l_pos);
+            a_chain->callback_atom_add(a_chain, a_base + l_pos.offset, l_pos.size); // !!! blocking GDB call !!!
+        }
+        return;
+    }
+    dap_chain_cell_load_ctx_t l_ctx = {
+        .chain = a_chain,
+        .cell = a_cell,
+        .base = a_base,
+        .atoms_count = a_atoms_count,
+        .chunks_count = (a_atoms_count + DAP_CHAIN_CELL_LOAD_CHUNK - 1) / DAP_CHAIN_CELL_LOAD_CHUNK,
+        .chunks_ahead = (uint64_t)l_threads_count * DAP_CHAIN_CELL_LOAD_AHEAD
+    };
+    l_ctx.chunks_ready = DAP_NEW_Z_SIZE(bool, l_ctx.chunks_count * sizeof(bool));
+    pthread_mutex_init(&l_ctx.mutex, NULL);
+    pthread_cond_init(&l_ctx.cond, NULL);
+    pthread_t *l_threads = DAP_NEW_Z_SIZE(pthread_t, l_threads_count * sizeof(pthread_t));
+    uint32_t l_threads_started = 0;
+    for (uint32_t i = 0; i < l_threads_count; i++) {
+        if (pthread_create(&l_threads[l_threads_started], NULL, s_cell_load_thread, &l_ctx))
+            log_it(L_WARNING, "Can't start chain loader thread #%u", i);
+        else
+            l_threads_started++;
+    }
+    log_it(L_DEBUG, "Load %"DAP_UINT64_FORMAT_U" atoms with %u loader threads", a_atoms_count, l_threads_started);
+    for (uint64_t l_chunk = 0; l_chunk < l_ctx.chunks_count; l_chunk++) {
+        pthread_mutex_lock(&l_ctx.mutex);
+        l_ctx.chunk_applying = l_chunk;
+        pthread_cond_broadcast(&l_ctx.cond);
+        while (l_threads_started && !l_ctx.chunks_ready[l_chunk])
+            pthread_cond_wait(&l_ctx.cond, &l_ctx.mutex);
+        pthread_mutex_unlock(&l_ctx.mutex);
+        uint64_t l_seq_end = MIN((l_chunk + 1) * DAP_CHAIN_CELL_LOAD_CHUNK, a_atoms_count);
+        for (uint64_t i = l_chunk * DAP_CHAIN_CELL_LOAD_CHUNK; i < l_seq_end; i++) {
+            dap_chain_cell_atom_pos_t l_pos;
+            dap_chain_cell_atom_pos_by_seq(a_cell, i, &l_pos);
+            a_chain->callback_atom_add(a_chain, a_base + l_pos.offset, l_pos.size); // !!! blocking GDB call !!!
+        }
+    }
+    for (uint32_t i = 0; i < l_threads_started; i++)
+        pthread_join(l_threads[i], NULL);
+    // Results for txs which were not checked, e.g. left in threshold, are useless now
+    dap_chain_ledger_tx_sign_preverify_clear(a_chain->ledger);
+    DAP_DELETE(l_threads);
+    DAP_DELETE(l_ctx.chunks_ready);
+    pthread_mutex_destroy(&l_ctx.mutex);
+    pthread_cond_destroy(&l_ctx.cond);
+}
+
 /**
  * @brief dap_chain_cell_load
  * load cell file, which is pointed in a_cell_file_path variable, for example "0.dchaincell"
+ * The file is mapped into memory and atoms are passed to the chain right from the mapping,
+ * their positions are taken from the sidecar index or the index is rebuilt if it doesn't match the file.
  * @param a_chain dap_chain_t object
  * @param a_cell_file_path contains name of chain, for example "0.dchaincell" 
  * @return
@@ -172,62 +1131,745 @@ int dap_chain_cell_load(dap_chain_t * a_chain, const char * a_cell_file_path)
     int ret = 0;
     char l_file_path[MAX_PATH] = {'\0'};
     dap_snprintf(l_file_path, MAX_PATH, "%s/%s", DAP_CHAIN_PVT(a_chain)->file_storage_dir, a_cell_file_path);
-    FILE *l_f = fopen(l_file_path, "rb");
-    if (!l_f) {
+    s_cell_tail_redo(l_file_path);
+    int l_fd = open(l_file_path, O_RDONLY);
+    if (l_fd < 0) {
         log_it(L_WARNING,"Can't read chain \"%s\"", l_file_path);
         return -1;
     }
-    dap_chain_cell_file_header_t l_hdr = { 0 };
-    if (fread(&l_hdr, 1, sizeof(l_hdr), l_f) != sizeof (l_hdr)) {
+    struct stat l_st;
+    if (fstat(l_fd, &l_st) || (size_t)l_st.st_size < sizeof(dap_chain_cell_file_header_t)) {
         log_it(L_ERROR,"Can't read chain header \"%s\"", l_file_path);
-        fclose(l_f);
+        close(l_fd);
         return -2;
     }
-    if (l_hdr.signature != DAP_CHAIN_CELL_FILE_SIGNATURE) {
+    dap_chain_cell_map_t *l_map = s_cell_map_file(l_fd, (size_t)l_st.st_size);
+    close(l_fd);
+    if (!l_map) {
+        log_it(L_ERROR, "Can't map chain \"%s\" into memory", l_file_path);
+        return -5;
+    }
+    dap_chain_cell_file_header_t *l_hdr = (dap_chain_cell_file_header_t *)l_map->addr;
+    if (l_hdr->signature != DAP_CHAIN_CELL_FILE_SIGNATURE) {
         log_it(L_ERROR, "Wrong signature in chain \"%s\", possible file corrupt", l_file_path);
-        fclose(l_f);
+        s_cell_map_delete(l_map);
         return -3;
     }
-    size_t l_el_size = 0;
-    unsigned long q = 0;
-    volatile int l_dummy;
-    for (l_dummy = fread(&l_el_size, 1, sizeof(l_el_size), l_f); !feof(l_f); l_el_size = 0, l_dummy = fread(&l_el_size, 1, sizeof(l_el_size), l_f))
-    {
-        if (!l_el_size) {
-            log_it(L_ERROR, "Zero element size, chain %s is corrupted", l_file_path);
+    dap_chain_cell_t *l_cell = dap_chain_cell_create_fill2(a_chain, a_cell_file_path);
+    pthread_rwlock_wrlock(&l_cell->storage_rwlock);
+    // Compressed file is unpacked, atoms positions refer to its raw image
+    l_map = s_cell_map_unpack(l_cell, l_map);
+    if (!l_map) {
+        log_it(L_ERROR, "Can't unpack chain \"%s\"", l_file_path);
+        pthread_rwlock_unlock(&l_cell->storage_rwlock);
+        dap_chain_cell_delete(l_cell);
+        return -5;
+    }
+    l_cell->maps = l_map;
+    bool l_compressed = l_cell->file_storage_type == DAP_CHAIN_CELL_FILE_TYPE_COMPRESSED;
+    if (l_compressed && l_cell->frames_end < (uint64_t)l_st.st_size) {
+        log_it(L_WARNING, "Chain %s has torn or broken frame at %"DAP_UINT64_FORMAT_U", truncate it",
+               l_file_path, l_cell->frames_end);
+        if (truncate(l_file_path, (off_t)l_cell->frames_end))
+            log_it(L_ERROR, "Can't truncate chain %s, errno %d", l_file_path, errno);
+    }
+    if (s_cell_index_load(l_cell)) {
+        log_it(L_NOTICE, "Index of cell %s is absent or outdated, rebuild it", a_cell_file_path);
+        int l_rebuild_ret = s_cell_index_rebuild(l_cell);
+        if (!l_compressed && (l_rebuild_ret == -1 || l_rebuild_ret == -2)) {
+            // The last write was interrupted, cut it off so new atoms follow the valid ones
+            uint64_t l_valid_end = s_cell_valid_end(l_cell);
+            log_it(L_WARNING, "Chain %s has torn tail after %"DAP_UINT64_FORMAT_U" atoms, truncate it to %"DAP_UINT64_FORMAT_U" bytes",
+                   l_file_path, l_cell->atoms_count, l_valid_end);
+            if (truncate(l_file_path, (off_t)l_valid_end))
+                log_it(L_ERROR, "Can't truncate chain %s, errno %d", l_file_path, errno);
+        } else if (l_rebuild_ret) {
+            log_it(L_ERROR, "Chain %s is corrupted after %"DAP_UINT64_FORMAT_U" atoms", l_file_path, l_cell->atoms_count);
             ret = -4;
-            break;
         }
-        dap_chain_atom_ptr_t l_element = DAP_NEW_SIZE(dap_chain_atom_ptr_t, l_el_size);
-        if (!l_element) {
-            log_it(L_ERROR, "Out of memory");
-            ret = -5;
+    }
+    // Bytes after the last atom are cut off, atoms appended in their place are mapped anew
+    if (!l_compressed)
+        l_map->size = MIN(l_map->size, s_cell_valid_end(l_cell));
+    uint64_t q = l_cell->atoms_count;
+    pthread_rwlock_unlock(&l_cell->storage_rwlock);
+    // Atoms that chain keeps point into the mapping, no copies needed
+    s_cell_load_atoms(a_chain, l_cell, l_map->addr, q);
+    if (ret < 0) {
+        log_it(L_INFO, "Couldn't load all atoms, %"DAP_UINT64_FORMAT_U" only", q);
+    } else {
+        log_it(L_INFO, "Loaded all %"DAP_UINT64_FORMAT_U" atoms in cell %s", q, a_cell_file_path);
+    }
+    if (!q)
+        dap_chain_cell_delete(l_cell);
+    return ret;
+
+}
+
+/**
+ * @brief s_cell_file_open
+ * open cell file and its index for appending, index is rebuilt if it's not loaded yet
+ * @param a_cell dap_chain_cell_t object
+ * @return 0 if ok
+ */
+static int s_cell_file_open(dap_chain_cell_t *a_cell)
+{
+    char *l_file_path = s_cell_file_path(a_cell, NULL);
+    s_cell_tail_redo(l_file_path);
+    a_cell->file_storage = fopen(l_file_path, "r+b");
+    if (!a_cell->file_storage) {
+        log_it(L_INFO, "Create chain cell");
+        a_cell->file_storage = fopen(l_file_path, "w+b");
+    }
+    DAP_DELETE(l_file_path);
+    if (!a_cell->file_storage) {
+        log_it(L_ERROR, "Chain cell \"%s\" cannot be opened 0x%016"DAP_UINT64_FORMAT_X,
+                a_cell->file_storage_path,
+                a_cell->id.uint64);
+        return -3;
+    }
+    if (!a_cell->file_index) {
+        if (a_cell->atoms_count) {
+            char *l_index_path = s_cell_file_path(a_cell, DAP_CHAIN_CELL_INDEX_SUFFIX);
+            a_cell->file_index = fopen(l_index_path, "ab");
+            DAP_DELETE(l_index_path);
+        } else {
+            // Nothing loaded, index whatever is already in the file
+            s_cell_map_add(a_cell, fileno(a_cell->file_storage));
+            s_cell_index_rebuild(a_cell);
+            if (a_cell->maps && a_cell->file_storage_type != DAP_CHAIN_CELL_FILE_TYPE_COMPRESSED)
+                a_cell->maps->size = MIN(a_cell->maps->size, s_cell_valid_end(a_cell));
+        }
+    }
+    // Anything after the last valid atom is a torn or corrupted tail, appending after it would hide new atoms
+    int l_fd = fileno(a_cell->file_storage);
+    struct stat l_st;
+    uint64_t l_valid_end = a_cell->file_storage_type == DAP_CHAIN_CELL_FILE_TYPE_COMPRESSED
+            ? MAX(a_cell->frames_end, sizeof(dap_chain_cell_file_header_t)) : s_cell_valid_end(a_cell);
+    if (!fstat(l_fd, &l_st) && (uint64_t)l_st.st_size > l_valid_end
+            && (uint64_t)l_st.st_size >= sizeof(dap_chain_cell_file_header_t)) {
+        log_it(L_WARNING, "Truncate %"DAP_UINT64_FORMAT_U" bytes of torn tail in cell 0x%016"DAP_UINT64_FORMAT_X,
+               (uint64_t)l_st.st_size - l_valid_end, a_cell->id.uint64);
+        if (ftruncate(l_fd, (off_t)l_valid_end))
+            log_it(L_ERROR, "Can't truncate cell 0x%016"DAP_UINT64_FORMAT_X", errno %d", a_cell->id.uint64, errno);
+    }
+    return 0;
+}
+
+/**
+  * @struct dap_chain_cell_writer
+  * @brief Sequential writer of a whole cell file, raw or compressed
+  */
+typedef struct dap_chain_cell_writer {
+    FILE *file;
+    uint8_t type;
+    uint64_t offset;        // next offset in the raw cell file image
+    uint8_t *frame;         // raw data collected for the next frame
+    size_t frame_size;
+    size_t frame_alloc;
+    uint32_t frame_atoms;
+} dap_chain_cell_writer_t;
+
+/**
+ * @brief s_cell_frame_pack
+ * pack raw cell file records into a frame, frame is stored unpacked if it doesn't shrink
+ * @param a_raw raw records
+ * @param a_raw_size raw records size
+ * @param a_atoms_count atoms in records
+ * @param a_frame[out] frame header
+ * @param a_packed[out] buffer with packed data to free, NULL if frame data is a_raw itself
+ * @return frame data
+ */
+static const uint8_t *s_cell_frame_pack(const uint8_t *a_raw, size_t a_raw_size, uint32_t a_atoms_count,
+                                        dap_chain_cell_frame_header_t *a_frame, uint8_t **a_packed)
+{
+    *a_frame = (dap_chain_cell_frame_header_t) {
+        .signature = DAP_CHAIN_CELL_FRAME_SIGNATURE,
+        .codec = DAP_CHAIN_CELL_FRAME_CODEC_NONE,
+        .atoms_count = a_atoms_count,
+        .raw_size = a_raw_size,
+        .data_size = a_raw_size
+    };
+    *a_packed = NULL;
+#ifdef DAP_CHAIN_CELL_ZSTD
+    size_t l_packed_alloc = ZSTD_compressBound(a_raw_size);
+    uint8_t *l_packed = DAP_NEW_SIZE(uint8_t, l_packed_alloc);
+    size_t l_packed_size = l_packed ? ZSTD_compress(l_packed, l_packed_alloc, a_raw, a_raw_size, s_cell_compress_level) : 0;
+    if (l_packed && !ZSTD_isError(l_packed_size) && l_packed_size < a_raw_size) {
+        a_frame->codec = DAP_CHAIN_CELL_FRAME_CODEC_ZSTD;
+        a_frame->data_size = l_packed_size;
+        *a_packed = l_packed;
+        return l_packed;
+    }
+    DAP_DEL_Z(l_packed);
+#endif
+    return a_raw;
+}
+
+/**
+ * @brief s_cell_frame_write
+ * pack raw cell file records into a frame and write it
+ * @param a_file cell file
+ * @param a_raw raw records
+ * @param a_raw_size raw records size
+ * @param a_atoms_count atoms in records
+ * @return 0 if ok
+ */
+static int s_cell_frame_write(FILE *a_file, const uint8_t *a_raw, size_t a_raw_size, uint32_t a_atoms_count)
+{
+    dap_chain_cell_frame_header_t l_frame;
+    uint8_t *l_packed;
+    const uint8_t *l_data = s_cell_frame_pack(a_raw, a_raw_size, a_atoms_count, &l_frame, &l_packed);
+    int l_ret = fwrite(&l_frame, 1, sizeof(l_frame), a_file) == sizeof(l_frame)
+            && fwrite(l_data, 1, l_frame.data_size, a_file) == l_frame.data_size ? 0 : -1;
+    DAP_DEL_Z(l_packed);
+    return l_ret;
+}
+
+/**
+ * @brief s_cell_writer_start
+ * @param a_writer writer to init
+ * @param a_file cell file opened for writing, must be empty
+ * @param a_hdr cell file header, its type sets the format
+ * @return 0 if ok
+ */
+static int s_cell_writer_start(dap_chain_cell_writer_t *a_writer, FILE *a_file, dap_chain_cell_file_header_t *a_hdr)
+{
+    *a_writer = (dap_chain_cell_writer_t) {
+        .file = a_file,
+        .type = a_hdr->type,
+        .offset = sizeof(*a_hdr)
+    };
+    return fwrite(a_hdr, 1, sizeof(*a_hdr), a_file) == sizeof(*a_hdr) ? 0 : -1;
+}
+
+/**
+ * @brief s_cell_writer_flush
+ * write collected frame if any
+ * @param a_writer
+ * @return 0 if ok
+ */
+static int s_cell_writer_flush(dap_chain_cell_writer_t *a_writer)
+{
+    if (!a_writer->frame_size)
+        return 0;
+    int l_ret = s_cell_frame_write(a_writer->file, a_writer->frame, a_writer->frame_size, a_writer->frame_atoms);
+    a_writer->frame_size = 0;
+    a_writer->frame_atoms = 0;
+    return l_ret;
+}
+
+/**
+ * @brief s_cell_writer_finish
+ * write the rest and free writer buffers
+ * @param a_writer
+ * @return 0 if ok
+ */
+static int s_cell_writer_finish(dap_chain_cell_writer_t *a_writer)
+{
+    int l_ret = s_cell_writer_flush(a_writer);
+    DAP_DEL_Z(a_writer->frame);
+    a_writer->frame_alloc = 0;
+    return l_ret;
+}
+
+/**
+ * @brief s_cell_writer_atom
+ * write size prefix and atom, compressed file gets them with the frame
+ * @param a_writer
+ * @param a_atom atom
+ * @param a_atom_size atom size
+ * @param a_offset[out] atom offset in the raw cell file image
+ * @return number of raw bytes added, <0 if error
+ */
+static ssize_t s_cell_writer_atom(dap_chain_cell_writer_t *a_writer, const void *a_atom, size_t a_atom_size, uint64_t *a_offset)
+{
+    if (a_writer->type == DAP_CHAIN_CELL_FILE_TYPE_COMPRESSED) {
+        size_t l_need = a_writer->frame_size + sizeof(a_atom_size) + a_atom_size;
+        if (l_need > a_writer->frame_alloc) {
+            a_writer->frame_alloc = MAX(l_need, DAP_CHAIN_CELL_FRAME_RAW_SIZE + DAP_CHAIN_CELL_FRAME_RAW_SIZE / 4);
+            a_writer->frame = DAP_REALLOC(a_writer->frame, a_writer->frame_alloc);
+            if (!a_writer->frame)
+                return -1;
+        }
+        memcpy(a_writer->frame + a_writer->frame_size, &a_atom_size, sizeof(a_atom_size));
+        memcpy(a_writer->frame + a_writer->frame_size + sizeof(a_atom_size), a_atom, a_atom_size);
+        a_writer->frame_size = l_need;
+        a_writer->frame_atoms++;
+        if (a_writer->frame_size >= DAP_CHAIN_CELL_FRAME_RAW_SIZE && s_cell_writer_flush(a_writer))
+            return -3;
+    } else {
+        if (fwrite(&a_atom_size, 1, sizeof(a_atom_size), a_writer->file) != sizeof(a_atom_size))
+            return -2;
+        if (fwrite(a_atom, 1, a_atom_size, a_writer->file) != a_atom_size)
+            return -3;
+    }
+    *a_offset = a_writer->offset + sizeof(a_atom_size);
+    a_writer->offset = *a_offset + a_atom_size;
+    return sizeof(a_atom_size) + a_atom_size;
+}
+
+/**
+ * @brief s_cell_file_write_atom
+ * write atom to the cell file and put it to index
+ * @param a_cell dap_chain_cell_t object
+ * @param a_writer cell file writer
+ * @param a_file_index index file or NULL
+ * @param a_atom atom
+ * @param a_atom_size atom size
+ * @return number of bytes written, <0 if error
+ */
+static ssize_t s_cell_file_write_atom(dap_chain_cell_t *a_cell, dap_chain_cell_writer_t *a_writer, FILE *a_file_index,
+                                      const void *a_atom, size_t a_atom_size)
+{
+    uint64_t l_offset = 0;
+    ssize_t l_ret = s_cell_writer_atom(a_writer, a_atom, a_atom_size, &l_offset);
+    if (l_ret < 0) {
+        log_it (L_ERROR, "Can't write data from cell 0x%016"DAP_UINT64_FORMAT_X" to the file \"%s\"",
+                        a_cell->id.uint64,
+                        a_cell->file_storage_path);
+        return l_ret;
+    }
+    dap_chain_hash_fast_t l_hash;
+    dap_hash_fast(a_atom, a_atom_size, &l_hash);
+    s_cell_index_add(a_cell, &l_hash, l_offset, a_atom_size);
+    if (a_file_index && s_cell_index_write_record(a_file_index, &l_hash, l_offset, a_atom_size))
+        log_it(L_WARNING, "Can't write index record for cell 0x%016"DAP_UINT64_FORMAT_X, a_cell->id.uint64);
+    return l_ret;
+}
+
+/**
+ * @brief s_cell_file_rewrite
+ * save all the chain atoms into a new cell file and replace the old one with it.
+ * New index is built aside and replaces the current one only when both files are in place,
+ * so the cell stays consistent if anything fails. Old file stays alive while it's mapped,
+ * so loaded atoms remain valid. Chain atoms are iterated without the cell lock, iterators read
+ * the cell themselves; it's taken only to replace the files. Call it holding the append queue
+ * @param a_cell dap_chain_cell_t object
+ * @return total bytes written, <=0 if error or nothing to save
+ */
+static int s_cell_file_rewrite(dap_chain_cell_t *a_cell)
+{
+    char *l_file_path = s_cell_file_path(a_cell, NULL),
+         *l_file_tmp_path = s_cell_file_path(a_cell, DAP_CHAIN_CELL_TMP_SUFFIX),
+         *l_index_path = s_cell_file_path(a_cell, DAP_CHAIN_CELL_INDEX_SUFFIX),
+         *l_index_tmp_path = dap_strdup_printf("%s"DAP_CHAIN_CELL_TMP_SUFFIX, l_index_path);
+    FILE *l_file = fopen(l_file_tmp_path, "w+b"), *l_file_index = fopen(l_index_tmp_path, "w+b");
+    dap_chain_cell_file_header_t l_hdr = {
+        .signature = DAP_CHAIN_CELL_FILE_SIGNATURE,
+        .version = DAP_CHAIN_CELL_FILE_VERSION,
+        .type = s_cell_compress ? DAP_CHAIN_CELL_FILE_TYPE_COMPRESSED : DAP_CHAIN_CELL_FILE_TYPE_RAW,
+        .chain_id = { .uint64 = a_cell->id.uint64 },
+        .chain_net_id = a_cell->chain->net_id
+    };
+    ssize_t l_total_wrote_bytes = 0;
+    size_t l_count = 0;
+    dap_chain_cell_writer_t l_writer = { 0 };
+    dap_chain_cell_t l_new = { .id = a_cell->id, .file_storage_path = a_cell->file_storage_path };
+    if (!l_file || !l_file_index || s_cell_writer_start(&l_writer, l_file, &l_hdr)
+            || s_cell_index_write_header(a_cell, l_file_index)) {
+        log_it(L_ERROR, "Can't init file storage for cell 0x%016"DAP_UINT64_FORMAT_X" ( %s )",
+                a_cell->id.uint64, a_cell->file_storage_path);
+        l_total_wrote_bytes = -4;
+        goto FIN;
+    }
+    size_t l_atom_size = 0;
+    dap_chain_atom_iter_t *l_atom_iter = a_cell->chain->callback_atom_iter_create(a_cell->chain);
+    for (dap_chain_atom_ptr_t l_atom = a_cell->chain->callback_atom_iter_get_first(l_atom_iter, &l_atom_size);
+         l_atom;
+         l_atom = a_cell->chain->callback_atom_iter_get_next(l_atom_iter, &l_atom_size), l_count++)
+    {
+        ssize_t l_wrote = s_cell_file_write_atom(&l_new, &l_writer, l_file_index, l_atom, l_atom_size);
+        if (l_wrote < 0) {
+            l_total_wrote_bytes = l_wrote;
             break;
         }
-        unsigned long l_read = fread(l_element, 1, l_el_size, l_f);
-        if(l_read == l_el_size) {
-            dap_chain_atom_verify_res_t l_res = a_chain->callback_atom_add(a_chain, l_element, l_el_size); // !!! blocking GDB call !!!
-            if (l_res == ATOM_PASS || l_res == ATOM_REJECT) {
-                DAP_DELETE(l_element);
-            }
-            ++q;
+        l_total_wrote_bytes += l_wrote;
+        if(a_cell->chain->callback_notify)
+            a_cell->chain->callback_notify(a_cell->chain->callback_notify_arg,
+                                           a_cell->chain,
+                                           a_cell->id,
+                                           (void *)l_atom,
+                                           l_atom_size);
+    }
+    a_cell->chain->callback_atom_iter_delete(l_atom_iter);
+    if (l_total_wrote_bytes > 0 && s_cell_writer_finish(&l_writer)) {
+        log_it(L_ERROR, "Can't write the last frame of cell 0x%016"DAP_UINT64_FORMAT_X, a_cell->id.uint64);
+        l_total_wrote_bytes = -3;
+    }
+    if (l_total_wrote_bytes <= 0)
+        goto FIN;
+    fflush(l_file);
+    fflush(l_file_index);
+    if (s_sync_atoms || s_sync_period_ms)
+        s_cell_fd_sync(fileno(l_file));
+    pthread_rwlock_wrlock(&a_cell->storage_rwlock);
+    // Index goes first: new index over the old file doesn't pass validation and is just rebuilt on load
+    if (rename(l_index_tmp_path, l_index_path)) {
+        log_it(L_ERROR, "Can't replace index of cell file \"%s\"", l_file_path);
+        l_total_wrote_bytes = -5;
+    } else if (rename(l_file_tmp_path, l_file_path)) {
+        log_it(L_ERROR, "Can't replace cell file \"%s\"", l_file_path);
+        remove(l_index_path);
+        l_total_wrote_bytes = -5;
+    } else {
+        dap_chain_cell_close(a_cell);
+        // Repacking of the replaced file tail is not needed anymore
+        char *l_redo_path = s_cell_file_path(a_cell, DAP_CHAIN_CELL_TAIL_SUFFIX);
+        remove(l_redo_path);
+        DAP_DELETE(l_redo_path);
+        a_cell->file_storage = l_file;
+        a_cell->file_index = l_file_index;
+        a_cell->file_storage_type = l_hdr.type;
+        l_file = l_file_index = NULL;
+        s_cell_index_clear(a_cell);
+        a_cell->atoms_index = l_new.atoms_index;
+        a_cell->atoms = l_new.atoms;
+        a_cell->atoms_count = l_new.atoms_count;
+        a_cell->atoms_size = l_new.atoms_size;
+        l_new.atoms_index = NULL;
+        l_new.atoms = NULL;
+        // Sequence numbers got before refer to the replaced file
+        a_cell->generation = atomic_fetch_add(&s_cell_generation, 1) + 1;
+        // Older mappings hold the replaced file for loaded atoms, positions now refer to the new one
+        s_cell_map_add(a_cell, fileno(a_cell->file_storage));
+        log_it(L_DEBUG, "Saved %zu atoms (total %zd bytes", l_count, l_total_wrote_bytes);
+    }
+    pthread_rwlock_unlock(&a_cell->storage_rwlock);
+FIN:
+    DAP_DEL_Z(l_writer.frame);
+    s_cell_index_clear(&l_new);
+    if (l_file) {
+        fclose(l_file);
+        remove(l_file_tmp_path);
+    }
+    if (l_file_index) {
+        fclose(l_file_index);
+        remove(l_index_tmp_path);
+    }
+    DAP_DELETE(l_file_path);
+    DAP_DELETE(l_file_tmp_path);
+    DAP_DELETE(l_index_path);
+    DAP_DELETE(l_index_tmp_path);
+    return (int)l_total_wrote_bytes;
+}
+
+/**
+ * @brief s_cell_file_header_check
+ * write the header if the cell file is empty yet
+ * @param a_cell dap_chain_cell_t object with the cell file opened
+ * @param a_fd cell file descriptor
+ * @return end of the file or <0 if error
+ */
+static off_t s_cell_file_header_check(dap_chain_cell_t *a_cell, int a_fd)
+{
+    off_t l_end = lseek(a_fd, 0, SEEK_END);
+    if (l_end >= (off_t)sizeof(dap_chain_cell_file_header_t))
+        return l_end;
+    dap_chain_cell_file_header_t l_hdr = {
+        .signature = DAP_CHAIN_CELL_FILE_SIGNATURE,
+        .version = DAP_CHAIN_CELL_FILE_VERSION,
+        .type = a_cell->file_storage_type,
+        .chain_id = { .uint64 = a_cell->id.uint64 },
+        .chain_net_id = a_cell->chain->net_id
+    };
+    struct iovec l_iov = { .iov_base = &l_hdr, .iov_len = sizeof(l_hdr) };
+    if (ftruncate(a_fd, 0) || lseek(a_fd, 0, SEEK_SET) || s_cell_fd_writev(a_fd, &l_iov, 1)) {
+        log_it(L_ERROR, "Can't init file storage for cell 0x%016"DAP_UINT64_FORMAT_X" ( %s )",
+                a_cell->id.uint64, a_cell->file_storage_path);
+        return -1;
+    }
+    log_it(L_NOTICE, "Initialized file storage for cell 0x%016"DAP_UINT64_FORMAT_X" ( %s )",
+            a_cell->id.uint64, a_cell->file_storage_path);
+    return (off_t)sizeof(l_hdr);
+}
+
+/**
+ * @brief s_cell_tail_find
+ * find the open tail of compressed cell file, it's the small frames after the last full one
+ * @param a_cell dap_chain_cell_t object
+ * @param a_fd compressed cell file descriptor
+ * @param a_end end of valid frames
+ */
+static void s_cell_tail_find(dap_chain_cell_t *a_cell, int a_fd, uint64_t a_end)
+{
+    dap_chain_cell_frame_header_t l_frame;
+    uint64_t l_offset = sizeof(dap_chain_cell_file_header_t);
+    a_cell->tail_start = l_offset;
+    a_cell->tail_size = 0;
+    a_cell->tail_atoms = 0;
+    while (l_offset + sizeof(l_frame) <= a_end && lseek(a_fd, (off_t)l_offset, SEEK_SET) == (off_t)l_offset
+            && read(a_fd, &l_frame, sizeof(l_frame)) == sizeof(l_frame)) {
+        l_offset += sizeof(l_frame) + l_frame.data_size;
+        if (l_frame.raw_size >= DAP_CHAIN_CELL_TAIL_RAW_SIZE || l_frame.atoms_count >= DAP_CHAIN_CELL_TAIL_ATOMS) {
+            a_cell->tail_start = l_offset;
+            a_cell->tail_size = 0;
+            a_cell->tail_atoms = 0;
         } else {
-            log_it(L_ERROR, "Read only %lu of %zu bytes, stop cell loading", l_read, l_el_size);
-            DAP_DELETE(l_element);
-            ret = -6;
+            a_cell->tail_size += l_frame.raw_size;
+            a_cell->tail_atoms += l_frame.atoms_count;
+        }
+    }
+    lseek(a_fd, 0, SEEK_END);
+}
+
+/**
+ * @brief s_cell_tail_pack
+ * repack the open tail of compressed cell file into one frame. The frame goes to the synced redo file first,
+ * so atoms of the tail survive a crash in the middle of overwriting it. Raw cell file image stays the same,
+ * so atoms positions and unpacked data remain valid. Call it holding the cell lock
+ * @param a_cell dap_chain_cell_t object
+ * @param a_fd compressed cell file descriptor
+ * @return 0 if ok, <0 if error; the cell file must be reopened if it's less than -3
+ */
+static int s_cell_tail_pack(dap_chain_cell_t *a_cell, int a_fd)
+{
+    uint64_t l_start = a_cell->tail_start, l_end = a_cell->frames_end;
+    // Unpacked data must end on a frame border of the new layout
+    if (a_cell->frames_mapped > l_start && a_cell->frames_mapped < l_end)
+        s_cell_map_frames(a_cell, a_fd);
+    size_t l_size = l_end - l_start;
+    uint8_t *l_data = DAP_NEW_SIZE(uint8_t, l_size);
+    if (!l_data || lseek(a_fd, (off_t)l_start, SEEK_SET) != (off_t)l_start
+            || read(a_fd, l_data, l_size) != (ssize_t)l_size) {
+        log_it(L_ERROR, "Can't read tail of cell 0x%016"DAP_UINT64_FORMAT_X", errno %d", a_cell->id.uint64, errno);
+        DAP_DEL_Z(l_data);
+        return -1;
+    }
+    uint64_t l_valid_size = 0;
+    dap_chain_cell_map_t *l_raw = s_cell_frames_unpack(l_data, l_size, 0, &l_valid_size);
+    DAP_DELETE(l_data);
+    if (!l_raw || l_valid_size != l_size) {
+        log_it(L_ERROR, "Can't unpack tail of cell 0x%016"DAP_UINT64_FORMAT_X, a_cell->id.uint64);
+        if (l_raw)
+            s_cell_map_delete(l_raw);
+        return -2;
+    }
+    dap_chain_cell_tail_header_t l_hdr = {
+        .signature = DAP_CHAIN_CELL_TAIL_SIGNATURE,
+        .offset = l_start,
+        .end = l_end
+    };
+    dap_chain_cell_frame_header_t l_frame;
+    uint8_t *l_packed;
+    const uint8_t *l_frame_data = s_cell_frame_pack(l_raw->addr, l_raw->size, a_cell->tail_atoms, &l_frame, &l_packed);
+    struct iovec l_iov[3] = {
+        { .iov_base = &l_hdr, .iov_len = sizeof(l_hdr) },
+        { .iov_base = &l_frame, .iov_len = sizeof(l_frame) },
+        { .iov_base = (void *)l_frame_data, .iov_len = l_frame.data_size }
+    };
+    uint64_t l_new_end = l_start + sizeof(l_frame) + l_frame.data_size;
+    char *l_redo_path = s_cell_file_path(a_cell, DAP_CHAIN_CELL_TAIL_SUFFIX);
+    int l_ret = 0, l_redo_fd = open(l_redo_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (l_redo_fd < 0 || s_cell_fd_writev(l_redo_fd, l_iov, 3) || s_cell_fd_sync(l_redo_fd)) {
+        log_it(L_ERROR, "Can't write tail redo file of cell 0x%016"DAP_UINT64_FORMAT_X", errno %d", a_cell->id.uint64, errno);
+        l_ret = -3;
+    }
+    if (l_redo_fd >= 0)
+        close(l_redo_fd);
+    if (!l_ret) {
+        // Redo file is in place, from now on the cell file is repacked one way or another
+        if (lseek(a_fd, (off_t)l_start, SEEK_SET) != (off_t)l_start || s_cell_fd_writev(a_fd, l_iov + 1, 2)
+                || ftruncate(a_fd, (off_t)l_new_end) || s_cell_fd_sync(a_fd)) {
+            log_it(L_ERROR, "Can't repack tail of cell 0x%016"DAP_UINT64_FORMAT_X", errno %d", a_cell->id.uint64, errno);
+            l_ret = -4;
+        } else
+            remove(l_redo_path);
+        if (a_cell->frames_mapped == l_end)
+            a_cell->frames_mapped = l_new_end;
+        a_cell->frames_end = l_new_end;
+        a_cell->tail_start = l_new_end;
+        a_cell->tail_size = 0;
+        a_cell->tail_atoms = 0;
+    } else
+        remove(l_redo_path);
+    DAP_DELETE(l_redo_path);
+    DAP_DEL_Z(l_packed);
+    s_cell_map_delete(l_raw);
+    return l_ret;
+}
+
+/**
+ * @brief s_cell_file_write_batch
+ * write queued atoms with as few syscalls as possible: atoms go by writev() calls,
+ * their index records go by one write, then data is synced if it's time to.
+ * Compressed cell gets every chunk as unpacked frame of its open tail, the tail is packed into one frame
+ * when it's big enough; a chunk that is big enough itself is packed at once. Frames are unpacked only
+ * when their atoms are read. Result for every atom is set in its ret field
+ * @param a_cell dap_chain_cell_t object
+ * @param a_batch list of queued atoms
+ */
+static void s_cell_file_write_batch(dap_chain_cell_t *a_cell, dap_chain_cell_append_t *a_batch)
+{
+    dap_chain_cell_append_t *l_append;
+    size_t l_count = 0;
+    DL_FOREACH(a_batch, l_append) {
+        l_append->ret = -2;
+        l_count++;
+    }
+    pthread_rwlock_wrlock(&a_cell->storage_rwlock);
+    if (!a_cell->file_storage && s_cell_file_open(a_cell)) {
+        DL_FOREACH(a_batch, l_append)
+            l_append->ret = -3;
+        pthread_rwlock_unlock(&a_cell->storage_rwlock);
+        return;
+    }
+    int l_fd = fileno(a_cell->file_storage);
+    off_t l_file_end = s_cell_file_header_check(a_cell, l_fd);
+    if (l_file_end < 0) {
+        DL_FOREACH(a_batch, l_append)
+            l_append->ret = -4;
+        dap_chain_cell_close(a_cell);
+        pthread_rwlock_unlock(&a_cell->storage_rwlock);
+        return;
+    }
+    bool l_compressed = a_cell->file_storage_type == DAP_CHAIN_CELL_FILE_TYPE_COMPRESSED;
+    // Offset in the raw cell file image, which is the file itself for raw cell
+    uint64_t l_offset = l_compressed ? s_cell_valid_end(a_cell) : (uint64_t)l_file_end;
+    if (l_compressed && !a_cell->tail_start)
+        s_cell_tail_find(a_cell, l_fd, (uint64_t)l_file_end);
+    // Compressed cell leaves the first iovec for frame header
+    int l_iov_first = l_compressed ? 1 : 0;
+    struct iovec l_iov[DAP_CHAIN_CELL_APPEND_IOV_ATOMS * 2 + 1];
+    dap_chain_cell_frame_header_t l_frame;
+    uint8_t *l_raw = NULL;
+    size_t l_raw_alloc = 0;
+    dap_chain_cell_index_record_t *l_records = DAP_NEW_Z_SIZE(dap_chain_cell_index_record_t,
+                                                              l_count * sizeof(dap_chain_cell_index_record_t));
+    size_t l_written = 0;
+    bool l_error = false;
+    dap_chain_cell_append_t *l_chunk = a_batch;
+    while (l_chunk && !l_error) {
+        int l_iov_count = l_iov_first;
+        size_t l_chunk_count = 0;
+        uint64_t l_chunk_size = 0;
+        for (l_append = l_chunk; l_append && l_chunk_count < DAP_CHAIN_CELL_APPEND_IOV_ATOMS; l_append = l_append->next) {
+            l_iov[l_iov_count++] = (struct iovec){ .iov_base = &l_append->atom_size, .iov_len = sizeof(l_append->atom_size) };
+            l_iov[l_iov_count++] = (struct iovec){ .iov_base = (void *)l_append->atom, .iov_len = l_append->atom_size };
+            l_chunk_count++;
+            l_chunk_size += sizeof(l_append->atom_size) + l_append->atom_size;
+        }
+        uint64_t l_chunk_written = l_chunk_size;
+        uint8_t *l_packed = NULL;
+        bool l_chunk_packed = l_compressed && a_cell->tail_start == (uint64_t)l_file_end
+                && l_chunk_size >= DAP_CHAIN_CELL_TAIL_RAW_SIZE;
+        if (l_compressed && !l_chunk_packed) {
+            l_frame = (dap_chain_cell_frame_header_t) {
+                .signature = DAP_CHAIN_CELL_FRAME_SIGNATURE,
+                .codec = DAP_CHAIN_CELL_FRAME_CODEC_NONE,
+                .atoms_count = l_chunk_count,
+                .raw_size = l_chunk_size,
+                .data_size = l_chunk_size
+            };
+            l_iov[0] = (struct iovec){ .iov_base = &l_frame, .iov_len = sizeof(l_frame) };
+            l_chunk_written = sizeof(l_frame) + l_chunk_size;
+        } else if (l_chunk_packed) {
+            // Gather raw records to pack them into one frame
+            if (l_chunk_size > l_raw_alloc) {
+                l_raw_alloc = l_chunk_size;
+                DAP_DEL_Z(l_raw);
+                l_raw = DAP_NEW_SIZE(uint8_t, l_raw_alloc);
+            }
+            if (!l_raw) {
+                l_raw_alloc = 0;
+                l_error = true;
+                break;
+            }
+            uint8_t *l_ptr = l_raw;
+            for (int i = l_iov_first; i < l_iov_count; i++) {
+                memcpy(l_ptr, l_iov[i].iov_base, l_iov[i].iov_len);
+                l_ptr += l_iov[i].iov_len;
+            }
+            const uint8_t *l_data = s_cell_frame_pack(l_raw, l_chunk_size, l_chunk_count, &l_frame, &l_packed);
+            l_iov[0] = (struct iovec){ .iov_base = &l_frame, .iov_len = sizeof(l_frame) };
+            l_iov[1] = (struct iovec){ .iov_base = (void *)l_data, .iov_len = l_frame.data_size };
+            l_iov_count = 2;
+            l_chunk_written = sizeof(l_frame) + l_frame.data_size;
+        }
+        int l_rc = s_cell_fd_writev(l_fd, l_iov, l_iov_count);
+        DAP_DEL_Z(l_packed);
+        if (l_rc) {
+            log_it(L_ERROR, "Can't write %zu atoms to cell 0x%016"DAP_UINT64_FORMAT_X" in \"%s\", errno %d",
+                   l_chunk_count, a_cell->id.uint64, a_cell->file_storage_path, errno);
+            l_error = true;
             break;
         }
+        l_file_end += l_chunk_written;
+        if (l_chunk_packed)
+            a_cell->tail_start = (uint64_t)l_file_end;
+        else if (l_compressed) {
+            a_cell->tail_size += l_chunk_size;
+            a_cell->tail_atoms += l_chunk_count;
+        }
+        for (size_t i = 0; i < l_chunk_count; i++, l_chunk = l_chunk->next) {
+            l_offset += sizeof(l_chunk->atom_size);
+            s_cell_index_add(a_cell, &l_chunk->hash, (uint64_t)l_offset, l_chunk->atom_size);
+            l_records[l_written++] = (dap_chain_cell_index_record_t) {
+                    .hash = l_chunk->hash, .offset = (uint64_t)l_offset, .size = l_chunk->atom_size };
+            l_chunk->ret = sizeof(l_chunk->atom_size) + l_chunk->atom_size;
+            l_offset += l_chunk->atom_size;
+        }
     }
-    if (ret < 0) {
-        log_it(L_INFO, "Couldn't load all atoms, %lu only", q);
-    } else {
-        log_it(L_INFO, "Loaded all %lu atoms in cell %s", q, a_cell_file_path);
+    if (a_cell->file_index && l_written) {
+        if (fwrite(l_records, sizeof(*l_records), l_written, a_cell->file_index) != l_written)
+            log_it(L_WARNING, "Can't write index records for cell 0x%016"DAP_UINT64_FORMAT_X, a_cell->id.uint64);
+        fflush(a_cell->file_index);
     }
-    if (q)
-        dap_chain_cell_create_fill2(a_chain, a_cell_file_path);
-    fclose(l_f);
-    return ret;
+    DAP_DELETE(l_records);
+    DAP_DEL_Z(l_raw);
+    a_cell->frames_end = (uint64_t)l_file_end;
+    if (!l_error && l_compressed
+            && (a_cell->tail_size >= DAP_CHAIN_CELL_TAIL_RAW_SIZE || a_cell->tail_atoms >= DAP_CHAIN_CELL_TAIL_ATOMS)
+            && s_cell_tail_pack(a_cell, l_fd) < -3)
+        l_error = true;
+    if (l_error) {
+        // Torn tail if any is cut off on the next open
+        dap_chain_cell_close(a_cell);
+    } else if (s_sync_atoms || s_sync_period_ms) {
+        a_cell->unsynced_count += l_written;
+        uint64_t l_now = s_time_ms();
+        if ((s_sync_atoms && a_cell->unsynced_count >= s_sync_atoms)
+                || (s_sync_period_ms && l_now - a_cell->synced_ms >= s_sync_period_ms)) {
+            if (s_cell_fd_sync(l_fd))
+                log_it(L_WARNING, "Can't sync cell 0x%016"DAP_UINT64_FORMAT_X", errno %d", a_cell->id.uint64, errno);
+            a_cell->unsynced_count = 0;
+            a_cell->synced_ms = l_now;
+        }
+    }
+    pthread_rwlock_unlock(&a_cell->storage_rwlock);
+}
 
+/**
+ * @brief s_cell_append_queued
+ * queue atoms and wait till they are written. Concurrent appends are grouped: the first thread that finds
+ * no batch in progress writes everything queued so far, others wait for their atoms to be written.
+ * Atoms queued together always go with the same batch
+ * @param a_cell dap_chain_cell_t object
+ * @param a_items list of atoms to append
+ */
+static void s_cell_append_queued(dap_chain_cell_t *a_cell, dap_chain_cell_append_t *a_items)
+{
+    dap_chain_cell_append_t *l_last = a_items->prev;
+    pthread_mutex_lock(&a_cell->append_mutex);
+    DL_CONCAT(a_cell->append_queue, a_items);
+    while (!l_last->done) {
+        if (a_cell->append_writing) {
+            pthread_cond_wait(&a_cell->append_cond, &a_cell->append_mutex);
+            continue;
+        }
+        // Nobody is writing, so our atoms are still queued: take the whole queue as a batch
+        dap_chain_cell_append_t *l_batch = a_cell->append_queue, *l_item, *l_tmp;
+        a_cell->append_queue = NULL;
+        a_cell->append_writing = true;
+        pthread_mutex_unlock(&a_cell->append_mutex);
+        s_cell_file_write_batch(a_cell, l_batch);
+        pthread_mutex_lock(&a_cell->append_mutex);
+        DL_FOREACH_SAFE(l_batch, l_item, l_tmp)
+            l_item->done = true;
+        a_cell->append_writing = false;
+        pthread_cond_broadcast(&a_cell->append_cond);
+    }
+    pthread_mutex_unlock(&a_cell->append_mutex);
 }
 
 /**
@@ -238,7 +1880,7 @@ int dap_chain_cell_load(dap_chain_t * a_chain, const char * a_cell_file_path)
  *  name - "zerochain"
  *  net_name - "kelvin-testnet"
  *  filepath - "C:\\Users\\Public\\Documents\\cellframe-node\\var\\lib\\network\\kelvin-testnet\\zerochain\\/0.dchaincell"
- * @param a_atom
+ * @param a_atom atom to append or NULL to rewrite the cell file with all the chain atoms
  * @param a_atom_size
  * @return
  */
@@ -251,103 +1893,325 @@ int dap_chain_cell_file_append( dap_chain_cell_t * a_cell, const void* a_atom, s
                                a_cell->id.uint64, a_cell->file_storage_path);
         return -1;
     }
-    if(!a_cell->file_storage) {
-        char l_file_path[MAX_PATH] = {'\0'};
-        dap_snprintf(l_file_path, MAX_PATH, "%s/%s", DAP_CHAIN_PVT(a_cell->chain)->file_storage_dir,
-                     a_cell->file_storage_path);
-        a_cell->file_storage = fopen(l_file_path, "r+b");
-        if (!a_cell->file_storage) {
-            log_it(L_INFO, "Create chain cell");
-            a_cell->file_storage = fopen(l_file_path, "w+b");
-        }
-        if (!a_cell->file_storage) {
-            log_it(L_ERROR, "Chain cell \"%s\" cannot be opened 0x%016"DAP_UINT64_FORMAT_X,
-                    a_cell->file_storage_path,
-                    a_cell->id.uint64);
-            return -3;
-        }
+    if (!a_atom) {
+        // Hold the append queue so that atoms appended meanwhile go to the new file
+        pthread_mutex_lock(&a_cell->append_mutex);
+        while (a_cell->append_writing)
+            pthread_cond_wait(&a_cell->append_cond, &a_cell->append_mutex);
+        a_cell->append_writing = true;
+        pthread_mutex_unlock(&a_cell->append_mutex);
+        int l_ret = s_cell_file_rewrite(a_cell);
+        if (!l_ret)
+            log_it(L_WARNING, "Nothing to save, event table is empty");
+        pthread_mutex_lock(&a_cell->append_mutex);
+        a_cell->append_writing = false;
+        pthread_cond_broadcast(&a_cell->append_cond);
+        pthread_mutex_unlock(&a_cell->append_mutex);
+        return l_ret;
     }
-    pthread_rwlock_wrlock(&a_cell->storage_rwlock);
-    fseek(a_cell->file_storage, 0L, SEEK_END);
-    if (ftell(a_cell->file_storage) < (long)sizeof(dap_chain_cell_file_header_t)) { // fill the header
-        fseek(a_cell->file_storage, 0L, SEEK_SET);
-        dap_chain_cell_file_header_t l_hdr = {
-            .signature = DAP_CHAIN_CELL_FILE_SIGNATURE,
-            .version = DAP_CHAIN_CELL_FILE_VERSION,
-            .type = DAP_CHAIN_CELL_FILE_TYPE_RAW,
-            .chain_id = { .uint64 = a_cell->id.uint64 },
-            .chain_net_id = a_cell->chain->net_id
-        };
-        if(fwrite(&l_hdr, 1, sizeof(l_hdr), a_cell->file_storage) == sizeof(l_hdr)) {
-            log_it(L_NOTICE, "Initialized file storage for cell 0x%016"DAP_UINT64_FORMAT_X" ( %s )",
-                    a_cell->id.uint64, a_cell->file_storage_path);
-        } else {
-            log_it(L_ERROR, "Can't init file storage for cell 0x%016"DAP_UINT64_FORMAT_X" ( %s )",
-                    a_cell->id.uint64, a_cell->file_storage_path);
-            dap_chain_cell_close(a_cell);
-            return -4;
-        }
+    dap_chain_cell_append_t l_append = { .atom = a_atom, .atom_size = a_atom_size };
+    dap_hash_fast(a_atom, a_atom_size, &l_append.hash);
+    l_append.prev = &l_append;
+    s_cell_append_queued(a_cell, &l_append);
+    if (l_append.ret > 0 && a_cell->chain && a_cell->chain->callback_notify)
+        a_cell->chain->callback_notify(a_cell->chain->callback_notify_arg,
+                                       a_cell->chain,
+                                       a_cell->id,
+                                       (void *)a_atom,
+                                       a_atom_size);
+    return (int)l_append.ret;
+}
+
+/**
+ * @brief dap_chain_cell_file_update
+ * save chain atoms which are not in the cell file yet, they are appended with one batch.
+ * Atoms already saved stay in place, so their positions and mappings remain valid.
+ * Chains append new atoms to the end of iteration order, so the scan resumes after the last atom
+ * checked by the previous call while the cell file isn't rewritten
+ * @param a_cell dap_chain_cell_t
+ * @return size of atoms data in the cell file, <=0 if error or nothing to save
+ */
+int dap_chain_cell_file_update( dap_chain_cell_t * a_cell)
+{
+    if (!a_cell || !a_cell->chain) {
+        log_it(L_WARNING, "Chain not found for cell 0x%016"DAP_UINT64_FORMAT_X, a_cell ? a_cell->id.uint64 : 0);
+        return -1;
     }
-    // if no atom provided in arguments, we flush all the atoms in given chain
-    size_t l_atom_size = a_atom_size ? a_atom_size : 0;
-    size_t l_total_wrote_bytes = 0, l_count = 0;
-    dap_chain_atom_iter_t *l_atom_iter = a_atom ? NULL : a_cell->chain->callback_atom_iter_create(a_cell->chain);
-    if (!a_atom) {
-        fseek(a_cell->file_storage, sizeof(dap_chain_cell_file_header_t), SEEK_SET);
+    dap_chain_t *l_chain = a_cell->chain;
+    dap_chain_cell_append_t *l_missing = NULL, *l_item, *l_tmp;
+    dap_chain_cell_atom_pos_t l_pos;
+    dap_chain_hash_fast_t l_hash, l_last_hash;
+    size_t l_atom_size = 0;
+    uint64_t l_generation;
+    pthread_rwlock_rdlock(&a_cell->storage_rwlock);
+    l_generation = a_cell->generation;
+    pthread_rwlock_unlock(&a_cell->storage_rwlock);
+    pthread_mutex_lock(&a_cell->append_mutex);
+    bool l_resume = a_cell->update_generation == l_generation;
+    l_last_hash = a_cell->update_last_hash;
+    pthread_mutex_unlock(&a_cell->append_mutex);
+    bool l_checked = false;
+    // Cell isn't locked here, chain iterators may read it
+    dap_chain_atom_iter_t *l_atom_iter = l_chain->callback_atom_iter_create(l_chain);
+    dap_chain_atom_ptr_t l_atom = NULL;
+    if (l_resume && l_chain->callback_atom_find_by_hash
+            && l_chain->callback_atom_find_by_hash(l_atom_iter, &l_last_hash, &l_atom_size)
+            && l_atom_iter->cur_item)
+        l_atom = l_chain->callback_atom_iter_get_next(l_atom_iter, &l_atom_size);
+    else
+        l_atom = l_chain->callback_atom_iter_get_first(l_atom_iter, &l_atom_size);
+    for ( ; l_atom; l_atom = l_chain->callback_atom_iter_get_next(l_atom_iter, &l_atom_size)) {
+        // DAG and blocks items keep the atom hash, don't hash the atom again
+        if (l_atom_iter->cur_hash)
+            l_hash = *l_atom_iter->cur_hash;
+        else
+            dap_hash_fast(l_atom, l_atom_size, &l_hash);
+        l_last_hash = l_hash;
+        l_checked = true;
+        if (!dap_chain_cell_atom_pos_by_hash(a_cell, &l_hash, &l_pos))
+            continue;
+        dap_chain_cell_append_t *l_append = DAP_NEW_Z(dap_chain_cell_append_t);
+        l_append->atom = l_atom;
+        l_append->atom_size = l_atom_size;
+        l_append->hash = l_hash;
+        DL_APPEND(l_missing, l_append);
     }
-    for (dap_chain_atom_ptr_t l_atom = a_atom ? (dap_chain_atom_ptr_t)a_atom : a_cell->chain->callback_atom_iter_get_first(l_atom_iter, &l_atom_size);
-         l_atom;
-         l_atom = a_atom ? NULL : a_cell->chain->callback_atom_iter_get_next(l_atom_iter, &l_atom_size), l_count++)
-    {
-        if (fwrite(&l_atom_size, 1, sizeof(l_atom_size), a_cell->file_storage) != sizeof(l_atom_size)) {
-            log_it (L_ERROR,"Can't write atom data size from cell 0x%016"DAP_UINT64_FORMAT_X" in \"%s\"",
-                    a_cell->id.uint64,
-                    a_cell->file_storage_path);
-            dap_chain_cell_close(a_cell);
-            l_total_wrote_bytes = -2;
-            break;
+    l_chain->callback_atom_iter_delete(l_atom_iter);
+    int l_ret = 0;
+    if (l_missing) {
+        s_cell_append_queued(a_cell, l_missing);
+        DL_FOREACH_SAFE(l_missing, l_item, l_tmp) {
+            if (l_item->ret <= 0 && !l_ret)
+                l_ret = (int)l_item->ret;
+            else if (l_item->ret > 0 && l_chain->callback_notify)
+                l_chain->callback_notify(l_chain->callback_notify_arg, l_chain, a_cell->id,
+                                         (void *)l_item->atom, l_item->atom_size);
+            DL_DELETE(l_missing, l_item);
+            DAP_DELETE(l_item);
         }
-        l_total_wrote_bytes += sizeof(l_atom_size);
-        if (fwrite(l_atom, 1, l_atom_size, a_cell->file_storage) != l_atom_size) {
-            log_it (L_ERROR, "Can't write data from cell 0x%016"DAP_UINT64_FORMAT_X" to the file \"%s\"",
-                            a_cell->id.uint64,
-                            a_cell->file_storage_path);
-            dap_chain_cell_close(a_cell);
-            l_total_wrote_bytes = -3;
-            break;
-        }
-        l_total_wrote_bytes += l_atom_size;
-        if(a_cell->chain && a_cell->chain->callback_notify)
-            a_cell->chain->callback_notify(a_cell->chain->callback_notify_arg,
-                                           a_cell->chain,
-                                           a_cell->id,
-                                           (void *)l_atom,
-                                           l_atom_size);
     }
-    if (l_total_wrote_bytes > 0) {
-        fflush(a_cell->file_storage);
-        if (!a_atom) {
-            ftruncate(fileno(a_cell->file_storage), l_total_wrote_bytes + sizeof(dap_chain_cell_file_header_t));
-            log_it(L_DEBUG, "Saved %zu atoms (total %zu bytes", l_count, l_total_wrote_bytes);
-        }
-    } else if (!a_atom) {
-        log_it(L_WARNING, "Nothing to save, event table is empty");
+    if (!l_ret && l_checked) {
+        // All checked atoms are in the cell file now, next call starts after them
+        pthread_mutex_lock(&a_cell->append_mutex);
+        a_cell->update_last_hash = l_last_hash;
+        a_cell->update_generation = l_generation;
+        pthread_mutex_unlock(&a_cell->append_mutex);
+    }
+    if (!l_ret) {
+        pthread_rwlock_rdlock(&a_cell->storage_rwlock);
+        l_ret = (int)MIN(s_cell_valid_end(a_cell) - sizeof(dap_chain_cell_file_header_t), (uint64_t)INT_MAX);
+        pthread_rwlock_unlock(&a_cell->storage_rwlock);
+        if (!l_ret)
+            log_it(L_WARNING, "Nothing to save, event table is empty");
     }
+    return l_ret;
+}
+
+/**
+ * @brief dap_chain_cell_atoms_count
+ * @param a_cell dap_chain_cell_t object
+ * @param a_generation[out] cell generation the count belongs to, may be NULL
+ * @return number of atoms in the cell file
+ */
+uint64_t dap_chain_cell_atoms_count(dap_chain_cell_t *a_cell, uint64_t *a_generation)
+{
+    if (!a_cell)
+        return 0;
+    pthread_rwlock_rdlock(&a_cell->storage_rwlock);
+    uint64_t l_count = a_cell->atoms_count;
+    if (a_generation)
+        *a_generation = a_cell->generation;
+    pthread_rwlock_unlock(&a_cell->storage_rwlock);
+    return l_count;
+}
 
+/**
+ * @brief dap_chain_cell_atom_pos_by_hash
+ * find atom position in the cell file by atom hash
+ * @param a_cell dap_chain_cell_t object
+ * @param a_atom_hash atom hash
+ * @param a_pos[out] atom position
+ * @return 0 if found, -1 if not
+ */
+int dap_chain_cell_atom_pos_by_hash(dap_chain_cell_t *a_cell, dap_chain_hash_fast_t *a_atom_hash, dap_chain_cell_atom_pos_t *a_pos)
+{
+    if (!a_cell || !a_atom_hash || !a_pos)
+        return -1;
+    dap_chain_cell_index_item_t *l_item = NULL;
+    pthread_rwlock_rdlock(&a_cell->storage_rwlock);
+    HASH_FIND(hh, a_cell->atoms_index, a_atom_hash, sizeof(*a_atom_hash), l_item);
+    if (l_item)
+        *a_pos = l_item->pos;
     pthread_rwlock_unlock(&a_cell->storage_rwlock);
-    if (l_atom_iter) {
-        a_cell->chain->callback_atom_iter_delete(l_atom_iter);
+    return l_item ? 0 : -1;
+}
+
+/**
+ * @brief dap_chain_cell_atom_pos_by_seq
+ * get atom position in the cell file by its sequence number
+ * @param a_cell dap_chain_cell_t object
+ * @param a_seq atom number in the cell file
+ * @param a_pos[out] atom position
+ * @return 0 if found, -1 if not
+ */
+int dap_chain_cell_atom_pos_by_seq(dap_chain_cell_t *a_cell, uint64_t a_seq, dap_chain_cell_atom_pos_t *a_pos)
+{
+    if (!a_cell || !a_pos)
+        return -1;
+    int l_ret = -1;
+    pthread_rwlock_rdlock(&a_cell->storage_rwlock);
+    if (a_seq < a_cell->atoms_count) {
+        *a_pos = a_cell->atoms[a_seq]->pos;
+        l_ret = 0;
     }
-    return (int)l_total_wrote_bytes;
+    pthread_rwlock_unlock(&a_cell->storage_rwlock);
+    return l_ret;
 }
 
 /**
- * @brief
- * return dap_chain_cell_file_append(a_cell, NULL, 0);
- * @param a_cell dap_chain_cell_t
- * @return
+ * @brief dap_chain_cell_atom_get
+ * get atom by its position right from the mapped cell file.
+ * Atoms appended after the last mapping are reached by mapping the file tail,
+ * mappings are kept, so returned pointer is valid as long as the cell is.
+ * All mappings are copy-on-write: the atom may be changed in memory, the cell file never is.
+ * @param a_cell dap_chain_cell_t object
+ * @param a_pos atom position
+ * @return pointer to the atom or NULL if error
  */
-int dap_chain_cell_file_update( dap_chain_cell_t * a_cell)
+void *dap_chain_cell_atom_get(dap_chain_cell_t *a_cell, const dap_chain_cell_atom_pos_t *a_pos)
 {
-    return dap_chain_cell_file_append(a_cell, NULL, 0);
+    if (!a_cell || !a_pos)
+        return NULL;
+    pthread_rwlock_rdlock(&a_cell->storage_rwlock);
+    uint8_t *l_ret = s_cell_map_find(a_cell, a_pos);
+    pthread_rwlock_unlock(&a_cell->storage_rwlock);
+    if (l_ret)
+        return l_ret;
+    pthread_rwlock_wrlock(&a_cell->storage_rwlock);
+    l_ret = s_cell_map_find(a_cell, a_pos);
+    if (!l_ret && a_cell->chain && !s_cell_map_tail(a_cell))
+        l_ret = s_cell_map_find(a_cell, a_pos);
+    pthread_rwlock_unlock(&a_cell->storage_rwlock);
+    return l_ret;
+}
+
+/**
+ * @brief dap_chain_cell_atom_get_by_seq
+ * get atom by its sequence number in the cell file. Position lookup and mapping are done under one lock,
+ * so the cell file rewritten meanwhile can't give the atom from another place
+ * @param a_cell dap_chain_cell_t object
+ * @param a_generation cell generation the sequence number was got in, see dap_chain_cell_atoms_count()
+ * @param a_seq atom number in the cell file
+ * @param a_pos[out] atom position
+ * @param a_hash[out] atom hash, may be NULL
+ * @return pointer to the atom, NULL if there is no such atom or the cell file was rewritten since a_generation
+ */
+void *dap_chain_cell_atom_get_by_seq(dap_chain_cell_t *a_cell, uint64_t a_generation, uint64_t a_seq,
+                                     dap_chain_cell_atom_pos_t *a_pos, dap_chain_hash_fast_t *a_hash)
+{
+    if (!a_cell || !a_pos)
+        return NULL;
+    uint8_t *l_ret = NULL;
+    pthread_rwlock_rdlock(&a_cell->storage_rwlock);
+    bool l_found = a_cell->generation == a_generation && a_seq < a_cell->atoms_count;
+    if (l_found) {
+        *a_pos = a_cell->atoms[a_seq]->pos;
+        if (a_hash)
+            *a_hash = a_cell->atoms[a_seq]->hash;
+        l_ret = s_cell_map_find(a_cell, a_pos);
+    }
+    pthread_rwlock_unlock(&a_cell->storage_rwlock);
+    if (l_ret || !l_found)
+        return l_ret;
+    pthread_rwlock_wrlock(&a_cell->storage_rwlock);
+    if (a_cell->generation == a_generation && a_seq < a_cell->atoms_count) {
+        *a_pos = a_cell->atoms[a_seq]->pos;
+        if (a_hash)
+            *a_hash = a_cell->atoms[a_seq]->hash;
+        l_ret = s_cell_map_find(a_cell, a_pos);
+        if (!l_ret && a_cell->chain && !s_cell_map_tail(a_cell))
+            l_ret = s_cell_map_find(a_cell, a_pos);
+    }
+    pthread_rwlock_unlock(&a_cell->storage_rwlock);
+    return l_ret;
+}
+
+/**
+ * @brief dap_chain_cell_file_convert
+ * convert cell file between raw and compressed formats offline.
+ * Atom positions don't change, so the sidecar index stays valid for the converted file
+ * @param a_src_path source cell file path
+ * @param a_dst_path destination cell file path
+ * @param a_compress true to produce compressed file, false for raw one
+ * @return number of converted atoms, <0 if error
+ */
+int dap_chain_cell_file_convert(const char *a_src_path, const char *a_dst_path, bool a_compress)
+{
+#ifndef DAP_CHAIN_CELL_ZSTD
+    if (a_compress) {
+        log_it(L_ERROR, "Built without zstd, can't compress cell files");
+        return -1;
+    }
+#endif
+    int l_fd = open(a_src_path, O_RDONLY);
+    if (l_fd < 0) {
+        log_it(L_ERROR, "Can't open cell file \"%s\"", a_src_path);
+        return -2;
+    }
+    struct stat l_st;
+    dap_chain_cell_map_t *l_map = NULL;
+    if (!fstat(l_fd, &l_st) && (size_t)l_st.st_size >= sizeof(dap_chain_cell_file_header_t))
+        l_map = s_cell_map_file(l_fd, (size_t)l_st.st_size);
+    close(l_fd);
+    dap_chain_cell_file_header_t *l_hdr = l_map ? (dap_chain_cell_file_header_t *)l_map->addr : NULL;
+    if (!l_hdr || l_hdr->signature != DAP_CHAIN_CELL_FILE_SIGNATURE) {
+        log_it(L_ERROR, "Wrong cell file \"%s\"", a_src_path);
+        if (l_map)
+            s_cell_map_delete(l_map);
+        return -3;
+    }
+    if (l_hdr->type == DAP_CHAIN_CELL_FILE_TYPE_COMPRESSED) {
+        uint64_t l_valid_size = 0;
+        dap_chain_cell_map_t *l_image = s_cell_frames_unpack(l_map->addr, l_map->size, sizeof(*l_hdr), &l_valid_size);
+        if (l_valid_size < l_map->size)
+            log_it(L_WARNING, "Cell file \"%s\" is broken after %"DAP_UINT64_FORMAT_U" bytes", a_src_path, l_valid_size);
+        s_cell_map_delete(l_map);
+        if (!(l_map = l_image))
+            return -4;
+    }
+    FILE *l_file = fopen(a_dst_path, "wb");
+    if (!l_file) {
+        log_it(L_ERROR, "Can't create cell file \"%s\"", a_dst_path);
+        s_cell_map_delete(l_map);
+        return -5;
+    }
+    dap_chain_cell_file_header_t l_hdr_new = *(dap_chain_cell_file_header_t *)l_map->addr;
+    l_hdr_new.type = a_compress ? DAP_CHAIN_CELL_FILE_TYPE_COMPRESSED : DAP_CHAIN_CELL_FILE_TYPE_RAW;
+    dap_chain_cell_writer_t l_writer;
+    int l_ret = s_cell_writer_start(&l_writer, l_file, &l_hdr_new) ? -6 : 0, l_count = 0;
+    uint64_t l_offset = sizeof(dap_chain_cell_file_header_t);
+    while (!l_ret && l_offset + sizeof(size_t) <= l_map->size) {
+        size_t l_el_size = *(size_t *)(l_map->addr + l_offset);
+        l_offset += sizeof(size_t);
+        if (!l_el_size || l_el_size > l_map->size - l_offset) {
+            log_it(L_WARNING, "Cell file \"%s\" is broken after %d atoms", a_src_path, l_count);
+            break;
+        }
+        uint64_t l_atom_offset;
+        if (s_cell_writer_atom(&l_writer, l_map->addr + l_offset, l_el_size, &l_atom_offset) < 0)
+            l_ret = -7;
+        else
+            l_count++;
+        l_offset += l_el_size;
+    }
+    if (s_cell_writer_finish(&l_writer) && !l_ret)
+        l_ret = -7;
+    if (fclose(l_file) && !l_ret)
+        l_ret = -7;
+    s_cell_map_delete(l_map);
+    if (l_ret) {
+        log_it(L_ERROR, "Can't write cell file \"%s\"", a_dst_path);
+        return l_ret;
+    }
+    return l_count;
 }
@@ -110,6 +110,8 @@ typedef struct dap_chain_ledger_token_item {
 typedef struct dap_chain_ledger_tx_item {
     dap_chain_hash_fast_t tx_hash_fast;
     dap_chain_datum_tx_t *tx;
+    uint64_t seq_num; // ledger-wide order of addition, not stored in GDB cache
+    dap_chain_datum_tx_items_view_t *items; // decoded items of tx, not stored in GDB cache
     struct {
         time_t ts_created;
         int n_outs;
@@ -128,6 +130,30 @@ typedef struct dap_chain_ledger_tx_spent_item {
 } dap_chain_ledger_tx_spent_item_t;
 
 
+// Transaction waiting in threshold for a missing previous tx or emission
+typedef struct dap_ledger_treshold_tx {
+    dap_chain_hash_fast_t tx_hash_fast;
+    dap_chain_datum_tx_t *tx;
+    size_t tx_size;
+    dap_chain_hash_fast_t wait_hash; // hash of missing previous tx or emission
+    struct dap_ledger_treshold_tx *wait_prev, *wait_next; // other txs waiting for the same hash
+    UT_hash_handle hh;
+} dap_ledger_treshold_tx_t;
+
+// Index of threshold txs by the hash they are waiting for
+typedef struct dap_ledger_treshold_wait {
+    dap_chain_hash_fast_t hash;
+    dap_ledger_treshold_tx_t *txs;
+    UT_hash_handle hh;
+} dap_ledger_treshold_wait_t;
+
+// Index of threshold emissions by the token ticker they are waiting for
+typedef struct dap_ledger_treshold_ticker {
+    char ticker[DAP_CHAIN_TICKER_SIZE_MAX];
+    dap_list_t *emissions;
+    UT_hash_handle hh;
+} dap_ledger_treshold_ticker_t;
+
 typedef struct dap_chain_ledger_tokenizer {
     char token_ticker[DAP_CHAIN_TICKER_SIZE_MAX];
     uint64_t sum;
@@ -149,6 +175,41 @@ typedef struct dap_chain_ledger_tx_bound {
     dap_chain_ledger_tx_item_t *item_out;
 } dap_chain_ledger_tx_bound_t;
 
+// History of address or token, growable array ordered by seq_num
+typedef struct dap_ledger_history_list {
+    dap_chain_ledger_history_item_t *items;
+    size_t count;
+    size_t size;
+} dap_ledger_history_list_t;
+
+typedef struct dap_ledger_history_addr {
+    dap_chain_addr_t addr;
+    dap_ledger_history_list_t list;
+    UT_hash_handle hh;
+} dap_ledger_history_addr_t;
+
+typedef struct dap_ledger_history_token {
+    char ticker[DAP_CHAIN_TICKER_SIZE_MAX];
+    dap_ledger_history_list_t list;
+    UT_hash_handle hh;
+} dap_ledger_history_token_t;
+
+// Tx history record as it stored in GDB cache, indexes are rebuilt from it on load
+typedef struct dap_ledger_history_out {
+    dap_chain_addr_t addr;
+    uint64_t value;
+    char token_ticker[DAP_CHAIN_TICKER_SIZE_MAX];
+} DAP_ALIGN_PACKED dap_ledger_history_out_t;
+
+typedef struct dap_ledger_history_record {
+    dap_chain_hash_fast_t tx_hash;
+    uint64_t seq_num;
+    uint64_t ts_created;
+    dap_chain_addr_t addr_from;
+    uint32_t outs_count;
+    dap_ledger_history_out_t outs[];
+} DAP_ALIGN_PACKED dap_ledger_history_record_t;
+
 // in-memory wallet balance
 typedef struct dap_ledger_wallet_balance {
     char *key;
@@ -167,28 +228,63 @@ typedef struct dap_ledger_cache_str_item {
     bool found;
 } dap_ledger_cache_str_item_t;
 
+// Number of independently locked parts of tx and balance indexes, must be a power of 2
+#define LEDGER_SHARDS_COUNT 16
+
+// Unspent and spent txs with the same hash always live in the same shard
+typedef struct dap_ledger_tx_shard {
+    dap_chain_ledger_tx_item_t *ledger_items;
+    dap_chain_ledger_tx_spent_item_t *spent_items;
+    pthread_rwlock_t rwlock;
+} dap_ledger_tx_shard_t;
+
+typedef struct dap_ledger_balance_shard {
+    dap_ledger_wallet_balance_t *balance_accounts;
+    pthread_rwlock_t rwlock;
+} dap_ledger_balance_shard_t;
+
+// Result of tx signatures verification done ahead of the tx processing
+typedef struct dap_ledger_tx_sign_item {
+    dap_chain_hash_fast_t tx_hash;
+    int result;
+    UT_hash_handle hh;
+} dap_ledger_tx_sign_item_t;
+
 // dap_ledget_t private section
 typedef struct dap_ledger_private {
     dap_chain_net_t * net;
-    // List of ledger - unspent transactions cache
-    dap_chain_ledger_tx_item_t *treshold_txs;
+    // Thresholds, insertion ordered so the head is always the oldest item
+    dap_ledger_treshold_tx_t *treshold_txs;
+    dap_ledger_treshold_wait_t *treshold_txs_waits;
     dap_chain_ledger_token_emission_item_t * treshold_emissions;
+    dap_ledger_treshold_ticker_t *treshold_emissions_waits;
+    dap_chain_ledger_treshold_info_t treshold_info;
 
-    dap_chain_ledger_tx_item_t *ledger_items;
-    dap_chain_ledger_tx_spent_item_t *spent_items;
+    // Ledger items & spent items sharded by first byte of tx hash
+    dap_ledger_tx_shard_t tx_shards[LEDGER_SHARDS_COUNT];
+    atomic_uint_fast64_t tx_seq_last;
 
     dap_chain_ledger_token_item_t *tokens;
 
-    dap_ledger_wallet_balance_t *balance_accounts;
+    // Tx history indexed by address and by token
+    dap_ledger_history_addr_t *history_addrs;
+    dap_ledger_history_token_t *history_tokens;
+    uint64_t history_seq_last;
+    pthread_rwlock_t history_rwlock;
+    bool history_rebuild; // History cache misses some cached txs, it's built again from chains on load
+
+    // Preverified tx signatures, filled by parallel chain loaders
+    dap_ledger_tx_sign_item_t *tx_signs;
+    pthread_rwlock_t tx_signs_rwlock;
+
+    // Wallet balances sharded by hash of "addr ticker" key
+    dap_ledger_balance_shard_t balance_shards[LEDGER_SHARDS_COUNT];
 
-    // for separate access to ledger
-    pthread_rwlock_t ledger_rwlock;
     // for separate access to tokens
     pthread_rwlock_t tokens_rwlock;
 
     pthread_rwlock_t treshold_txs_rwlock;
     pthread_rwlock_t treshold_emissions_rwlock;
-    pthread_rwlock_t balance_accounts_rwlock;
 
     uint16_t check_flags;
     bool check_ds;
@@ -206,11 +302,25 @@ typedef struct dap_ledger_private {
 } dap_ledger_private_t;
 #define PVT(a) ( (dap_ledger_private_t* ) a->_internal )
 
+static inline dap_ledger_tx_shard_t *s_tx_shard(dap_ledger_private_t *a_ledger_pvt, const dap_chain_hash_fast_t *a_tx_hash)
+{
+    return &a_ledger_pvt->tx_shards[a_tx_hash->raw[0] & (LEDGER_SHARDS_COUNT - 1)];
+}
+
+static inline dap_ledger_balance_shard_t *s_balance_shard(dap_ledger_private_t *a_ledger_pvt, const char *a_balance_key)
+{
+    unsigned l_hashv;
+    HASH_VALUE(a_balance_key, strlen(a_balance_key), l_hashv);
+    return &a_ledger_pvt->balance_shards[l_hashv & (LEDGER_SHARDS_COUNT - 1)];
+}
+
 
 static  dap_chain_ledger_tx_item_t* tx_item_find_by_addr(dap_ledger_t *a_ledger,
         const dap_chain_addr_t *a_addr, const char * a_token, dap_chain_hash_fast_t *a_tx_first_hash);
-static void s_treshold_emissions_proc( dap_ledger_t * a_ledger);
-static void s_treshold_txs_proc( dap_ledger_t * a_ledger);
+static void s_treshold_emissions_proc(dap_ledger_t *a_ledger, const char *a_token_ticker);
+static void s_treshold_txs_proc(dap_ledger_t *a_ledger, const dap_chain_hash_fast_t *a_hash);
+static int s_tx_add(dap_ledger_t *a_ledger, dap_chain_datum_tx_t *a_tx, dap_hash_fast_t *a_tx_hash, bool a_from_threshold,
+                    dap_chain_hash_fast_t *a_missing_hash);
 static int s_token_tsd_parse(dap_ledger_t * a_ledger, dap_chain_ledger_token_item_t *a_token_item , dap_chain_datum_token_t * a_token, size_t a_token_size);
 static int s_ledger_permissions_check(dap_chain_ledger_token_item_t *  a_token_item, uint16_t a_permission_id, const void * a_data,size_t a_data_size );
 static bool s_ledger_tps_callback(void *a_arg);
@@ -232,6 +342,9 @@ int dap_chain_ledger_init()
 {
     s_debug_more = dap_config_get_item_bool_default(g_config,"ledger","debug_more",false);
     s_token_supply_limit_disable = dap_config_get_item_bool_default(g_config,"ledger","token_supply_limit_disable",false);
+    s_treshold_txs_max = dap_config_get_item_uint32_default(g_config, "ledger", "treshold_txs_max", s_treshold_txs_max);
+    s_treshold_emissions_max = dap_config_get_item_uint32_default(g_config, "ledger", "treshold_emissions_max",
+                                                                  s_treshold_emissions_max);
     return 0;
 }
 
@@ -261,11 +374,15 @@ static dap_ledger_t * dap_chain_ledger_handle_new(void)
     l_ledger->_internal = l_ledger_pvt = DAP_NEW_Z(dap_ledger_private_t);
 
     // Initialize Read/Write Lock Attribute
-    pthread_rwlock_init(&l_ledger_pvt->ledger_rwlock, NULL); // PTHREAD_RWLOCK_INITIALIZER;
+    for (int i = 0; i < LEDGER_SHARDS_COUNT; i++) {
+        pthread_rwlock_init(&l_ledger_pvt->tx_shards[i].rwlock, NULL);
+        pthread_rwlock_init(&l_ledger_pvt->balance_shards[i].rwlock, NULL);
+    }
     pthread_rwlock_init(&l_ledger_pvt->tokens_rwlock, NULL);
     pthread_rwlock_init(&l_ledger_pvt->treshold_txs_rwlock , NULL);
     pthread_rwlock_init(&l_ledger_pvt->treshold_emissions_rwlock , NULL);
-    pthread_rwlock_init(&l_ledger_pvt->balance_accounts_rwlock , NULL);
+    pthread_rwlock_init(&l_ledger_pvt->history_rwlock, NULL);
+    pthread_rwlock_init(&l_ledger_pvt->tx_signs_rwlock, NULL);
     return l_ledger;
 }
 
@@ -280,11 +397,16 @@ void dap_chain_ledger_handle_free(dap_ledger_t *a_ledger)
         return;
     log_it(L_INFO,"Ledger %s destroyed", a_ledger->net_name);
     // Destroy Read/Write Lock
-    pthread_rwlock_destroy(&PVT(a_ledger)->ledger_rwlock);
+    for (int i = 0; i < LEDGER_SHARDS_COUNT; i++) {
+        pthread_rwlock_destroy(&PVT(a_ledger)->tx_shards[i].rwlock);
+        pthread_rwlock_destroy(&PVT(a_ledger)->balance_shards[i].rwlock);
+    }
     pthread_rwlock_destroy(&PVT(a_ledger)->tokens_rwlock);
     pthread_rwlock_destroy(&PVT(a_ledger)->treshold_txs_rwlock );
     pthread_rwlock_destroy(&PVT(a_ledger)->treshold_emissions_rwlock );
-    pthread_rwlock_destroy(&PVT(a_ledger)->balance_accounts_rwlock );
+    pthread_rwlock_destroy(&PVT(a_ledger)->history_rwlock);
+    dap_chain_ledger_tx_sign_preverify_clear(a_ledger);
+    pthread_rwlock_destroy(&PVT(a_ledger)->tx_signs_rwlock);
     DAP_DELETE(PVT(a_ledger));
     DAP_DELETE(a_ledger);
 
@@ -293,6 +415,7 @@ void dap_chain_ledger_handle_free(dap_ledger_t *a_ledger)
 void dap_chain_ledger_load_end(dap_ledger_t *a_ledger)
 {
     PVT(a_ledger)->load_mode = false;
+    PVT(a_ledger)->history_rebuild = false;
 }
 
 
@@ -455,8 +578,8 @@ int dap_chain_ledger_token_add(dap_ledger_t * a_ledger,  dap_chain_datum_token_t
         if(s_debug_more)
             log_it(L_WARNING,"Unknown token declaration type 0x%04X", a_token->type );
     }
-    // Proc emissions tresholds
-    s_treshold_emissions_proc( a_ledger); //TODO process thresholds only for no-consensus chains
+    // Proc emissions waiting for this token
+    s_treshold_emissions_proc(a_ledger, l_token_item->ticker); //TODO process thresholds only for no-consensus chains
 
     return  0;
 }
@@ -958,61 +1081,256 @@ dap_list_t *dap_chain_ledger_token_info(dap_ledger_t *a_ledger)
 }
 
 /**
- * @brief s_treshold_emissions_proc
+ * @brief s_treshold_tx_wait
+ * Index threshold tx by the hash it waits for, treshold_txs_rwlock must be locked for write
+ * @param a_ledger_pvt
+ * @param a_tx
+ * @param a_wait_hash
+ */
+static void s_treshold_tx_wait(dap_ledger_private_t *a_ledger_pvt, dap_ledger_treshold_tx_t *a_tx,
+                               const dap_chain_hash_fast_t *a_wait_hash)
+{
+    dap_ledger_treshold_wait_t *l_wait = NULL;
+    memcpy(&a_tx->wait_hash, a_wait_hash, sizeof(dap_chain_hash_fast_t));
+    HASH_FIND(hh, a_ledger_pvt->treshold_txs_waits, a_wait_hash, sizeof(dap_chain_hash_fast_t), l_wait);
+    if (!l_wait) {
+        l_wait = DAP_NEW_Z(dap_ledger_treshold_wait_t);
+        memcpy(&l_wait->hash, a_wait_hash, sizeof(dap_chain_hash_fast_t));
+        HASH_ADD(hh, a_ledger_pvt->treshold_txs_waits, hash, sizeof(dap_chain_hash_fast_t), l_wait);
+    }
+    DL_APPEND2(l_wait->txs, a_tx, wait_prev, wait_next);
+}
+
+/**
+ * @brief s_treshold_tx_unwait
+ * Remove threshold tx from the waiting index, treshold_txs_rwlock must be locked for write
+ * @param a_ledger_pvt
+ * @param a_tx
+ */
+static void s_treshold_tx_unwait(dap_ledger_private_t *a_ledger_pvt, dap_ledger_treshold_tx_t *a_tx)
+{
+    dap_ledger_treshold_wait_t *l_wait = NULL;
+    HASH_FIND(hh, a_ledger_pvt->treshold_txs_waits, &a_tx->wait_hash, sizeof(dap_chain_hash_fast_t), l_wait);
+    if (!l_wait)
+        return;
+    DL_DELETE2(l_wait->txs, a_tx, wait_prev, wait_next);
+    if (!l_wait->txs) {
+        HASH_DEL(a_ledger_pvt->treshold_txs_waits, l_wait);
+        DAP_DELETE(l_wait);
+    }
+}
+
+/**
+ * @brief s_treshold_txs_add
+ * Put tx into threshold until a_wait_hash appears in ledger. When threshold is full the oldest tx is evicted
  * @param a_ledger
+ * @param a_tx
+ * @param a_tx_hash
+ * @param a_wait_hash hash of missing previous tx or emission
+ * @return true if tx was added, false if it's already in threshold
  */
-static void s_treshold_emissions_proc(dap_ledger_t * a_ledger)
-{ 
-    bool l_success;
-    do {
-        l_success = false;
-        dap_chain_ledger_token_emission_item_t *l_emission_item, *l_emission_tmp;
-        pthread_rwlock_rdlock(&PVT(a_ledger)->treshold_emissions_rwlock);
-        HASH_ITER(hh, PVT(a_ledger)->treshold_emissions, l_emission_item, l_emission_tmp) {
-            pthread_rwlock_unlock(&PVT(a_ledger)->treshold_emissions_rwlock);
-            int l_res = dap_chain_ledger_token_emission_add(a_ledger, (byte_t *)l_emission_item->datum_token_emission,
-                                                            l_emission_item->datum_token_emission_size);
-            if (l_res != DAP_CHAIN_CS_VERIFY_CODE_TX_NO_TOKEN) {
-                pthread_rwlock_wrlock(&PVT(a_ledger)->treshold_emissions_rwlock);
-                HASH_DEL(PVT(a_ledger)->treshold_emissions, l_emission_item);
-                pthread_rwlock_unlock(&PVT(a_ledger)->treshold_emissions_rwlock);
-                DAP_DELETE(l_emission_item);
-                l_success = true;
+static bool s_treshold_txs_add(dap_ledger_t *a_ledger, dap_chain_datum_tx_t *a_tx, dap_chain_hash_fast_t *a_tx_hash,
+                               const dap_chain_hash_fast_t *a_wait_hash)
+{
+    dap_ledger_private_t *l_ledger_pvt = PVT(a_ledger);
+    dap_chain_ledger_treshold_info_t *l_info = &l_ledger_pvt->treshold_info;
+    dap_ledger_treshold_tx_t *l_item = NULL;
+    pthread_rwlock_wrlock(&l_ledger_pvt->treshold_txs_rwlock);
+    HASH_FIND(hh, l_ledger_pvt->treshold_txs, a_tx_hash, sizeof(dap_chain_hash_fast_t), l_item);
+    if (l_item) {
+        pthread_rwlock_unlock(&l_ledger_pvt->treshold_txs_rwlock);
+        return false;
+    }
+    while (l_ledger_pvt->treshold_txs && HASH_COUNT(l_ledger_pvt->treshold_txs) >= s_treshold_txs_max) {
+        dap_ledger_treshold_tx_t *l_oldest = l_ledger_pvt->treshold_txs;
+        HASH_DEL(l_ledger_pvt->treshold_txs, l_oldest);
+        s_treshold_tx_unwait(l_ledger_pvt, l_oldest);
+        l_info->txs_size -= sizeof(dap_ledger_treshold_tx_t) + l_oldest->tx_size;
+        l_info->txs_evicted++;
+        if (s_debug_more) {
+            char l_hash_str[70];
+            dap_chain_hash_fast_to_str(&l_oldest->tx_hash_fast, l_hash_str, sizeof(l_hash_str));
+            log_it(L_WARNING, "Treshold for transactions is overfulled (%zu max), tx %s evicted", s_treshold_txs_max, l_hash_str);
+        }
+        DAP_DELETE(l_oldest->tx);
+        DAP_DELETE(l_oldest);
+    }
+    l_item = DAP_NEW_Z(dap_ledger_treshold_tx_t);
+    memcpy(&l_item->tx_hash_fast, a_tx_hash, sizeof(dap_chain_hash_fast_t));
+    l_item->tx_size = dap_chain_datum_tx_get_size(a_tx);
+    l_item->tx = DAP_DUP_SIZE(a_tx, l_item->tx_size);
+    HASH_ADD(hh, l_ledger_pvt->treshold_txs, tx_hash_fast, sizeof(dap_chain_hash_fast_t), l_item);
+    s_treshold_tx_wait(l_ledger_pvt, l_item, a_wait_hash);
+    l_info->txs_added++;
+    l_info->txs_size += sizeof(dap_ledger_treshold_tx_t) + l_item->tx_size;
+    if (HASH_COUNT(l_ledger_pvt->treshold_txs) > l_info->txs_count_max)
+        l_info->txs_count_max = HASH_COUNT(l_ledger_pvt->treshold_txs);
+    pthread_rwlock_unlock(&l_ledger_pvt->treshold_txs_rwlock);
+    return true;
+}
+
+/**
+ * @brief s_treshold_emissions_add
+ * Put emission into threshold until its token is declared, treshold_emissions_rwlock must be locked for write.
+ * When threshold is full the oldest emission is evicted
+ * @param a_ledger_pvt
+ * @param a_emission_item
+ */
+static void s_treshold_emissions_add(dap_ledger_private_t *a_ledger_pvt, dap_chain_ledger_token_emission_item_t *a_emission_item)
+{
+    dap_chain_ledger_treshold_info_t *l_info = &a_ledger_pvt->treshold_info;
+    dap_ledger_treshold_ticker_t *l_wait = NULL;
+    while (a_ledger_pvt->treshold_emissions && HASH_COUNT(a_ledger_pvt->treshold_emissions) >= s_treshold_emissions_max) {
+        dap_chain_ledger_token_emission_item_t *l_oldest = a_ledger_pvt->treshold_emissions;
+        HASH_DEL(a_ledger_pvt->treshold_emissions, l_oldest);
+        HASH_FIND_STR(a_ledger_pvt->treshold_emissions_waits, l_oldest->datum_token_emission->hdr.ticker, l_wait);
+        if (l_wait) {
+            l_wait->emissions = dap_list_remove(l_wait->emissions, l_oldest);
+            if (!l_wait->emissions) {
+                HASH_DEL(a_ledger_pvt->treshold_emissions_waits, l_wait);
+                DAP_DELETE(l_wait);
             }
+        }
+        l_info->emissions_size -= sizeof(dap_chain_ledger_token_emission_item_t) + l_oldest->datum_token_emission_size;
+        l_info->emissions_evicted++;
+        if (s_debug_more)
+            log_it(L_WARNING, "Treshold for emissions is overfulled (%zu max), emission of %s evicted",
+                   s_treshold_emissions_max, l_oldest->datum_token_emission->hdr.ticker);
+        DAP_DELETE(l_oldest->datum_token_emission);
+        DAP_DELETE(l_oldest);
+    }
+    HASH_ADD(hh, a_ledger_pvt->treshold_emissions, datum_token_emission_hash,
+             sizeof(dap_chain_hash_fast_t), a_emission_item);
+    const char *l_ticker = a_emission_item->datum_token_emission->hdr.ticker;
+    HASH_FIND_STR(a_ledger_pvt->treshold_emissions_waits, l_ticker, l_wait);
+    if (!l_wait) {
+        l_wait = DAP_NEW_Z(dap_ledger_treshold_ticker_t);
+        dap_snprintf(l_wait->ticker, sizeof(l_wait->ticker), "%s", l_ticker);
+        HASH_ADD_STR(a_ledger_pvt->treshold_emissions_waits, ticker, l_wait);
+    }
+    l_wait->emissions = dap_list_append(l_wait->emissions, a_emission_item);
+    l_info->emissions_added++;
+    l_info->emissions_size += sizeof(dap_chain_ledger_token_emission_item_t) + a_emission_item->datum_token_emission_size;
+    if (HASH_COUNT(a_ledger_pvt->treshold_emissions) > l_info->emissions_count_max)
+        l_info->emissions_count_max = HASH_COUNT(a_ledger_pvt->treshold_emissions);
+}
 
-            pthread_rwlock_rdlock(&PVT(a_ledger)->treshold_emissions_rwlock);
+/**
+ * @brief s_treshold_emissions_proc
+ * Add emissions waiting for just declared token
+ * @param a_ledger
+ * @param a_token_ticker
+ */
+static void s_treshold_emissions_proc(dap_ledger_t *a_ledger, const char *a_token_ticker)
+{
+    dap_ledger_private_t *l_ledger_pvt = PVT(a_ledger);
+    dap_ledger_treshold_ticker_t *l_wait = NULL;
+    dap_list_t *l_woken = NULL;
+    pthread_rwlock_wrlock(&l_ledger_pvt->treshold_emissions_rwlock);
+    HASH_FIND_STR(l_ledger_pvt->treshold_emissions_waits, a_token_ticker, l_wait);
+    if (l_wait) {
+        HASH_DEL(l_ledger_pvt->treshold_emissions_waits, l_wait);
+        l_woken = l_wait->emissions;
+        DAP_DELETE(l_wait);
+        for (dap_list_t *it = l_woken; it; it = it->next) {
+            dap_chain_ledger_token_emission_item_t *l_emission_item = it->data;
+            HASH_DEL(l_ledger_pvt->treshold_emissions, l_emission_item);
+            l_ledger_pvt->treshold_info.emissions_size -= sizeof(dap_chain_ledger_token_emission_item_t) +
+                                                          l_emission_item->datum_token_emission_size;
         }
-        pthread_rwlock_unlock(&PVT(a_ledger)->treshold_emissions_rwlock);
-    } while (l_success); 
+    }
+    pthread_rwlock_unlock(&l_ledger_pvt->treshold_emissions_rwlock);
+    for (dap_list_t *it = l_woken; it; it = it->next) {
+        dap_chain_ledger_token_emission_item_t *l_emission_item = it->data;
+        int l_res = dap_chain_ledger_token_emission_add(a_ledger, (byte_t *)l_emission_item->datum_token_emission,
+                                                        l_emission_item->datum_token_emission_size);
+        if (l_res != DAP_CHAIN_CS_VERIFY_CODE_TX_NO_TOKEN) {
+            pthread_rwlock_wrlock(&l_ledger_pvt->treshold_emissions_rwlock);
+            l_ledger_pvt->treshold_info.emissions_resolved++;
+            pthread_rwlock_unlock(&l_ledger_pvt->treshold_emissions_rwlock);
+        }
+        DAP_DELETE(l_emission_item->datum_token_emission);
+        DAP_DELETE(l_emission_item);
+    }
+    dap_list_free(l_woken);
 }
 
 /**
  * @brief s_treshold_txs_proc
+ * Add txs waiting for just appeared tx or emission, then txs waiting for them and so on
  * @param a_ledger
+ * @param a_hash hash of tx or emission added to ledger
  */
-static void s_treshold_txs_proc( dap_ledger_t *a_ledger)
-{  
-    bool l_success;
-    dap_ledger_private_t * l_ledger_pvt = PVT(a_ledger);
-    do {
-        l_success = false;
-        dap_chain_ledger_tx_item_t *l_tx_item, *l_tx_tmp;
-        pthread_rwlock_rdlock(&l_ledger_pvt->treshold_txs_rwlock);
-        HASH_ITER(hh, l_ledger_pvt->treshold_txs, l_tx_item, l_tx_tmp) {            
-            pthread_rwlock_unlock(& l_ledger_pvt->treshold_txs_rwlock );
-            int l_res = dap_chain_ledger_tx_add(a_ledger, l_tx_item->tx, &l_tx_item->tx_hash_fast, true);
-            if (l_res != DAP_CHAIN_CS_VERIFY_CODE_TX_NO_EMISSION &&
-                    l_res != DAP_CHAIN_CS_VERIFY_CODE_TX_NO_PREVIOUS) {
-                pthread_rwlock_wrlock(&l_ledger_pvt->treshold_txs_rwlock);
-                HASH_DEL(l_ledger_pvt->treshold_txs, l_tx_item);
-                pthread_rwlock_unlock(& l_ledger_pvt->treshold_txs_rwlock );                          
-                DAP_DELETE(l_tx_item);
-                l_success = true;
-            }
-            pthread_rwlock_rdlock(&l_ledger_pvt->treshold_txs_rwlock);
+static void s_treshold_txs_proc(dap_ledger_t *a_ledger, const dap_chain_hash_fast_t *a_hash)
+{
+    dap_ledger_private_t *l_ledger_pvt = PVT(a_ledger);
+    dap_chain_ledger_treshold_info_t *l_info = &l_ledger_pvt->treshold_info;
+    dap_list_t *l_hashes = dap_list_append(NULL, DAP_DUP(a_hash));
+    while (l_hashes) {
+        dap_chain_hash_fast_t *l_hash = l_hashes->data;
+        l_hashes = dap_list_delete_link(l_hashes, l_hashes);
+        dap_ledger_treshold_tx_t *l_woken = NULL, *l_tx, *l_tmp;
+        dap_ledger_treshold_wait_t *l_wait = NULL;
+        pthread_rwlock_wrlock(&l_ledger_pvt->treshold_txs_rwlock);
+        HASH_FIND(hh, l_ledger_pvt->treshold_txs_waits, l_hash, sizeof(dap_chain_hash_fast_t), l_wait);
+        if (l_wait) {
+            HASH_DEL(l_ledger_pvt->treshold_txs_waits, l_wait);
+            l_woken = l_wait->txs;
+            DAP_DELETE(l_wait);
+            DL_FOREACH2(l_woken, l_tx, wait_next)
+                HASH_DEL(l_ledger_pvt->treshold_txs, l_tx);
         }
-        pthread_rwlock_unlock(& l_ledger_pvt->treshold_txs_rwlock );
-    } while (l_success);
+        pthread_rwlock_unlock(&l_ledger_pvt->treshold_txs_rwlock);
+        DAP_DELETE(l_hash);
+        DL_FOREACH_SAFE2(l_woken, l_tx, l_tmp, wait_next) {
+            dap_chain_hash_fast_t l_missing_hash = {};
+            int l_res = s_tx_add(a_ledger, l_tx->tx, &l_tx->tx_hash_fast, true, &l_missing_hash);
+            bool l_requeued = false;
+            pthread_rwlock_wrlock(&l_ledger_pvt->treshold_txs_rwlock);
+            if (l_res == DAP_CHAIN_CS_VERIFY_CODE_TX_NO_PREVIOUS || l_res == DAP_CHAIN_CS_VERIFY_CODE_TX_NO_EMISSION) {
+                // Another parent is still missing, wait for it
+                dap_ledger_treshold_tx_t *l_dup = NULL;
+                HASH_FIND(hh, l_ledger_pvt->treshold_txs, &l_tx->tx_hash_fast, sizeof(dap_chain_hash_fast_t), l_dup);
+                if (!l_dup) {
+                    HASH_ADD(hh, l_ledger_pvt->treshold_txs, tx_hash_fast, sizeof(dap_chain_hash_fast_t), l_tx);
+                    s_treshold_tx_wait(l_ledger_pvt, l_tx, &l_missing_hash);
+                    l_requeued = true;
+                }
+            } else if (l_res < 0)
+                l_info->txs_dropped++;
+            else
+                l_info->txs_resolved++;
+            if (!l_requeued)
+                l_info->txs_size -= sizeof(dap_ledger_treshold_tx_t) + l_tx->tx_size;
+            pthread_rwlock_unlock(&l_ledger_pvt->treshold_txs_rwlock);
+            if (l_requeued)
+                continue;
+            if (l_res >= 0)
+                l_hashes = dap_list_append(l_hashes, DAP_DUP(&l_tx->tx_hash_fast));
+            DAP_DELETE(l_tx->tx);
+            DAP_DELETE(l_tx);
+        }
+    }
+}
+
+/**
+ * @brief dap_chain_ledger_treshold_info
+ * Get current depth, size and counters of threshold queues
+ * @param a_ledger
+ * @param a_info
+ */
+void dap_chain_ledger_treshold_info(dap_ledger_t *a_ledger, dap_chain_ledger_treshold_info_t *a_info)
+{
+    dap_ledger_private_t *l_ledger_pvt = PVT(a_ledger);
+    pthread_rwlock_rdlock(&l_ledger_pvt->treshold_txs_rwlock);
+    pthread_rwlock_rdlock(&l_ledger_pvt->treshold_emissions_rwlock);
+    *a_info = l_ledger_pvt->treshold_info;
+    a_info->txs_count = HASH_COUNT(l_ledger_pvt->treshold_txs);
+    a_info->txs_limit = s_treshold_txs_max;
+    a_info->emissions_count = HASH_COUNT(l_ledger_pvt->treshold_emissions);
+    a_info->emissions_limit = s_treshold_emissions_max;
+    pthread_rwlock_unlock(&l_ledger_pvt->treshold_emissions_rwlock);
+    pthread_rwlock_unlock(&l_ledger_pvt->treshold_txs_rwlock);
 }
 
 /**
@@ -1075,6 +1393,290 @@ bool s_update_token_cache(dap_ledger_t *a_ledger, dap_chain_ledger_token_item_t
     return true;
 }
 
+static void s_history_list_add(dap_ledger_history_list_t *a_list, const dap_chain_ledger_history_item_t *a_item)
+{
+    if (a_list->count == a_list->size) {
+        a_list->size = a_list->size ? a_list->size * 2 : 8;
+        a_list->items = DAP_REALLOC(a_list->items, a_list->size * sizeof(dap_chain_ledger_history_item_t));
+    }
+    a_list->items[a_list->count++] = *a_item;
+}
+
+static void s_history_addr_add(dap_ledger_private_t *a_ledger_pvt, const dap_chain_addr_t *a_addr,
+                               const dap_chain_ledger_history_item_t *a_item)
+{
+    dap_ledger_history_addr_t *l_history_addr = NULL;
+    HASH_FIND(hh, a_ledger_pvt->history_addrs, a_addr, sizeof(dap_chain_addr_t), l_history_addr);
+    if (!l_history_addr) {
+        l_history_addr = DAP_NEW_Z(dap_ledger_history_addr_t);
+        memcpy(&l_history_addr->addr, a_addr, sizeof(dap_chain_addr_t));
+        HASH_ADD(hh, a_ledger_pvt->history_addrs, addr, sizeof(dap_chain_addr_t), l_history_addr);
+    }
+    s_history_list_add(&l_history_addr->list, a_item);
+}
+
+static void s_history_token_add(dap_ledger_private_t *a_ledger_pvt, const dap_chain_ledger_history_item_t *a_item)
+{
+    dap_ledger_history_token_t *l_history_token = NULL;
+    HASH_FIND_STR(a_ledger_pvt->history_tokens, a_item->token_ticker, l_history_token);
+    if (!l_history_token) {
+        l_history_token = DAP_NEW_Z(dap_ledger_history_token_t);
+        dap_stpcpy(l_history_token->ticker, a_item->token_ticker);
+        HASH_ADD_STR(a_ledger_pvt->history_tokens, ticker, l_history_token);
+    }
+    s_history_list_add(&l_history_token->list, a_item);
+}
+
+/**
+ * @brief s_history_index
+ * Add transfers of tx history record to address and token indexes, history_rwlock must be locked for writing
+ * @param a_ledger_pvt
+ * @param a_record
+ */
+static void s_history_index(dap_ledger_private_t *a_ledger_pvt, const dap_ledger_history_record_t *a_record)
+{
+    static const dap_chain_addr_t l_addr_blank = {};
+    bool l_has_sender = memcmp(&a_record->addr_from, &l_addr_blank, sizeof(dap_chain_addr_t));
+    dap_chain_ledger_history_item_t l_item = {
+        .tx_hash = a_record->tx_hash,
+        .seq_num = a_record->seq_num,
+        .ts_created = (time_t)a_record->ts_created,
+        .addr_from = a_record->addr_from
+    };
+    for (uint32_t i = 0; i < a_record->outs_count; i++) {
+        const dap_ledger_history_out_t *l_out = &a_record->outs[i];
+        if (l_has_sender && !memcmp(&l_out->addr, &a_record->addr_from, sizeof(dap_chain_addr_t)))
+            continue;   // send to self
+        l_item.value = l_out->value;
+        memcpy(&l_item.addr_to, &l_out->addr, sizeof(dap_chain_addr_t));
+        memcpy(l_item.token_ticker, l_out->token_ticker, DAP_CHAIN_TICKER_SIZE_MAX);
+        l_item.token_ticker[DAP_CHAIN_TICKER_SIZE_MAX - 1] = '\0';
+        l_item.direction = DAP_CHAIN_LEDGER_HISTORY_TRANSFER;
+        s_history_token_add(a_ledger_pvt, &l_item);
+        if (l_has_sender) {
+            l_item.direction = DAP_CHAIN_LEDGER_HISTORY_SEND;
+            s_history_addr_add(a_ledger_pvt, &a_record->addr_from, &l_item);
+        }
+        l_item.direction = DAP_CHAIN_LEDGER_HISTORY_RECV;
+        s_history_addr_add(a_ledger_pvt, &l_out->addr, &l_item);
+    }
+}
+
+/**
+ * @brief s_history_add
+ * Index transfers of just added tx and store its history record in GDB cache
+ * @param a_ledger
+ * @param a_tx
+ * @param a_tx_hash
+ * @param a_items decoded items of a_tx
+ * @param a_addr_from sender address, blank if unknown
+ * @param a_token_ticker ticker of OUT items
+ */
+static void s_history_add(dap_ledger_t *a_ledger, dap_chain_datum_tx_t *a_tx, dap_chain_hash_fast_t *a_tx_hash,
+                          dap_chain_datum_tx_items_view_t *a_items, dap_chain_addr_t *a_addr_from, const char *a_token_ticker)
+{
+    dap_ledger_private_t *l_ledger_pvt = PVT(a_ledger);
+    size_t l_record_size = sizeof(dap_ledger_history_record_t) + a_items->out_count * sizeof(dap_ledger_history_out_t);
+    dap_ledger_history_record_t *l_record = DAP_NEW_Z_SIZE(dap_ledger_history_record_t, l_record_size);
+    memcpy(&l_record->tx_hash, a_tx_hash, sizeof(dap_chain_hash_fast_t));
+    memcpy(&l_record->addr_from, a_addr_from, sizeof(dap_chain_addr_t));
+    l_record->ts_created = a_tx->header.ts_created;
+    for (int i = 0; i < a_items->out_count; i++) {
+        dap_ledger_history_out_t *l_out = &l_record->outs[l_record->outs_count];
+        switch (*a_items->out[i]) {
+        case TX_ITEM_TYPE_OUT: {
+            dap_chain_tx_out_t *l_tx_out = (dap_chain_tx_out_t *)a_items->out[i];
+            if (!a_token_ticker || !*a_token_ticker)
+                continue;
+            memcpy(&l_out->addr, &l_tx_out->addr, sizeof(dap_chain_addr_t));
+            l_out->value = l_tx_out->header.value;
+            dap_stpcpy(l_out->token_ticker, a_token_ticker);
+        } break;
+        case TX_ITEM_TYPE_OUT_EXT: {
+            dap_chain_tx_out_ext_t *l_tx_out_ext = (dap_chain_tx_out_ext_t *)a_items->out[i];
+            memcpy(&l_out->addr, &l_tx_out_ext->addr, sizeof(dap_chain_addr_t));
+            l_out->value = l_tx_out_ext->header.value;
+            memcpy(l_out->token_ticker, l_tx_out_ext->token, DAP_CHAIN_TICKER_SIZE_MAX - 1);
+        } break;
+        default:    // conditional outs are not transfers to address
+            continue;
+        }
+        l_record->outs_count++;
+    }
+    l_record_size = sizeof(dap_ledger_history_record_t) + l_record->outs_count * sizeof(dap_ledger_history_out_t);
+
+    pthread_rwlock_wrlock(&l_ledger_pvt->history_rwlock);
+    l_record->seq_num = ++l_ledger_pvt->history_seq_last;
+    s_history_index(l_ledger_pvt, l_record);
+    pthread_rwlock_unlock(&l_ledger_pvt->history_rwlock);
+
+    // Key is zero-padded to keep records in order of addition
+    char *l_gdb_group = dap_chain_ledger_get_gdb_group(a_ledger, DAP_CHAIN_LEDGER_HISTORY_STR);
+    if (!dap_chain_global_db_gr_set(dap_strdup_printf("%016"DAP_UINT64_FORMAT_x, l_record->seq_num),
+                                    l_record, l_record_size, l_gdb_group)) {
+        if(s_debug_more)
+            log_it(L_WARNING, "Ledger history cache mismatch");
+    }
+    DAP_DELETE(l_gdb_group);
+}
+
+/**
+ * @brief s_history_backfill
+ * Index tx which is already in ledger cache but not in history cache. Sender address is taken
+ * from the previous tx of the first regular in, it's looked up in chains if it's spent
+ * @param a_ledger
+ * @param a_tx
+ * @param a_tx_hash
+ * @param a_token_ticker ticker of OUT items
+ */
+static void s_history_backfill(dap_ledger_t *a_ledger, dap_chain_datum_tx_t *a_tx, dap_chain_hash_fast_t *a_tx_hash,
+                               const char *a_token_ticker)
+{
+    dap_chain_datum_tx_items_view_t *l_items = dap_chain_datum_tx_items_view_create(a_tx);
+    if (!l_items)
+        return;
+    dap_chain_addr_t l_addr_from = {};
+    for (int i = 0; i < l_items->in_count; i++) {
+        dap_chain_hash_fast_t *l_prev_hash = &l_items->in[i]->header.tx_prev_hash;
+        if (dap_hash_fast_is_blank(l_prev_hash))
+            continue;   // emission
+        dap_chain_datum_tx_t *l_tx_prev = dap_chain_ledger_tx_find_by_hash(a_ledger, l_prev_hash);
+        if (!l_tx_prev && PVT(a_ledger)->net)
+            l_tx_prev = dap_chain_net_get_tx_by_hash(PVT(a_ledger)->net, l_prev_hash, TX_SEARCH_TYPE_NET);
+        dap_chain_datum_tx_items_view_t *l_items_prev = l_tx_prev ? dap_chain_datum_tx_items_view_create(l_tx_prev) : NULL;
+        uint32_t l_idx = l_items->in[i]->header.tx_out_prev_idx;
+        if (l_items_prev && l_idx < (uint32_t)l_items_prev->out_count) {
+            if (*l_items_prev->out[l_idx] == TX_ITEM_TYPE_OUT)
+                memcpy(&l_addr_from, &((dap_chain_tx_out_t *)l_items_prev->out[l_idx])->addr, sizeof(dap_chain_addr_t));
+            else if (*l_items_prev->out[l_idx] == TX_ITEM_TYPE_OUT_EXT)
+                memcpy(&l_addr_from, &((dap_chain_tx_out_ext_t *)l_items_prev->out[l_idx])->addr, sizeof(dap_chain_addr_t));
+        }
+        DAP_DEL_Z(l_items_prev);
+        break;
+    }
+    s_history_add(a_ledger, a_tx, a_tx_hash, l_items, &l_addr_from, a_token_ticker);
+    DAP_DELETE(l_items);
+}
+
+static int s_history_record_compare(const void *a_rec1, const void *a_rec2)
+{
+    uint64_t l_seq1 = (*(dap_ledger_history_record_t **)a_rec1)->seq_num,
+             l_seq2 = (*(dap_ledger_history_record_t **)a_rec2)->seq_num;
+    return l_seq1 < l_seq2 ? -1 : l_seq1 > l_seq2;
+}
+
+/**
+ * @brief s_history_load_cache
+ * Rebuild history indexes from records stored in GDB cache
+ * @param a_ledger
+ */
+static void s_history_load_cache(dap_ledger_t *a_ledger)
+{
+    dap_ledger_private_t *l_ledger_pvt = PVT(a_ledger);
+    char *l_gdb_group = dap_chain_ledger_get_gdb_group(a_ledger, DAP_CHAIN_LEDGER_HISTORY_STR);
+    size_t l_objs_count = 0;
+    dap_global_db_obj_t *l_objs = dap_chain_global_db_gr_load(l_gdb_group, &l_objs_count);
+    dap_ledger_history_record_t **l_records = l_objs_count
+            ? DAP_NEW_Z_SIZE(dap_ledger_history_record_t *, l_objs_count * sizeof(dap_ledger_history_record_t *))
+            : NULL;
+    size_t l_records_count = 0;
+    for (size_t i = 0; i < l_objs_count; i++) {
+        dap_ledger_history_record_t *l_record = (dap_ledger_history_record_t *)l_objs[i].value;
+        if (l_objs[i].value_len < sizeof(dap_ledger_history_record_t) ||
+                l_objs[i].value_len != sizeof(dap_ledger_history_record_t) + l_record->outs_count * sizeof(dap_ledger_history_out_t)) {
+            log_it(L_WARNING, "Corrupted ledger history record %s", l_objs[i].key);
+            continue;
+        }
+        l_records[l_records_count++] = l_record;
+    }
+    // History group appeared after the ledger cache or lost some records, so it's built again
+    // from chains while they are loaded, as txs come in chain order
+    size_t l_txs_count = 0;
+    for (int i = 0; i < LEDGER_SHARDS_COUNT; i++)
+        l_txs_count += HASH_COUNT(l_ledger_pvt->tx_shards[i].ledger_items) + HASH_COUNT(l_ledger_pvt->tx_shards[i].spent_items);
+    if (l_records_count < l_txs_count) {
+        log_it(L_NOTICE, "Ledger history cache has %zu records for %zu txs, it will be rebuilt from chains",
+               l_records_count, l_txs_count);
+        dap_chain_global_db_gr_del(NULL, l_gdb_group);
+        l_ledger_pvt->history_rebuild = true;
+        l_records_count = 0;
+    }
+    // GDB driver doesn't guarantee the order of keys
+    if (l_records_count)
+        qsort(l_records, l_records_count, sizeof(dap_ledger_history_record_t *), s_history_record_compare);
+    pthread_rwlock_wrlock(&l_ledger_pvt->history_rwlock);
+    for (size_t i = 0; i < l_records_count; i++) {
+        s_history_index(l_ledger_pvt, l_records[i]);
+        if (l_records[i]->seq_num > l_ledger_pvt->history_seq_last)
+            l_ledger_pvt->history_seq_last = l_records[i]->seq_num;
+    }
+    pthread_rwlock_unlock(&l_ledger_pvt->history_rwlock);
+    DAP_DELETE(l_records);
+    dap_chain_global_db_objs_delete(l_objs, l_objs_count);
+    DAP_DELETE(l_gdb_group);
+}
+
+static size_t s_history_list_get(dap_ledger_history_list_t *a_list, size_t a_offset, size_t a_count,
+                                 dap_chain_ledger_history_item_t **a_items, size_t *a_items_count)
+{
+    size_t l_count = 0;
+    if (a_list && a_offset < a_list->count) {
+        l_count = a_list->count - a_offset;
+        if (a_count && a_count < l_count)
+            l_count = a_count;
+    }
+    if (a_items)
+        *a_items = l_count ? DAP_DUP_SIZE(a_list->items + a_offset, l_count * sizeof(dap_chain_ledger_history_item_t)) : NULL;
+    if (a_items_count)
+        *a_items_count = l_count;
+    return a_list ? a_list->count : 0;
+}
+
+/**
+ * @brief dap_chain_ledger_history_addr
+ * Get a page of address history, takes time proportional to the page size
+ * @param a_ledger
+ * @param a_addr
+ * @param a_offset number of oldest items to skip
+ * @param a_count max number of items, 0 - no limit
+ * @param a_items page of history items, must be freed by caller
+ * @param a_items_count number of items in page
+ * @return size_t total number of items in address history
+ */
+size_t dap_chain_ledger_history_addr(dap_ledger_t *a_ledger, const dap_chain_addr_t *a_addr, size_t a_offset, size_t a_count,
+                                     dap_chain_ledger_history_item_t **a_items, size_t *a_items_count)
+{
+    dap_ledger_private_t *l_ledger_pvt = PVT(a_ledger);
+    dap_ledger_history_addr_t *l_history_addr = NULL;
+    pthread_rwlock_rdlock(&l_ledger_pvt->history_rwlock);
+    HASH_FIND(hh, l_ledger_pvt->history_addrs, a_addr, sizeof(dap_chain_addr_t), l_history_addr);
+    size_t l_ret = s_history_list_get(l_history_addr ? &l_history_addr->list : NULL, a_offset, a_count, a_items, a_items_count);
+    pthread_rwlock_unlock(&l_ledger_pvt->history_rwlock);
+    return l_ret;
+}
+
+/**
+ * @brief dap_chain_ledger_history_token
+ * Get a page of token transfers history, takes time proportional to the page size
+ * @param a_ledger
+ * @param a_token_ticker
+ * @param a_offset number of oldest items to skip
+ * @param a_count max number of items, 0 - no limit
+ * @param a_items page of history items, must be freed by caller
+ * @param a_items_count number of items in page
+ * @return size_t total number of items in token history
+ */
+size_t dap_chain_ledger_history_token(dap_ledger_t *a_ledger, const char *a_token_ticker, size_t a_offset, size_t a_count,
+                                      dap_chain_ledger_history_item_t **a_items, size_t *a_items_count)
+{
+    dap_ledger_private_t *l_ledger_pvt = PVT(a_ledger);
+    dap_ledger_history_token_t *l_history_token = NULL;
+    pthread_rwlock_rdlock(&l_ledger_pvt->history_rwlock);
+    HASH_FIND_STR(l_ledger_pvt->history_tokens, a_token_ticker, l_history_token);
+    size_t l_ret = s_history_list_get(l_history_token ? &l_history_token->list : NULL, a_offset, a_count, a_items, a_items_count);
+    pthread_rwlock_unlock(&l_ledger_pvt->history_rwlock);
+    return l_ret;
+}
 
 void dap_chain_ledger_load_cache(dap_ledger_t *a_ledger)
 {
@@ -1131,8 +1733,7 @@ void dap_chain_ledger_load_cache(dap_ledger_t *a_ledger)
             HASH_ADD(hh, l_token_item->token_emissions, datum_token_emission_hash,
                      sizeof(dap_chain_hash_fast_t), l_emission_item);
         } else {
-            HASH_ADD(hh, l_ledger_pvt->treshold_emissions, datum_token_emission_hash,
-                     sizeof(dap_chain_hash_fast_t), l_emission_item);
+            s_treshold_emissions_add(l_ledger_pvt, l_emission_item);
         }
     }
     dap_chain_global_db_objs_delete(l_objs, l_objs_count);
@@ -1147,7 +1748,10 @@ void dap_chain_ledger_load_cache(dap_ledger_t *a_ledger)
         l_tx_item->tx = DAP_NEW_Z_SIZE(dap_chain_datum_tx_t, l_objs[i].value_len - sizeof(l_tx_item->cache_data));
         memcpy(l_tx_item->tx, l_objs[i].value + sizeof(l_tx_item->cache_data), l_objs[i].value_len - sizeof(l_tx_item->cache_data));
         memcpy(&l_tx_item->cache_data, l_objs[i].value, sizeof(l_tx_item->cache_data));
-        HASH_ADD(hh, l_ledger_pvt->ledger_items, tx_hash_fast, sizeof(dap_chain_hash_fast_t), l_tx_item);
+        l_tx_item->items = dap_chain_datum_tx_items_view_create(l_tx_item->tx);
+        l_tx_item->seq_num = ++l_ledger_pvt->tx_seq_last;
+        dap_ledger_tx_shard_t *l_shard = s_tx_shard(l_ledger_pvt, &l_tx_item->tx_hash_fast);
+        HASH_ADD(hh, l_shard->ledger_items, tx_hash_fast, sizeof(dap_chain_hash_fast_t), l_tx_item);
     }
     dap_chain_global_db_objs_delete(l_objs, l_objs_count);
     DAP_DELETE(l_gdb_group);
@@ -1159,7 +1763,8 @@ void dap_chain_ledger_load_cache(dap_ledger_t *a_ledger)
         dap_chain_ledger_tx_spent_item_t *l_tx_spent_item = DAP_NEW_Z(dap_chain_ledger_tx_spent_item_t);
         dap_chain_hash_fast_from_str(l_objs[i].key, &l_tx_spent_item->tx_hash_fast);
         strncpy(l_tx_spent_item->token_ticker, (char *)l_objs[i].value, DAP_CHAIN_TICKER_SIZE_MAX);
-        HASH_ADD(hh, l_ledger_pvt->spent_items, tx_hash_fast, sizeof(dap_chain_hash_fast_t), l_tx_spent_item);
+        dap_ledger_tx_shard_t *l_shard = s_tx_shard(l_ledger_pvt, &l_tx_spent_item->tx_hash_fast);
+        HASH_ADD(hh, l_shard->spent_items, tx_hash_fast, sizeof(dap_chain_hash_fast_t), l_tx_spent_item);
     }
     dap_chain_global_db_objs_delete(l_objs, l_objs_count);
     DAP_DELETE(l_gdb_group);
@@ -1176,7 +1781,8 @@ void dap_chain_ledger_load_cache(dap_ledger_t *a_ledger)
             strcpy(l_balance_item->token_ticker, l_ptr);
         }
         l_balance_item->balance = *(uint128_t *)l_objs[i].value;
-        HASH_ADD_KEYPTR(hh, l_ledger_pvt->balance_accounts, l_balance_item->key,
+        dap_ledger_balance_shard_t *l_shard = s_balance_shard(l_ledger_pvt, l_balance_item->key);
+        HASH_ADD_KEYPTR(hh, l_shard->balance_accounts, l_balance_item->key,
                         strlen(l_balance_item->key), l_balance_item);
         /* notify dashboard */
         struct json_object *l_json = wallet_info_json_collect(a_ledger, l_balance_item);
@@ -1185,6 +1791,8 @@ void dap_chain_ledger_load_cache(dap_ledger_t *a_ledger)
     }
     dap_chain_global_db_objs_delete(l_objs, l_objs_count);
     DAP_DELETE(l_gdb_group);
+
+    s_history_load_cache(a_ledger);
 }
 
 /**
@@ -1242,7 +1850,6 @@ int dap_chain_ledger_token_emission_add_check(dap_ledger_t *a_ledger, byte_t *a_
                                        : &l_ledger_priv->treshold_emissions_rwlock);
     HASH_FIND(hh,l_token_item ? l_token_item->token_emissions : l_ledger_priv->treshold_emissions,
               &l_token_emission_hash, sizeof(l_token_emission_hash), l_token_emission_item);
-    unsigned long long l_threshold_emissions_count = HASH_COUNT( l_ledger_priv->treshold_emissions);
     pthread_rwlock_unlock(l_token_item ? &l_token_item->token_emissions_rwlock
                                        : &l_ledger_priv->treshold_emissions_rwlock);
     if(l_token_emission_item ) {
@@ -1250,11 +1857,6 @@ int dap_chain_ledger_token_emission_add_check(dap_ledger_t *a_ledger, byte_t *a_
             log_it(L_ERROR, "Can't add token emission datum of %"DAP_UINT64_FORMAT_U" %s ( %s ): already present in cache",
                 l_token_emission_item->datum_token_emission->hdr.value, c_token_ticker, l_hash_str);
         l_ret = -1;
-    }else if ( (! l_token_item) && ( l_threshold_emissions_count >= s_treshold_emissions_max)) {
-        if(s_debug_more)
-            log_it(L_WARNING,"Treshold for emissions is overfulled (%zu max)",
-               s_treshold_emissions_max);
-        l_ret = -2;
     }
     DAP_DELETE(l_hash_str);
     if (l_ret || !PVT(a_ledger)->check_token_emission)
@@ -1337,69 +1939,63 @@ int dap_chain_ledger_token_emission_add(dap_ledger_t *a_ledger, byte_t *a_token_
                                         : &l_ledger_priv->treshold_emissions_rwlock);
     HASH_FIND(hh,l_token_item ? l_token_item->token_emissions : l_ledger_priv->treshold_emissions,
               &l_token_emission_hash, sizeof(l_token_emission_hash), l_token_emission_item);
-    unsigned long long l_threshold_emissions_count = HASH_COUNT( l_ledger_priv->treshold_emissions);
     pthread_rwlock_unlock(l_token_item ? &l_token_item->token_emissions_rwlock
                                        : &l_ledger_priv->treshold_emissions_rwlock);
     if(l_token_emission_item == NULL ) {
-        if ( l_token_item || l_threshold_emissions_count < s_treshold_emissions_max  ) {
-            l_token_emission_item = DAP_NEW_Z(dap_chain_ledger_token_emission_item_t);
-            size_t l_emission_size = a_token_emission_size;
-            l_token_emission_item->datum_token_emission = l_token_item
-                                                                     ? dap_chain_datum_emission_read(a_token_emission, &l_emission_size)
-                                                                     : DAP_DUP_SIZE(a_token_emission, a_token_emission_size);
-            memcpy(l_token_emission_item->datum_token_emission, a_token_emission, a_token_emission_size);
-            memcpy(&l_token_emission_item->datum_token_emission_hash,
-                   &l_token_emission_hash, sizeof(l_token_emission_hash));
-
-            //
-            // update token current_supply_
-            // 
-
-            if (!PVT(a_ledger)->load_mode && l_token_item && !s_token_supply_limit_disable){
-                if (!s_update_token_cache(a_ledger, l_token_item, l_token_emission_item->datum_token_emission->hdr.value))
-                   return DAP_CHAIN_CS_VERIFY_CODE_TX_NO_EMISSION;
-            }
-
-            if (s_token_supply_limit_disable)
-                log_it(L_WARNING,"s_token_supply_limit_disable is enabled in config, please fix it and disable");
+        l_token_emission_item = DAP_NEW_Z(dap_chain_ledger_token_emission_item_t);
+        size_t l_emission_size = a_token_emission_size;
+        l_token_emission_item->datum_token_emission = l_token_item
+                                                                 ? dap_chain_datum_emission_read(a_token_emission, &l_emission_size)
+                                                                 : DAP_DUP_SIZE(a_token_emission, a_token_emission_size);
+        memcpy(l_token_emission_item->datum_token_emission, a_token_emission, a_token_emission_size);
+        memcpy(&l_token_emission_item->datum_token_emission_hash,
+               &l_token_emission_hash, sizeof(l_token_emission_hash));
+
+        //
+        // update token current_supply_
+        // 
+
+        if (!PVT(a_ledger)->load_mode && l_token_item && !s_token_supply_limit_disable){
+            if (!s_update_token_cache(a_ledger, l_token_item, l_token_emission_item->datum_token_emission->hdr.value))
+               return DAP_CHAIN_CS_VERIFY_CODE_TX_NO_EMISSION;
+        }
 
-            l_token_emission_item->datum_token_emission_size = a_token_emission_size;
-            pthread_rwlock_wrlock( l_token_item ? &l_token_item->token_emissions_rwlock
-                                                : &l_ledger_priv->treshold_emissions_rwlock);
-            if (l_token_item) {
-                HASH_ADD(hh, l_token_item->token_emissions, datum_token_emission_hash,
-                         sizeof(l_token_emission_hash), l_token_emission_item);
-            } else {
-                HASH_ADD(hh, l_ledger_priv->treshold_emissions, datum_token_emission_hash,
-                         sizeof(l_token_emission_hash), l_token_emission_item);
-                l_ret = DAP_CHAIN_CS_VERIFY_CODE_TX_NO_TOKEN;
-            }
-            pthread_rwlock_unlock( l_token_item ? &l_token_item->token_emissions_rwlock
-                                                : &l_ledger_priv->treshold_emissions_rwlock);
-            if (l_token_item) {
-                // Add it to cache
-                dap_chain_datum_token_emission_t *l_emission_cache = DAP_DUP_SIZE(a_token_emission, a_token_emission_size);
-                char *l_gdb_group = dap_chain_ledger_get_gdb_group(a_ledger, DAP_CHAIN_LEDGER_EMISSIONS_STR);
-                if (!dap_chain_global_db_gr_set(dap_strdup(l_hash_str), l_emission_cache, a_token_emission_size, l_gdb_group)) {
-                    log_it(L_WARNING, "Ledger cache mismatch");
-                   // DAP_DELETE(l_emission_cache);
-                }
-                DAP_DELETE(l_gdb_group);
-            }            char * l_token_emission_address_str = dap_chain_addr_to_str(&(l_token_emission_item->datum_token_emission->hdr.address) );
-            if(s_debug_more)
-                log_it(L_NOTICE, "Added token emission datum to %s: type=%s value=%.1Lf token=%s to_addr=%s ",
-                           l_token_item?"emissions cache":"emissions treshold",
-                           c_dap_chain_datum_token_emission_type_str[l_token_emission_item->datum_token_emission->hdr.type ] ,
-                           dap_chain_datoshi_to_coins(l_token_emission_item->datum_token_emission->hdr.value), c_token_ticker,
-                           l_token_emission_address_str);
+        if (s_token_supply_limit_disable)
+            log_it(L_WARNING,"s_token_supply_limit_disable is enabled in config, please fix it and disable");
+
+        l_token_emission_item->datum_token_emission_size = a_token_emission_size;
+        // Log before insertion, threshold item may be evicted by another thread right after it
+        if(s_debug_more) {
+            char * l_token_emission_address_str = dap_chain_addr_to_str(&(l_token_emission_item->datum_token_emission->hdr.address) );
+            log_it(L_NOTICE, "Added token emission datum to %s: type=%s value=%.1Lf token=%s to_addr=%s ",
+                       l_token_item?"emissions cache":"emissions treshold",
+                       c_dap_chain_datum_token_emission_type_str[l_token_emission_item->datum_token_emission->hdr.type ] ,
+                       dap_chain_datoshi_to_coins(l_token_emission_item->datum_token_emission->hdr.value), c_token_ticker,
+                       l_token_emission_address_str);
             DAP_DELETE(l_token_emission_address_str);
-            if (l_token_item)
-                s_treshold_txs_proc(a_ledger);
-        }else{
-            if(s_debug_more)
-                log_it(L_WARNING,"Treshold for emissions is overfulled (%zu max), dropping down new data, added nothing",
-                   s_treshold_emissions_max);
-            l_ret = -2;
+        }
+        pthread_rwlock_wrlock( l_token_item ? &l_token_item->token_emissions_rwlock
+                                            : &l_ledger_priv->treshold_emissions_rwlock);
+        if (l_token_item) {
+            HASH_ADD(hh, l_token_item->token_emissions, datum_token_emission_hash,
+                     sizeof(l_token_emission_hash), l_token_emission_item);
+        } else {
+            s_treshold_emissions_add(l_ledger_priv, l_token_emission_item);
+            l_ret = DAP_CHAIN_CS_VERIFY_CODE_TX_NO_TOKEN;
+        }
+        pthread_rwlock_unlock( l_token_item ? &l_token_item->token_emissions_rwlock
+                                            : &l_ledger_priv->treshold_emissions_rwlock);
+        if (l_token_item) {
+            // Add it to cache
+            dap_chain_datum_token_emission_t *l_emission_cache = DAP_DUP_SIZE(a_token_emission, a_token_emission_size);
+            char *l_gdb_group = dap_chain_ledger_get_gdb_group(a_ledger, DAP_CHAIN_LEDGER_EMISSIONS_STR);
+            if (!dap_chain_global_db_gr_set(dap_strdup(l_hash_str), l_emission_cache, a_token_emission_size, l_gdb_group)) {
+                log_it(L_WARNING, "Ledger cache mismatch");
+               // DAP_DELETE(l_emission_cache);
+            }
+            DAP_DELETE(l_gdb_group);
+            // Wake up txs waiting for this emission
+            s_treshold_txs_proc(a_ledger, &l_token_emission_hash);
         }
     } else {
         if (l_token_item) {
@@ -1499,15 +2095,16 @@ const char* dap_chain_ledger_tx_get_token_ticker_by_hash(dap_ledger_t *a_ledger,
         return NULL;
 
     dap_chain_ledger_tx_item_t *l_item;
-    pthread_rwlock_rdlock(&l_ledger_priv->ledger_rwlock);
-    HASH_FIND(hh, l_ledger_priv->ledger_items, a_tx_hash, sizeof (*a_tx_hash), l_item);
+    dap_ledger_tx_shard_t *l_shard = s_tx_shard(l_ledger_priv, a_tx_hash);
+    pthread_rwlock_rdlock(&l_shard->rwlock);
+    HASH_FIND(hh, l_shard->ledger_items, a_tx_hash, sizeof (*a_tx_hash), l_item);
     if (l_item) {
-        pthread_rwlock_unlock(&l_ledger_priv->ledger_rwlock);
+        pthread_rwlock_unlock(&l_shard->rwlock);
             return l_item->cache_data.token_ticker;
     }
     dap_chain_ledger_tx_spent_item_t *l_spent_item;
-    HASH_FIND(hh, l_ledger_priv->spent_items, a_tx_hash, sizeof (*a_tx_hash), l_spent_item);
-    pthread_rwlock_unlock(&l_ledger_priv->ledger_rwlock);
+    HASH_FIND(hh, l_shard->spent_items, a_tx_hash, sizeof (*a_tx_hash), l_spent_item);
+    pthread_rwlock_unlock(&l_shard->rwlock);
     return l_spent_item ? l_spent_item->token_ticker : NULL;
 }
 
@@ -1562,23 +2159,29 @@ void dap_chain_ledger_addr_get_token_ticker_all(dap_ledger_t *a_ledger, dap_chai
 void dap_chain_ledger_addr_get_token_ticker_all_fast(dap_ledger_t *a_ledger, dap_chain_addr_t * a_addr,
         char *** a_tickers, size_t * a_tickers_size) {
     dap_ledger_wallet_balance_t *wallet_balance, *tmp;
-    size_t l_count = HASH_COUNT(PVT(a_ledger)->balance_accounts);
-    if(l_count){
-        char **l_tickers = DAP_NEW_Z_SIZE(char*, l_count * sizeof(char*));
-        l_count = 0;
-        char *l_addr = dap_chain_addr_to_str(a_addr);
-        pthread_rwlock_rdlock(&PVT(a_ledger)->balance_accounts_rwlock);
-        HASH_ITER(hh, PVT(a_ledger)->balance_accounts, wallet_balance, tmp) {
+    char **l_tickers = NULL;
+    size_t l_count = 0, l_tickers_size = 0;
+    char *l_addr = dap_chain_addr_to_str(a_addr);
+    for (int i = 0; i < LEDGER_SHARDS_COUNT; i++) {
+        dap_ledger_balance_shard_t *l_shard = &PVT(a_ledger)->balance_shards[i];
+        pthread_rwlock_rdlock(&l_shard->rwlock);
+        HASH_ITER(hh, l_shard->balance_accounts, wallet_balance, tmp) {
             char **l_keys = dap_strsplit(wallet_balance->key, " ", -1);
             if (!dap_strcmp(l_keys[0], l_addr)) {
+                if (l_count == l_tickers_size) {
+                    l_tickers_size = l_tickers_size ? l_tickers_size * 2 : 8;
+                    l_tickers = DAP_REALLOC(l_tickers, l_tickers_size * sizeof(char*));
+                }
                 l_tickers[l_count] = dap_strdup(wallet_balance->token_ticker);
                 ++l_count;
             }
             dap_strfreev(l_keys);
         }
-        pthread_rwlock_unlock(&PVT(a_ledger)->balance_accounts_rwlock);
-        *a_tickers = l_tickers;
+        pthread_rwlock_unlock(&l_shard->rwlock);
     }
+    DAP_DELETE(l_addr);
+    if (l_count)
+        *a_tickers = l_tickers;
     *a_tickers_size = l_count;
 }
 
@@ -1600,9 +2203,10 @@ static dap_chain_datum_tx_t* s_find_datum_tx_by_hash(dap_ledger_t *a_ledger,
     dap_ledger_private_t *l_ledger_priv = PVT(a_ledger);
     dap_chain_datum_tx_t *l_tx_ret = NULL;
     dap_chain_ledger_tx_item_t *l_tx_item;
-    pthread_rwlock_rdlock(&l_ledger_priv->ledger_rwlock);
-    HASH_FIND(hh, l_ledger_priv->ledger_items, a_tx_hash, sizeof(dap_chain_hash_fast_t), l_tx_item); // tx_hash already in the hash?
-    pthread_rwlock_unlock(&l_ledger_priv->ledger_rwlock);
+    dap_ledger_tx_shard_t *l_shard = s_tx_shard(l_ledger_priv, a_tx_hash);
+    pthread_rwlock_rdlock(&l_shard->rwlock);
+    HASH_FIND(hh, l_shard->ledger_items, a_tx_hash, sizeof(dap_chain_hash_fast_t), l_tx_item); // tx_hash already in the hash?
+    pthread_rwlock_unlock(&l_shard->rwlock);
     if(l_tx_item) {
         l_tx_ret = l_tx_item->tx;
         if(a_item_out)
@@ -1625,12 +2229,77 @@ dap_chain_datum_tx_t* dap_chain_ledger_tx_find_by_hash(dap_ledger_t *a_ledger, d
 bool dap_chain_ledger_tx_spent_find_by_hash(dap_ledger_t *a_ledger, dap_chain_hash_fast_t *a_tx_hash)
 {
     dap_chain_ledger_tx_spent_item_t *l_tx_item;
-    pthread_rwlock_rdlock(&PVT(a_ledger)->ledger_rwlock);
-    HASH_FIND(hh, PVT(a_ledger)->spent_items, a_tx_hash, sizeof(dap_chain_hash_fast_t), l_tx_item);
-    pthread_rwlock_unlock(&PVT(a_ledger)->ledger_rwlock);
+    dap_ledger_tx_shard_t *l_shard = s_tx_shard(PVT(a_ledger), a_tx_hash);
+    pthread_rwlock_rdlock(&l_shard->rwlock);
+    HASH_FIND(hh, l_shard->spent_items, a_tx_hash, sizeof(dap_chain_hash_fast_t), l_tx_item);
+    pthread_rwlock_unlock(&l_shard->rwlock);
     return l_tx_item;
 }
 
+/**
+ * @brief s_tx_iter_lock_from
+ * Read-lock tx shards one by one starting from *a_shard_idx until non-empty one is found
+ * @return first item of locked shard or NULL if no shards left (nothing is locked then)
+ */
+static dap_chain_ledger_tx_item_t *s_tx_iter_lock_from(dap_ledger_private_t *a_ledger_pvt, int *a_shard_idx)
+{
+    for ( ; *a_shard_idx < LEDGER_SHARDS_COUNT; (*a_shard_idx)++) {
+        dap_ledger_tx_shard_t *l_shard = &a_ledger_pvt->tx_shards[*a_shard_idx];
+        pthread_rwlock_rdlock(&l_shard->rwlock);
+        if (l_shard->ledger_items)
+            return l_shard->ledger_items;
+        pthread_rwlock_unlock(&l_shard->rwlock);
+    }
+    return NULL;
+}
+
+/**
+ * @brief s_tx_iter_first
+ * Start ledger-wide iteration over unspent txs. Only the shard of current item is locked
+ * @param a_tx_prev_hash if not blank, iteration continues from the next item after this one
+ * @param a_shard_idx [out] current shard index, must be passed to s_tx_iter_next() & s_tx_iter_stop()
+ * @return
+ */
+static dap_chain_ledger_tx_item_t *s_tx_iter_first(dap_ledger_private_t *a_ledger_pvt, const dap_chain_hash_fast_t *a_tx_prev_hash,
+                                                   int *a_shard_idx)
+{
+    *a_shard_idx = 0;
+    if (!a_tx_prev_hash || dap_hash_fast_is_blank((dap_chain_hash_fast_t *)a_tx_prev_hash))
+        return s_tx_iter_lock_from(a_ledger_pvt, a_shard_idx);
+    *a_shard_idx = a_tx_prev_hash->raw[0] & (LEDGER_SHARDS_COUNT - 1);
+    dap_ledger_tx_shard_t *l_shard = &a_ledger_pvt->tx_shards[*a_shard_idx];
+    dap_chain_ledger_tx_item_t *l_item;
+    pthread_rwlock_rdlock(&l_shard->rwlock);
+    HASH_FIND(hh, l_shard->ledger_items, a_tx_prev_hash, sizeof(dap_chain_hash_fast_t), l_item);
+    if (!l_item) {
+        // Previous item is gone, nothing to continue from
+        pthread_rwlock_unlock(&l_shard->rwlock);
+        *a_shard_idx = LEDGER_SHARDS_COUNT;
+        return NULL;
+    }
+    if (l_item->hh.next)
+        return l_item->hh.next;
+    pthread_rwlock_unlock(&l_shard->rwlock);
+    (*a_shard_idx)++;
+    return s_tx_iter_lock_from(a_ledger_pvt, a_shard_idx);
+}
+
+static dap_chain_ledger_tx_item_t *s_tx_iter_next(dap_ledger_private_t *a_ledger_pvt, dap_chain_ledger_tx_item_t *a_item,
+                                                  int *a_shard_idx)
+{
+    if (a_item->hh.next)
+        return a_item->hh.next;
+    pthread_rwlock_unlock(&a_ledger_pvt->tx_shards[*a_shard_idx].rwlock);
+    (*a_shard_idx)++;
+    return s_tx_iter_lock_from(a_ledger_pvt, a_shard_idx);
+}
+
+static void s_tx_iter_stop(dap_ledger_private_t *a_ledger_pvt, int a_shard_idx)
+{
+    if (a_shard_idx < LEDGER_SHARDS_COUNT)
+        pthread_rwlock_unlock(&a_ledger_pvt->tx_shards[a_shard_idx].rwlock);
+}
+
 /**
  * Check whether used 'out' items (local function)
  */
@@ -1698,14 +2367,94 @@ static int s_ledger_permissions_check(dap_chain_ledger_token_item_t *  a_token_i
     return -10;
 }
 
+/**
+ * @brief Verify tx signatures ahead of its processing and remember the result
+ * @details Thread-safe, intended to be called from parallel chain loaders while the tx is still waiting for its turn
+ * @param a_ledger
+ * @param a_tx
+ */
+void dap_chain_ledger_tx_sign_preverify(dap_ledger_t *a_ledger, dap_chain_datum_tx_t *a_tx)
+{
+    if (!a_ledger || !a_tx)
+        return;
+    dap_ledger_private_t *l_ledger_priv = PVT(a_ledger);
+    dap_chain_hash_fast_t l_tx_hash;
+    dap_hash_fast(a_tx, dap_chain_datum_tx_get_size(a_tx), &l_tx_hash);
+    // Txs already known from the ledger cache are skipped on load, don't waste time on them
+    dap_chain_ledger_tx_item_t *l_tx_item;
+    dap_chain_ledger_tx_spent_item_t *l_tx_spent_item;
+    dap_ledger_tx_shard_t *l_shard = s_tx_shard(l_ledger_priv, &l_tx_hash);
+    pthread_rwlock_rdlock(&l_shard->rwlock);
+    HASH_FIND(hh, l_shard->ledger_items, &l_tx_hash, sizeof(dap_chain_hash_fast_t), l_tx_item);
+    HASH_FIND(hh, l_shard->spent_items, &l_tx_hash, sizeof(dap_chain_hash_fast_t), l_tx_spent_item);
+    pthread_rwlock_unlock(&l_shard->rwlock);
+    if (l_tx_item || l_tx_spent_item)
+        return;
+    dap_ledger_tx_sign_item_t *l_sign_item = DAP_NEW_Z(dap_ledger_tx_sign_item_t);
+    l_sign_item->tx_hash = l_tx_hash;
+    l_sign_item->result = dap_chain_datum_tx_verify_sign(a_tx);
+    dap_ledger_tx_sign_item_t *l_sign_item_old;
+    pthread_rwlock_wrlock(&l_ledger_priv->tx_signs_rwlock);
+    HASH_FIND(hh, l_ledger_priv->tx_signs, &l_tx_hash, sizeof(dap_chain_hash_fast_t), l_sign_item_old);
+    if (!l_sign_item_old)
+        HASH_ADD(hh, l_ledger_priv->tx_signs, tx_hash, sizeof(dap_chain_hash_fast_t), l_sign_item);
+    pthread_rwlock_unlock(&l_ledger_priv->tx_signs_rwlock);
+    if (l_sign_item_old)
+        DAP_DELETE(l_sign_item);
+}
+
+/**
+ * @brief Drop all remembered results of tx signatures preverification
+ * @param a_ledger
+ */
+void dap_chain_ledger_tx_sign_preverify_clear(dap_ledger_t *a_ledger)
+{
+    dap_ledger_private_t *l_ledger_priv = PVT(a_ledger);
+    dap_ledger_tx_sign_item_t *l_sign_item, *l_tmp;
+    pthread_rwlock_wrlock(&l_ledger_priv->tx_signs_rwlock);
+    HASH_ITER(hh, l_ledger_priv->tx_signs, l_sign_item, l_tmp) {
+        HASH_DEL(l_ledger_priv->tx_signs, l_sign_item);
+        DAP_DELETE(l_sign_item);
+    }
+    pthread_rwlock_unlock(&l_ledger_priv->tx_signs_rwlock);
+}
+
+/**
+ * @brief Verify tx signatures, taking the preverified result if there is one
+ * @return 1 OK, otherwise error
+ */
+static int s_tx_verify_sign(dap_ledger_t *a_ledger, dap_chain_datum_tx_t *a_tx)
+{
+    dap_ledger_private_t *l_ledger_priv = PVT(a_ledger);
+    pthread_rwlock_rdlock(&l_ledger_priv->tx_signs_rwlock);
+    bool l_have_signs = l_ledger_priv->tx_signs != NULL;
+    pthread_rwlock_unlock(&l_ledger_priv->tx_signs_rwlock);
+    if (l_have_signs) {
+        dap_chain_hash_fast_t l_tx_hash;
+        dap_hash_fast(a_tx, dap_chain_datum_tx_get_size(a_tx), &l_tx_hash);
+        dap_ledger_tx_sign_item_t *l_sign_item;
+        pthread_rwlock_wrlock(&l_ledger_priv->tx_signs_rwlock);
+        HASH_FIND(hh, l_ledger_priv->tx_signs, &l_tx_hash, sizeof(dap_chain_hash_fast_t), l_sign_item);
+        if (l_sign_item)
+            HASH_DEL(l_ledger_priv->tx_signs, l_sign_item);
+        pthread_rwlock_unlock(&l_ledger_priv->tx_signs_rwlock);
+        if (l_sign_item) {
+            int l_ret = l_sign_item->result;
+            DAP_DELETE(l_sign_item);
+            return l_ret;
+        }
+    }
+    return dap_chain_datum_tx_verify_sign(a_tx);
+}
+
 /**
  * Checking a new transaction before adding to the cache
+ * a_missing_hash is set to the hash of absent previous tx or emission when the tx is a threshold candidate
  *
  * return 1 OK, -1 error
  */
-// Checking a new transaction before adding to the cache
-int dap_chain_ledger_tx_cache_check(dap_ledger_t *a_ledger, dap_chain_datum_tx_t *a_tx,
-        dap_list_t **a_list_bound_items, dap_list_t **a_list_tx_out)
+static int s_tx_cache_check(dap_ledger_t *a_ledger, dap_chain_datum_tx_t *a_tx, dap_chain_datum_tx_items_view_t *a_items,
+        dap_list_t **a_list_bound_items, dap_list_t **a_list_tx_out, dap_chain_hash_fast_t *a_missing_hash)
 {
     /*
      Steps of checking for current transaction tx2 and every previous transaction tx1:
@@ -1725,7 +2474,7 @@ int dap_chain_ledger_tx_cache_check(dap_ledger_t *a_ledger, dap_chain_datum_tx_t
      */
 
     dap_ledger_private_t *l_ledger_priv = PVT(a_ledger);
-    if(!a_tx){
+    if(!a_tx || !a_items){
         log_it(L_DEBUG, "NULL transaction, check broken");
         return -1;
     }
@@ -1742,38 +2491,27 @@ int dap_chain_ledger_tx_cache_check(dap_ledger_t *a_ledger, dap_chain_datum_tx_t
 
     // check all previous transactions
     int l_err_num = 0;
-    int l_prev_tx_count = 0;
+    bool l_sign_checked = false;
 
     // ----------------------------------------------------------------
-    // find all 'in' items in current transaction
-    dap_list_t *l_list_in = dap_chain_datum_tx_items_get((dap_chain_datum_tx_t*) a_tx, TX_ITEM_TYPE_IN,
-                                                          &l_prev_tx_count);
-    // find all conditional 'in' items in current transaction
-    dap_list_t *l_list_tmp = dap_chain_datum_tx_items_get((dap_chain_datum_tx_t *)a_tx, TX_ITEM_TYPE_IN_COND,
-                                                          &l_prev_tx_count);
-    if (l_list_tmp) {
-        // add conditional input to common list
-        l_list_in = dap_list_append(l_list_in, l_list_tmp->data);
-        dap_list_free(l_list_tmp);
-    }
-    l_list_tmp = l_list_in;
+    // all 'in' items of current transaction and the first conditional 'in' item after them
+    int l_in_total = a_items->in_count + (a_items->in_cond_count ? 1 : 0);
     dap_chain_ledger_tx_bound_t *bound_item;
-    int l_list_tmp_num = 0;
      // find all previous transactions
-    for (dap_list_t *l_list_tmp = l_list_in; l_list_tmp; l_list_tmp = dap_list_next(l_list_tmp), l_list_tmp_num++) {
+    for (int l_list_tmp_num = 0; l_list_tmp_num < l_in_total; l_list_tmp_num++) {
         bound_item = DAP_NEW_Z(dap_chain_ledger_tx_bound_t);
         dap_chain_tx_in_t *l_tx_in = NULL;
         dap_chain_addr_t l_tx_in_from={0};
         dap_chain_tx_in_cond_t *l_tx_in_cond;
         dap_chain_hash_fast_t l_tx_prev_hash={0};
-        uint8_t l_cond_type = *(uint8_t *)l_list_tmp->data;
+        uint8_t l_cond_type = l_list_tmp_num < a_items->in_count ? TX_ITEM_TYPE_IN : TX_ITEM_TYPE_IN_COND;
         // one of the previous transaction
         if (l_cond_type == TX_ITEM_TYPE_IN) {
-            l_tx_in = (dap_chain_tx_in_t *)l_list_tmp->data;
+            l_tx_in = a_items->in[l_list_tmp_num];
             l_tx_prev_hash = l_tx_in->header.tx_prev_hash;
             bound_item->in.tx_cur_in = l_tx_in;
         } else { // TX_ITEM_TYPE_IN_COND
-            l_tx_in_cond = (dap_chain_tx_in_cond_t *)l_list_tmp->data;
+            l_tx_in_cond = a_items->in_cond[0];
             l_tx_prev_hash = l_tx_in_cond->header.tx_prev_hash;
             bound_item->in.tx_cur_in_cond = l_tx_in_cond;
         }
@@ -1797,7 +2535,7 @@ int dap_chain_ledger_tx_cache_check(dap_ledger_t *a_ledger, dap_chain_datum_tx_t
             }
             l_is_first_transaction = true;
             if (!l_token) {
-                dap_chain_tx_token_t *l_tx_token = (dap_chain_tx_token_t *)dap_chain_datum_tx_item_get(a_tx, NULL, TX_ITEM_TYPE_TOKEN, NULL);
+                dap_chain_tx_token_t *l_tx_token = a_items->token;
                 if (!l_tx_token) {
                     l_err_num = -4;
                     break;
@@ -1817,6 +2555,8 @@ int dap_chain_ledger_tx_cache_check(dap_ledger_t *a_ledger, dap_chain_datum_tx_t
             //if(s_debug_more)  // Too many messages with thresholds processing
             //    log_it(L_DEBUG,"No previous transaction was found for hash %s",l_tx_prev_hash_str);
             l_err_num = DAP_CHAIN_CS_VERIFY_CODE_TX_NO_PREVIOUS;
+            if (a_missing_hash)
+                memcpy(a_missing_hash, &l_tx_prev_hash, sizeof(dap_chain_hash_fast_t));
             break;
         }
         if(s_debug_more)
@@ -1830,9 +2570,12 @@ int dap_chain_ledger_tx_cache_check(dap_ledger_t *a_ledger, dap_chain_datum_tx_t
             break;
         }
 
-        // 2. Verify signature in current transaction
-        if(dap_chain_datum_tx_verify_sign(a_tx) != 1)
-            return -2;
+        // 2. Verify signature in current transaction, it doesn't depend on the 'in' item so do it once
+        if (!l_sign_checked) {
+            if (s_tx_verify_sign(a_ledger, a_tx) != 1)
+                return -2;
+            l_sign_checked = true;
+        }
 
         // 3. Compare hash in previous transaction with hash inside 'in' item
         // calculate hash of previous transaction anew
@@ -1846,11 +2589,8 @@ int dap_chain_ledger_tx_cache_check(dap_ledger_t *a_ledger, dap_chain_datum_tx_t
         }
 
         uint64_t l_value;
-        // Get list of all 'out' items from previous transaction
-        dap_list_t *l_list_prev_out = dap_chain_datum_tx_items_get(l_tx_prev, TX_ITEM_TYPE_OUT_ALL, NULL);
         // Get one 'out' item in previous transaction bound with current 'in' item
-        void *l_tx_prev_out = dap_list_nth_data(l_list_prev_out, l_idx);
-        dap_list_free(l_list_prev_out);
+        void *l_tx_prev_out = l_idx >= 0 && l_idx < l_item_out->items->out_count ? l_item_out->items->out[l_idx] : NULL;
         if(!l_tx_prev_out) {
             l_err_num = -8;
             break;
@@ -1871,8 +2611,7 @@ int dap_chain_ledger_tx_cache_check(dap_ledger_t *a_ledger, dap_chain_datum_tx_t
             dap_chain_hash_fast_t l_hash_pkey;
             {
                 // Get sign item
-                dap_chain_tx_sig_t *l_tx_sig = (dap_chain_tx_sig_t*) dap_chain_datum_tx_item_get(a_tx, NULL,
-                        TX_ITEM_TYPE_SIG, NULL);
+                dap_chain_tx_sig_t *l_tx_sig = a_items->sig;
                 // Get sign from sign item
                 dap_sign_t *l_sign = dap_chain_datum_tx_item_sign_get_sig((dap_chain_tx_sig_t*) l_tx_sig);
                 // Get public key from sign
@@ -1902,11 +2641,11 @@ int dap_chain_ledger_tx_cache_check(dap_ledger_t *a_ledger, dap_chain_datum_tx_t
                 break;
             }
             // 5a. Check for condition owner
-            dap_chain_tx_sig_t *l_tx_prev_sig = (dap_chain_tx_sig_t *)dap_chain_datum_tx_item_get(l_tx_prev, NULL, TX_ITEM_TYPE_SIG, NULL);
+            dap_chain_tx_sig_t *l_tx_prev_sig = l_item_out->items->sig;
             dap_sign_t *l_prev_sign = dap_chain_datum_tx_item_sign_get_sig((dap_chain_tx_sig_t *)l_tx_prev_sig);
             size_t l_prev_pkey_ser_size = 0;
             const uint8_t *l_prev_pkey_ser = dap_sign_get_pkey(l_prev_sign, &l_prev_pkey_ser_size);
-            dap_chain_tx_sig_t *l_tx_sig = (dap_chain_tx_sig_t *)dap_chain_datum_tx_item_get(a_tx, NULL, TX_ITEM_TYPE_SIG, NULL);
+            dap_chain_tx_sig_t *l_tx_sig = a_items->sig;
             dap_sign_t *l_sign = dap_chain_datum_tx_item_sign_get_sig((dap_chain_tx_sig_t *)l_tx_sig);
             size_t l_pkey_ser_size = 0;
             const uint8_t *l_pkey_ser = dap_sign_get_pkey(l_sign, &l_pkey_ser_size);
@@ -1993,8 +2732,6 @@ int dap_chain_ledger_tx_cache_check(dap_ledger_t *a_ledger, dap_chain_datum_tx_t
         l_value_cur->sum += l_value;
         l_list_bound_items = dap_list_append(l_list_bound_items, bound_item);
     }
-    if (l_list_in)
-        dap_list_free(l_list_in);
 
     if (l_err_num) {
         DAP_DELETE(bound_item);
@@ -2017,17 +2754,15 @@ int dap_chain_ledger_tx_cache_check(dap_ledger_t *a_ledger, dap_chain_datum_tx_t
             strcpy(l_value_cur->token_ticker, l_token);
         HASH_ADD_STR(l_values_from_cur_tx, token_ticker, l_value_cur);
     }
-    dap_list_t *l_list_tx_out = NULL;
     bool emission_flag = !l_is_first_transaction || (l_is_first_transaction && l_ledger_priv->check_token_emission);
-    // find 'out' items
-    dap_list_t *l_list_out = dap_chain_datum_tx_items_get((dap_chain_datum_tx_t*) a_tx, TX_ITEM_TYPE_OUT_ALL, NULL);
+    // check 'out' items
     uint64_t l_value=0;
-    for (l_list_tmp = l_list_out; l_list_tmp; l_list_tmp = dap_list_next(l_list_tmp)) {
-        dap_chain_tx_item_type_t l_type = *(uint8_t *)l_list_tmp->data;
+    for (int i = 0; i < a_items->out_count; i++) {
+        dap_chain_tx_item_type_t l_type = *a_items->out[i];
         dap_chain_addr_t l_tx_out_to={0};
         if (l_type == TX_ITEM_TYPE_OUT)
         {
-            dap_chain_tx_out_t *l_tx_out = (dap_chain_tx_out_t *)l_list_tmp->data;
+            dap_chain_tx_out_t *l_tx_out = (dap_chain_tx_out_t *)a_items->out[i];
             if (l_multichannel) { // token ticker is mandatory for multichannel transactions
                 l_err_num = -16;
                 break;
@@ -2036,9 +2771,8 @@ int dap_chain_ledger_tx_cache_check(dap_ledger_t *a_ledger, dap_chain_datum_tx_t
                  l_value = l_tx_out->header.value;
             }
             memcpy(&l_tx_out_to , &l_tx_out->addr, sizeof (l_tx_out_to));
-            l_list_tx_out = dap_list_append(l_list_tx_out, l_tx_out);
         } else if (l_type == TX_ITEM_TYPE_OUT_EXT) {
-            dap_chain_tx_out_ext_t *l_tx_out = (dap_chain_tx_out_ext_t *)l_list_tmp->data;
+            dap_chain_tx_out_ext_t *l_tx_out = (dap_chain_tx_out_ext_t *)a_items->out[i];
             if (!l_multichannel) { // token ticker is depricated for single-channel transactions
                 l_err_num = -16;
                 break;
@@ -2048,9 +2782,8 @@ int dap_chain_ledger_tx_cache_check(dap_ledger_t *a_ledger, dap_chain_datum_tx_t
                  l_token = l_tx_out->token;
             }
             memcpy(&l_tx_out_to , &l_tx_out->addr, sizeof (l_tx_out_to));
-            l_list_tx_out = dap_list_append(l_list_tx_out, l_tx_out);
         } else if (l_type == TX_ITEM_TYPE_OUT_COND) {
-            dap_chain_tx_out_cond_t *l_tx_out = (dap_chain_tx_out_cond_t *)l_list_tmp->data;
+            dap_chain_tx_out_cond_t *l_tx_out = (dap_chain_tx_out_cond_t *)a_items->out[i];
             if (emission_flag) {
                 l_value = l_tx_out->header.value;
             }
@@ -2059,7 +2792,6 @@ int dap_chain_ledger_tx_cache_check(dap_ledger_t *a_ledger, dap_chain_datum_tx_t
                 l_err_num = -18;
                 break;
             }
-            l_list_tx_out = dap_list_append(l_list_tx_out, l_tx_out);
         }
         if (l_multichannel) {
             HASH_FIND_STR(l_values_from_cur_tx, l_token, l_value_cur);
@@ -2112,10 +2844,6 @@ int dap_chain_ledger_tx_cache_check(dap_ledger_t *a_ledger, dap_chain_datum_tx_t
         }
     }
 
-
-    if ( l_list_out )
-        dap_list_free(l_list_out);
-
     // Additional check whether the transaction is first
     while (l_is_first_transaction && !l_err_num) {
         if (l_ledger_priv->check_token_emission) { // Check the token emission
@@ -2128,6 +2856,8 @@ int dap_chain_ledger_tx_cache_check(dap_ledger_t *a_ledger, dap_chain_datum_tx_t
             } else {
                 log_it(L_WARNING, "Emission for tx_token wasn't found");
                 l_err_num = DAP_CHAIN_CS_VERIFY_CODE_TX_NO_EMISSION;
+                if (a_missing_hash)
+                    memcpy(a_missing_hash, l_emission_hash, sizeof(dap_chain_hash_fast_t));
                 break;
             }
         }
@@ -2158,15 +2888,26 @@ int dap_chain_ledger_tx_cache_check(dap_ledger_t *a_ledger, dap_chain_datum_tx_t
     } else {
         *a_list_bound_items = l_list_bound_items;
     }
-    if (!a_list_tx_out || l_err_num) {
-        dap_list_free(l_list_tx_out);
-    } else {
+    if (a_list_tx_out && !l_err_num) {
+        dap_list_t *l_list_tx_out = NULL;
+        for (int i = a_items->out_count - 1; i >= 0; i--)
+            l_list_tx_out = dap_list_prepend(l_list_tx_out, a_items->out[i]);
         *a_list_tx_out = l_list_tx_out;
     }
 
     return l_err_num;
 }
 
+// Checking a new transaction before adding to the cache
+int dap_chain_ledger_tx_cache_check(dap_ledger_t *a_ledger, dap_chain_datum_tx_t *a_tx,
+        dap_list_t **a_list_bound_items, dap_list_t **a_list_tx_out)
+{
+    dap_chain_datum_tx_items_view_t *l_items = dap_chain_datum_tx_items_view_create(a_tx);
+    int l_ret = s_tx_cache_check(a_ledger, a_tx, l_items, a_list_bound_items, a_list_tx_out, NULL);
+    DAP_DELETE(l_items);
+    return l_ret;
+}
+
 /**
  * @brief dap_chain_ledger_tx_check
  * @param a_ledger
@@ -2177,12 +2918,8 @@ int dap_chain_ledger_tx_add_check(dap_ledger_t *a_ledger, dap_chain_datum_tx_t *
 {
     if(!a_tx)
         return -2;
-    dap_list_t *l_list_bound_items = NULL;
-    dap_list_t *l_list_tx_out = NULL;
-
     int l_ret_check;
-    if( (l_ret_check = dap_chain_ledger_tx_cache_check(
-             a_ledger, a_tx, &l_list_bound_items, &l_list_tx_out)) < 0){
+    if( (l_ret_check = dap_chain_ledger_tx_cache_check(a_ledger, a_tx, NULL, NULL)) < 0){
         if(s_debug_more)
             log_it (L_DEBUG, "dap_chain_ledger_tx_add_check() tx not passed the check: code %d ",l_ret_check);
         return l_ret_check;
@@ -2234,10 +2971,12 @@ static int s_tx_cache_update(dap_ledger_t *a_ledger, dap_chain_ledger_tx_item_t
 
 /**
  * Add new transaction to the cache list
+ * Txs from threshold are neither put back into it nor wake up their dependents, s_treshold_txs_proc() does it
  *
  * return 1 OK, -1 error
  */
-int dap_chain_ledger_tx_add(dap_ledger_t *a_ledger, dap_chain_datum_tx_t *a_tx, dap_hash_fast_t *a_tx_hash, bool a_from_threshold)
+static int s_tx_add(dap_ledger_t *a_ledger, dap_chain_datum_tx_t *a_tx, dap_hash_fast_t *a_tx_hash, bool a_from_threshold,
+                    dap_chain_hash_fast_t *a_missing_hash)
 {
     if(!a_tx){
         if(s_debug_more)
@@ -2247,7 +2986,6 @@ int dap_chain_ledger_tx_add(dap_ledger_t *a_ledger, dap_chain_datum_tx_t *a_tx,
     int ret = 1;
     dap_ledger_private_t *l_ledger_priv = PVT(a_ledger);
     dap_list_t *l_list_bound_items = NULL;
-    dap_list_t *l_list_tx_out = NULL;
     dap_chain_ledger_tx_item_t *l_item_tmp = NULL;
     if (!l_ledger_priv->tps_timer) {
         clock_gettime(CLOCK_REALTIME, &l_ledger_priv->tps_start_time);
@@ -2257,9 +2995,10 @@ int dap_chain_ledger_tx_add(dap_ledger_t *a_ledger, dap_chain_datum_tx_t *a_tx,
         l_ledger_priv->tps_timer = dap_timerfd_start(500, s_ledger_tps_callback, l_ledger_priv);
     }
     bool l_from_threshold = a_from_threshold;
-    pthread_rwlock_rdlock(&l_ledger_priv->ledger_rwlock);
-    HASH_FIND(hh, l_ledger_priv->ledger_items, a_tx_hash, sizeof(dap_chain_hash_fast_t), l_item_tmp);
-    pthread_rwlock_unlock(&l_ledger_priv->ledger_rwlock);
+    dap_ledger_tx_shard_t *l_shard = s_tx_shard(l_ledger_priv, a_tx_hash);
+    pthread_rwlock_rdlock(&l_shard->rwlock);
+    HASH_FIND(hh, l_shard->ledger_items, a_tx_hash, sizeof(dap_chain_hash_fast_t), l_item_tmp);
+    pthread_rwlock_unlock(&l_shard->rwlock);
     char l_tx_hash_str[70];
     dap_chain_hash_fast_to_str(a_tx_hash, l_tx_hash_str, sizeof(l_tx_hash_str));
     if (l_item_tmp) {     // transaction already present in the cache list
@@ -2269,30 +3008,23 @@ int dap_chain_ledger_tx_add(dap_ledger_t *a_ledger, dap_chain_datum_tx_t *a_tx,
     }
     int l_ret_check;
     l_item_tmp = NULL;
-    if( (l_ret_check = dap_chain_ledger_tx_cache_check(
-             a_ledger, a_tx, &l_list_bound_items, &l_list_tx_out)) < 0) {
-        if (l_ret_check == DAP_CHAIN_CS_VERIFY_CODE_TX_NO_PREVIOUS) {
-            if (!l_from_threshold) {
-                pthread_rwlock_rdlock(&l_ledger_priv->treshold_txs_rwlock);
-                HASH_FIND(hh, l_ledger_priv->treshold_txs, a_tx_hash, sizeof(*a_tx_hash), l_item_tmp);
-                unsigned long long l_threshold_txs_count = HASH_COUNT(l_ledger_priv->treshold_txs);
-                if (!l_item_tmp) {
-                    if (l_threshold_txs_count >= s_treshold_txs_max) {
-                        if(s_debug_more)
-                            log_it(L_WARNING,"Treshold for tranactions is overfulled (%zu max), dropping down new data, added nothing",
-                                       s_treshold_txs_max);
-                    } else {
-                        l_item_tmp = DAP_NEW_Z(dap_chain_ledger_tx_item_t);
-                        memcpy(&l_item_tmp->tx_hash_fast, a_tx_hash, sizeof(dap_chain_hash_fast_t));
-                        size_t l_tx_size = dap_chain_datum_tx_get_size(a_tx);
-                        l_item_tmp->tx = DAP_NEW_SIZE(dap_chain_datum_tx_t, l_tx_size);
-                        memcpy(l_item_tmp->tx, a_tx, l_tx_size);
-                        HASH_ADD(hh, l_ledger_priv->treshold_txs, tx_hash_fast, sizeof(dap_chain_hash_fast_t), l_item_tmp);
-                        if(s_debug_more)
-                            log_it (L_DEBUG, "Tx %s added to threshold", l_tx_hash_str);
-                    }
-                }
-                pthread_rwlock_unlock(&l_ledger_priv->treshold_txs_rwlock);
+    dap_chain_hash_fast_t l_missing_hash = {};
+    // Decode tx items once, the view goes to ledger item with the tx
+    dap_chain_datum_tx_items_view_t *l_items = dap_chain_datum_tx_items_view_create(a_tx);
+    if( (l_ret_check = s_tx_cache_check(
+             a_ledger, a_tx, l_items, &l_list_bound_items, NULL, &l_missing_hash)) < 0) {
+        DAP_DELETE(l_items);
+        if (l_ret_check == DAP_CHAIN_CS_VERIFY_CODE_TX_NO_PREVIOUS ||
+                l_ret_check == DAP_CHAIN_CS_VERIFY_CODE_TX_NO_EMISSION) {
+            if (a_missing_hash)
+                memcpy(a_missing_hash, &l_missing_hash, sizeof(dap_chain_hash_fast_t));
+            if (!l_from_threshold && s_treshold_txs_add(a_ledger, a_tx, a_tx_hash, &l_missing_hash)) {
+                if(s_debug_more)
+                    log_it (L_DEBUG, "Tx %s added to threshold", l_tx_hash_str);
+                // Parent tx could be added while we were checking, so nobody would wake us up
+                if (l_ret_check == DAP_CHAIN_CS_VERIFY_CODE_TX_NO_PREVIOUS &&
+                        s_find_datum_tx_by_hash(a_ledger, &l_missing_hash, NULL))
+                    s_treshold_txs_proc(a_ledger, &l_missing_hash);
             }
         } else {
             if(s_debug_more)
@@ -2303,6 +3035,34 @@ int dap_chain_ledger_tx_add(dap_ledger_t *a_ledger, dap_chain_datum_tx_t *a_tx,
     if(s_debug_more)
         log_it ( L_DEBUG, "dap_chain_ledger_tx_add() check passed for tx %s",l_tx_hash_str);
 
+    // Publish the tx item before any balance or spent mark is touched: the lookup above is only
+    // a fast path, the duplicate check that counts is the one under the shard write lock
+    size_t l_tx_size = dap_chain_datum_tx_get_size(a_tx);
+    l_item_tmp = DAP_NEW_Z(dap_chain_ledger_tx_item_t);
+    memcpy(&l_item_tmp->tx_hash_fast, a_tx_hash, sizeof(dap_chain_hash_fast_t));
+    l_item_tmp->tx = DAP_NEW_SIZE(dap_chain_datum_tx_t, l_tx_size);
+    memcpy(l_item_tmp->tx, a_tx, l_tx_size);
+    dap_chain_datum_tx_items_view_rebase(l_items, a_tx, l_item_tmp->tx);
+    l_item_tmp->items = l_items;
+    l_item_tmp->cache_data.ts_created = time(NULL); // Time of transasction added to ledger
+    l_item_tmp->cache_data.n_outs = l_items->out_count;
+    pthread_rwlock_wrlock(&l_shard->rwlock);
+    dap_chain_ledger_tx_item_t *l_item_dup = NULL;
+    HASH_FIND(hh, l_shard->ledger_items, a_tx_hash, sizeof(dap_chain_hash_fast_t), l_item_dup);
+    if (l_item_dup) {
+        pthread_rwlock_unlock(&l_shard->rwlock);
+        if(s_debug_more)
+            log_it(L_WARNING, "Transaction %s already present in the cache", l_tx_hash_str);
+        dap_list_free_full(l_list_bound_items, free);
+        DAP_DELETE(l_item_tmp->tx);
+        DAP_DELETE(l_item_tmp);
+        DAP_DELETE(l_items);
+        return -1;
+    }
+    l_item_tmp->seq_num = atomic_fetch_add(&l_ledger_priv->tx_seq_last, 1) + 1;
+    HASH_ADD(hh, l_shard->ledger_items, tx_hash_fast, sizeof(dap_chain_hash_fast_t), l_item_tmp); // tx_hash_fast: name of key field
+    pthread_rwlock_unlock(&l_shard->rwlock);
+
     char l_token_ticker[DAP_CHAIN_TICKER_SIZE_MAX]      = { '\0'},
          l_token_ticker_old[DAP_CHAIN_TICKER_SIZE_MAX]  = { '\0'};
 
@@ -2313,6 +3073,7 @@ int dap_chain_ledger_tx_add(dap_ledger_t *a_ledger, dap_chain_datum_tx_t *a_tx,
     dap_list_t *l_list_tmp = l_list_bound_items;
     char *l_ticker_trl = NULL, *l_ticker_old_trl = NULL;
     bool l_stake_updated = false;
+    dap_chain_addr_t l_addr_from = {};    // all regular ins are from the same address, remember it for history
     // Update balance: deducts
     while(l_list_tmp) {
         dap_chain_ledger_tx_bound_t *bound_item = l_list_tmp->data;
@@ -2335,22 +3096,25 @@ int dap_chain_ledger_tx_add(dap_ledger_t *a_ledger, dap_chain_datum_tx_t *a_tx,
             dap_chain_addr_t *l_addr = (l_out_type == TX_ITEM_TYPE_OUT) ?
                                         &bound_item->out.tx_prev_out->addr :
                                         &bound_item->out.tx_prev_out_ext->addr;
+            memcpy(&l_addr_from, l_addr, sizeof(dap_chain_addr_t));
             char *l_addr_str = dap_chain_addr_to_str(l_addr);
             char *l_wallet_balance_key = dap_strjoin(" ", l_addr_str, l_token_ticker, (char*)NULL);
-            pthread_rwlock_rdlock(&PVT(a_ledger)->balance_accounts_rwlock);
-            HASH_FIND_STR(PVT(a_ledger)->balance_accounts, l_wallet_balance_key, wallet_balance);
-            pthread_rwlock_unlock(&PVT(a_ledger)->balance_accounts_rwlock);
+            dap_ledger_balance_shard_t *l_balance_shard = s_balance_shard(l_ledger_priv, l_wallet_balance_key);
+            pthread_rwlock_wrlock(&l_balance_shard->rwlock);
+            HASH_FIND_STR(l_balance_shard->balance_accounts, l_wallet_balance_key, wallet_balance);
             if (wallet_balance) {
                 uint64_t l_value = (l_out_type == TX_ITEM_TYPE_OUT) ?
                                     bound_item->out.tx_prev_out->header.value :
                                     bound_item->out.tx_prev_out_ext->header.value;
-                if(s_debug_more)
-                    log_it(L_DEBUG,"SPEND %"DAP_UINT64_FORMAT_U" from addr: %s", l_value, l_wallet_balance_key);
                 uint128_t l_sub = dap_chain_uint128_from(l_value);
                 wallet_balance->balance = dap_uint128_substract(wallet_balance->balance, l_sub);
-                // Update the cache
+                if(s_debug_more)
+                    log_it(L_DEBUG,"SPEND %"DAP_UINT64_FORMAT_U" from addr: %s", l_value, l_wallet_balance_key);
+                // Update the cache while the balance can't change under us
                 s_balance_cache_update(a_ledger, wallet_balance);
+                pthread_rwlock_unlock(&l_balance_shard->rwlock);
             } else {
+                pthread_rwlock_unlock(&l_balance_shard->rwlock);
                 if(s_debug_more)
                     log_it(L_ERROR,"!!! Attempt to SPEND from some non-existent balance !!!: %s %s", l_addr_str, l_token_ticker);
             }
@@ -2388,23 +3152,24 @@ int dap_chain_ledger_tx_add(dap_ledger_t *a_ledger, dap_chain_datum_tx_t *a_tx,
             dap_chain_hash_fast_t l_tx_prev_hash_to_del = bound_item->tx_prev_hash_fast;
             // remove from memory ledger
             int res = dap_chain_ledger_tx_remove(a_ledger, &l_tx_prev_hash_to_del);
-            if(res == -2) {
+            if(res != 1) {
                 if(s_debug_more) {
                     char * l_tx_prev_hash_str = dap_chain_hash_fast_to_str_new(&l_tx_prev_hash_to_del);
-                    log_it(L_ERROR, "Can't delete previous transactions because hash=%s not found", l_tx_prev_hash_str);
+                    if (res == -2)
+                        log_it(L_ERROR, "Can't delete previous transactions because hash=%s not found", l_tx_prev_hash_str);
+                    else
+                        log_it(L_ERROR, "Can't delete previous transactions with hash=%s", l_tx_prev_hash_str);
                     DAP_DELETE(l_tx_prev_hash_str);
                 }
+                // Take back the item published above
+                pthread_rwlock_wrlock(&l_shard->rwlock);
+                HASH_DEL(l_shard->ledger_items, l_item_tmp);
+                pthread_rwlock_unlock(&l_shard->rwlock);
                 dap_list_free_full(l_list_bound_items, free);
-                return -100;
-            }
-            else if(res != 1) {
-                if(s_debug_more) {
-                    char * l_tx_prev_hash_str = dap_chain_hash_fast_to_str_new(&l_tx_prev_hash_to_del);
-                    log_it(L_ERROR, "Can't delete previous transactions with hash=%s", l_tx_prev_hash_str);
-                    DAP_DELETE(l_tx_prev_hash_str);
-                }
-                dap_list_free_full(l_list_bound_items, free);
-                return -101;
+                DAP_DELETE(l_item_tmp->tx);
+                DAP_DELETE(l_item_tmp);
+                DAP_DELETE(l_items);
+                return res == -2 ? -100 : -101;
             }
         }
         // go to next previous transaction
@@ -2418,18 +3183,18 @@ int dap_chain_ledger_tx_add(dap_ledger_t *a_ledger, dap_chain_datum_tx_t *a_tx,
         //int l_base_tx_count = 0;
         //dap_list_t *l_base_tx_list = dap_chain_datum_tx_items_get(a_tx, TX_ITEM_TYPE_TOKEN, &l_base_tx_count );
         //if (l_base_tx_count >=1  && l_base_tx_list){
-        dap_chain_tx_token_t * l_tx_token = (dap_chain_tx_token_t *) dap_chain_datum_tx_item_get(a_tx, NULL, TX_ITEM_TYPE_TOKEN, NULL);
+        dap_chain_tx_token_t * l_tx_token = l_items->token;
         if (l_tx_token)
             l_ticker_trl = dap_stpcpy(l_token_ticker, l_tx_token->header.ticker);
         //}
     }
 
     //Update balance : raise
-    for (dap_list_t *l_tx_out = l_list_tx_out; l_tx_out; l_tx_out = dap_list_next(l_tx_out)) {
-        dap_chain_tx_item_type_t l_type = *(uint8_t *)l_tx_out->data;
+    for (int i = 0; i < l_items->out_count; i++) {
+        dap_chain_tx_item_type_t l_type = *l_items->out[i];
         if (l_type == TX_ITEM_TYPE_OUT_COND) {
             // Update stakes if any
-            dap_chain_tx_out_cond_t *l_cond = (dap_chain_tx_out_cond_t *)l_tx_out->data;
+            dap_chain_tx_out_cond_t *l_cond = (dap_chain_tx_out_cond_t *)l_items->out[i];
             if (l_cond->header.subtype == DAP_CHAIN_TX_OUT_COND_SUBTYPE_SRV_STAKE && !l_stake_updated) {
                 dap_chain_ledger_verificator_t *l_verificator;
                 int l_tmp = (int)DAP_CHAIN_TX_OUT_COND_SUBTYPE_SRV_STAKE_UPDATE;
@@ -2445,9 +3210,9 @@ int dap_chain_ledger_tx_add(dap_ledger_t *a_ledger, dap_chain_datum_tx_t *a_tx,
         dap_chain_tx_out_t *l_out_item = NULL;
         dap_chain_tx_out_ext_t *l_out_item_ext = NULL;
         if (l_type == TX_ITEM_TYPE_OUT) {
-            l_out_item = (dap_chain_tx_out_t *)l_tx_out->data;
+            l_out_item = (dap_chain_tx_out_t *)l_items->out[i];
         } else {
-            l_out_item_ext = (dap_chain_tx_out_ext_t *)l_tx_out->data;
+            l_out_item_ext = (dap_chain_tx_out_ext_t *)l_items->out[i];
         }
         if ((l_out_item  || l_out_item_ext) && l_ticker_trl) {
              dap_chain_addr_t *l_addr = (l_type == TX_ITEM_TYPE_OUT) ?
@@ -2467,31 +3232,30 @@ int dap_chain_ledger_tx_add(dap_ledger_t *a_ledger, dap_chain_datum_tx_t *a_tx,
 
             if(s_debug_more)
                 log_it (L_DEBUG,"GOT %"DAP_UINT64_FORMAT_U" to addr: %s", l_value, l_wallet_balance_key);
-            pthread_rwlock_rdlock(&l_ledger_priv->balance_accounts_rwlock);
-            HASH_FIND_STR(PVT(a_ledger)->balance_accounts, l_wallet_balance_key, wallet_balance);
-            pthread_rwlock_unlock(&l_ledger_priv->balance_accounts_rwlock);
+            dap_ledger_balance_shard_t *l_balance_shard = s_balance_shard(l_ledger_priv, l_wallet_balance_key);
+            uint128_t l_add = dap_chain_uint128_from(l_value);
+            pthread_rwlock_wrlock(&l_balance_shard->rwlock);
+            HASH_FIND_STR(l_balance_shard->balance_accounts, l_wallet_balance_key, wallet_balance);
             if (wallet_balance) {
+                wallet_balance->balance = dap_uint128_add(wallet_balance->balance, l_add);
                 if(s_debug_more)
                     log_it(L_DEBUG, "Balance item is present in cache");
-                uint128_t l_add = dap_chain_uint128_from(l_value);
-                wallet_balance->balance = dap_uint128_add(wallet_balance->balance, l_add);
                 DAP_DELETE (l_wallet_balance_key);
-                // Update the cache
+                // Update the cache while the balance can't change under us
                 s_balance_cache_update(a_ledger, wallet_balance);
+                pthread_rwlock_unlock(&l_balance_shard->rwlock);
             } else {
                 wallet_balance = DAP_NEW_Z(dap_ledger_wallet_balance_t);
                 wallet_balance->key = l_wallet_balance_key;
                 strcpy(wallet_balance->token_ticker, l_token_ticker);
-                uint128_t l_add = dap_chain_uint128_from(l_value);
                 wallet_balance->balance = dap_uint128_add(wallet_balance->balance, l_add);
+                HASH_ADD_KEYPTR(hh, l_balance_shard->balance_accounts, wallet_balance->key,
+                                strlen(l_wallet_balance_key), wallet_balance);
                 if(s_debug_more)
                     log_it(L_DEBUG,"!!! Create new balance item: %s %s", l_addr_str, l_token_ticker);
-                pthread_rwlock_wrlock(&l_ledger_priv->balance_accounts_rwlock);
-                HASH_ADD_KEYPTR(hh, PVT(a_ledger)->balance_accounts, wallet_balance->key,
-                                strlen(l_wallet_balance_key), wallet_balance);
-                pthread_rwlock_unlock(&l_ledger_priv->balance_accounts_rwlock);
                 // Add it to cache
                 s_balance_cache_update(a_ledger, wallet_balance);
+                pthread_rwlock_unlock(&l_balance_shard->rwlock);
             }
             DAP_DELETE (l_addr_str);
         } else {
@@ -2500,20 +3264,12 @@ int dap_chain_ledger_tx_add(dap_ledger_t *a_ledger, dap_chain_datum_tx_t *a_tx,
         }
     }
 
-    if (l_list_tx_out)
-        dap_list_free(l_list_tx_out);
-
     // add transaction to the cache list
     if(ret == 1){
-        l_item_tmp = DAP_NEW_Z(dap_chain_ledger_tx_item_t);
-        memcpy(&l_item_tmp->tx_hash_fast, a_tx_hash, sizeof(dap_chain_hash_fast_t));
-        l_item_tmp->tx = DAP_NEW_SIZE(dap_chain_datum_tx_t, dap_chain_datum_tx_get_size(a_tx));
-        l_item_tmp->cache_data.ts_created = time(NULL); // Time of transasction added to ledger
-        dap_list_t *l_tist_tmp = dap_chain_datum_tx_items_get(a_tx, TX_ITEM_TYPE_OUT_ALL, &l_item_tmp->cache_data.n_outs);
         // If debug mode dump the UTXO
         if (dap_log_level_get() == L_DEBUG && s_debug_more) {
             for (size_t i =0; i < (size_t) l_item_tmp->cache_data.n_outs; i++){
-                dap_chain_tx_out_t *l_tx_out = l_tist_tmp->data;
+                dap_chain_tx_out_t *l_tx_out = (dap_chain_tx_out_t *)l_items->out[i];
                 if (l_tx_out->header.type != TX_ITEM_TYPE_OUT)
                     continue;
                 char * l_tx_out_addr_str = dap_chain_addr_to_str( &l_tx_out->addr );
@@ -2521,8 +3277,6 @@ int dap_chain_ledger_tx_add(dap_ledger_t *a_ledger, dap_chain_datum_tx_t *a_tx,
                 DAP_DELETE (l_tx_out_addr_str);
             }
         }
-        if(l_tist_tmp)
-            dap_list_free(l_tist_tmp);
         if (!l_ticker_trl) { //No token ticker in previous txs
             if(s_debug_more)
                 log_it(L_DEBUG, "No token ticker in previous txs");
@@ -2530,21 +3284,20 @@ int dap_chain_ledger_tx_add(dap_ledger_t *a_ledger, dap_chain_datum_tx_t *a_tx,
             //dap_list_t *l_tokens_list = dap_chain_datum_tx_items_get(a_tx, TX_ITEM_TYPE_TOKEN, &l_tokens_count );
             //if ( l_tokens_count>0 ){
                 //dap_chain_tx_token_t * l_token = (dap_chain_tx_token_t*) l_tokens_list->data;
-            dap_chain_tx_token_t *l_token = (dap_chain_tx_token_t *)dap_chain_datum_tx_item_get(a_tx, NULL, TX_ITEM_TYPE_TOKEN, NULL);
+            dap_chain_tx_token_t *l_token = l_items->token;
             l_ticker_trl = l_token
                     ? dap_stpcpy(l_token_ticker, l_token->header.ticker)
                     : NULL;
                 //dap_list_free(l_tokens_list);
             //}
         }
-        if (l_ticker_trl && !l_multichannel)
+        if (l_ticker_trl && !l_multichannel) {
+            pthread_rwlock_wrlock(&l_shard->rwlock);
             dap_stpcpy(l_item_tmp->cache_data.token_ticker, l_token_ticker);
-
-        size_t l_tx_size = dap_chain_datum_tx_get_size(a_tx);
-        memcpy(l_item_tmp->tx, a_tx, l_tx_size);
-        pthread_rwlock_rdlock(&l_ledger_priv->ledger_rwlock);
-        HASH_ADD(hh, l_ledger_priv->ledger_items, tx_hash_fast, sizeof(dap_chain_hash_fast_t), l_item_tmp); // tx_hash_fast: name of key field
-        pthread_rwlock_unlock(&l_ledger_priv->ledger_rwlock);
+            pthread_rwlock_unlock(&l_shard->rwlock);
+        }
+        s_history_add(a_ledger, l_item_tmp->tx, a_tx_hash, l_items, &l_addr_from,
+                      *l_item_tmp->cache_data.token_ticker ? l_item_tmp->cache_data.token_ticker : NULL);
         // Count TPS
         clock_gettime(CLOCK_REALTIME, &l_ledger_priv->tps_end_time);
         l_ledger_priv->tps_count++;
@@ -2560,12 +3313,17 @@ int dap_chain_ledger_tx_add(dap_ledger_t *a_ledger, dap_chain_datum_tx_t *a_tx,
         }
         DAP_DELETE(l_gdb_group);
         if (!l_from_threshold)
-            s_treshold_txs_proc(a_ledger);
+            s_treshold_txs_proc(a_ledger, a_tx_hash);
         ret = 1;
     }
     return ret;
 }
 
+int dap_chain_ledger_tx_add(dap_ledger_t *a_ledger, dap_chain_datum_tx_t *a_tx, dap_hash_fast_t *a_tx_hash, bool a_from_threshold)
+{
+    return s_tx_add(a_ledger, a_tx, a_tx_hash, a_from_threshold, NULL);
+}
+
 static bool s_ledger_tps_callback(void *a_arg)
 {
     dap_ledger_private_t *l_ledger_pvt = (dap_ledger_private_t *)a_arg;
@@ -2589,22 +3347,27 @@ int dap_chain_ledger_tx_load(dap_ledger_t *a_ledger, dap_chain_datum_tx_t *a_tx,
         return dap_chain_ledger_tx_add(a_ledger, a_tx, &l_tx_hash, false);
     } else {
         dap_chain_ledger_tx_item_t *l_tx_item;
-        pthread_rwlock_rdlock(&PVT(a_ledger)->ledger_rwlock);
-        HASH_FIND(hh, PVT(a_ledger)->ledger_items, &l_tx_hash, sizeof(dap_chain_hash_fast_t), l_tx_item);
-        if (l_tx_item) {
-            pthread_rwlock_unlock(&PVT(a_ledger)->ledger_rwlock);
+        dap_chain_ledger_tx_spent_item_t *l_tx_spent_item;
+        dap_ledger_tx_shard_t *l_shard = s_tx_shard(PVT(a_ledger), &l_tx_hash);
+        pthread_rwlock_rdlock(&l_shard->rwlock);
+        HASH_FIND(hh, l_shard->ledger_items, &l_tx_hash, sizeof(dap_chain_hash_fast_t), l_tx_item);
+        HASH_FIND(hh, l_shard->spent_items, &l_tx_hash, sizeof(dap_chain_hash_fast_t), l_tx_spent_item);
+        char l_token_ticker[DAP_CHAIN_TICKER_SIZE_MAX] = { '\0' };
+        if (l_tx_item || l_tx_spent_item)
+            strncpy(l_token_ticker, l_tx_item ? l_tx_item->cache_data.token_ticker : l_tx_spent_item->token_ticker,
+                    DAP_CHAIN_TICKER_SIZE_MAX - 1);
+        pthread_rwlock_unlock(&l_shard->rwlock);
+        if (l_tx_item || l_tx_spent_item) {
+            if (PVT(a_ledger)->history_rebuild)
+                s_history_backfill(a_ledger, a_tx, &l_tx_hash, *l_token_ticker ? l_token_ticker : NULL);
             return 1;
         }
-        HASH_FIND(hh, PVT(a_ledger)->treshold_txs, &l_tx_hash, sizeof(dap_chain_hash_fast_t), l_tx_item);
-        if (l_tx_item) {
-            pthread_rwlock_unlock(&PVT(a_ledger)->ledger_rwlock);
+        dap_ledger_treshold_tx_t *l_treshold_tx;
+        pthread_rwlock_rdlock(&PVT(a_ledger)->treshold_txs_rwlock);
+        HASH_FIND(hh, PVT(a_ledger)->treshold_txs, &l_tx_hash, sizeof(dap_chain_hash_fast_t), l_treshold_tx);
+        pthread_rwlock_unlock(&PVT(a_ledger)->treshold_txs_rwlock);
+        if (l_treshold_tx)
             return DAP_CHAIN_CS_VERIFY_CODE_TX_NO_PREVIOUS;
-        }
-        dap_chain_ledger_tx_spent_item_t *l_tx_spent_item;
-        HASH_FIND(hh, PVT(a_ledger)->spent_items, &l_tx_hash, sizeof(dap_chain_hash_fast_t), l_tx_spent_item);
-        pthread_rwlock_unlock(&PVT(a_ledger)->ledger_rwlock);
-        if (l_tx_spent_item)
-            return 1;
     }
     return dap_chain_ledger_tx_add(a_ledger, a_tx, &l_tx_hash, false);
 }
@@ -2621,22 +3384,23 @@ int dap_chain_ledger_tx_remove(dap_ledger_t *a_ledger, dap_chain_hash_fast_t *a_
     int l_ret = -1;
     dap_ledger_private_t *l_ledger_priv = PVT(a_ledger);
     dap_chain_ledger_tx_item_t *l_item_tmp;
-    pthread_rwlock_rdlock(&l_ledger_priv->ledger_rwlock);
-    HASH_FIND(hh, l_ledger_priv->ledger_items, a_tx_hash, sizeof(dap_chain_hash_fast_t), l_item_tmp);
+    dap_ledger_tx_shard_t *l_shard = s_tx_shard(l_ledger_priv, a_tx_hash);
+    pthread_rwlock_wrlock(&l_shard->rwlock);
+    HASH_FIND(hh, l_shard->ledger_items, a_tx_hash, sizeof(dap_chain_hash_fast_t), l_item_tmp);
     if(l_item_tmp != NULL) {
-        HASH_DEL(l_ledger_priv->ledger_items, l_item_tmp);
+        HASH_DEL(l_shard->ledger_items, l_item_tmp);
         // Remove it from cache
         char *l_gdb_group = dap_chain_ledger_get_gdb_group(a_ledger, DAP_CHAIN_LEDGER_TXS_STR);
         dap_chain_global_db_gr_del(dap_chain_hash_fast_to_str_new(a_tx_hash), l_gdb_group);
         DAP_DELETE(l_gdb_group);
         l_ret = 1;
         dap_chain_ledger_tx_spent_item_t *l_item_used;
-        HASH_FIND(hh, l_ledger_priv->spent_items, a_tx_hash, sizeof(dap_chain_hash_fast_t), l_item_used);
+        HASH_FIND(hh, l_shard->spent_items, a_tx_hash, sizeof(dap_chain_hash_fast_t), l_item_used);
         if (!l_item_used) {   // Add it to spent items
             l_item_used = DAP_NEW_Z(dap_chain_ledger_tx_spent_item_t);
             memcpy(&l_item_used->tx_hash_fast, a_tx_hash, sizeof(dap_chain_hash_fast_t));
             strncpy(l_item_used->token_ticker, l_item_tmp->cache_data.token_ticker, DAP_CHAIN_TICKER_SIZE_MAX);
-            HASH_ADD(hh, l_ledger_priv->spent_items, tx_hash_fast, sizeof(dap_chain_hash_fast_t), l_item_used);
+            HASH_ADD(hh, l_shard->spent_items, tx_hash_fast, sizeof(dap_chain_hash_fast_t), l_item_used);
             // Add it to cache
             char *l_cache_data = DAP_NEW_Z_SIZE(char, DAP_CHAIN_TICKER_SIZE_MAX);
             strncpy(l_cache_data, l_item_used->token_ticker, DAP_CHAIN_TICKER_SIZE_MAX);
@@ -2650,12 +3414,13 @@ int dap_chain_ledger_tx_remove(dap_ledger_t *a_ledger, dap_chain_hash_fast_t *a_
             DAP_DELETE(l_gdb_group);
         }
         // del struct for hash
+        DAP_DELETE(l_item_tmp->items);
         DAP_DELETE(l_item_tmp);
     }
     else
         // hash not found in the cache
         l_ret = -2;
-    pthread_rwlock_unlock(&l_ledger_priv->ledger_rwlock);
+    pthread_rwlock_unlock(&l_shard->rwlock);
     return l_ret;
 }
 
@@ -2665,19 +3430,25 @@ int dap_chain_ledger_tx_remove(dap_ledger_t *a_ledger, dap_chain_hash_fast_t *a_
 void dap_chain_ledger_purge(dap_ledger_t *a_ledger, bool a_preserve_db)
 {
     dap_ledger_private_t *l_ledger_priv = PVT(a_ledger);
-    pthread_rwlock_wrlock(&l_ledger_priv->ledger_rwlock);
+    for (int i = 0; i < LEDGER_SHARDS_COUNT; i++) {
+        pthread_rwlock_wrlock(&l_ledger_priv->tx_shards[i].rwlock);
+        pthread_rwlock_wrlock(&l_ledger_priv->balance_shards[i].rwlock);
+    }
     pthread_rwlock_wrlock(&l_ledger_priv->tokens_rwlock);
     pthread_rwlock_wrlock(&l_ledger_priv->treshold_emissions_rwlock);
     pthread_rwlock_wrlock(&l_ledger_priv->treshold_txs_rwlock);
-    pthread_rwlock_wrlock(&l_ledger_priv->balance_accounts_rwlock);
+    pthread_rwlock_wrlock(&l_ledger_priv->history_rwlock);
 
     // delete transactions
     dap_chain_ledger_tx_item_t *l_item_current, *l_item_tmp;
     char *l_gdb_group;
-    HASH_ITER(hh, l_ledger_priv->ledger_items , l_item_current, l_item_tmp) {
-        HASH_DEL(l_ledger_priv->ledger_items, l_item_current);
-        DAP_DELETE(l_item_current->tx);
-        DAP_DELETE(l_item_current);
+    for (int i = 0; i < LEDGER_SHARDS_COUNT; i++) {
+        HASH_ITER(hh, l_ledger_priv->tx_shards[i].ledger_items , l_item_current, l_item_tmp) {
+            HASH_DEL(l_ledger_priv->tx_shards[i].ledger_items, l_item_current);
+            DAP_DELETE(l_item_current->items);
+            DAP_DELETE(l_item_current->tx);
+            DAP_DELETE(l_item_current);
+        }
     }
     if (!a_preserve_db) {
         l_gdb_group = dap_chain_ledger_get_gdb_group(a_ledger, DAP_CHAIN_LEDGER_TXS_STR);
@@ -2687,9 +3458,11 @@ void dap_chain_ledger_purge(dap_ledger_t *a_ledger, bool a_preserve_db)
 
     // delete spent transactions
     dap_chain_ledger_tx_spent_item_t *l_spent_item_current, *l_spent_item_tmp;
-    HASH_ITER(hh, l_ledger_priv->spent_items, l_spent_item_current, l_spent_item_tmp) {
-        HASH_DEL(l_ledger_priv->spent_items, l_spent_item_current);
-        DAP_DELETE(l_item_current);
+    for (int i = 0; i < LEDGER_SHARDS_COUNT; i++) {
+        HASH_ITER(hh, l_ledger_priv->tx_shards[i].spent_items, l_spent_item_current, l_spent_item_tmp) {
+            HASH_DEL(l_ledger_priv->tx_shards[i].spent_items, l_spent_item_current);
+            DAP_DELETE(l_spent_item_current);
+        }
     }
     if (!a_preserve_db) {
         l_gdb_group = dap_chain_ledger_get_gdb_group(a_ledger, DAP_CHAIN_LEDGER_SPENT_TXS_STR);
@@ -2699,9 +3472,12 @@ void dap_chain_ledger_purge(dap_ledger_t *a_ledger, bool a_preserve_db)
 
     // delete balances
     dap_ledger_wallet_balance_t *l_balance_current, *l_balance_tmp;
-    HASH_ITER(hh, l_ledger_priv->balance_accounts, l_balance_current, l_balance_tmp) {
-        HASH_DEL(l_ledger_priv->balance_accounts, l_balance_current);
-        DAP_DELETE(l_balance_current);
+    for (int i = 0; i < LEDGER_SHARDS_COUNT; i++) {
+        HASH_ITER(hh, l_ledger_priv->balance_shards[i].balance_accounts, l_balance_current, l_balance_tmp) {
+            HASH_DEL(l_ledger_priv->balance_shards[i].balance_accounts, l_balance_current);
+            DAP_DELETE(l_balance_current->key);
+            DAP_DELETE(l_balance_current);
+        }
     }
     if (!a_preserve_db) {
         l_gdb_group = dap_chain_ledger_get_gdb_group(a_ledger, DAP_CHAIN_LEDGER_BALANCES_STR);
@@ -2740,18 +3516,55 @@ void dap_chain_ledger_purge(dap_ledger_t *a_ledger, bool a_preserve_db)
         DAP_DELETE(l_emission_current->datum_token_emission);
         DAP_DELETE(l_emission_current);
     }
+    dap_ledger_treshold_ticker_t *l_ticker_wait, *l_ticker_wait_tmp;
+    HASH_ITER(hh, l_ledger_priv->treshold_emissions_waits, l_ticker_wait, l_ticker_wait_tmp) {
+        HASH_DEL(l_ledger_priv->treshold_emissions_waits, l_ticker_wait);
+        dap_list_free(l_ticker_wait->emissions);
+        DAP_DELETE(l_ticker_wait);
+    }
     // delete threshold transactions
-    HASH_ITER(hh, l_ledger_priv->treshold_txs, l_item_current, l_item_tmp) {
-        HASH_DEL(l_ledger_priv->treshold_txs, l_item_current);
-        DAP_DELETE(l_item_current->tx);
-        DAP_DELETE(l_item_current);
+    dap_ledger_treshold_tx_t *l_treshold_tx, *l_treshold_tx_tmp;
+    HASH_ITER(hh, l_ledger_priv->treshold_txs, l_treshold_tx, l_treshold_tx_tmp) {
+        HASH_DEL(l_ledger_priv->treshold_txs, l_treshold_tx);
+        DAP_DELETE(l_treshold_tx->tx);
+        DAP_DELETE(l_treshold_tx);
+    }
+    dap_ledger_treshold_wait_t *l_tx_wait, *l_tx_wait_tmp;
+    HASH_ITER(hh, l_ledger_priv->treshold_txs_waits, l_tx_wait, l_tx_wait_tmp) {
+        HASH_DEL(l_ledger_priv->treshold_txs_waits, l_tx_wait);
+        DAP_DELETE(l_tx_wait);
+    }
+    l_ledger_priv->treshold_info.txs_size = 0;
+    l_ledger_priv->treshold_info.emissions_size = 0;
+
+    // delete history indexes
+    dap_ledger_history_addr_t *l_history_addr, *l_history_addr_tmp;
+    HASH_ITER(hh, l_ledger_priv->history_addrs, l_history_addr, l_history_addr_tmp) {
+        HASH_DEL(l_ledger_priv->history_addrs, l_history_addr);
+        DAP_DELETE(l_history_addr->list.items);
+        DAP_DELETE(l_history_addr);
+    }
+    dap_ledger_history_token_t *l_history_token, *l_history_token_tmp;
+    HASH_ITER(hh, l_ledger_priv->history_tokens, l_history_token, l_history_token_tmp) {
+        HASH_DEL(l_ledger_priv->history_tokens, l_history_token);
+        DAP_DELETE(l_history_token->list.items);
+        DAP_DELETE(l_history_token);
+    }
+    l_ledger_priv->history_seq_last = 0;
+    if (!a_preserve_db) {
+        l_gdb_group = dap_chain_ledger_get_gdb_group(a_ledger, DAP_CHAIN_LEDGER_HISTORY_STR);
+        dap_chain_global_db_gr_del(NULL, l_gdb_group);
+        DAP_DELETE(l_gdb_group);
     }
 
-    pthread_rwlock_unlock(&l_ledger_priv->ledger_rwlock);
     pthread_rwlock_unlock(&l_ledger_priv->tokens_rwlock);
     pthread_rwlock_unlock(&l_ledger_priv->treshold_emissions_rwlock);
     pthread_rwlock_unlock(&l_ledger_priv->treshold_txs_rwlock);
-    pthread_rwlock_unlock(&l_ledger_priv->balance_accounts_rwlock);
+    pthread_rwlock_unlock(&l_ledger_priv->history_rwlock);
+    for (int i = 0; i < LEDGER_SHARDS_COUNT; i++) {
+        pthread_rwlock_unlock(&l_ledger_priv->tx_shards[i].rwlock);
+        pthread_rwlock_unlock(&l_ledger_priv->balance_shards[i].rwlock);
+    }
 }
 
 /**
@@ -2760,9 +3573,13 @@ void dap_chain_ledger_purge(dap_ledger_t *a_ledger, bool a_preserve_db)
  */
 unsigned dap_chain_ledger_count(dap_ledger_t *a_ledger)
 {
-    pthread_rwlock_rdlock(&PVT(a_ledger)->ledger_rwlock);
-    unsigned long ret = HASH_COUNT(PVT(a_ledger)->ledger_items);
-    pthread_rwlock_unlock(&PVT(a_ledger)->ledger_rwlock);
+    unsigned long ret = 0;
+    for (int i = 0; i < LEDGER_SHARDS_COUNT; i++) {
+        dap_ledger_tx_shard_t *l_shard = &PVT(a_ledger)->tx_shards[i];
+        pthread_rwlock_rdlock(&l_shard->rwlock);
+        ret += HASH_COUNT(l_shard->ledger_items);
+        pthread_rwlock_unlock(&l_shard->rwlock);
+    }
     return ret;
 }
 
@@ -2778,29 +3595,29 @@ uint64_t dap_chain_ledger_count_from_to(dap_ledger_t * a_ledger, time_t a_ts_fro
     uint64_t l_ret = 0;
     dap_ledger_private_t *l_ledger_priv = PVT(a_ledger);
     dap_chain_ledger_tx_item_t *l_iter_current, *l_item_tmp;
-    pthread_rwlock_rdlock(&l_ledger_priv->ledger_rwlock);
-    if ( a_ts_from && a_ts_to) {
-        HASH_ITER(hh, l_ledger_priv->ledger_items , l_iter_current, l_item_tmp){
-            if ( l_iter_current->cache_data.ts_created >= a_ts_from && l_iter_current->cache_data.ts_created <= a_ts_to )
-            l_ret++;
-        }
-    } else if ( a_ts_to ){
-        HASH_ITER(hh, l_ledger_priv->ledger_items , l_iter_current, l_item_tmp){
-            if ( l_iter_current->cache_data.ts_created <= a_ts_to )
-            l_ret++;
-        }
-    } else if ( a_ts_from ){
-        HASH_ITER(hh, l_ledger_priv->ledger_items , l_iter_current, l_item_tmp){
-            if ( l_iter_current->cache_data.ts_created >= a_ts_from )
-            l_ret++;
-        }
-    }else {
-        HASH_ITER(hh, l_ledger_priv->ledger_items , l_iter_current, l_item_tmp){
-            l_ret++;
+    for (int i = 0; i < LEDGER_SHARDS_COUNT; i++) {
+        dap_ledger_tx_shard_t *l_shard = &l_ledger_priv->tx_shards[i];
+        pthread_rwlock_rdlock(&l_shard->rwlock);
+        if ( a_ts_from && a_ts_to) {
+            HASH_ITER(hh, l_shard->ledger_items , l_iter_current, l_item_tmp){
+                if ( l_iter_current->cache_data.ts_created >= a_ts_from && l_iter_current->cache_data.ts_created <= a_ts_to )
+                l_ret++;
+            }
+        } else if ( a_ts_to ){
+            HASH_ITER(hh, l_shard->ledger_items , l_iter_current, l_item_tmp){
+                if ( l_iter_current->cache_data.ts_created <= a_ts_to )
+                l_ret++;
+            }
+        } else if ( a_ts_from ){
+            HASH_ITER(hh, l_shard->ledger_items , l_iter_current, l_item_tmp){
+                if ( l_iter_current->cache_data.ts_created >= a_ts_from )
+                l_ret++;
+            }
+        }else {
+            l_ret += HASH_COUNT(l_shard->ledger_items);
         }
+        pthread_rwlock_unlock(&l_shard->rwlock);
     }
-
-    pthread_rwlock_unlock(&l_ledger_priv->ledger_rwlock);
     return l_ret;
 }
 
@@ -2846,14 +3663,16 @@ uint128_t dap_chain_ledger_calc_balance(dap_ledger_t *a_ledger, const dap_chain_
     dap_ledger_wallet_balance_t *l_balance_item = NULL;// ,* l_balance_item_tmp = NULL;
     char *l_addr = dap_chain_addr_to_str(a_addr);
     char *l_wallet_balance_key = dap_strjoin(" ", l_addr, a_token_ticker, (char*)NULL);
-    pthread_rwlock_rdlock(&PVT(a_ledger)->balance_accounts_rwlock);
-    HASH_FIND_STR(PVT(a_ledger)->balance_accounts, l_wallet_balance_key, l_balance_item);
-    pthread_rwlock_unlock(&PVT(a_ledger)->balance_accounts_rwlock);
+    dap_ledger_balance_shard_t *l_shard = s_balance_shard(PVT(a_ledger), l_wallet_balance_key);
+    pthread_rwlock_rdlock(&l_shard->rwlock);
+    HASH_FIND_STR(l_shard->balance_accounts, l_wallet_balance_key, l_balance_item);
+    if (l_balance_item)
+        l_ret = l_balance_item->balance;
+    pthread_rwlock_unlock(&l_shard->rwlock);
     if (l_balance_item) {
         if(s_debug_more)
             log_it (L_INFO,"Found address in cache with balance %s",
-                            dap_chain_balance_print(l_balance_item->balance));
-        l_ret = l_balance_item->balance;
+                            dap_chain_balance_print(l_ret));
     } else {
         if (s_debug_more)
             log_it (L_WARNING, "Balance item %s not found", l_wallet_balance_key);
@@ -2883,9 +3702,10 @@ uint128_t dap_chain_ledger_calc_balance_full(dap_ledger_t *a_ledger, const dap_c
 
     */
     dap_ledger_private_t *l_ledger_priv = PVT(a_ledger);
-    dap_chain_ledger_tx_item_t *l_iter_current, *l_item_tmp;
-    pthread_rwlock_rdlock(&l_ledger_priv->ledger_rwlock);
-    HASH_ITER(hh, l_ledger_priv->ledger_items , l_iter_current, l_item_tmp)
+    dap_chain_ledger_tx_item_t *l_iter_current;
+    int l_shard_idx;
+    for (l_iter_current = s_tx_iter_first(l_ledger_priv, NULL, &l_shard_idx); l_iter_current;
+            l_iter_current = s_tx_iter_next(l_ledger_priv, l_iter_current, &l_shard_idx))
     {
         dap_chain_datum_tx_t *l_cur_tx = l_iter_current->tx;
 
@@ -2893,26 +3713,25 @@ uint128_t dap_chain_ledger_calc_balance_full(dap_ledger_t *a_ledger, const dap_c
         //        int l_n_outs_used = l_iter_current->n_outs_used; // number of used 'out' items
 
         // Get 'out' items from transaction
-        int l_out_item_count = 0;
-        dap_list_t *l_list_out_items = dap_chain_datum_tx_items_get(l_cur_tx, TX_ITEM_TYPE_OUT_ALL, &l_out_item_count);
+        int l_out_item_count = l_iter_current->items->out_count;
         if(l_out_item_count >= MAX_OUT_ITEMS) {
             if(s_debug_more)
                 log_it(L_ERROR, "Too many 'out' items=%d in transaction (max=%d)", l_out_item_count, MAX_OUT_ITEMS);
             if (l_out_item_count >= MAX_OUT_ITEMS){
+                s_tx_iter_stop(l_ledger_priv, l_shard_idx);
                 uint128_t l_ret;
                 memset(&l_ret,0,sizeof(l_ret));
                 return l_ret;
             }
         }
-        int l_out_idx_tmp = 0;
-        for (dap_list_t *l_list_tmp = l_list_out_items; l_list_tmp; l_list_tmp = dap_list_next(l_list_tmp), l_out_idx_tmp++) {
-            assert(l_list_tmp->data);
-            dap_chain_tx_item_type_t l_type = *(uint8_t *)l_list_tmp->data;
+        for (int l_out_idx_tmp = 0; l_out_idx_tmp < l_out_item_count; l_out_idx_tmp++) {
+            uint8_t *l_out_item = l_iter_current->items->out[l_out_idx_tmp];
+            dap_chain_tx_item_type_t l_type = *l_out_item;
             if (l_type == TX_ITEM_TYPE_OUT_COND) {
                 continue;
             }
             if (l_type == TX_ITEM_TYPE_OUT) {
-                const dap_chain_tx_out_t *l_tx_out = (const dap_chain_tx_out_t*) l_list_tmp->data;
+                const dap_chain_tx_out_t *l_tx_out = (const dap_chain_tx_out_t*) l_out_item;
                 // Check for token name
                 if (!strcmp(a_token_ticker, l_iter_current->cache_data.token_ticker))
                 {   // if transaction has the out item with requested addr
@@ -2928,7 +3747,7 @@ uint128_t dap_chain_ledger_calc_balance_full(dap_ledger_t *a_ledger, const dap_c
                 }
             }
             if (l_type == TX_ITEM_TYPE_OUT_EXT) {
-                const dap_chain_tx_out_ext_t *l_tx_out = (const dap_chain_tx_out_ext_t*) l_list_tmp->data;
+                const dap_chain_tx_out_ext_t *l_tx_out = (const dap_chain_tx_out_ext_t*) l_out_item;
                 // Check for token name
                 if (!strcmp(a_token_ticker, l_tx_out->token))
                 {   // if transaction has the out item with requested addr
@@ -2943,9 +3762,8 @@ uint128_t dap_chain_ledger_calc_balance_full(dap_ledger_t *a_ledger, const dap_c
                 }
             }
         }
-        dap_list_free(l_list_out_items);
     }
-    pthread_rwlock_unlock(&l_ledger_priv->ledger_rwlock);
+    s_tx_iter_stop(l_ledger_priv, l_shard_idx);
     return balance;
 }
 
@@ -2963,35 +3781,27 @@ static dap_chain_ledger_tx_item_t* tx_item_find_by_addr(dap_ledger_t *a_ledger,
         return NULL;
     dap_ledger_private_t *l_ledger_priv = PVT(a_ledger);
     bool is_tx_found = false;
-    bool is_null_hash = dap_hash_fast_is_blank(a_tx_first_hash);
-    bool is_search_enable = is_null_hash;
-    dap_chain_ledger_tx_item_t *l_iter_current, *l_item_tmp;
-    pthread_rwlock_rdlock(&l_ledger_priv->ledger_rwlock);
-    HASH_ITER(hh, l_ledger_priv->ledger_items , l_iter_current, l_item_tmp)
+    dap_chain_ledger_tx_item_t *l_iter_current;
+    int l_shard_idx;
+    // start searching from the next hash after a_tx_first_hash
+    for (l_iter_current = s_tx_iter_first(l_ledger_priv, a_tx_first_hash, &l_shard_idx); l_iter_current;
+            l_iter_current = s_tx_iter_next(l_ledger_priv, l_iter_current, &l_shard_idx))
     {
         // If a_token is setup we check if its not our token - miss it
         if (a_token && *l_iter_current->cache_data.token_ticker &&
                 dap_strcmp(l_iter_current->cache_data.token_ticker, a_token))
             continue;
         // Now work with it
-        dap_chain_datum_tx_t *l_tx = l_iter_current->tx;
         dap_chain_hash_fast_t *l_tx_hash = &l_iter_current->tx_hash_fast;
-        // start searching from the next hash after a_tx_first_hash
-        if(!is_search_enable) {
-            if(dap_hash_fast_compare(l_tx_hash, a_tx_first_hash))
-                is_search_enable = true;
-            continue;
-        }
         // Get 'out' items from transaction
-        dap_list_t *l_list_out_items = dap_chain_datum_tx_items_get(l_tx, TX_ITEM_TYPE_OUT_ALL, NULL);
-        for(dap_list_t *l_list_tmp = l_list_out_items; l_list_tmp; l_list_tmp = dap_list_next(l_list_tmp)) {
-            assert(l_list_tmp->data);
-            dap_chain_tx_item_type_t l_type = *(uint8_t *)l_list_tmp->data;
+        for (int i = 0; i < l_iter_current->items->out_count; i++) {
+            uint8_t *l_out_item = l_iter_current->items->out[i];
+            dap_chain_tx_item_type_t l_type = *l_out_item;
             if (l_type == TX_ITEM_TYPE_OUT_COND) {
                 continue;
             }
             if (l_type == TX_ITEM_TYPE_OUT) {
-                const dap_chain_tx_out_t *l_tx_out = (const dap_chain_tx_out_t *)l_list_tmp->data;
+                const dap_chain_tx_out_t *l_tx_out = (const dap_chain_tx_out_t *)l_out_item;
                 // if transaction has the out item with requested addr
                 if(!memcmp(a_addr, &l_tx_out->addr, sizeof(dap_chain_addr_t))) {
                     memcpy(a_tx_first_hash, l_tx_hash, sizeof(dap_chain_hash_fast_t));
@@ -3000,7 +3810,7 @@ static dap_chain_ledger_tx_item_t* tx_item_find_by_addr(dap_ledger_t *a_ledger,
                 }
             }
             if (l_type == TX_ITEM_TYPE_OUT_EXT) {
-                const dap_chain_tx_out_ext_t *l_tx_out_ext = (const dap_chain_tx_out_ext_t *)l_list_tmp->data;
+                const dap_chain_tx_out_ext_t *l_tx_out_ext = (const dap_chain_tx_out_ext_t *)l_out_item;
                 // If a_token is setup we check if its not our token - miss it
                 if (a_token && dap_strcmp(l_tx_out_ext->token, a_token)) {
                     continue;
@@ -3012,13 +3822,12 @@ static dap_chain_ledger_tx_item_t* tx_item_find_by_addr(dap_ledger_t *a_ledger,
                 }
             }
         }
-        dap_list_free(l_list_out_items);
         // already found transaction
         if(is_tx_found)
             break;
 
     }
-    pthread_rwlock_unlock(&l_ledger_priv->ledger_rwlock);
+    s_tx_iter_stop(l_ledger_priv, l_shard_idx);
     if(is_tx_found)
         return l_iter_current;
     else
@@ -3055,22 +3864,15 @@ const dap_chain_datum_tx_t* dap_chain_ledger_tx_find_by_pkey(dap_ledger_t *a_led
         return NULL;
     dap_ledger_private_t *l_ledger_priv = PVT(a_ledger);
     dap_chain_datum_tx_t *l_cur_tx = NULL;
-    bool is_null_hash = dap_hash_fast_is_blank(a_tx_first_hash);
-    bool is_search_enable = is_null_hash;
-    dap_chain_ledger_tx_item_t *l_iter_current, *l_item_tmp;
-    pthread_rwlock_rdlock(&l_ledger_priv->ledger_rwlock);
-    HASH_ITER(hh, l_ledger_priv->ledger_items , l_iter_current, l_item_tmp) {
+    dap_chain_ledger_tx_item_t *l_iter_current;
+    int l_shard_idx;
+    // start searching from the next hash after a_tx_first_hash
+    for (l_iter_current = s_tx_iter_first(l_ledger_priv, a_tx_first_hash, &l_shard_idx); l_iter_current;
+            l_iter_current = s_tx_iter_next(l_ledger_priv, l_iter_current, &l_shard_idx)) {
         dap_chain_datum_tx_t *l_tx_tmp = l_iter_current->tx;
         dap_chain_hash_fast_t *l_tx_hash_tmp = &l_iter_current->tx_hash_fast;
-        // start searching from the next hash after a_tx_first_hash
-        if(!is_search_enable) {
-            if(dap_hash_fast_compare(l_tx_hash_tmp, a_tx_first_hash))
-                is_search_enable = true;
-            continue;
-        }
         // Get sign item from transaction
-        dap_chain_tx_sig_t *l_tx_sig = (dap_chain_tx_sig_t*) dap_chain_datum_tx_item_get(l_tx_tmp, NULL,
-                TX_ITEM_TYPE_SIG, NULL);
+        dap_chain_tx_sig_t *l_tx_sig = l_iter_current->items->sig;
         // Get dap_sign_t from item
         dap_sign_t *l_sig = dap_chain_datum_tx_item_sign_get_sig(l_tx_sig);
         if(l_sig) {
@@ -3083,7 +3885,7 @@ const dap_chain_datum_tx_t* dap_chain_ledger_tx_find_by_pkey(dap_ledger_t *a_led
             }
         }
     }
-    pthread_rwlock_unlock(&l_ledger_priv->ledger_rwlock);
+    s_tx_iter_stop(l_ledger_priv, l_shard_idx);
     return l_cur_tx;
 }
 
@@ -3099,23 +3901,17 @@ dap_chain_datum_tx_t* dap_chain_ledger_tx_cache_find_out_cond(dap_ledger_t *a_le
         return NULL;
     dap_ledger_private_t *l_ledger_priv = PVT(a_ledger);
     dap_chain_datum_tx_t *l_cur_tx = NULL;
-    bool is_null_hash = dap_hash_fast_is_blank(a_tx_first_hash);
-    bool is_search_enable = is_null_hash;
-    dap_chain_ledger_tx_item_t *l_iter_current = NULL, *l_item_tmp = NULL;
+    dap_chain_ledger_tx_item_t *l_iter_current = NULL;
     dap_chain_tx_out_cond_t *l_tx_out_cond = NULL;
-    int l_tx_out_cond_idx;
-    pthread_rwlock_rdlock(&l_ledger_priv->ledger_rwlock);
-    HASH_ITER(hh, l_ledger_priv->ledger_items, l_iter_current, l_item_tmp) {
+    int l_tx_out_cond_idx = 0, l_shard_idx;
+    // start searching from the next hash after a_tx_first_hash
+    for (l_iter_current = s_tx_iter_first(l_ledger_priv, a_tx_first_hash, &l_shard_idx); l_iter_current;
+            l_iter_current = s_tx_iter_next(l_ledger_priv, l_iter_current, &l_shard_idx)) {
         dap_chain_datum_tx_t *l_tx_tmp = l_iter_current->tx;
         dap_chain_hash_fast_t *l_tx_hash_tmp = &l_iter_current->tx_hash_fast;
-        // start searching from the next hash after a_tx_first_hash
-        if(!is_search_enable) {
-            if(dap_hash_fast_compare(l_tx_hash_tmp, a_tx_first_hash))
-                is_search_enable = true;
-            continue;
-        }
         // Get out_cond item from transaction
-        l_tx_out_cond = dap_chain_datum_tx_out_cond_get(l_tx_tmp, &l_tx_out_cond_idx);
+        l_tx_out_cond = l_iter_current->items->out_cond;
+        l_tx_out_cond_idx = l_iter_current->items->out_cond_idx;
 
         if(l_tx_out_cond) {
             l_cur_tx = l_tx_tmp;
@@ -3126,7 +3922,7 @@ dap_chain_datum_tx_t* dap_chain_ledger_tx_cache_find_out_cond(dap_ledger_t *a_le
             break;
         }
     }
-    pthread_rwlock_unlock(&l_ledger_priv->ledger_rwlock);
+    s_tx_iter_stop(l_ledger_priv, l_shard_idx);
     if (a_out_cond) {
         *a_out_cond = l_tx_out_cond;
     }
@@ -3195,28 +3991,25 @@ dap_list_t *dap_chain_ledger_get_list_tx_outs_with_val(dap_ledger_t *a_ledger, c
     while(l_value_transfer < a_value_need)
     {
         // Get the transaction in the cache by the addr in out item
-        dap_chain_datum_tx_t *l_tx = dap_chain_ledger_tx_find_by_addr(a_ledger, a_token_ticker, a_addr_from,
-                                                                             &l_tx_cur_hash);
-        if(!l_tx)
+        dap_chain_ledger_tx_item_t *l_tx_item = tx_item_find_by_addr(a_ledger, a_addr_from, a_token_ticker, &l_tx_cur_hash);
+        if(!l_tx_item)
             break;
-        // Get all item from transaction by type
-        dap_list_t *l_list_out_items = dap_chain_datum_tx_items_get(l_tx, TX_ITEM_TYPE_OUT_ALL, NULL);
-
-        uint32_t l_out_idx_tmp = 0; // current index of 'out' item
-        for (dap_list_t *l_list_tmp = l_list_out_items; l_list_tmp; l_list_tmp = dap_list_next(l_list_tmp), l_out_idx_tmp++) {
-            dap_chain_tx_item_type_t l_type = *(uint8_t *)l_list_tmp->data;
+        // 'out' items of the transaction, index in array is the 'out' index
+        for (int l_out_idx_tmp = 0; l_out_idx_tmp < l_tx_item->items->out_count; l_out_idx_tmp++) {
+            uint8_t *l_out_item = l_tx_item->items->out[l_out_idx_tmp];
+            dap_chain_tx_item_type_t l_type = *l_out_item;
             if (l_type == TX_ITEM_TYPE_OUT_COND) {
                 continue;
             }
             uint64_t l_value;
             if (l_type == TX_ITEM_TYPE_OUT) {
-                dap_chain_tx_out_t *l_out = (dap_chain_tx_out_t *)l_list_tmp->data;
+                dap_chain_tx_out_t *l_out = (dap_chain_tx_out_t *)l_out_item;
                 if (!l_out->header.value || memcmp(a_addr_from, &l_out->addr, sizeof(dap_chain_addr_t))) {
                     continue;
                 }
                 l_value =  l_out->header.value;
             } else { // TX_ITEM_TYPE_OUT_EXT
-                dap_chain_tx_out_ext_t *l_out_ext = (dap_chain_tx_out_ext_t *)l_list_tmp->data;
+                dap_chain_tx_out_ext_t *l_out_ext = (dap_chain_tx_out_ext_t *)l_out_item;
                 if (!l_out_ext->header.value || memcmp(a_addr_from, &l_out_ext->addr, sizeof(dap_chain_addr_t)) ||
                         strcmp((char *)a_token_ticker, l_out_ext->token)) {
                     continue;
@@ -3224,7 +4017,7 @@ dap_list_t *dap_chain_ledger_get_list_tx_outs_with_val(dap_ledger_t *a_ledger, c
                 l_value =  l_out_ext->header.value;
             }
             // Check whether used 'out' items
-            if (!dap_chain_ledger_tx_hash_is_used_out_item (a_ledger, &l_tx_cur_hash, l_out_idx_tmp)) {
+            if (!dap_chain_ledger_item_is_used_out(l_tx_item, l_out_idx_tmp)) {
                 list_used_item_t *item = DAP_NEW(list_used_item_t);
                 memcpy(&item->tx_hash_fast, &l_tx_cur_hash, sizeof(dap_chain_hash_fast_t));
                 item->num_idx_out = l_out_idx_tmp;
@@ -3237,7 +4030,6 @@ dap_list_t *dap_chain_ledger_get_list_tx_outs_with_val(dap_ledger_t *a_ledger, c
                 }
             }
         }
-        dap_list_free(l_list_out_items);
     }
 
     // nothing to tranfer (not enough funds)
@@ -3280,23 +4072,32 @@ int dap_chain_ledger_verificator_rwlock_init(void) {
 dap_list_t * dap_chain_ledger_get_txs(dap_ledger_t *a_ledger, size_t a_count, size_t a_page){
     dap_ledger_private_t *l_ledger_priv = PVT(a_ledger);
     size_t l_offset = a_count * (a_page - 1);
-    size_t l_count = HASH_COUNT(l_ledger_priv->ledger_items);
     if (a_page < 2)
         l_offset = 0;
-    if (l_offset > l_count){
-        return NULL;
+    // Walk all shards from their tails merging by addition order, newest first
+    dap_chain_ledger_tx_item_t *l_cursors[LEDGER_SHARDS_COUNT];
+    for (int i = 0; i < LEDGER_SHARDS_COUNT; i++) {
+        dap_ledger_tx_shard_t *l_shard = &l_ledger_priv->tx_shards[i];
+        pthread_rwlock_rdlock(&l_shard->rwlock);
+        l_cursors[i] = l_shard->ledger_items
+                ? ELMT_FROM_HH(l_shard->ledger_items->hh.tbl, l_shard->ledger_items->hh.tbl->tail)
+                : NULL;
     }
     dap_list_t *l_list = NULL;
-    size_t l_counter = 0;
     size_t l_end = l_offset + a_count;
-    dap_chain_ledger_tx_item_t *l_ptr = l_ledger_priv->ledger_items->hh.tbl->tail->prev;
-    l_ptr = l_ptr->hh.next;
-    for (dap_chain_ledger_tx_item_t *ptr = l_ptr; ptr != NULL && l_counter < l_end; ptr = ptr->hh.prev){
-        if (l_counter >= l_offset){
-            dap_chain_datum_tx_t *l_tx = ptr->tx;
-            l_list = dap_list_append(l_list, l_tx);
+    for (size_t l_counter = 0; l_counter < l_end; l_counter++) {
+        int l_newest = -1;
+        for (int i = 0; i < LEDGER_SHARDS_COUNT; i++) {
+            if (l_cursors[i] && (l_newest < 0 || l_cursors[i]->seq_num > l_cursors[l_newest]->seq_num))
+                l_newest = i;
         }
-        l_counter++;
+        if (l_newest < 0)
+            break;
+        if (l_counter >= l_offset)
+            l_list = dap_list_append(l_list, l_cursors[l_newest]->tx);
+        l_cursors[l_newest] = l_cursors[l_newest]->hh.prev;
     }
+    for (int i = 0; i < LEDGER_SHARDS_COUNT; i++)
+        pthread_rwlock_unlock(&l_ledger_priv->tx_shards[i].rwlock);
     return l_list;
 }
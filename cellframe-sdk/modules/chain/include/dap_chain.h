@@ -189,5 +189,10 @@ dap_chain_t * dap_chain_load_from_cfg(dap_ledger_t* a_ledger,const char * a_chai
 void dap_chain_delete(dap_chain_t * a_chain);
 void dap_chain_add_callback_notify(dap_chain_t * a_chain, dap_chain_callback_notify_t a_callback, void * a_arg);
 dap_chain_atom_ptr_t dap_chain_get_atom_by_hash(dap_chain_t * a_chain, dap_chain_hash_fast_t * a_atom_hash, size_t * a_atom_size);
+dap_chain_atom_iter_t *dap_chain_atom_iter_snapshot_create(dap_chain_t *a_chain, dap_chain_cell_id_t a_cell_id);
+dap_chain_atom_ptr_t dap_chain_atom_iter_snapshot_get_next(dap_chain_atom_iter_t *a_iter, size_t *a_atom_size);
+dap_chain_atom_ptr_t dap_chain_atom_iter_snapshot_find_by_hash(dap_chain_atom_iter_t *a_iter, dap_chain_hash_fast_t *a_atom_hash,
+                                                               size_t *a_atom_size);
+void dap_chain_atom_iter_snapshot_delete(dap_chain_atom_iter_t *a_iter);
 bool dap_chain_get_atom_last_hash(dap_chain_t * a_chain, dap_hash_fast_t * a_atom_hash);
 ssize_t dap_chain_atom_save(dap_chain_t *a_chain, const uint8_t *a_atom, size_t a_atom_size, dap_chain_cell_id_t a_cell_id);
@@ -30,6 +30,20 @@
 typedef struct dap_chain dap_chain_t;
 typedef struct dap_chain_cell dap_chain_cell_t;
 
+/**
+  * @struct dap_chain_cell_atom_pos
+  * @brief Atom position in the cell file
+  */
+typedef struct dap_chain_cell_atom_pos {
+    uint64_t seq;       /// @brief Atom number in the cell file, starting from 0
+    uint64_t offset;    /// @brief Offset of atom data in the cell file
+    uint64_t size;      /// @brief Atom size
+} dap_chain_cell_atom_pos_t;
+
+typedef struct dap_chain_cell_index_item dap_chain_cell_index_item_t;
+typedef struct dap_chain_cell_map dap_chain_cell_map_t;
+typedef struct dap_chain_cell_append dap_chain_cell_append_t;
+
 typedef struct dap_chain_cell {
     dap_chain_cell_id_t id;
     dap_chain_t * chain;
@@ -37,8 +51,30 @@ typedef struct dap_chain_cell {
     char * file_storage_path;
     FILE * file_storage; /// @param file_cache @brief Cache for raw blocks
     uint8_t file_storage_type; /// @param file_storage_type  @brief Is file_storage is raw, compressed or smth else
+    uint64_t frames_end; /// @param frames_end @brief End of the last valid frame in compressed cell file
+    uint64_t frames_mapped; /// @param frames_mapped @brief End of the frames unpacked into memory
+    uint64_t tail_start; /// @param tail_start @brief Start of the open tail of small frames in compressed cell file, 0 if it's not found yet
+    uint64_t tail_size; /// @param tail_size @brief Raw size of the open tail
+    uint32_t tail_atoms; /// @param tail_atoms @brief Atoms in the open tail
     pthread_rwlock_t storage_rwlock;
 
+    FILE * file_index; /// @param file_index @brief Sidecar index: atom hash -> position, appended with the cell file
+    dap_chain_cell_index_item_t * atoms_index; /// @param atoms_index @brief Atom positions by hash
+    dap_chain_cell_index_item_t ** atoms; /// @param atoms @brief Atom positions by sequence number
+    uint64_t atoms_count;
+    uint64_t atoms_size; /// @param atoms_size @brief Allocated size of atoms array
+    dap_chain_cell_map_t * maps; /// @param maps @brief Memory mappings of the cell file, the newest first
+    uint64_t generation; /// @param generation @brief Changes with every rewrite of the cell file, unique among all cells
+
+    pthread_mutex_t append_mutex;
+    pthread_cond_t append_cond;
+    dap_chain_cell_append_t * append_queue; /// @param append_queue @brief Atoms waiting to be written with the next batch
+    bool append_writing; /// @param append_writing @brief Some thread is writing a batch or rewriting the cell file now
+    uint64_t unsynced_count; /// @param unsynced_count @brief Atoms written since the last data sync
+    uint64_t synced_ms; /// @param synced_ms @brief Time of the last data sync
+    dap_chain_hash_fast_t update_last_hash; /// @param update_last_hash @brief Last atom checked by dap_chain_cell_file_update(), it and atoms before it are saved
+    uint64_t update_generation; /// @param update_generation @brief Cell generation update_last_hash belongs to, 0 if nothing is checked yet
+
     UT_hash_handle hh;
 } dap_chain_cell_t;
 
@@ -81,3 +117,10 @@ void dap_chain_cell_delete(dap_chain_cell_t *a_cell);
 int dap_chain_cell_load(dap_chain_t * a_chain, const char * a_cell_file_path);
 int dap_chain_cell_file_update( dap_chain_cell_t * a_cell);
 int dap_chain_cell_file_append( dap_chain_cell_t * a_cell,const void* a_atom, size_t a_atom_size);
+uint64_t dap_chain_cell_atoms_count(dap_chain_cell_t *a_cell, uint64_t *a_generation);
+int dap_chain_cell_atom_pos_by_hash(dap_chain_cell_t *a_cell, dap_chain_hash_fast_t *a_atom_hash, dap_chain_cell_atom_pos_t *a_pos);
+int dap_chain_cell_atom_pos_by_seq(dap_chain_cell_t *a_cell, uint64_t a_seq, dap_chain_cell_atom_pos_t *a_pos);
+void *dap_chain_cell_atom_get(dap_chain_cell_t *a_cell, const dap_chain_cell_atom_pos_t *a_pos);
+void *dap_chain_cell_atom_get_by_seq(dap_chain_cell_t *a_cell, uint64_t a_generation, uint64_t a_seq,
+                                     dap_chain_cell_atom_pos_t *a_pos, dap_chain_hash_fast_t *a_hash);
+int dap_chain_cell_file_convert(const char *a_src_path, const char *a_dst_path, bool a_compress);
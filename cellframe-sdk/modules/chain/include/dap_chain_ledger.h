@@ -42,6 +42,43 @@ typedef struct dap_ledger {
     void *_internal;
 } dap_ledger_t;
 
+// Threshold queues state, depth and bytes are current values, counters are cumulative
+typedef struct dap_chain_ledger_treshold_info {
+    size_t txs_count;
+    size_t txs_count_max;       // highest depth ever reached
+    size_t txs_limit;
+    size_t txs_size;            // bytes held by waiting txs
+    uint64_t txs_added;
+    uint64_t txs_resolved;      // waiting txs that got into ledger
+    uint64_t txs_dropped;       // woken txs rejected for other reasons
+    uint64_t txs_evicted;       // oldest txs pushed out by overflow
+    size_t emissions_count;
+    size_t emissions_count_max;
+    size_t emissions_limit;
+    size_t emissions_size;
+    uint64_t emissions_added;
+    uint64_t emissions_resolved;
+    uint64_t emissions_evicted;
+} dap_chain_ledger_treshold_info_t;
+
+typedef enum dap_chain_ledger_history_dir {
+    DAP_CHAIN_LEDGER_HISTORY_TRANSFER = 0,  // token history entries
+    DAP_CHAIN_LEDGER_HISTORY_RECV,
+    DAP_CHAIN_LEDGER_HISTORY_SEND
+} dap_chain_ledger_history_dir_t;
+
+// One value transfer of an indexed transaction
+typedef struct dap_chain_ledger_history_item {
+    dap_chain_hash_fast_t tx_hash;
+    uint64_t seq_num;               // position of the tx in ledger history
+    time_t ts_created;
+    dap_chain_ledger_history_dir_t direction;
+    uint64_t value;
+    char token_ticker[DAP_CHAIN_TICKER_SIZE_MAX];
+    dap_chain_addr_t addr_from;     // blank for emission and conditional txs
+    dap_chain_addr_t addr_to;
+} dap_chain_ledger_history_item_t;
+
 typedef bool (* dap_chain_ledger_verificator_callback_t)(dap_chain_tx_out_cond_t *a_cond, dap_chain_datum_tx_t *a_tx, bool a_owner);
 
 // Checks the emission of the token, usualy on zero chain
@@ -65,6 +102,7 @@ typedef bool (* dap_chain_ledger_verificator_callback_t)(dap_chain_tx_out_cond_t
 #define DAP_CHAIN_LEDGER_TXS_STR                 "txs"
 #define DAP_CHAIN_LEDGER_SPENT_TXS_STR           "spent_txs"
 #define DAP_CHAIN_LEDGER_BALANCES_STR            "balances"
+#define DAP_CHAIN_LEDGER_HISTORY_STR             "history"
 
 int dap_chain_ledger_init();
 void dap_chain_ledger_deinit();
@@ -126,6 +164,18 @@ int dap_chain_ledger_token_add(dap_ledger_t * a_ledger,dap_chain_datum_token_t *
 int dap_chain_ledger_token_load(dap_ledger_t * a_ledger,dap_chain_datum_token_t *a_token, size_t a_token_size);
 int dap_chain_ledger_token_decl_add_check(dap_ledger_t * a_ledger,dap_chain_datum_token_t *a_token);
 dap_list_t *dap_chain_ledger_token_info(dap_ledger_t *a_ledger);
+void dap_chain_ledger_treshold_info(dap_ledger_t *a_ledger, dap_chain_ledger_treshold_info_t *a_info);
+
+/**
+ * Get a page of indexed history of address or token, oldest first.
+ * a_count == 0 means up to the end. Returned items must be freed with DAP_DELETE
+ *
+ * return total number of history items for address or token
+ */
+size_t dap_chain_ledger_history_addr(dap_ledger_t *a_ledger, const dap_chain_addr_t *a_addr, size_t a_offset, size_t a_count,
+                                     dap_chain_ledger_history_item_t **a_items, size_t *a_items_count);
+size_t dap_chain_ledger_history_token(dap_ledger_t *a_ledger, const char *a_token_ticker, size_t a_offset, size_t a_count,
+                                      dap_chain_ledger_history_item_t **a_items, size_t *a_items_count);
 /**
  * Add token emission datum
  */
@@ -146,6 +196,13 @@ void dap_chain_ledger_addr_get_token_ticker_all(dap_ledger_t *a_ledger, dap_chai
 void dap_chain_ledger_addr_get_token_ticker_all_fast(dap_ledger_t *a_ledger, dap_chain_addr_t * a_addr,
         char *** a_tickers, size_t * a_tickers_size);
 
+/**
+ * Verify tx signatures ahead of the tx processing, thread-safe.
+ * The result is taken once by the tx check instead of verifying signatures again
+ */
+void dap_chain_ledger_tx_sign_preverify(dap_ledger_t *a_ledger, dap_chain_datum_tx_t *a_tx);
+void dap_chain_ledger_tx_sign_preverify_clear(dap_ledger_t *a_ledger);
+
 // Checking a new transaction before adding to the cache
 int dap_chain_ledger_tx_cache_check(dap_ledger_t *a_ledger, dap_chain_datum_tx_t *a_tx,
         dap_list_t **a_list_bound_items, dap_list_t **a_list_tx_out);
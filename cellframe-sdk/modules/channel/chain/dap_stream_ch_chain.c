@@ -192,7 +192,8 @@ static bool s_stream_ch_delete_in_proc(dap_proc_thread_t * a_thread, void * a_ar
 static void s_stream_ch_delete(dap_stream_ch_t* a_ch, void* a_arg)
 {
     (void) a_arg;
-    dap_proc_queue_add_callback_inter(a_ch->stream_worker->worker->proc_queue_input,s_stream_ch_delete_in_proc,a_ch->internal );
+    dap_proc_queue_add_callback_inter_ext(a_ch->stream_worker->worker->proc_queue_input, s_stream_ch_delete_in_proc, a_ch->internal,
+                                          DAP_PROC_PRI_NORMAL, true);
     a_ch->internal = NULL; // To prevent its cleaning in worker
 }
 
@@ -256,7 +257,7 @@ static void s_sync_out_chains_last_worker_callback(dap_worker_t *a_worker, void
             l_sync_request->request_hdr.cell_id.uint64, &l_request, sizeof(l_request));
     if (l_ch_chain->request_atom_iter)
     {
-        l_ch_chain->request_atom_iter->chain->callback_atom_iter_delete(l_ch_chain->request_atom_iter);
+        dap_chain_atom_iter_snapshot_delete(l_ch_chain->request_atom_iter);
         l_ch_chain->request_atom_iter = NULL;
     }
 
@@ -279,14 +280,13 @@ static bool s_sync_out_chains_proc_callback(dap_proc_thread_t *a_thread, void *a
     dap_chain_t * l_chain = dap_chain_find_by_id(l_sync_request->request_hdr.net_id, l_sync_request->request_hdr.chain_id);
     assert(l_chain);
     //pthread_rwlock_rdlock(&l_chain->atoms_rwlock);
-    l_sync_request->chain.request_atom_iter = l_chain->callback_atom_iter_create(l_chain);
-    size_t l_first_size = 0;
-    dap_chain_atom_ptr_t l_iter = l_chain->callback_atom_iter_get_first(l_sync_request->chain.request_atom_iter, &l_first_size);
-    if (l_iter && l_first_size) {
+    l_sync_request->chain.request_atom_iter = dap_chain_atom_iter_snapshot_create(l_chain, l_sync_request->request_hdr.cell_id);
+    size_t l_first_size = l_sync_request->chain.request_atom_iter ? l_sync_request->chain.request_atom_iter->cur_size : 0;
+    if (l_first_size && l_sync_request->chain.request_atom_iter->cur) {
         // first packet
         if (!dap_hash_fast_is_blank(&l_sync_request->request.hash_from)) {
-            (void ) l_chain->callback_atom_find_by_hash(l_sync_request->chain.request_atom_iter,
-                                                          &l_sync_request->request.hash_from, &l_first_size);
+            (void ) dap_chain_atom_iter_snapshot_find_by_hash(l_sync_request->chain.request_atom_iter,
+                                                              &l_sync_request->request.hash_from, &l_first_size);
         }
 
 
@@ -898,7 +898,8 @@ void s_stream_ch_packet_in(dap_stream_ch_t* a_ch, void* a_arg)
                 l_ch_chain->request.id_start = 1;   // incremental sync by default
             struct sync_request *l_sync_request = dap_stream_ch_chain_create_sync_request(l_chain_pkt, a_ch);
             l_ch_chain->stats_request_gdb_processed = 0;
-            dap_proc_queue_add_callback_inter(a_ch->stream_worker->worker->proc_queue_input, s_sync_update_gdb_proc_callback, l_sync_request);
+            dap_proc_queue_add_callback_inter_ext(a_ch->stream_worker->worker->proc_queue_input, s_sync_update_gdb_proc_callback, l_sync_request,
+                                                  DAP_PROC_PRI_LOW, true);
         } break;
 
         // Response with metadata organized in TSD
@@ -1006,7 +1007,8 @@ void s_stream_ch_packet_in(dap_stream_ch_t* a_ch, void* a_arg)
                 if (l_chain_pkt_data_size == sizeof(dap_stream_ch_chain_sync_request_t))
                     memcpy(&l_ch_chain->request, l_chain_pkt->data, sizeof(dap_stream_ch_chain_sync_request_t));
                 struct sync_request *l_sync_request = dap_stream_ch_chain_create_sync_request(l_chain_pkt, a_ch);
-                dap_proc_queue_add_callback_inter(a_ch->stream_worker->worker->proc_queue_input, s_sync_out_gdb_proc_callback, l_sync_request);
+                dap_proc_queue_add_callback_inter_ext(a_ch->stream_worker->worker->proc_queue_input, s_sync_out_gdb_proc_callback, l_sync_request,
+                                                      DAP_PROC_PRI_LOW, true);
             }else{
                 log_it(L_WARNING, "DAP_STREAM_CH_CHAIN_PKT_TYPE_SYNC_GLOBAL_DB: Wrong chain packet size %zd when expected %zd", l_chain_pkt_data_size, sizeof(l_ch_chain->request));
                 s_stream_ch_write_error_unsafe(a_ch, l_chain_pkt->hdr.net_id.uint64,
@@ -1040,7 +1042,8 @@ void s_stream_ch_packet_in(dap_stream_ch_t* a_ch, void* a_arg)
                 l_pkt_item->pkt_data = DAP_NEW_SIZE(byte_t, l_chain_pkt_data_size);
                 memcpy(l_pkt_item->pkt_data, l_chain_pkt->data, l_chain_pkt_data_size);
                 l_pkt_item->pkt_data_size = l_chain_pkt_data_size;
-                dap_proc_queue_add_callback_inter(a_ch->stream_worker->worker->proc_queue_input, s_gdb_in_pkt_proc_callback, l_sync_request);
+                dap_proc_queue_add_callback_inter_ext(a_ch->stream_worker->worker->proc_queue_input, s_gdb_in_pkt_proc_callback, l_sync_request,
+                                                      DAP_PROC_PRI_LOW, true);
             } else {
                 log_it(L_WARNING, "Packet with GLOBAL_DB atom has zero body size");
                 s_stream_ch_write_error_unsafe(a_ch, l_chain_pkt->hdr.net_id.uint64,
@@ -1103,8 +1106,7 @@ void s_stream_ch_packet_in(dap_stream_ch_t* a_ch, void* a_arg)
                 if(s_debug_more)
                     log_it(L_INFO, "Out: UPDATE_CHAINS_START pkt: net %s chain %s cell 0x%016"DAP_UINT64_FORMAT_X, l_chain->name,
                                         l_chain->net_name, l_chain_pkt->hdr.cell_id.uint64);
-                l_ch_chain->request_atom_iter = l_chain->callback_atom_iter_create(l_chain);
-                l_chain->callback_atom_iter_get_first(l_ch_chain->request_atom_iter, NULL);
+                l_ch_chain->request_atom_iter = dap_chain_atom_iter_snapshot_create(l_chain, l_chain_pkt->hdr.cell_id);
                 memcpy(&l_ch_chain->request_hdr, &l_chain_pkt->hdr, sizeof(dap_stream_ch_chain_pkt_hdr_t));
                 dap_stream_ch_chain_pkt_write_unsafe(a_ch, DAP_STREAM_CH_CHAIN_PKT_TYPE_UPDATE_CHAINS_START,
                                                      l_chain_pkt->hdr.net_id.uint64,l_chain_pkt->hdr.chain_id.uint64,
@@ -1240,7 +1242,8 @@ void s_stream_ch_packet_in(dap_stream_ch_t* a_ch, void* a_arg)
                     DAP_DELETE(l_hash_from_str);
                     DAP_DELETE(l_hash_to_str);
                 }
-                dap_proc_queue_add_callback_inter(a_ch->stream_worker->worker->proc_queue_input, s_sync_out_chains_proc_callback, l_sync_request);
+                dap_proc_queue_add_callback_inter_ext(a_ch->stream_worker->worker->proc_queue_input, s_sync_out_chains_proc_callback, l_sync_request,
+                                                      DAP_PROC_PRI_NORMAL, true);
             } else {
                 log_it(L_WARNING, "DAP_STREAM_CH_CHAIN_PKT_TYPE_SYNC_CHAINS: Wrong chain packet size %zd when expected %zd",
                        l_chain_pkt_data_size, sizeof(l_ch_chain->request));
@@ -1288,7 +1291,8 @@ void s_stream_ch_packet_in(dap_stream_ch_t* a_ch, void* a_arg)
                             log_it(L_INFO, "In: CHAIN pkt: atom hash %s (size %zd)", l_atom_hash_str, l_chain_pkt_data_size);
                             DAP_DELETE(l_atom_hash_str);
                         }
-                        dap_proc_queue_add_callback_inter(a_ch->stream_worker->worker->proc_queue_input, s_sync_in_chains_callback, l_sync_request);
+                        dap_proc_queue_add_callback_inter_ext(a_ch->stream_worker->worker->proc_queue_input, s_sync_in_chains_callback, l_sync_request,
+                                                              DAP_PROC_PRI_NORMAL, true);
                     } else {
                         log_it(L_WARNING, "Empty chain packet");
                         s_stream_ch_write_error_unsafe(a_ch, l_chain_pkt->hdr.net_id.uint64,
@@ -1396,10 +1400,9 @@ void dap_stream_ch_chain_go_idle ( dap_stream_ch_chain_t * a_ch_chain)
     // Cleanup after request
     memset(&a_ch_chain->request, 0, sizeof(a_ch_chain->request));
     memset(&a_ch_chain->request_hdr, 0, sizeof(a_ch_chain->request_hdr));
-    if (a_ch_chain->request_atom_iter && a_ch_chain->request_atom_iter->chain &&
-            a_ch_chain->request_atom_iter->chain->callback_atom_iter_delete) {
-                a_ch_chain->request_atom_iter->chain->callback_atom_iter_delete(a_ch_chain->request_atom_iter);
-                a_ch_chain->request_atom_iter = NULL;
+    if (a_ch_chain->request_atom_iter) {
+        dap_chain_atom_iter_snapshot_delete(a_ch_chain->request_atom_iter);
+        a_ch_chain->request_atom_iter = NULL;
     }
     // free log list
     dap_db_log_list_delete(a_ch_chain->request_db_log);
@@ -1425,7 +1428,8 @@ void s_stream_ch_packet_out(dap_stream_ch_t* a_ch, void* a_arg)
 {
     UNUSED(a_arg);
 
-    if (a_ch->stream->esocket->buf_out_size >= a_ch->stream->esocket->buf_out_size_max / 2)
+    // Output buffer grows on demand, so wait for it to drain below the usual socket buffer size
+    if (a_ch->stream->esocket->buf_out_size >= DAP_EVENTS_SOCKET_BUF / 2)
         return;
     dap_stream_ch_chain_t *l_ch_chain = DAP_STREAM_CH_CHAIN(a_ch);
 
@@ -1545,7 +1549,7 @@ void s_stream_ch_packet_out(dap_stream_ch_t* a_ch, void* a_arg)
                 // Shift offset counter
                 l_data_size += sizeof (dap_stream_ch_chain_update_element_t);
                 // Then get next atom
-                l_ch_chain->request_atom_iter->chain->callback_atom_iter_get_next(l_ch_chain->request_atom_iter, NULL);
+                dap_chain_atom_iter_snapshot_get_next(l_ch_chain->request_atom_iter, NULL);
             }
             if (l_data_size){
                 if(s_debug_more)
@@ -1612,7 +1616,7 @@ void s_stream_ch_packet_out(dap_stream_ch_t* a_ch, void* a_arg)
                                          l_hash_item);
                 }
                 // Then get next atom and populate new last
-                l_ch_chain->request_atom_iter->chain->callback_atom_iter_get_next(l_ch_chain->request_atom_iter, NULL);
+                dap_chain_atom_iter_snapshot_get_next(l_ch_chain->request_atom_iter, NULL);
                 if (l_was_sent_smth)
                     break;
             }
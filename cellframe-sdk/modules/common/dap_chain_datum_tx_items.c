@@ -423,3 +423,96 @@ dap_chain_tx_out_cond_t *dap_chain_datum_tx_out_cond_get(dap_chain_datum_tx_t *a
     }
     return l_res;
 }
+
+/**
+ * Decode transaction items into typed arrays
+ *
+ * return view allocated as one block (free it with DAP_DELETE), NULL Error
+ */
+dap_chain_datum_tx_items_view_t *dap_chain_datum_tx_items_view_create(dap_chain_datum_tx_t *a_tx)
+{
+    if(!a_tx)
+        return NULL;
+    uint32_t l_tx_items_pos, l_tx_items_size = a_tx->header.tx_items_size;
+    int l_in_count = 0, l_in_cond_count = 0, l_out_count = 0;
+    // Count items to allocate arrays at once
+    for (l_tx_items_pos = 0; l_tx_items_pos < l_tx_items_size; ) {
+        uint8_t *l_item = a_tx->tx_items + l_tx_items_pos;
+        size_t l_item_size = dap_chain_datum_item_tx_get_size(l_item);
+        if(!l_item_size)
+            break;
+        switch (dap_chain_datum_tx_item_get_type(l_item)) {
+        case TX_ITEM_TYPE_IN: l_in_count++; break;
+        case TX_ITEM_TYPE_IN_COND: l_in_cond_count++; break;
+        case TX_ITEM_TYPE_OUT:
+        case TX_ITEM_TYPE_OUT_EXT:
+        case TX_ITEM_TYPE_OUT_COND: l_out_count++; break;
+        default: break;
+        }
+        l_tx_items_pos += l_item_size;
+    }
+    dap_chain_datum_tx_items_view_t *l_view = DAP_NEW_Z_SIZE(dap_chain_datum_tx_items_view_t,
+            sizeof(dap_chain_datum_tx_items_view_t) + (l_in_count + l_in_cond_count + l_out_count) * sizeof(void *));
+    if(!l_view)
+        return NULL;
+    l_view->in = (dap_chain_tx_in_t **)(l_view + 1);
+    l_view->in_cond = (dap_chain_tx_in_cond_t **)(l_view->in + l_in_count);
+    l_view->out = (uint8_t **)(l_view->in_cond + l_in_cond_count);
+    l_view->out_cond_idx = -1;
+    for (l_tx_items_pos = 0; l_tx_items_pos < l_tx_items_size; ) {
+        uint8_t *l_item = a_tx->tx_items + l_tx_items_pos;
+        size_t l_item_size = dap_chain_datum_item_tx_get_size(l_item);
+        if(!l_item_size)
+            break;
+        switch (dap_chain_datum_tx_item_get_type(l_item)) {
+        case TX_ITEM_TYPE_IN:
+            l_view->in[l_view->in_count++] = (dap_chain_tx_in_t *)l_item;
+            break;
+        case TX_ITEM_TYPE_IN_COND:
+            l_view->in_cond[l_view->in_cond_count++] = (dap_chain_tx_in_cond_t *)l_item;
+            break;
+        case TX_ITEM_TYPE_OUT_COND:
+            if (!l_view->out_cond) {
+                l_view->out_cond = (dap_chain_tx_out_cond_t *)l_item;
+                l_view->out_cond_idx = l_view->out_count;
+            }
+            // fall through
+        case TX_ITEM_TYPE_OUT:
+        case TX_ITEM_TYPE_OUT_EXT:
+            l_view->out[l_view->out_count++] = l_item;
+            break;
+        case TX_ITEM_TYPE_SIG:
+            if (!l_view->sig)
+                l_view->sig = (dap_chain_tx_sig_t *)l_item;
+            break;
+        case TX_ITEM_TYPE_TOKEN:
+            if (!l_view->token)
+                l_view->token = (dap_chain_tx_token_t *)l_item;
+            break;
+        default: break;
+        }
+        l_tx_items_pos += l_item_size;
+    }
+    return l_view;
+}
+
+#define TX_VIEW_REBASE(p, old, new) ((p) = (p) ? (void *)((byte_t *)(new) + ((const byte_t *)(p) - (const byte_t *)(old))) : NULL)
+
+/**
+ * Repoint view made for a_tx_old to the same items of its copy a_tx_new
+ */
+void dap_chain_datum_tx_items_view_rebase(dap_chain_datum_tx_items_view_t *a_view, const dap_chain_datum_tx_t *a_tx_old,
+                                          dap_chain_datum_tx_t *a_tx_new)
+{
+    if (!a_view || a_tx_old == a_tx_new)
+        return;
+    for (int i = 0; i < a_view->in_count; i++)
+        TX_VIEW_REBASE(a_view->in[i], a_tx_old, a_tx_new);
+    for (int i = 0; i < a_view->in_cond_count; i++)
+        TX_VIEW_REBASE(a_view->in_cond[i], a_tx_old, a_tx_new);
+    for (int i = 0; i < a_view->out_count; i++)
+        TX_VIEW_REBASE(a_view->out[i], a_tx_old, a_tx_new);
+    TX_VIEW_REBASE(a_view->out_cond, a_tx_old, a_tx_new);
+    TX_VIEW_REBASE(a_view->sig, a_tx_old, a_tx_new);
+    TX_VIEW_REBASE(a_view->token, a_tx_old, a_tx_new);
+}
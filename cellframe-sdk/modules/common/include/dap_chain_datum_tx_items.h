@@ -161,3 +161,27 @@ uint8_t* dap_chain_datum_tx_item_get( dap_chain_datum_tx_t *a_tx, int *a_item_id
 dap_list_t* dap_chain_datum_tx_items_get(dap_chain_datum_tx_t *a_tx, dap_chain_tx_item_type_t a_type, int *a_item_count);
 // Get conditional out item with it's idx
 dap_chain_tx_out_cond_t *dap_chain_datum_tx_out_cond_get(dap_chain_datum_tx_t *a_tx, int *a_out_num);
+
+// Transaction items grouped by type in one pass, pointers refer to the items inside the transaction
+typedef struct dap_chain_datum_tx_items_view {
+    dap_chain_tx_in_t **in;
+    int in_count;
+    dap_chain_tx_in_cond_t **in_cond;
+    int in_cond_count;
+    uint8_t **out;                      // OUT, OUT_EXT and OUT_COND items, array index is the 'out' index of tx
+    int out_count;
+    dap_chain_tx_out_cond_t *out_cond;  // first conditional out
+    int out_cond_idx;                   // its index in out array, -1 if no conditional outs
+    dap_chain_tx_sig_t *sig;            // first sign item
+    dap_chain_tx_token_t *token;        // first token item
+} dap_chain_datum_tx_items_view_t;
+
+/**
+ * Decode transaction items into typed arrays
+ *
+ * return view allocated as one block (free it with DAP_DELETE), NULL Error
+ */
+dap_chain_datum_tx_items_view_t *dap_chain_datum_tx_items_view_create(dap_chain_datum_tx_t *a_tx);
+// Repoint view made for a_tx_old to the same items of its copy a_tx_new
+void dap_chain_datum_tx_items_view_rebase(dap_chain_datum_tx_items_view_t *a_view, const dap_chain_datum_tx_t *a_tx_old,
+                                          dap_chain_datum_tx_t *a_tx_new);
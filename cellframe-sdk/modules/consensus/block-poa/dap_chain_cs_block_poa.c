@@ -47,6 +47,7 @@ typedef struct dap_chain_cs_dag_poa_pvt
 {
     dap_enc_key_t *sign_key;
     dap_cert_t ** auth_certs;
+    dap_cert_pkey_index_t * auth_certs_index; // Auth certs by their public keys hashes
     char * auth_certs_prefix;
     uint16_t auth_certs_count;
     uint16_t auth_certs_count_verify; // Number of signatures, needed for event verification
@@ -200,6 +201,7 @@ static int s_callback_new(dap_chain_t * a_chain, dap_config_t * a_chain_cfg)
                 }
                 log_it(L_NOTICE, "Initialized auth cert \"%s\"", l_cert_name);
             }
+            l_poa_pvt->auth_certs_index = dap_cert_pkey_index_new(l_poa_pvt->auth_certs, l_poa_pvt->auth_certs_count);
         }
     }
     log_it(L_NOTICE,"Initialized Block-PoA consensus with %u/%u minimum consensus",l_poa_pvt->auth_certs_count,l_poa_pvt->auth_certs_count_verify);
@@ -255,6 +257,8 @@ static void s_callback_delete(dap_chain_cs_blocks_t * a_blocks)
         if ( l_poa_pvt->auth_certs )
             DAP_DELETE ( l_poa_pvt->auth_certs);
 
+        dap_cert_pkey_index_delete(l_poa_pvt->auth_certs_index);
+
         if ( l_poa_pvt->auth_certs_prefix )
             DAP_DELETE( l_poa_pvt->auth_certs_prefix );
 
@@ -300,7 +304,6 @@ static size_t s_callback_block_sign(dap_chain_cs_blocks_t *a_blocks, dap_chain_b
 static int s_callback_block_verify(dap_chain_cs_blocks_t * a_blocks, dap_chain_block_t * a_block, size_t a_block_size)
 {
     dap_chain_cs_block_poa_pvt_t * l_poa_pvt = PVT ( DAP_CHAIN_CS_BLOCK_POA( a_blocks ) );
-    uint16_t l_signs_verified_count = 0;
 
     // Check for first signature
     dap_sign_t * l_sign = dap_chain_block_sign_get(a_block,a_block_size,0);
@@ -310,38 +313,47 @@ static int s_callback_block_verify(dap_chain_cs_blocks_t * a_blocks, dap_chain_b
     }
     // Parse the rest signs
     size_t l_offset = (byte_t *)l_sign - a_block->meta_n_datum_n_sign;
+    dap_sign_t **l_signs = NULL;
+    size_t l_signs_count = 0, l_signs_size = 0;
+    int l_ret = 0;
     while (l_offset < a_block_size - sizeof(a_block->hdr)) {
         if (!dap_sign_verify_size(l_sign, a_block_size)) {
             log_it(L_ERROR, "Corrupted block: sign size is bigger than block size");
-            return -3;
+            l_ret = -3;
+            break;
         }
         size_t l_sign_size = dap_sign_get_size(l_sign);
         // Check if sign size 0
         if (!l_sign_size){
             log_it(L_ERROR, "Corrupted block: sign size got zero");
-            return -4;
+            l_ret = -4;
+            break;
         }
         // Check if sign size too big
         if (l_sign_size > a_block_size- sizeof (a_block->hdr)-l_offset ){
             log_it(L_ERROR, "Corrupted block: sign size %zd is too big, out from block size %zd", l_sign_size, a_block_size);
-            return -5;
+            l_ret = -5;
+            break;
         }
-        // Compare signature with auth_certs
-        for (uint16_t j = 0; j < l_poa_pvt->auth_certs_count; j++) {
-            if (dap_cert_compare_with_sign ( l_poa_pvt->auth_certs[j], l_sign) == 0){
-                l_signs_verified_count++;
-                break;
-            }
+        if (l_signs_count == l_signs_size) {
+            l_signs_size = l_signs_size ? l_signs_size * 2 : 8;
+            l_signs = DAP_REALLOC(l_signs, l_signs_size * sizeof(dap_sign_t *));
         }
+        l_signs[l_signs_count++] = l_sign;
         //TODO verify sign itself
         l_offset += l_sign_size;
         l_sign = (dap_sign_t *)(a_block->meta_n_datum_n_sign + l_offset);
     }
-    if (l_offset != a_block_size - sizeof(a_block->hdr)) {
+    if (!l_ret && l_offset != a_block_size - sizeof(a_block->hdr)) {
         log_it(L_ERROR, "Corrupted block: sign end exceeded the block bound");
-        return -6;
+        l_ret = -6;
     }
-    return l_signs_verified_count >= l_poa_pvt->auth_certs_count_verify ? 0 : -1;
+    // Check if signatures are made with auth_certs, every cert counts once
+    if (!l_ret && dap_cert_pkey_index_count_signers(l_poa_pvt->auth_certs_index, l_signs, l_signs_count)
+            < l_poa_pvt->auth_certs_count_verify)
+        l_ret = -1;
+    DAP_DEL_Z(l_signs);
+    return l_ret;
 }
 
 dap_cert_t **dap_chain_cs_block_poa_get_auth_certs(dap_chain_t *a_chain, size_t *a_auth_certs_count)
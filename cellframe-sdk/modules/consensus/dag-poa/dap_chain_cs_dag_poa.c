@@ -57,6 +57,7 @@ typedef struct dap_chain_cs_dag_poa_pvt
 {
     dap_cert_t * events_sign_cert;
     dap_cert_t ** auth_certs;
+    dap_cert_pkey_index_t * auth_certs_index; // Auth certs by their public keys hashes
     char * auth_certs_prefix;
     uint16_t auth_certs_count;
     uint16_t auth_certs_count_verify; // Number of signatures, needed for event verification
@@ -325,6 +326,7 @@ static int s_callback_new(dap_chain_t * a_chain, dap_config_t * a_chain_cfg)
                 }
                 log_it(L_NOTICE, "Initialized auth cert \"%s\"", l_cert_name);
             }
+            l_poa_pvt->auth_certs_index = dap_cert_pkey_index_new(l_poa_pvt->auth_certs, l_poa_pvt->auth_certs_count);
         }
     }
     log_it(L_NOTICE,"Initialized DAG-PoA consensus with %u/%u minimum consensus",l_poa_pvt->auth_certs_count,l_poa_pvt->auth_certs_count_verify);
@@ -335,81 +337,35 @@ static int s_callback_new(dap_chain_t * a_chain, dap_config_t * a_chain_cfg)
 }
 
 
-typedef struct event_clean_dup_items {
-    uint16_t signs_count;
-    uint64_t ts_update;
-    char * hash_str;
-    UT_hash_handle hh;
-} event_clean_dup_items_t;
-
-static event_clean_dup_items_t *s_event_clean_dup_items = NULL;
-
 /**
  * @brief clean duplicated event in round confirmation stage
- * 
+ * @details Only events of the same round are checked, they are taken from DAG round state
  * @param a_dag dap_chain_cs_dag_t DAG object
  * @param a_event_hash_hex_str event hash string hash (f.e. "0xF5A8447F19EDF7B4662A9DD284E31669DACA4D973E2DF2A41BA96C735EC47C89")
  */
 static void s_round_event_clean_dup(dap_chain_cs_dag_t * a_dag, const char *a_event_hash_hex_str) {
     char * l_gdb_group_events = a_dag->gdb_group_events_round_new;
-    size_t l_event_size = 0;
-    dap_chain_cs_dag_event_t * l_event;
-    dap_chain_cs_dag_event_round_cfg_t l_event_round_cfg;
-    if ( (l_event = dap_chain_cs_dag_event_gdb_get( a_event_hash_hex_str, &l_event_size,
-                                                    l_gdb_group_events, &l_event_round_cfg )) == NULL  ) {
+    size_t l_events_count = 0;
+    dap_chain_cs_dag_round_event_info_t *l_events = dap_chain_cs_dag_round_events_get(a_dag, a_event_hash_hex_str, &l_events_count);
+    if (!l_events)
         return;
-    }
-
-    //char * l_event_first_hash_str = dap_chain_hash_fast_to_str_new(&l_event_round_cfg.first_event_hash);
-    size_t l_events_round_size = 0;
-    // dap_global_db_obj_t * l_events_round = dap_chain_global_db_gr_load(a_dag->gdb_group_events_round_new, &l_events_round_size );
-    dap_store_obj_t *l_events_round = dap_chain_global_db_driver_read(a_dag->gdb_group_events_round_new, NULL, &l_events_round_size);
     uint16_t l_max_signs_count = 0;
-    //char * l_max_signs_hash;
-    for (size_t l_index = 0; l_index<l_events_round_size; l_index++) {
-        // dap_chain_cs_dag_event_t * l_event = (dap_chain_cs_dag_event_t *)
-        //         ((dap_chain_cs_dag_event_round_item_t *)l_events_round[l_index].value)->event;
-        // size_t l_event_size = ((dap_chain_cs_dag_event_round_item_t *)l_events_round[l_index].value)->event_size;
-        dap_chain_cs_dag_event_round_item_t *l_event_round_item = (dap_chain_cs_dag_event_round_item_t *)l_events_round[l_index].value;
-        dap_chain_cs_dag_event_t * l_event = (dap_chain_cs_dag_event_t *)l_event_round_item->event;
-        if ( memcmp(&l_event_round_cfg.first_event_hash, 
-                        &l_event_round_item->cfg.first_event_hash, sizeof(dap_chain_hash_fast_t)) == 0 ) {
-            event_clean_dup_items_t * l_item = DAP_NEW_Z(event_clean_dup_items_t);
-            l_item->signs_count = l_event->header.signs_count;
-            // l_item->ts_update = l_events_round[l_index].timestamp;
-            l_item->ts_update = l_event_round_item->cfg.ts_update;
-            l_item->hash_str = l_events_round[l_index].key;
-            HASH_ADD_STR(s_event_clean_dup_items, hash_str, l_item);
-            if ( l_event->header.signs_count > l_max_signs_count ) {
-                l_max_signs_count = l_event->header.signs_count;
-            }
-        }
+    for (size_t i = 0; i < l_events_count; i++) {
+        if ( l_events[i].signs_count > l_max_signs_count )
+            l_max_signs_count = l_events[i].signs_count;
     }
-
-    uint64_t l_max_ts_update = 0;
-    char * l_max_ts_update_hash;
-    event_clean_dup_items_t *l_clean_item=NULL, *l_clean_tmp=NULL;
-    HASH_ITER(hh, s_event_clean_dup_items, l_clean_item, l_clean_tmp) {
-        if ( l_clean_item->signs_count < l_max_signs_count ) {
-            // delete dup by min signatures 
-            dap_chain_global_db_gr_del(dap_strdup(l_clean_item->hash_str), l_gdb_group_events);
-            HASH_DEL(s_event_clean_dup_items, l_clean_item);
-            DAP_DELETE(l_clean_item);
-        } else if ( l_clean_item->ts_update > l_max_ts_update ) {
-            l_max_ts_update = l_clean_item->ts_update;
-            l_max_ts_update_hash = l_clean_item->hash_str;
-        }
+    // Keep the last updated one from events with max signatures
+    size_t l_keep = l_events_count;
+    for (size_t i = 0; i < l_events_count; i++) {
+        if ( l_events[i].signs_count == l_max_signs_count
+                && (l_keep == l_events_count || l_events[i].ts_update > l_events[l_keep].ts_update) )
+            l_keep = i;
     }
-    HASH_ITER(hh, s_event_clean_dup_items, l_clean_item, l_clean_tmp) {
-        if ( dap_strcmp(l_max_ts_update_hash, l_clean_item->hash_str) != 0 ) {
-            // delete dup by older
-            dap_chain_global_db_gr_del(dap_strdup(l_clean_item->hash_str), l_gdb_group_events);
-        }
-        HASH_DEL(s_event_clean_dup_items, l_clean_item);
-        DAP_DELETE(l_clean_item);
+    for (size_t i = 0; i < l_events_count; i++) {
+        if ( i != l_keep ) // delete dup by min signatures or by older
+            dap_chain_global_db_gr_del(dap_strdup(l_events[i].key), l_gdb_group_events);
     }
-    //HASH_CLEAR(hh, s_event_clean_dup_items);
-    dap_store_obj_free(l_events_round, l_events_round_size);
+    DAP_DELETE(l_events);
 }
 
 /**
@@ -606,6 +562,8 @@ static void s_callback_delete(dap_chain_cs_dag_t * a_dag)
         if ( l_poa_pvt->auth_certs )
             DAP_DELETE ( l_poa_pvt->auth_certs);
 
+        dap_cert_pkey_index_delete(l_poa_pvt->auth_certs_index);
+
         if ( l_poa_pvt->auth_certs_prefix )
             free ( l_poa_pvt->auth_certs_prefix );
 
@@ -730,27 +688,36 @@ static int s_callback_event_verify(dap_chain_cs_dag_t * a_dag, dap_chain_cs_dag_
     // if ( a_dag_event->header.signs_count >= l_poa_pvt->auth_certs_count_verify ){
     if ( a_dag_event->header.signs_count >= l_certs_count_verify ){
 
-        size_t l_verified = 0;
+        dap_sign_t **l_signs = DAP_NEW_Z_SIZE(dap_sign_t *, a_dag_event->header.signs_count * sizeof(dap_sign_t *));
+        size_t l_signs_count = 0;
+        int l_ret = 0;
         for ( uint16_t i = 0; i < a_dag_event->header.signs_count; i++ ) {
             if (l_offset_from_beginning == a_dag_event_size)
                 break;
-            dap_sign_t * l_sign = dap_chain_cs_dag_event_get_sign(a_dag_event,a_dag_event_size , 0);
-            if ( l_sign == NULL){
+            if (l_offset_from_beginning + sizeof(dap_sign_t) > a_dag_event_size){
+                log_it(L_WARNING,"Incorrect size with event %p", a_dag_event);
+                l_ret = -7;
+                break;
+            }
+            dap_sign_t * l_sign = (dap_sign_t *)((byte_t *)a_dag_event + l_offset_from_beginning);
+            if ( l_sign->header.type.type == SIG_TYPE_NULL ){
                 log_it(L_WARNING, "Event is NOT signed with anything");
-                return -4;
+                l_ret = -4;
+                break;
             }
             l_offset_from_beginning += dap_sign_get_size( l_sign);
             if (l_offset_from_beginning > a_dag_event_size){
                 log_it(L_WARNING,"Incorrect size with event %p", a_dag_event);
-                return -7;
-            }
-            for (uint16_t j = 0; j < l_poa_pvt->auth_certs_count; j++) {
-                if (dap_cert_compare_with_sign ( l_poa_pvt->auth_certs[j], l_sign) == 0)
-                    l_verified++;
+                l_ret = -7;
+                break;
             }
+            l_signs[l_signs_count++] = l_sign;
         }
-        //return l_verified >= l_poa_pvt->auth_certs_count_verify ? 0 : -1;
-        return l_verified >= l_certs_count_verify ? 0 : -1;
+        // Every auth cert counts once, repeated signature doesn't make the quorum
+        if (!l_ret && dap_cert_pkey_index_count_signers(l_poa_pvt->auth_certs_index, l_signs, l_signs_count) < l_certs_count_verify)
+            l_ret = -1;
+        DAP_DELETE(l_signs);
+        return l_ret;
     }else if (a_dag_event->header.hash_count == 0){
         dap_chain_hash_fast_t l_event_hash;
         dap_chain_cs_dag_event_calc_hash(a_dag_event,a_dag_event_size, &l_event_hash);
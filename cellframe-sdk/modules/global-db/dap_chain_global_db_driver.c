@@ -76,7 +76,7 @@ static dap_db_driver_callbacks_t s_drv_callback;
  * @brief Initializes a database driver. 
  * @note You should Call this function before using the driver.
  * @param driver_name a string determining a type of database driver:
- * "сdb", "sqlite" ("sqlite3") or "pgsql"
+ * "сdb", "sqlite" ("sqlite3"), "mdbx" or "pgsql"
  * @param a_filename_db a path to a database file
  * @return Returns 0, if successful; otherwise <0.
  */
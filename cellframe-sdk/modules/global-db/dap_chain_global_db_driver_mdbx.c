@@ -23,9 +23,7 @@
 
 #include <stddef.h>
 #include <string.h>
-#include <dirent.h>
 #include <pthread.h>
-#include <sys/stat.h>
 #include <uthash.h>
 #define _GNU_SOURCE
 
@@ -38,11 +36,67 @@
 
 #ifdef DAP_CHAIN_GDB_ENGINE_MDBX
 
+#include "mdbx.h"
+
 #define LOG_TAG "dap_chain_global_db_mdbx"
 
-static char *s_cdb_path = NULL;
+/** Max number of named DBIs, each group takes two of them */
+#define DAP_MDBX_MAXDBS         4096
+/** Suffix of the per-group id -> key index DBI */
+#define DAP_MDBX_IDS_SUFFIX     "/ids"
+/** Upper limit of the memory map */
+#define DAP_MDBX_SIZE_UPPER     (64ULL << 30)
+/** Growth step of the data file */
+#define DAP_MDBX_SIZE_GROWTH    (16ULL << 20)
+
+/**
+ * Stored record layout:
+ * key -> key string with trailing zero
+ * val -> header followed by the value itself
+ */
+typedef struct dap_mdbx_record {
+    uint64_t id;
+    uint64_t timestamp;
+    uint64_t value_len;
+    uint8_t value[];
+} DAP_ALIGN_PACKED dap_mdbx_record_t;
+
+/** Struct for a group instance */
+typedef struct dap_mdbx_group {
+    char *name;
+    MDBX_dbi dbi;       // key -> record
+    MDBX_dbi dbi_ids;   // id -> key, ordered by id
+    UT_hash_handle hh;
+} dap_mdbx_group_t;
+
+/** Last id assigned in a group by a write transaction */
+typedef struct dap_mdbx_txn_id {
+    dap_mdbx_group_t *group;
+    uint64_t id;
+    UT_hash_handle hh;
+} dap_mdbx_txn_id_t;
+
+/** A path to the MDBX environment directory. */
+static char *s_mdbx_path = NULL;
+/** The MDBX environment. */
+static MDBX_env *s_mdbx_env = NULL;
+/** Opened groups. */
+static dap_mdbx_group_t *s_groups = NULL;
+/** A mutex serializing DBI opening. */
+static pthread_mutex_t s_groups_mutex = PTHREAD_MUTEX_INITIALIZER;
+/** A read-write lock for the groups hash table. */
+static pthread_rwlock_t s_groups_rwlock = PTHREAD_RWLOCK_INITIALIZER;
+/** Batch write transaction, owned by the thread that started it. */
+static __thread MDBX_txn *s_txn_batch = NULL;
+/** Groups opened by the write transaction of this thread, their DBIs are valid only after it's committed. */
+static __thread dap_mdbx_group_t *s_groups_pending = NULL;
+/** Last ids of groups changed by the write transaction of this thread, they are dropped when it ends. */
+static __thread dap_mdbx_txn_id_t *s_txn_ids = NULL;
+
 static int s_driver_callback_deinit();
 static int s_driver_callback_flush(void);
+static int s_driver_callback_txn_start(void);
+static int s_driver_callback_txn_end(void);
 static int s_driver_callback_apply_store_obj(pdap_store_obj_t a_store_obj);
 static dap_store_obj_t *s_driver_callback_read_last_store_obj(const char* a_group);
 static bool s_driver_callback_is_obj(const char *a_group, const char *a_key);
@@ -52,44 +106,259 @@ static size_t s_driver_callback_read_count_store(const char *a_group, uint64_t a
 static dap_list_t* s_driver_callback_get_groups_by_mask(const char *a_group_mask);
 
 /**
- * @brief dap_db_driver_mdbx_init
- * @param a_cdb_path
- * @param a_drv_callback
- * @return
+ * @brief Finds an opened group
+ * @param a_group a group name
+ * @return A pointer to the group instance or NULL if it isn't opened
  */
-int dap_db_driver_mdbx_init(const char *a_cdb_path, dap_db_driver_callbacks_t *a_drv_callback)
+static dap_mdbx_group_t *s_group_find(const char *a_group)
 {
-    s_cdb_path = dap_strdup(a_cdb_path);
-    if(s_cdb_path[strlen(s_cdb_path)] == '/') {
-        s_cdb_path[strlen(s_cdb_path)] = '\0';
+    dap_mdbx_group_t *l_group = NULL;
+    HASH_FIND_STR(s_groups_pending, a_group, l_group);
+    if (l_group)
+        return l_group;
+    pthread_rwlock_rdlock(&s_groups_rwlock);
+    HASH_FIND_STR(s_groups, a_group, l_group);
+    pthread_rwlock_unlock(&s_groups_rwlock);
+    return l_group;
+}
+
+/**
+ * @brief Opens both DBIs of a group and registers it
+ * @details Group opened in a write transaction stays pending until s_txn_write_end()
+ * @param a_txn transaction to open DBIs in, must be a write one if a_create is set
+ * @param a_group a group name
+ * @param a_create create DBIs if they are absent
+ * @return A pointer to the group instance, NULL if error
+ */
+static dap_mdbx_group_t *s_group_open(MDBX_txn *a_txn, const char *a_group, bool a_create)
+{
+    dap_mdbx_group_t *l_group = NULL;
+    pthread_mutex_lock(&s_groups_mutex);
+    HASH_FIND_STR(s_groups, a_group, l_group);
+    if (l_group)
+        goto FIN;
+    MDBX_dbi l_dbi, l_dbi_ids;
+    char *l_ids_name = dap_strdup_printf("%s"DAP_MDBX_IDS_SUFFIX, a_group);
+    MDBX_db_flags_t l_flags = a_create ? MDBX_CREATE : MDBX_DB_DEFAULTS;
+    int l_rc = mdbx_dbi_open(a_txn, a_group, l_flags, &l_dbi);
+    if (l_rc == MDBX_SUCCESS)
+        l_rc = mdbx_dbi_open(a_txn, l_ids_name, l_flags | MDBX_INTEGERKEY, &l_dbi_ids);
+    DAP_DELETE(l_ids_name);
+    if (l_rc != MDBX_SUCCESS) {
+        log_it(L_ERROR, "Can't open group \"%s\": \"%s\"", a_group, mdbx_strerror(l_rc));
+        goto FIN;
     }
-    dap_mkdir_with_parents(s_cdb_path);
-    struct dirent *d;
-    DIR *dir = opendir(s_cdb_path);
-    if (!dir) {
-        log_it(L_ERROR, "Couldn't open db directory");
-        return -1;
+    l_group = DAP_NEW_Z(dap_mdbx_group_t);
+    l_group->name = dap_strdup(a_group);
+    l_group->dbi = l_dbi;
+    l_group->dbi_ids = l_dbi_ids;
+    if (!(mdbx_txn_flags(a_txn) & MDBX_TXN_RDONLY))
+        HASH_ADD_KEYPTR(hh, s_groups_pending, l_group->name, strlen(l_group->name), l_group);
+    else {
+        pthread_rwlock_wrlock(&s_groups_rwlock);
+        HASH_ADD_KEYPTR(hh, s_groups, l_group->name, strlen(l_group->name), l_group);
+        pthread_rwlock_unlock(&s_groups_rwlock);
     }
-    for (d = readdir(dir); d; d = readdir(dir)) {
-#ifdef _DIRENT_HAVE_D_TYPE
-        if (d->d_type != DT_DIR)
-            continue;
-#else
-        struct _stat buf;
-        int res = _stat(d->d_name, &buf);
-        if (!S_ISDIR(buf.st_mode) || !res) {
-            continue;
+    if (a_create)
+        log_it(L_INFO, "Group \"%s\" opened", a_group);
+FIN:
+    pthread_mutex_unlock(&s_groups_mutex);
+    return l_group;
+}
+
+/**
+ * @brief Commits or aborts a write transaction and publishes or drops the groups it has opened
+ * @param a_txn the write transaction
+ * @param a_commit commit the transaction, abort it otherwise
+ * @return MDBX_SUCCESS if the transaction is committed or aborted, error code otherwise
+ */
+static int s_txn_write_end(MDBX_txn *a_txn, bool a_commit)
+{
+    int l_rc = a_commit ? mdbx_txn_commit(a_txn) : mdbx_txn_abort(a_txn);
+    bool l_publish = a_commit && l_rc == MDBX_SUCCESS;
+    dap_mdbx_txn_id_t *l_id, *l_id_tmp;
+    HASH_ITER(hh, s_txn_ids, l_id, l_id_tmp) {
+        HASH_DEL(s_txn_ids, l_id);
+        DAP_DELETE(l_id);
+    }
+    dap_mdbx_group_t *l_group, *l_tmp, *l_found;
+    pthread_mutex_lock(&s_groups_mutex);
+    pthread_rwlock_wrlock(&s_groups_rwlock);
+    HASH_ITER(hh, s_groups_pending, l_group, l_tmp) {
+        HASH_DEL(s_groups_pending, l_group);
+        l_found = NULL;
+        if (l_publish)
+            HASH_FIND_STR(s_groups, l_group->name, l_found);
+        if (l_publish && !l_found)
+            HASH_ADD_KEYPTR(hh, s_groups, l_group->name, strlen(l_group->name), l_group);
+        else {
+            // DBI handles are closed with the aborted transaction
+            DAP_DELETE(l_group->name);
+            DAP_DELETE(l_group);
         }
-#endif
-        if (!dap_strcmp(d->d_name, ".") || !dap_strcmp(d->d_name, "..")) {
+    }
+    pthread_rwlock_unlock(&s_groups_rwlock);
+    pthread_mutex_unlock(&s_groups_mutex);
+    return l_rc;
+}
+
+/**
+ * @brief Begins a read transaction, or joins the batch one of the current thread
+ * @param a_txn[out] the transaction
+ * @return true if the transaction is owned by the caller and must be aborted by it
+ */
+static bool s_txn_read_begin(MDBX_txn **a_txn)
+{
+    if (s_txn_batch) {
+        *a_txn = s_txn_batch;
+        return false;
+    }
+    int l_rc = mdbx_txn_begin(s_mdbx_env, NULL, MDBX_TXN_RDONLY, a_txn);
+    if (l_rc != MDBX_SUCCESS) {
+        log_it(L_ERROR, "Can't begin read transaction: \"%s\"", mdbx_strerror(l_rc));
+        *a_txn = NULL;
+    }
+    return true;
+}
+
+/**
+ * @brief Ends a transaction got from s_txn_read_begin()
+ * @param a_txn the transaction
+ * @param a_owned the value returned by s_txn_read_begin()
+ */
+static inline void s_txn_read_end(MDBX_txn *a_txn, bool a_owned)
+{
+    if (a_txn && a_owned)
+        mdbx_txn_abort(a_txn);
+}
+
+/**
+ * @brief Fills a view with a stored record
+ * @param a_view[out] the view
+ * @param a_key key value from DBI
+ * @param a_data record value from DBI
+ * @return true if the record is well-formed
+ */
+static bool s_record_to_view(dap_db_mdbx_obj_view_t *a_view, const MDBX_val *a_key, const MDBX_val *a_data)
+{
+    if (a_data->iov_len < sizeof(dap_mdbx_record_t))
+        return false;
+    const dap_mdbx_record_t *l_rec = (const dap_mdbx_record_t *)a_data->iov_base;
+    if (a_data->iov_len != sizeof(dap_mdbx_record_t) + l_rec->value_len)
+        return false;
+    a_view->id = l_rec->id;
+    a_view->timestamp = l_rec->timestamp;
+    a_view->key = (const char *)a_key->iov_base;
+    a_view->value = l_rec->value;
+    a_view->value_len = l_rec->value_len;
+    return true;
+}
+
+/**
+ * @brief Copies a view into a store object
+ * @param a_obj[out] the store object
+ * @param a_group a group name
+ * @param a_view the view
+ */
+static void s_view_to_store_obj(dap_store_obj_t *a_obj, const char *a_group, const dap_db_mdbx_obj_view_t *a_view)
+{
+    a_obj->id = a_view->id;
+    a_obj->timestamp = a_view->timestamp;
+    a_obj->group = dap_strdup(a_group);
+    a_obj->key = dap_strdup(a_view->key);
+    a_obj->value_len = a_view->value_len;
+    a_obj->value = a_view->value_len ? DAP_DUP_SIZE(a_view->value, a_view->value_len) : NULL;
+}
+
+/**
+ * @brief Walks a group in id order starting from a_id
+ * @param a_txn read transaction
+ * @param a_group the group instance
+ * @param a_id first id to visit
+ * @param a_callback called for every record
+ * @param a_arg callback argument
+ * @return Number of records visited
+ */
+static size_t s_group_iterate(MDBX_txn *a_txn, dap_mdbx_group_t *a_group, uint64_t a_id,
+                              dap_db_mdbx_view_callback_t a_callback, void *a_arg)
+{
+    size_t l_count = 0;
+    MDBX_cursor *l_cursor = NULL;
+    if (mdbx_cursor_open(a_txn, a_group->dbi_ids, &l_cursor) != MDBX_SUCCESS)
+        return 0;
+    MDBX_val l_id = { .iov_base = &a_id, .iov_len = sizeof(uint64_t) }, l_key, l_data;
+    int l_rc = mdbx_cursor_get(l_cursor, &l_id, &l_key, MDBX_SET_RANGE);
+    for ( ; l_rc == MDBX_SUCCESS; l_rc = mdbx_cursor_get(l_cursor, &l_id, &l_key, MDBX_NEXT)) {
+        dap_db_mdbx_obj_view_t l_view;
+        if (mdbx_get(a_txn, a_group->dbi, &l_key, &l_data) != MDBX_SUCCESS
+                || !s_record_to_view(&l_view, &l_key, &l_data)) {
+            log_it(L_WARNING, "Broken id index entry in group \"%s\"", a_group->name);
             continue;
         }
-        if (0) {
-            s_driver_callback_deinit();
-            closedir(dir);
-            return -2;
-        }
+        l_count++;
+        if (a_callback && !a_callback(&l_view, a_arg))
+            break;
+    }
+    mdbx_cursor_close(l_cursor);
+    return l_count;
+}
+
+/**
+ * @brief Initiates MDBX environment with callback fuctions.
+ * @param a_mdbx_path a path to MDBX environment directory. Saved in s_mdbx_path
+ * @param a_drv_callback a struct for callback functions
+ * @return 0 if success, <0 error.
+ */
+int dap_db_driver_mdbx_init(const char *a_mdbx_path, dap_db_driver_callbacks_t *a_drv_callback)
+{
+    s_mdbx_path = dap_strdup(a_mdbx_path);
+    size_t l_path_len = strlen(s_mdbx_path);
+    if (l_path_len && s_mdbx_path[l_path_len - 1] == '/')
+        s_mdbx_path[l_path_len - 1] = '\0';
+    dap_mkdir_with_parents(s_mdbx_path);
+
+    int l_rc = mdbx_env_create(&s_mdbx_env);
+    if (l_rc == MDBX_SUCCESS)
+        l_rc = mdbx_env_set_maxdbs(s_mdbx_env, DAP_MDBX_MAXDBS);
+    if (l_rc == MDBX_SUCCESS)
+        l_rc = mdbx_env_set_geometry(s_mdbx_env, -1, -1, DAP_MDBX_SIZE_UPPER, DAP_MDBX_SIZE_GROWTH, -1, -1);
+    if (l_rc == MDBX_SUCCESS)
+        l_rc = mdbx_env_open(s_mdbx_env, s_mdbx_path, MDBX_NOTLS | MDBX_SAFE_NOSYNC | MDBX_LIFORECLAIM, 0664);
+    if (l_rc != MDBX_SUCCESS) {
+        log_it(L_ERROR, "Can't open MDBX environment \"%s\": \"%s\"", s_mdbx_path, mdbx_strerror(l_rc));
+        s_driver_callback_deinit();
+        return -1;
+    }
+    // Open all existing groups, their names are the keys of the main DBI
+    MDBX_txn *l_txn = NULL;
+    MDBX_dbi l_dbi_main;
+    MDBX_cursor *l_cursor = NULL;
+    l_rc = mdbx_txn_begin(s_mdbx_env, NULL, MDBX_TXN_RDONLY, &l_txn);
+    if (l_rc == MDBX_SUCCESS)
+        l_rc = mdbx_dbi_open(l_txn, NULL, MDBX_DB_DEFAULTS, &l_dbi_main);
+    if (l_rc == MDBX_SUCCESS)
+        l_rc = mdbx_cursor_open(l_txn, l_dbi_main, &l_cursor);
+    if (l_rc != MDBX_SUCCESS) {
+        log_it(L_ERROR, "Can't read MDBX groups list: \"%s\"", mdbx_strerror(l_rc));
+        if (l_txn)
+            mdbx_txn_abort(l_txn);
+        s_driver_callback_deinit();
+        return -2;
     }
+    size_t l_suffix_len = strlen(DAP_MDBX_IDS_SUFFIX);
+    MDBX_val l_key, l_data;
+    while (mdbx_cursor_get(l_cursor, &l_key, &l_data, MDBX_NEXT) == MDBX_SUCCESS) {
+        char *l_name = DAP_NEW_Z_SIZE(char, l_key.iov_len + 1);
+        memcpy(l_name, l_key.iov_base, l_key.iov_len);
+        size_t l_name_len = strlen(l_name);
+        if (l_name_len <= l_suffix_len || strcmp(l_name + l_name_len - l_suffix_len, DAP_MDBX_IDS_SUFFIX))
+            s_group_open(l_txn, l_name, false);
+        DAP_DELETE(l_name);
+    }
+    mdbx_cursor_close(l_cursor);
+    // Commit to keep opened DBI handles
+    mdbx_txn_commit(l_txn);
+
     a_drv_callback->read_last_store_obj = s_driver_callback_read_last_store_obj;
     a_drv_callback->apply_store_obj     = s_driver_callback_apply_store_obj;
     a_drv_callback->read_store_obj      = s_driver_callback_read_store_obj;
@@ -97,104 +366,421 @@ int dap_db_driver_mdbx_init(const char *a_cdb_path, dap_db_driver_callbacks_t *a
     a_drv_callback->read_count_store    = s_driver_callback_read_count_store;
     a_drv_callback->get_groups_by_mask  = s_driver_callback_get_groups_by_mask;
     a_drv_callback->is_obj              = s_driver_callback_is_obj;
+    a_drv_callback->transaction_start   = s_driver_callback_txn_start;
+    a_drv_callback->transaction_end     = s_driver_callback_txn_end;
     a_drv_callback->deinit              = s_driver_callback_deinit;
     a_drv_callback->flush               = s_driver_callback_flush;
-
-    closedir(dir);
     return 0;
 }
 
 /**
- * @brief s_driver_callback_deinit
- * @return
+ * @brief Closes MDBX environment and frees the groups.
+ * @return 0
  */
 static int s_driver_callback_deinit()
 {
+    dap_mdbx_group_t *l_group, *l_tmp;
+    pthread_rwlock_wrlock(&s_groups_rwlock);
+    HASH_ITER(hh, s_groups, l_group, l_tmp) {
+        HASH_DEL(s_groups, l_group);
+        DAP_DELETE(l_group->name);
+        DAP_DELETE(l_group);
+    }
+    pthread_rwlock_unlock(&s_groups_rwlock);
+    if (s_mdbx_env) {
+        mdbx_env_close(s_mdbx_env);
+        s_mdbx_env = NULL;
+    }
+    DAP_DEL_Z(s_mdbx_path);
     return 0;
 }
 
 /**
- * @brief s_driver_callback_flush
- * @return
+ * @brief Flushes MDBX to the disk.
+ * @return 0 if success, <0 error.
  */
 static int s_driver_callback_flush(void)
 {
-    int ret = 0;
     log_it(L_DEBUG, "Flushing MDBX on the disk");
-    return ret;
+    int l_rc = mdbx_env_sync_ex(s_mdbx_env, true, false);
+    if (l_rc != MDBX_SUCCESS && l_rc != MDBX_RESULT_TRUE) {
+        log_it(L_ERROR, "Can't flush MDBX: \"%s\"", mdbx_strerror(l_rc));
+        return -1;
+    }
+    return 0;
 }
 
 /**
- * @brief s_driver_callback_read_last_store_obj
- * @param a_group
- * @return
+ * @brief Starts a batch write transaction for the current thread.
+ * @details All the following applies and reads of this thread go through it until s_driver_callback_txn_end()
+ * @return 0 if success, <0 error.
+ */
+static int s_driver_callback_txn_start(void)
+{
+    if (s_txn_batch) {
+        log_it(L_WARNING, "Batch transaction is already started");
+        return -1;
+    }
+    int l_rc = mdbx_txn_begin(s_mdbx_env, NULL, MDBX_TXN_READWRITE, &s_txn_batch);
+    if (l_rc != MDBX_SUCCESS) {
+        log_it(L_ERROR, "Can't begin batch transaction: \"%s\"", mdbx_strerror(l_rc));
+        s_txn_batch = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Commits the batch write transaction of the current thread.
+ * @return 0 if success, <0 error.
+ */
+static int s_driver_callback_txn_end(void)
+{
+    if (!s_txn_batch)
+        return -1;
+    int l_rc = s_txn_write_end(s_txn_batch, true);
+    s_txn_batch = NULL;
+    if (l_rc != MDBX_SUCCESS) {
+        log_it(L_ERROR, "Can't commit batch transaction: \"%s\"", mdbx_strerror(l_rc));
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Callback for collecting the last visited record
+ */
+static bool s_view_last_callback(const dap_db_mdbx_obj_view_t *a_view, void *a_arg)
+{
+    s_view_to_store_obj((dap_store_obj_t *)a_arg, ((dap_store_obj_t *)a_arg)->group, a_view);
+    return false;
+}
+
+/**
+ * @brief Read last store item from MDBX.
+ * @param a_group a group name
+ * @return If successful, a pointer to item, otherwise NULL.
  */
 static dap_store_obj_t *s_driver_callback_read_last_store_obj(const char* a_group)
 {
-    return NULL;
+    if (!a_group)
+        return NULL;
+    dap_mdbx_group_t *l_group = s_group_find(a_group);
+    if (!l_group)
+        return NULL;
+    MDBX_txn *l_txn;
+    bool l_owned = s_txn_read_begin(&l_txn);
+    if (!l_txn)
+        return NULL;
+    dap_store_obj_t *l_obj = NULL;
+    MDBX_cursor *l_cursor = NULL;
+    MDBX_val l_id, l_key;
+    if (mdbx_cursor_open(l_txn, l_group->dbi_ids, &l_cursor) == MDBX_SUCCESS) {
+        if (mdbx_cursor_get(l_cursor, &l_id, &l_key, MDBX_LAST) == MDBX_SUCCESS) {
+            dap_store_obj_t l_tmp = { .group = (char *)a_group };
+            if (s_group_iterate(l_txn, l_group, *(uint64_t *)l_id.iov_base, s_view_last_callback, &l_tmp))
+                l_obj = DAP_DUP(&l_tmp);
+        }
+        mdbx_cursor_close(l_cursor);
+    }
+    s_txn_read_end(l_txn, l_owned);
+    return l_obj;
 }
 
 /**
- * @brief s_driver_callback_is_obj
- * @param a_group
- * @param a_key
- * @return
+ * @brief Checks if MDBX has a_key
+ * @param a_group the group name
+ * @param a_key the key
+ * @return true or false
  */
 static bool s_driver_callback_is_obj(const char *a_group, const char *a_key)
 {
-    return false;
+    if (!a_group || !a_key)
+        return false;
+    dap_mdbx_group_t *l_group = s_group_find(a_group);
+    if (!l_group)
+        return false;
+    MDBX_txn *l_txn;
+    bool l_owned = s_txn_read_begin(&l_txn);
+    if (!l_txn)
+        return false;
+    MDBX_val l_key = { .iov_base = (void *)a_key, .iov_len = strlen(a_key) + 1 }, l_data;
+    bool l_ret = mdbx_get(l_txn, l_group->dbi, &l_key, &l_data) == MDBX_SUCCESS;
+    s_txn_read_end(l_txn, l_owned);
+    return l_ret;
 }
 
+/** Argument of the collecting callback */
+typedef struct dap_mdbx_collect_arg {
+    const char *group;
+    dap_store_obj_t *objs;
+    size_t count;
+    size_t count_max;
+} dap_mdbx_collect_arg_t;
+
 /**
- * @brief s_driver_callback_read_store_obj
- * @param a_group
- * @param a_key
- * @param a_count_out
- * @return
+ * @brief Callback for copying visited records into store objects
+ */
+static bool s_view_collect_callback(const dap_db_mdbx_obj_view_t *a_view, void *a_arg)
+{
+    dap_mdbx_collect_arg_t *l_arg = (dap_mdbx_collect_arg_t *)a_arg;
+    s_view_to_store_obj(l_arg->objs + l_arg->count++, l_arg->group, a_view);
+    return l_arg->count < l_arg->count_max;
+}
+
+/**
+ * @brief Gets records of a group in id order
+ * @param a_group the group name
+ * @param a_id first id
+ * @param a_count_out[in] a count of items to read, 0 means no limit
+ * @param a_count_out[out] a count of items were got
+ * @return If successful, pointer to items, otherwise NULL.
+ */
+static dap_store_obj_t *s_read_from_id(const char *a_group, uint64_t a_id, size_t *a_count_out)
+{
+    dap_mdbx_group_t *l_group = s_group_find(a_group);
+    if (!l_group)
+        return NULL;
+    MDBX_txn *l_txn;
+    bool l_owned = s_txn_read_begin(&l_txn);
+    if (!l_txn)
+        return NULL;
+    MDBX_stat l_stat;
+    if (mdbx_dbi_stat(l_txn, l_group->dbi_ids, &l_stat, sizeof(l_stat)) != MDBX_SUCCESS || !l_stat.ms_entries) {
+        s_txn_read_end(l_txn, l_owned);
+        if (a_count_out)
+            *a_count_out = 0;
+        return NULL;
+    }
+    size_t l_count_max = a_count_out ? *a_count_out : 0;
+    if (!l_count_max || l_count_max > l_stat.ms_entries)
+        l_count_max = l_stat.ms_entries;
+    dap_mdbx_collect_arg_t l_arg = {
+        .group = a_group,
+        .objs = DAP_NEW_Z_SIZE(dap_store_obj_t, l_count_max * sizeof(dap_store_obj_t)),
+        .count_max = l_count_max
+    };
+    s_group_iterate(l_txn, l_group, a_id, s_view_collect_callback, &l_arg);
+    s_txn_read_end(l_txn, l_owned);
+    if (!l_arg.count)
+        DAP_DEL_Z(l_arg.objs);
+    if (a_count_out)
+        *a_count_out = l_arg.count;
+    return l_arg.objs;
+}
+
+/**
+ * @brief Gets items from MDBX by a_group and a_key. If a_key=NULL then gets a_count_out items.
+ * @param a_group the group name
+ * @param a_key the key or NULL
+ * @param a_count_out IN. Count of read items. OUT Count of items was read
+ * @return If successful, pointer to items; otherwise NULL.
  */
 static dap_store_obj_t *s_driver_callback_read_store_obj(const char *a_group, const char *a_key, size_t *a_count_out)
 {
-    return NULL;
+    if (!a_group)
+        return NULL;
+    if (!a_key)
+        return s_read_from_id(a_group, 0, a_count_out);
+    dap_mdbx_group_t *l_group = s_group_find(a_group);
+    if (!l_group)
+        return NULL;
+    MDBX_txn *l_txn;
+    bool l_owned = s_txn_read_begin(&l_txn);
+    if (!l_txn)
+        return NULL;
+    dap_store_obj_t *l_obj = NULL;
+    dap_db_mdbx_obj_view_t l_view;
+    MDBX_val l_key = { .iov_base = (void *)a_key, .iov_len = strlen(a_key) + 1 }, l_data;
+    if (mdbx_get(l_txn, l_group->dbi, &l_key, &l_data) == MDBX_SUCCESS
+            && s_record_to_view(&l_view, &l_key, &l_data)) {
+        l_obj = DAP_NEW_Z(dap_store_obj_t);
+        s_view_to_store_obj(l_obj, a_group, &l_view);
+        if (a_count_out)
+            *a_count_out = 1;
+    }
+    s_txn_read_end(l_txn, l_owned);
+    return l_obj;
 }
 
 /**
- * @brief s_driver_callback_read_cond_store_obj
- * @param a_group
- * @param a_id
- * @param a_count_out
- * @return
+ * @brief Gets items from MDBX by a_group and a_id.
+ * @param a_group the group name
+ * @param a_id id
+ * @param a_count_out[in] a count of items
+ * @param a_count[out] a count of items were got
+ * @return If successful, pointer to items, otherwise NULL.
  */
 static dap_store_obj_t* s_driver_callback_read_cond_store_obj(const char *a_group, uint64_t a_id, size_t *a_count_out)
 {
-    return NULL;
+    if (!a_group)
+        return NULL;
+    return s_read_from_id(a_group, a_id, a_count_out);
 }
 
 /**
- * @brief s_driver_callback_read_count_store
- * @param a_group
- * @param a_id
- * @return
+ * @brief Reads count of items in MDBX by a_group and a_id.
+ * @param a_group the group name
+ * @param a_id id
+ * @return If successful, count of store items; otherwise 0.
  */
 static size_t s_driver_callback_read_count_store(const char *a_group, uint64_t a_id)
 {
-    return 0;
+    if (!a_group)
+        return 0;
+    dap_mdbx_group_t *l_group = s_group_find(a_group);
+    if (!l_group)
+        return 0;
+    MDBX_txn *l_txn;
+    bool l_owned = s_txn_read_begin(&l_txn);
+    if (!l_txn)
+        return 0;
+    size_t l_count = 0;
+    if (a_id <= 1) {
+        MDBX_stat l_stat;
+        if (mdbx_dbi_stat(l_txn, l_group->dbi_ids, &l_stat, sizeof(l_stat)) == MDBX_SUCCESS)
+            l_count = l_stat.ms_entries;
+    } else {
+        // Walk the id index only, records aren't touched
+        MDBX_cursor *l_cursor = NULL;
+        if (mdbx_cursor_open(l_txn, l_group->dbi_ids, &l_cursor) == MDBX_SUCCESS) {
+            MDBX_val l_id = { .iov_base = &a_id, .iov_len = sizeof(uint64_t) }, l_key;
+            int l_rc = mdbx_cursor_get(l_cursor, &l_id, &l_key, MDBX_SET_RANGE);
+            for ( ; l_rc == MDBX_SUCCESS; l_rc = mdbx_cursor_get(l_cursor, &l_id, &l_key, MDBX_NEXT))
+                l_count++;
+            mdbx_cursor_close(l_cursor);
+        }
+    }
+    s_txn_read_end(l_txn, l_owned);
+    return l_count;
 }
 
 /**
  * @brief s_driver_callback_get_groups_by_mask
  * @details Check whether the groups match the pattern a_group_mask, which is a shell wildcard pattern
  * @param a_group_mask
- * @return
+ * @return If successful, pointer to dap_list with group names; otherwise NULL.
  */
 static dap_list_t* s_driver_callback_get_groups_by_mask(const char *a_group_mask)
 {
-    return NULL;
+    dap_list_t *l_ret_list = NULL;
+    if (!a_group_mask)
+        return NULL;
+    dap_mdbx_group_t *l_group, *l_tmp;
+    pthread_rwlock_rdlock(&s_groups_rwlock);
+    HASH_ITER(hh, s_groups, l_group, l_tmp) {
+        if (!dap_fnmatch(a_group_mask, l_group->name, 0))
+            l_ret_list = dap_list_prepend(l_ret_list, dap_strdup(l_group->name));
+    }
+    pthread_rwlock_unlock(&s_groups_rwlock);
+    return l_ret_list;
+}
+
+/**
+ * @brief Gets the last id assigned in a group as the write transaction sees it
+ * @details It's read from the ids DBI on the first use in the transaction and isn't kept after it,
+ * so ids assigned by an aborted transaction are forgotten with it
+ * @param a_txn the write transaction
+ * @param a_group the group
+ * @return A pointer to the last id of the group in this transaction
+ */
+static dap_mdbx_txn_id_t *s_txn_id_get(MDBX_txn *a_txn, dap_mdbx_group_t *a_group)
+{
+    dap_mdbx_txn_id_t *l_id = NULL;
+    HASH_FIND_PTR(s_txn_ids, &a_group, l_id);
+    if (l_id)
+        return l_id;
+    l_id = DAP_NEW_Z(dap_mdbx_txn_id_t);
+    l_id->group = a_group;
+    MDBX_cursor *l_cursor = NULL;
+    MDBX_val l_key, l_data;
+    if (mdbx_cursor_open(a_txn, a_group->dbi_ids, &l_cursor) == MDBX_SUCCESS) {
+        if (mdbx_cursor_get(l_cursor, &l_key, &l_data, MDBX_LAST) == MDBX_SUCCESS)
+            l_id->id = *(uint64_t *)l_key.iov_base;
+        mdbx_cursor_close(l_cursor);
+    }
+    HASH_ADD_PTR(s_txn_ids, group, l_id);
+    return l_id;
 }
 
 /**
- * @brief s_driver_callback_apply_store_obj
- * @param a_store_obj
- * @return
+ * @brief Applies one object inside a write transaction
+ * @param a_txn the write transaction
+ * @param a_store_obj a pointer to the item
+ * @return 0 if success, 1 if item to delete is missing, <0 error.
+ */
+static int s_apply_store_obj(MDBX_txn *a_txn, pdap_store_obj_t a_store_obj)
+{
+    dap_mdbx_group_t *l_group = s_group_find(a_store_obj->group);
+    if (!l_group)
+        l_group = s_group_open(a_txn, a_store_obj->group, a_store_obj->type == 'a');
+    if (!l_group)
+        return a_store_obj->type == 'd' ? 1 : -1;
+    MDBX_val l_key = { .iov_base = a_store_obj->key, .iov_len = a_store_obj->key ? strlen(a_store_obj->key) + 1 : 0 };
+    MDBX_val l_data;
+    int l_rc = MDBX_SUCCESS;
+    if (a_store_obj->type == 'a') {
+        if (!a_store_obj->key)
+            return -2;
+        // Drop id index entry of the overwritten record
+        if (mdbx_get(a_txn, l_group->dbi, &l_key, &l_data) == MDBX_SUCCESS && l_data.iov_len >= sizeof(dap_mdbx_record_t)) {
+            uint64_t l_id_old = ((dap_mdbx_record_t *)l_data.iov_base)->id;
+            MDBX_val l_id = { .iov_base = &l_id_old, .iov_len = sizeof(uint64_t) };
+            mdbx_del(a_txn, l_group->dbi_ids, &l_id, NULL);
+        }
+        dap_mdbx_txn_id_t *l_last_id = s_txn_id_get(a_txn, l_group);
+        uint64_t l_id_new = l_last_id->id + 1;
+        l_data.iov_len = sizeof(dap_mdbx_record_t) + a_store_obj->value_len;
+        // Reserve the record in place and fill it without intermediate buffer
+        l_rc = mdbx_put(a_txn, l_group->dbi, &l_key, &l_data, MDBX_UPSERT | MDBX_RESERVE);
+        if (l_rc == MDBX_SUCCESS) {
+            dap_mdbx_record_t *l_rec = (dap_mdbx_record_t *)l_data.iov_base;
+            l_rec->id = l_id_new;
+            l_rec->timestamp = a_store_obj->timestamp;
+            l_rec->value_len = a_store_obj->value_len;
+            if (a_store_obj->value_len)
+                memcpy(l_rec->value, a_store_obj->value, a_store_obj->value_len);
+            MDBX_val l_id = { .iov_base = &l_id_new, .iov_len = sizeof(uint64_t) };
+            l_rc = mdbx_put(a_txn, l_group->dbi_ids, &l_id, &l_key, MDBX_APPEND);
+        }
+        if (l_rc != MDBX_SUCCESS) {
+            log_it(L_ERROR, "Couldn't add record with key [%s] to MDBX: \"%s\"", a_store_obj->key, mdbx_strerror(l_rc));
+            return -1;
+        }
+        l_last_id->id = l_id_new;
+    } else if (a_store_obj->type == 'd') {
+        if (a_store_obj->key) {
+            l_rc = mdbx_get(a_txn, l_group->dbi, &l_key, &l_data);
+            if (l_rc == MDBX_NOTFOUND)
+                return 1;
+            if (l_rc == MDBX_SUCCESS && l_data.iov_len >= sizeof(dap_mdbx_record_t)) {
+                uint64_t l_id_old = ((dap_mdbx_record_t *)l_data.iov_base)->id;
+                MDBX_val l_id = { .iov_base = &l_id_old, .iov_len = sizeof(uint64_t) };
+                mdbx_del(a_txn, l_group->dbi_ids, &l_id, NULL);
+            }
+            l_rc = mdbx_del(a_txn, l_group->dbi, &l_key, NULL);
+        } else {
+            // Truncate the group, ids start from the beginning
+            l_rc = mdbx_drop(a_txn, l_group->dbi, false);
+            if (l_rc == MDBX_SUCCESS)
+                l_rc = mdbx_drop(a_txn, l_group->dbi_ids, false);
+            if (l_rc == MDBX_SUCCESS) {
+                s_txn_id_get(a_txn, l_group)->id = 0;
+                log_it(L_INFO, "Group \"%s\" truncated", l_group->name);
+            }
+        }
+        if (l_rc != MDBX_SUCCESS) {
+            log_it(L_ERROR, "Couldn't delete from group \"%s\": \"%s\"", l_group->name, mdbx_strerror(l_rc));
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Adds or deletes item in MDBX depending on a_store_obj->type.
+ * @param a_store_obj a pointer to the item
+ * @return 0 if success, 1 if item to delete is missing, <0 error.
  */
 static int s_driver_callback_apply_store_obj(pdap_store_obj_t a_store_obj)
 {
@@ -202,7 +788,81 @@ static int s_driver_callback_apply_store_obj(pdap_store_obj_t a_store_obj)
         return -1;
     }
     int ret = 0;
+    MDBX_txn *l_txn = s_txn_batch;
+    if (!l_txn) {
+        int l_rc = mdbx_txn_begin(s_mdbx_env, NULL, MDBX_TXN_READWRITE, &l_txn);
+        if (l_rc != MDBX_SUCCESS) {
+            log_it(L_ERROR, "Can't begin write transaction: \"%s\"", mdbx_strerror(l_rc));
+            ret = -1;
+            goto FIN;
+        }
+    }
+    ret = s_apply_store_obj(l_txn, a_store_obj);
+    if (l_txn != s_txn_batch) {
+        if (ret < 0)
+            s_txn_write_end(l_txn, false);
+        else if (s_txn_write_end(l_txn, true) != MDBX_SUCCESS)
+            ret = -1;
+    }
+FIN:
+    DAP_DEL_Z(a_store_obj->key);
+    DAP_DEL_Z(a_store_obj->value);
     return ret;
 }
 
+/**
+ * @brief Iterates a group in id order without copying records
+ * @param a_group the group name
+ * @param a_id_from first id to visit
+ * @param a_callback called for every record with a view valid only inside the call
+ * @param a_arg callback argument
+ * @return Number of records visited
+ */
+size_t dap_db_driver_mdbx_iterate(const char *a_group, uint64_t a_id_from, dap_db_mdbx_view_callback_t a_callback, void *a_arg)
+{
+    if (!a_group || !a_callback)
+        return 0;
+    dap_mdbx_group_t *l_group = s_group_find(a_group);
+    if (!l_group)
+        return 0;
+    MDBX_txn *l_txn;
+    bool l_owned = s_txn_read_begin(&l_txn);
+    if (!l_txn)
+        return 0;
+    size_t l_count = s_group_iterate(l_txn, l_group, a_id_from, a_callback, a_arg);
+    s_txn_read_end(l_txn, l_owned);
+    return l_count;
+}
+
+/**
+ * @brief Gets one record by key without copying it
+ * @param a_group the group name
+ * @param a_key the key
+ * @param a_callback called with a view valid only inside the call
+ * @param a_arg callback argument
+ * @return 0 if found, 1 if not found, <0 error
+ */
+int dap_db_driver_mdbx_get_view(const char *a_group, const char *a_key, dap_db_mdbx_view_callback_t a_callback, void *a_arg)
+{
+    if (!a_group || !a_key || !a_callback)
+        return -1;
+    dap_mdbx_group_t *l_group = s_group_find(a_group);
+    if (!l_group)
+        return 1;
+    MDBX_txn *l_txn;
+    bool l_owned = s_txn_read_begin(&l_txn);
+    if (!l_txn)
+        return -2;
+    int l_ret = 1;
+    dap_db_mdbx_obj_view_t l_view;
+    MDBX_val l_key = { .iov_base = (void *)a_key, .iov_len = strlen(a_key) + 1 }, l_data;
+    if (mdbx_get(l_txn, l_group->dbi, &l_key, &l_data) == MDBX_SUCCESS
+            && s_record_to_view(&l_view, &l_key, &l_data)) {
+        a_callback(&l_view, a_arg);
+        l_ret = 0;
+    }
+    s_txn_read_end(l_txn, l_owned);
+    return l_ret;
+}
+
 #endif
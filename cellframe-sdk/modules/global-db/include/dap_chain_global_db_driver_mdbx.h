@@ -21,6 +21,30 @@
  along with any DAP based project.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#pragma once
+
 #include "dap_chain_global_db_driver.h"
 
+/**
+ * @brief Zero-copy view of a stored object.
+ * @details key and value point straight into the MDBX memory map and are valid
+ * only inside the callback that received the view, while its read transaction is alive.
+ */
+typedef struct dap_db_mdbx_obj_view {
+    uint64_t id;
+    uint64_t timestamp;
+    const char *key;
+    const uint8_t *value;
+    uint64_t value_len;
+} dap_db_mdbx_obj_view_t;
+
+/**
+ * @brief Callback for zero-copy reads
+ * @return true to continue iteration, false to stop
+ */
+typedef bool (*dap_db_mdbx_view_callback_t)(const dap_db_mdbx_obj_view_t *a_view, void *a_arg);
+
 int dap_db_driver_mdbx_init(const char*, dap_db_driver_callbacks_t*);
+
+size_t dap_db_driver_mdbx_iterate(const char *a_group, uint64_t a_id_from, dap_db_mdbx_view_callback_t a_callback, void *a_arg);
+int dap_db_driver_mdbx_get_view(const char *a_group, const char *a_key, dap_db_mdbx_view_callback_t a_callback, void *a_arg);
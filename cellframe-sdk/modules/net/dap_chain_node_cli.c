@@ -1095,20 +1095,23 @@ int dap_chain_node_cli_init(dap_config_t * g_config)
 
     // Transaction history
     dap_chain_node_cli_cmd_item_create("tx_history", com_tx_history, "Transaction history (for address or by hash)",
-            "tx_history  [-addr <addr> | -w <wallet name> | -tx <tx_hash>] -net <net name> -chain <chain name>\n");
+            "tx_history  [-addr <addr> | -w <wallet name>] -net <net name> [-page_start <page>] [-page_size <size>] [-page <pages>]\n"
+            "tx_history  -tx <tx_hash> -net <net name> -chain <chain name>\n");
 
     // Ledger info
     dap_chain_node_cli_cmd_item_create("ledger", com_ledger, "Ledger info",
             "ledger list coins -net <network name>\n"
             "ledger list coins_cond -net <network name>\n"
             "ledger list addrs -net <network name>\n"
-            "ledger tx [all | -addr <addr> | -w <wallet name> | -tx <tx_hash>] [-chain <chain name>] -net <network name>\n");
+            "ledger tx [all | -addr <addr> | -w <wallet name> | -tx <tx_hash>] [-chain <chain name>] -net <network name>"
+                " [-page_start <page>] [-page_size <size>] [-page <pages>]\n"
+            "ledger threshold -net <network name>\n");
 
     // Token info
     dap_chain_node_cli_cmd_item_create("token", com_token, "Token info",
             "token list -net <network name>\n"
             "token info -net <network name> -name <token name>\n"
-            "token tx [all | -addr <wallet_addr> | -wallet <wallet_name>] -name <token name> -net <network name> [-page_start <page>] [-page <page>]\n");
+            "token tx [all | -addr <wallet_addr> | -wallet <wallet_name>] -name <token name> -net <network name> [-page_start <page>] [-page_size <size>] [-page <pages>]\n");
 
     // Log
     dap_chain_node_cli_cmd_item_create ("print_log", com_print_log, "Print log info",
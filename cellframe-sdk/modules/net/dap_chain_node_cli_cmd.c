@@ -4112,10 +4112,12 @@ int com_tx_history(int a_argc, char ** a_argv, char **a_str_reply)
             return -3;
         }
     }
-    //Select chain emission
+    // Chain is needed only to look for tx by hash, address history is taken from ledger index
     if(!l_chain_str) {
-        dap_chain_node_cli_set_reply_text(a_str_reply, "tx_history requires parameter '-chain'");
-        return -4;
+        if(l_tx_hash_str) {
+            dap_chain_node_cli_set_reply_text(a_str_reply, "tx_history requires parameter '-chain' with '-tx'");
+            return -4;
+        }
     } else {
         if((l_chain = dap_chain_net_get_chain_by_name(l_net, l_chain_str)) == NULL) { // Can't find such chain
             dap_chain_node_cli_set_reply_text(a_str_reply,
@@ -4160,9 +4162,15 @@ int com_tx_history(int a_argc, char ** a_argv, char **a_str_reply)
         }
     }
 
-    char *l_str_out = l_tx_hash_str ?
-                                      dap_db_history_tx(&l_tx_hash, l_chain, l_hash_out_type) :
-                                      dap_db_history_addr(l_addr, l_chain, l_hash_out_type);
+    char *l_str_out = NULL;
+    if (l_tx_hash_str)
+        l_str_out = dap_db_history_tx(&l_tx_hash, l_chain, l_hash_out_type);
+    else {
+        // address history is taken from ledger index
+        size_t l_offset, l_count;
+        dap_db_history_page_parse(a_argv, arg_index, a_argc, &l_offset, &l_count);
+        l_str_out = dap_db_history_addr_page(l_net->pub.ledger, l_addr, l_hash_out_type, l_offset, l_count);
+    }
 
     char *l_str_ret = NULL;
     if(l_tx_hash_str) {
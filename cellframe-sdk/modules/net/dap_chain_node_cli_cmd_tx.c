@@ -764,6 +764,141 @@ char* dap_db_history_addr(dap_chain_addr_t * a_addr, dap_chain_t * a_chain, cons
     return l_ret_str;
 }
 
+/**
+ * @brief s_history_items_print
+ * Print history items of ledger index grouped by transaction
+ * @param a_str_out
+ * @param a_items
+ * @param a_items_count
+ * @param a_hash_out_type
+ */
+static void s_history_items_print(dap_string_t *a_str_out, dap_chain_ledger_history_item_t *a_items, size_t a_items_count,
+                                  const char *a_hash_out_type)
+{
+    static const dap_chain_addr_t l_addr_blank = {};
+    for (size_t i = 0; i < a_items_count; i++) {
+        dap_chain_ledger_history_item_t *l_item = a_items + i;
+        if (!i || l_item->seq_num != a_items[i - 1].seq_num) {
+            char *l_tx_hash_str = dap_strcmp(a_hash_out_type, "hex")
+                    ? dap_enc_base58_encode_hash_to_str(&l_item->tx_hash)
+                    : dap_chain_hash_fast_to_str_new(&l_item->tx_hash);
+            char l_time_str[70] = " \n";
+            if (l_item->ts_created > 0)
+                dap_ctime_r(&l_item->ts_created, l_time_str);
+            dap_string_append_printf(a_str_out, "TX hash %s\n\t%s", l_tx_hash_str, l_time_str);
+            DAP_DELETE(l_tx_hash_str);
+        }
+        bool l_emission = !memcmp(&l_item->addr_from, &l_addr_blank, sizeof(dap_chain_addr_t));
+        char *l_addr_from_str = l_emission ? NULL : dap_chain_addr_to_str(&l_item->addr_from);
+        char *l_addr_to_str = dap_chain_addr_to_str(&l_item->addr_to);
+        switch (l_item->direction) {
+        case DAP_CHAIN_LEDGER_HISTORY_SEND:
+            dap_string_append_printf(a_str_out, "\tsend %"DAP_UINT64_FORMAT_U" %s to %s\n",
+                                     l_item->value, l_item->token_ticker, l_addr_to_str);
+            break;
+        case DAP_CHAIN_LEDGER_HISTORY_RECV:
+            dap_string_append_printf(a_str_out, "\trecv %"DAP_UINT64_FORMAT_U" %s from %s\n",
+                                     l_item->value, l_item->token_ticker, l_emission ? "emission" : l_addr_from_str);
+            break;
+        default:
+            dap_string_append_printf(a_str_out, "\ttransfer %"DAP_UINT64_FORMAT_U" %s from %s to %s\n",
+                                     l_item->value, l_item->token_ticker, l_emission ? "emission" : l_addr_from_str,
+                                     l_addr_to_str);
+            break;
+        }
+        DAP_DELETE(l_addr_from_str);
+        DAP_DELETE(l_addr_to_str);
+    }
+}
+
+/**
+ * @brief s_history_page_print
+ * Print a page of history items got from ledger index
+ * @param a_items history items, they are freed
+ * @param a_items_count
+ * @param a_total total number of history items
+ * @param a_offset number of oldest history items skipped
+ * @param a_hash_out_type
+ * @return char*
+ */
+static char* s_history_page_print(dap_chain_ledger_history_item_t *a_items, size_t a_items_count, size_t a_total,
+                                  size_t a_offset, const char *a_hash_out_type)
+{
+    dap_string_t *l_str_out = dap_string_new(NULL);
+    s_history_items_print(l_str_out, a_items, a_items_count, a_hash_out_type);
+    DAP_DELETE(a_items);
+    if (!a_items_count)
+        dap_string_append(l_str_out, "\tempty\n");
+    dap_string_append_printf(l_str_out, "---------------\nitems %zu-%zu of %zu", a_items_count ? a_offset + 1 : 0,
+                             a_offset + a_items_count, a_total);
+    return dap_string_free(l_str_out, false);
+}
+
+/**
+ * @brief dap_db_history_addr_page
+ * Get a page of address history from ledger index, without chain scanning
+ * @param a_ledger
+ * @param a_addr
+ * @param a_hash_out_type
+ * @param a_offset number of oldest history items to skip
+ * @param a_count max number of history items, 0 - up to the end
+ * @return char*
+ */
+char* dap_db_history_addr_page(dap_ledger_t *a_ledger, dap_chain_addr_t *a_addr, const char *a_hash_out_type,
+                               size_t a_offset, size_t a_count)
+{
+    dap_chain_ledger_history_item_t *l_items = NULL;
+    size_t l_items_count = 0;
+    size_t l_total = dap_chain_ledger_history_addr(a_ledger, a_addr, a_offset, a_count, &l_items, &l_items_count);
+    return s_history_page_print(l_items, l_items_count, l_total, a_offset, a_hash_out_type);
+}
+
+/**
+ * @brief s_history_token_page
+ * Get a page of token transfers history from ledger index
+ * @param a_ledger
+ * @param a_token_ticker
+ * @param a_hash_out_type
+ * @param a_offset number of oldest history items to skip
+ * @param a_count max number of history items, 0 - up to the end
+ * @return char*
+ */
+static char* s_history_token_page(dap_ledger_t *a_ledger, const char *a_token_ticker, const char *a_hash_out_type,
+                                  size_t a_offset, size_t a_count)
+{
+    dap_chain_ledger_history_item_t *l_items = NULL;
+    size_t l_items_count = 0;
+    size_t l_total = dap_chain_ledger_history_token(a_ledger, a_token_ticker, a_offset, a_count, &l_items, &l_items_count);
+    return s_history_page_print(l_items, l_items_count, l_total, a_offset, a_hash_out_type);
+}
+
+/**
+ * @brief dap_db_history_page_parse
+ * Parse -page_start, -page_size and -page options: -page pages of -page_size items starting from -page_start page.
+ * Without -page_start the whole history is requested
+ * @param a_argv
+ * @param a_arg_index
+ * @param a_argc
+ * @param a_offset[out] number of oldest history items to skip
+ * @param a_count[out] max number of history items, 0 - up to the end
+ */
+void dap_db_history_page_parse(char **a_argv, int a_arg_index, int a_argc, size_t *a_offset, size_t *a_count)
+{
+    const char *l_page_start_str = NULL, *l_page_size_str = NULL, *l_page_str = NULL;
+    dap_chain_node_cli_find_option_val(a_argv, a_arg_index, a_argc, "-page_start", &l_page_start_str);
+    dap_chain_node_cli_find_option_val(a_argv, a_arg_index, a_argc, "-page_size", &l_page_size_str);
+    dap_chain_node_cli_find_option_val(a_argv, a_arg_index, a_argc, "-page", &l_page_str);
+    long l_page_start = l_page_start_str ? strtol(l_page_start_str, NULL, 10) : -1;
+    long l_page_size = l_page_size_str ? strtol(l_page_size_str, NULL, 10) : 10;
+    long l_page = l_page_str ? strtol(l_page_str, NULL, 10) : 2;
+    if (l_page_size < 1)
+        l_page_size = 1;
+    if (l_page < 1)
+        l_page = 1;
+    *a_offset = l_page_start < 0 ? 0 : (size_t)(l_page_start * l_page_size);
+    *a_count = l_page_start < 0 ? 0 : (size_t)(l_page * l_page_size);
+}
+
 /**
  * @brief char* dap_db_history_token_list
  * 
@@ -1113,7 +1248,7 @@ static char* dap_db_history_filter(dap_chain_t * a_chain, dap_ledger_t *a_ledger
  */
 int com_ledger(int a_argc, char ** a_argv, char **a_str_reply)
 {
-    enum { CMD_NONE, CMD_LIST, CMD_TX_HISTORY, CMD_TX_INFO };
+    enum { CMD_NONE, CMD_LIST, CMD_TX_HISTORY, CMD_TX_INFO, CMD_THRESHOLD };
     int arg_index = 1;
     const char *l_addr_base58 = NULL;
     const char *l_wallet_name = NULL;
@@ -1140,6 +1275,8 @@ int com_ledger(int a_argc, char ** a_argv, char **a_str_reply)
         l_cmd = CMD_TX_HISTORY;
         if (dap_chain_node_cli_find_option_val(a_argv, 2, 3, "info", NULL))
             l_cmd = CMD_TX_INFO;
+    } else if (dap_chain_node_cli_find_option_val(a_argv, 1, 2, "threshold", NULL)){
+        l_cmd = CMD_THRESHOLD;
     }
     // command tx_history
     if(l_cmd == CMD_TX_HISTORY) {
@@ -1216,6 +1353,18 @@ int com_ledger(int a_argc, char ** a_argv, char **a_str_reply)
                 return -1;
             }
         }
+        // address history is taken from ledger index of the whole net
+        if(l_addr && !l_tx_hash_str && !l_is_all) {
+            size_t l_offset, l_count;
+            dap_db_history_page_parse(a_argv, arg_index, a_argc, &l_offset, &l_count);
+            char *l_str_out = dap_db_history_addr_page(l_net->pub.ledger, l_addr, l_hash_out_type, l_offset, l_count);
+            char *l_addr_str = dap_chain_addr_to_str(l_addr);
+            dap_chain_node_cli_set_reply_text(a_str_reply, "history for addr %s:\n%s\n", l_addr_str, l_str_out);
+            DAP_DELETE(l_addr_str);
+            DAP_DELETE(l_str_out);
+            DAP_DELETE(l_addr);
+            return 0;
+        }
 
         dap_string_t *l_str_ret = dap_string_new(NULL); //char *l_str_ret = NULL;
         dap_chain_t *l_chain_cur;
@@ -1242,21 +1391,10 @@ int com_ledger(int a_argc, char ** a_argv, char **a_str_reply)
                     l_str_out = dap_db_history_filter(l_chain_cur, l_ledger, NULL, NULL, l_hash_out_type, -1, 0, NULL, l_list_tx_hash_processd);
                     dap_string_append_printf(l_str_ret, "all history:\n%s\n", l_str_out ? l_str_out : " empty");
                 }
-                else {
-                    l_str_out = l_tx_hash_str ?
-                                                dap_db_history_tx(&l_tx_hash, l_chain_cur, l_hash_out_type) :
-                                                dap_db_history_addr(l_addr, l_chain_cur, l_hash_out_type);
-
-                    if(l_tx_hash_str) {
-                        dap_string_append_printf(l_str_ret, "history for tx hash %s:\n%s\n", l_tx_hash_str,
-                                l_str_out ? l_str_out : " empty");
-                    }
-                    else if(l_addr) {
-                        char *l_addr_str = dap_chain_addr_to_str(l_addr);
-                        dap_string_append_printf(l_str_ret, "history for addr %s:\n%s\n", l_addr_str,
-                                l_str_out ? l_str_out : " empty");
-                        DAP_DELETE(l_addr_str);
-                    }
+                else if(l_tx_hash_str) {
+                    l_str_out = dap_db_history_tx(&l_tx_hash, l_chain_cur, l_hash_out_type);
+                    dap_string_append_printf(l_str_ret, "history for tx hash %s:\n%s\n", l_tx_hash_str,
+                            l_str_out ? l_str_out : " empty");
                 }
                 DAP_DELETE(l_str_out);
                 l_num++;
@@ -1305,6 +1443,31 @@ int com_ledger(int a_argc, char ** a_argv, char **a_str_reply)
         dap_chain_node_cli_set_reply_text(a_str_reply, l_str_ret->str);
         dap_string_free(l_str_ret, true);
         return 0;
+    } else if (l_cmd == CMD_THRESHOLD){
+        dap_chain_node_cli_find_option_val(a_argv, 2, a_argc, "-net", &l_net_str);
+        if (l_net_str == NULL){
+            dap_chain_node_cli_set_reply_text(a_str_reply, "Command 'threshold' requires key -net");
+            return -1;
+        }
+        dap_ledger_t *l_ledger = dap_chain_ledger_by_net_name(l_net_str);
+        if (l_ledger == NULL){
+            dap_chain_node_cli_set_reply_text(a_str_reply, "Can't get ledger for net %s", l_net_str);
+            return -2;
+        }
+        dap_chain_ledger_treshold_info_t l_info;
+        dap_chain_ledger_treshold_info(l_ledger, &l_info);
+        dap_chain_node_cli_set_reply_text(a_str_reply,
+                "Threshold of %s ledger\n"
+                "transactions: %zu of %zu (max %zu), %zu bytes\n"
+                "\tadded %"DAP_UINT64_FORMAT_U", resolved %"DAP_UINT64_FORMAT_U", dropped %"DAP_UINT64_FORMAT_U", evicted %"DAP_UINT64_FORMAT_U"\n"
+                "emissions: %zu of %zu (max %zu), %zu bytes\n"
+                "\tadded %"DAP_UINT64_FORMAT_U", resolved %"DAP_UINT64_FORMAT_U", evicted %"DAP_UINT64_FORMAT_U"\n",
+                l_net_str,
+                l_info.txs_count, l_info.txs_limit, l_info.txs_count_max, l_info.txs_size,
+                l_info.txs_added, l_info.txs_resolved, l_info.txs_dropped, l_info.txs_evicted,
+                l_info.emissions_count, l_info.emissions_limit, l_info.emissions_count_max, l_info.emissions_size,
+                l_info.emissions_added, l_info.emissions_resolved, l_info.emissions_evicted);
+        return 0;
     } else if (l_cmd == CMD_TX_INFO){
         //GET hash
         dap_chain_node_cli_find_option_val(a_argv, arg_index, a_argc, "-hash", &l_tx_hash_str);
@@ -1346,7 +1509,7 @@ int com_ledger(int a_argc, char ** a_argv, char **a_str_reply)
         dap_string_free(l_str, true);
     }
     else{
-        dap_chain_node_cli_set_reply_text(a_str_reply, "Command 'ledger' requires parameter 'list' or 'tx' or 'info'");
+        dap_chain_node_cli_set_reply_text(a_str_reply, "Command 'ledger' requires parameter 'list' or 'tx' or 'info' or 'threshold'");
         return -1;
     }
     return 0;
@@ -1368,7 +1531,6 @@ int com_token(int a_argc, char ** a_argv, char **a_str_reply)
     int arg_index = 1;
     const char *l_net_str = NULL;
     dap_chain_net_t * l_net = NULL;
-    dap_chain_tx_hash_processed_ht_t *l_list_tx_hash_processd = NULL;
 
     const char * l_hash_out_type = NULL;
     dap_chain_node_cli_find_option_val(a_argv, arg_index, a_argc, "-H", &l_hash_out_type);
@@ -1479,63 +1641,19 @@ int com_token(int a_argc, char ** a_argv, char **a_str_reply)
             l_subcmd = SUBCMD_TX_ADDR;
 
         const char *l_token_name_str = NULL;
-        const char *l_page_start_str = NULL;
-        const char *l_page_size_str = NULL;
-        const char *l_page_str = NULL;
         dap_chain_node_cli_find_option_val(a_argv, arg_index, a_argc, "-name", &l_token_name_str);
-        dap_chain_node_cli_find_option_val(a_argv, arg_index, a_argc, "-page_start", &l_page_start_str);
-        dap_chain_node_cli_find_option_val(a_argv, arg_index, a_argc, "-page_size", &l_page_size_str);
-        dap_chain_node_cli_find_option_val(a_argv, arg_index, a_argc, "-page", &l_page_str);
         if(!l_token_name_str) {
             dap_chain_node_cli_set_reply_text(a_str_reply, "command requires parameter '-name' <token name>");
             return -4;
         }
-        long l_page_start = -1;// not used if =-1
-        long l_page_size = 10;
-        long l_page = 2;
-        long l_cur_datum = 0;
-        if(l_page_start_str)
-            l_page_start = strtol(l_page_start_str, NULL, 10);
-        if(l_page_size_str) {
-            l_page_size = strtol(l_page_size_str, NULL, 10);
-            if(l_page_size < 1)
-                l_page_size = 1;
-        }
-        if(l_page_str) {
-            l_page = strtol(l_page_str, NULL, 10);
-            if(l_page < 1)
-                l_page = 1;
-        }
-
+        size_t l_offset, l_count;
+        dap_db_history_page_parse(a_argv, arg_index, a_argc, &l_offset, &l_count);
 
          // tx all
         if(l_subcmd == SUBCMD_TX_ALL) {
-            dap_string_t *l_str_out = dap_string_new(NULL);
-            // get first chain
-            void *l_chain_tmp = (void*) 0x1;
-            dap_chain_t *l_chain_cur = dap_chain_enum(&l_chain_tmp);
-            while(l_chain_cur) {
-                // only selected net
-                if(l_net->pub.id.uint64 == l_chain_cur->net_id.uint64) {
-                    long l_chain_datum = l_cur_datum;
-                    dap_ledger_t *l_ledger = dap_chain_ledger_by_net_name(l_net_str);
-                    char *l_datum_list_str = dap_db_history_filter(l_chain_cur, l_ledger, l_token_name_str, NULL,
-                            l_hash_out_type, l_page_start * l_page_size, (l_page_start+l_page)*l_page_size, &l_chain_datum, l_list_tx_hash_processd);
-                    if(l_datum_list_str) {
-                        l_cur_datum += l_chain_datum;
-                        dap_string_append_printf(l_str_out, "Chain: %s\n", l_chain_cur->name);
-                        dap_string_append_printf(l_str_out, "%s\n\n", l_datum_list_str);
-                        DAP_DELETE(l_datum_list_str);
-                    }
-                }
-                // next chain
-                dap_chain_enum_unlock();
-                l_chain_cur = dap_chain_enum(&l_chain_tmp);
-            }
-            dap_chain_enum_unlock();
-            _dap_chain_tx_hash_processed_ht_free(l_list_tx_hash_processd);
-            dap_chain_node_cli_set_reply_text(a_str_reply, l_str_out->str);
-            dap_string_free(l_str_out, true);
+            char *l_str_out = s_history_token_page(l_net->pub.ledger, l_token_name_str, l_hash_out_type, l_offset, l_count);
+            dap_chain_node_cli_set_reply_text(a_str_reply, "Token %s transfers:\n%s\n", l_token_name_str, l_str_out);
+            DAP_DELETE(l_str_out);
             return 0;
         }
         // tx -addr or tx -wallet
@@ -1568,29 +1686,9 @@ int com_token(int a_argc, char ** a_argv, char **a_str_reply)
                 return -3;
             }
 
-            dap_string_t *l_str_out = dap_string_new(NULL);
-            // get first chain
-            void *l_chain_tmp = (void*) 0x1;
-            dap_chain_t *l_chain_cur = dap_chain_enum(&l_chain_tmp);
-            while(l_chain_cur) {
-                // only selected net
-                if(l_net->pub.id.uint64 == l_chain_cur->net_id.uint64) {
-                    long l_chain_datum = l_cur_datum;
-                    char *l_datum_list_str = dap_db_history_addr(l_addr_base58, l_chain_cur, l_hash_out_type);
-                    if(l_datum_list_str) {
-                        l_cur_datum += l_chain_datum;
-                        dap_string_append_printf(l_str_out, "Chain: %s\n", l_chain_cur->name);
-                        dap_string_append_printf(l_str_out, "%s\n\n", l_datum_list_str);
-                        DAP_DELETE(l_datum_list_str);
-                    }
-                }
-                // next chain
-                dap_chain_enum_unlock();
-                l_chain_cur = dap_chain_enum(&l_chain_tmp);
-            }
-            dap_chain_enum_unlock();
-            dap_chain_node_cli_set_reply_text(a_str_reply, l_str_out->str);
-            dap_string_free(l_str_out, true);
+            char *l_str_out = dap_db_history_addr_page(l_net->pub.ledger, l_addr_base58, l_hash_out_type, l_offset, l_count);
+            dap_chain_node_cli_set_reply_text(a_str_reply, "%s\n", l_str_out);
+            DAP_DELETE(l_str_out);
             DAP_DELETE(l_addr_base58);
             return 0;
 
@@ -24,6 +24,7 @@
 
 #include "dap_chain.h"
 #include "dap_chain_common.h"
+#include "dap_chain_ledger.h"
 
 /**
  *
@@ -31,6 +32,9 @@
  */
 char* dap_db_history_tx(dap_chain_hash_fast_t* a_tx_hash, dap_chain_t * a_chain, const char *a_hash_out_type);
 char* dap_db_history_addr(dap_chain_addr_t * a_addr, dap_chain_t * a_chain, const char *a_hash_out_type);
+char* dap_db_history_addr_page(dap_ledger_t *a_ledger, dap_chain_addr_t *a_addr, const char *a_hash_out_type,
+                               size_t a_offset, size_t a_count);
+void dap_db_history_page_parse(char **a_argv, int a_arg_index, int a_argc, size_t *a_offset, size_t *a_count);
 
 /**
  * ledger command
@@ -154,6 +154,17 @@ dap_chain_datum_tx_t* dap_chain_block_cache_get_tx_by_hash (dap_chain_block_cach
  */
 void dap_chain_block_cache_delete(dap_chain_block_cache_t * a_block_cache)
 {
+    // Parsed data points into the block, block itself isn't owned by cache
+    dap_chain_block_cache_tx_index_t *l_tx_index = NULL, *l_tmp = NULL;
+    HASH_ITER(hh, a_block_cache->tx_index, l_tx_index, l_tmp) {
+        HASH_DEL(a_block_cache->tx_index, l_tx_index);
+        DAP_DELETE(l_tx_index);
+    }
+    DAP_DEL_Z(a_block_cache->datum);
+    DAP_DEL_Z(a_block_cache->meta);
+    DAP_DEL_Z(a_block_cache->links_hash);
+    DAP_DEL_Z(a_block_cache->sign);
+    DAP_DEL_Z(a_block_cache->block_hash_str);
     DAP_DELETE(a_block_cache);
     log_it(L_DEBUG,"Block cache deleted");
 }
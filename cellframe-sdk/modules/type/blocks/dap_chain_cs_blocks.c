@@ -33,6 +33,7 @@
 #include "dap_chain_block_cache.h"
 #include "dap_chain_block_chunk.h"
 #include "dap_timerfd.h"
+#include "utlist.h"
 #include "dap_chain_node_cli.h"
 #include "dap_chain_node_cli_cmd.h"
 #define LOG_TAG "dap_chain_cs_blocks"
@@ -45,24 +46,50 @@ typedef struct dap_chain_tx_block_index
     UT_hash_handle hh;
 } dap_chain_tx_block_index_t;
 
+/**
+ * @brief Always resident record of the main chain block
+ * @details Parsed block cache is kept only for the recently used blocks, the rest
+ * are parsed again from the cell file position when needed
+ */
+typedef struct dap_chain_block_index_item
+{
+    dap_chain_hash_fast_t block_hash;
+    uint64_t height;
+    size_t block_size;
+    dap_chain_block_t * block; // Block as it was added, used until its position in the cell file is known, NULL then
+    dap_chain_cell_id_t cell_id;
+    dap_chain_cell_atom_pos_t pos;
+    bool is_stored; // Block is found in the cell file, cell_id and pos are valid
+    dap_chain_block_cache_t * cache; // Parsed block or NULL if it was pushed out
+    unsigned int pins; // Parsed block is in use by dap_chain_block_cs_cache_get_by_hash() callers and can't be pushed out
+    struct dap_chain_block_index_item * prev; // LRU list of the items with parsed cache
+    struct dap_chain_block_index_item * next;
+    UT_hash_handle hh;
+} dap_chain_block_index_item_t;
+
 typedef struct dap_chain_cs_blocks_pvt
 {
     pthread_rwlock_t rwlock;
     // Parent link
     dap_chain_cs_blocks_t * cs_blocks;
 
-    // All the blocks are here. In feature should be limited with 1000 when the rest would be loaded from file when needs them
-    dap_chain_block_cache_t * blocks;
+    // All the main chain blocks are here, parsed caches are limited with cache_blocks_max
+    dap_chain_block_index_item_t * blocks;
+    dap_chain_block_index_item_t ** blocks_by_height;
+    uint64_t blocks_by_height_size;
     dap_chain_block_cache_t * blocks_tx_treshold;
 
+    // Parsed block caches, the most recently used first
+    pthread_mutex_t cache_mutex;
+    dap_chain_block_index_item_t * cache_lru;
+    size_t cache_count;
+    size_t cache_blocks_max;
+
     // Chunks treshold
     dap_chain_block_chunks_t * chunks;
 
     dap_chain_tx_block_index_t * tx_block_index; // To find block hash by tx hash
 
-    // General links
-    dap_chain_block_cache_t * block_cache_first; // Mapped area start
-    dap_chain_block_cache_t * block_cache_last; // Last block in mapped area
     dap_chain_hash_fast_t genesis_block_hash;
 
     uint64_t blocks_count;
@@ -81,7 +108,7 @@ typedef struct dap_chain_cs_blocks_pvt
 typedef struct dap_chain_cs_blocks_iter
 {
     dap_chain_cs_blocks_t * blocks;
-    dap_chain_block_cache_t * cache;
+    dap_chain_block_index_item_t * item;
 } dap_chain_cs_blocks_iter_t;
 
 #define PVT(a) ((dap_chain_cs_blocks_pvt_t *)(a)->_pvt )
@@ -131,6 +158,8 @@ static size_t s_callback_add_datums(dap_chain_t * a_chain, dap_chain_datum_t **
 
 static bool s_seed_mode=false;
 
+#define DAP_CHAIN_CS_BLOCKS_CACHE_MIN 16
+
 
 /**
  * @brief dap_chain_cs_blocks_init
@@ -217,6 +246,10 @@ int dap_chain_cs_blocks_new(dap_chain_t * a_chain, dap_config_t * a_chain_config
     l_cs_blocks->_pvt = l_cs_blocks_pvt;
     pthread_rwlock_init(&l_cs_blocks_pvt->rwlock,NULL);
     pthread_rwlock_init(&l_cs_blocks_pvt->datums_lock, NULL);
+    pthread_mutex_init(&l_cs_blocks_pvt->cache_mutex, NULL);
+    l_cs_blocks_pvt->cache_blocks_max = dap_config_get_item_uint32_default(a_chain_config, "blocks", "cache_blocks_max", 1000);
+    if (l_cs_blocks_pvt->cache_blocks_max < DAP_CHAIN_CS_BLOCKS_CACHE_MIN)
+        l_cs_blocks_pvt->cache_blocks_max = DAP_CHAIN_CS_BLOCKS_CACHE_MIN;
 
     const char * l_genesis_blocks_hash_str = dap_config_get_item_str_default(a_chain_config,"blocks","genesis_block",NULL);
     if ( l_genesis_blocks_hash_str ){
@@ -244,8 +277,275 @@ void dap_chain_cs_blocks_delete(dap_chain_t * a_chain)
     s_callback_delete(a_chain);
 }
 
+/**
+ * @brief s_block_index_find
+ * @details Call it under rwlock
+ * @param a_blocks
+ * @param a_block_hash
+ * @return
+ */
+static dap_chain_block_index_item_t *s_block_index_find(dap_chain_cs_blocks_t *a_blocks, dap_chain_hash_fast_t *a_block_hash)
+{
+    dap_chain_block_index_item_t *l_item = NULL;
+    HASH_FIND(hh, PVT(a_blocks)->blocks, a_block_hash, sizeof(*a_block_hash), l_item);
+    return l_item;
+}
+
+/**
+ * @brief s_block_index_last
+ * @details Call it under rwlock
+ * @param a_blocks
+ * @return Top of the main chain or NULL if it's empty
+ */
+static inline dap_chain_block_index_item_t *s_block_index_last(dap_chain_cs_blocks_t *a_blocks)
+{
+    dap_chain_cs_blocks_pvt_t *l_pvt = PVT(a_blocks);
+    return l_pvt->blocks_count ? l_pvt->blocks_by_height[l_pvt->blocks_count - 1] : NULL;
+}
+
+/**
+ * @brief s_block_index_locate
+ * @details Looks for the block position in the cell files. Call it under cache_mutex
+ * @param a_blocks
+ * @param a_item
+ * @return true if block is stored in the cell file
+ */
+static bool s_block_index_locate(dap_chain_cs_blocks_t *a_blocks, dap_chain_block_index_item_t *a_item)
+{
+    if (a_item->is_stored)
+        return true;
+    dap_chain_t *l_chain = a_blocks->chain;
+    // Block usually is saved to its own cell, look through the rest if not
+    dap_chain_cell_t *l_cell = dap_chain_cell_find_by_id(l_chain, a_item->block->hdr.cell_id);
+    if (!l_cell || dap_chain_cell_atom_pos_by_hash(l_cell, &a_item->block_hash, &a_item->pos)) {
+        pthread_rwlock_rdlock(&l_chain->cell_rwlock);
+        for (l_cell = l_chain->cells; l_cell; l_cell = l_cell->hh.next)
+            if (!dap_chain_cell_atom_pos_by_hash(l_cell, &a_item->block_hash, &a_item->pos))
+                break;
+        pthread_rwlock_unlock(&l_chain->cell_rwlock);
+    }
+    if (!l_cell || a_item->pos.size != a_item->block_size)
+        return false;
+    a_item->cell_id = l_cell->id;
+    a_item->is_stored = true;
+    return true;
+}
+
+/**
+ * @brief s_block_index_get_stored
+ * @details Call it under cache_mutex
+ * @param a_blocks
+ * @param a_item
+ * @return Block from the cell file or NULL if it isn't known to be stored there
+ */
+static dap_chain_block_t *s_block_index_get_stored(dap_chain_cs_blocks_t *a_blocks, dap_chain_block_index_item_t *a_item)
+{
+    if (!a_item->is_stored)
+        return NULL;
+    dap_chain_cell_t *l_cell = dap_chain_cell_find_by_id(a_blocks->chain, a_item->cell_id);
+    return l_cell ? (dap_chain_block_t *)dap_chain_cell_atom_get(l_cell, &a_item->pos) : NULL;
+}
+
+/**
+ * @brief s_block_index_get_block
+ * @details Call it under cache_mutex
+ * @param a_blocks
+ * @param a_item
+ * @return Block from the cell file if it's already stored there, or the block which was added
+ */
+static dap_chain_block_t *s_block_index_get_block(dap_chain_cs_blocks_t *a_blocks, dap_chain_block_index_item_t *a_item)
+{
+    dap_chain_block_t *l_block = s_block_index_get_stored(a_blocks, a_item);
+    return l_block ? l_block : a_item->block;
+}
+
+/**
+ * @brief s_block_index_drop_block
+ * @details Frees the block copy which was added if the item is read from the cell file now. Call it under cache_mutex
+ * @param a_blocks
+ * @param a_item
+ */
+static void s_block_index_drop_block(dap_chain_cs_blocks_t *a_blocks, dap_chain_block_index_item_t *a_item)
+{
+    if (!a_item->block)
+        return;
+    dap_chain_block_t *l_block = s_block_index_get_stored(a_blocks, a_item);
+    if (!l_block)
+        return;
+    // Blocks loaded from the cell file are its mapped data, the ones added after are owned by chain
+    if (l_block != a_item->block)
+        DAP_DELETE(a_item->block);
+    a_item->block = NULL;
+}
+
+/**
+ * @brief s_block_cache_trim
+ * @details Drops the least recently used parsed blocks over the limit. Blocks that are not found
+ * in the cell files yet and pinned ones are kept. Call it under cache_mutex
+ * @param a_blocks
+ */
+static void s_block_cache_trim(dap_chain_cs_blocks_t *a_blocks)
+{
+    dap_chain_cs_blocks_pvt_t *l_pvt = PVT(a_blocks);
+    if (l_pvt->cache_count <= l_pvt->cache_blocks_max)
+        return;
+    // Walk from the tail, the head is the block just used by the caller
+    dap_chain_block_index_item_t *l_item = l_pvt->cache_lru ? l_pvt->cache_lru->prev : NULL;
+    while (l_item && l_item != l_pvt->cache_lru && l_pvt->cache_count > l_pvt->cache_blocks_max) {
+        dap_chain_block_index_item_t *l_item_prev = l_item->prev;
+        if (!l_item->pins && s_block_index_locate(a_blocks, l_item)) {
+            DL_DELETE(l_pvt->cache_lru, l_item);
+            l_item->prev = l_item->next = NULL;
+            dap_chain_block_cache_delete(l_item->cache);
+            l_item->cache = NULL;
+            l_pvt->cache_count--;
+            s_block_index_drop_block(a_blocks, l_item);
+        }
+        l_item = l_item_prev;
+    }
+}
+
+/**
+ * @brief s_block_cache_put
+ * @details Links parsed block with the index item as the most recently used one. Call it under cache_mutex
+ * @param a_blocks
+ * @param a_item
+ * @param a_block_cache
+ */
+static void s_block_cache_put(dap_chain_cs_blocks_t *a_blocks, dap_chain_block_index_item_t *a_item, dap_chain_block_cache_t *a_block_cache)
+{
+    dap_chain_cs_blocks_pvt_t *l_pvt = PVT(a_blocks);
+    a_item->cache = a_block_cache;
+    DL_PREPEND(l_pvt->cache_lru, a_item);
+    l_pvt->cache_count++;
+    s_block_cache_trim(a_blocks);
+}
+
+/**
+ * @brief s_block_cache_take
+ * @details Unlinks parsed block from the index item, caller owns it then. Call it under cache_mutex
+ * @param a_blocks
+ * @param a_item
+ * @return
+ */
+static dap_chain_block_cache_t *s_block_cache_take(dap_chain_cs_blocks_t *a_blocks, dap_chain_block_index_item_t *a_item)
+{
+    dap_chain_cs_blocks_pvt_t *l_pvt = PVT(a_blocks);
+    dap_chain_block_cache_t *l_ret = a_item->cache;
+    if (l_ret) {
+        DL_DELETE(l_pvt->cache_lru, a_item);
+        a_item->prev = a_item->next = NULL;
+        a_item->cache = NULL;
+        a_item->pins = 0;
+        l_pvt->cache_count--;
+    } else {
+        dap_chain_block_t *l_block = s_block_index_get_block(a_blocks, a_item);
+        l_ret = l_block ? dap_chain_block_cache_new(a_blocks, l_block, a_item->block_size) : NULL;
+    }
+    return l_ret;
+}
+
+/**
+ * @brief s_block_index_get_cache
+ * @details Returns parsed block, parses it again from the cell file if it was pushed out.
+ * Returned cache is pinned, it stays valid until dap_chain_block_cs_cache_release() call
+ * @param a_blocks
+ * @param a_item
+ * @return
+ */
+static dap_chain_block_cache_t *s_block_index_get_cache(dap_chain_cs_blocks_t *a_blocks, dap_chain_block_index_item_t *a_item)
+{
+    dap_chain_cs_blocks_pvt_t *l_pvt = PVT(a_blocks);
+    pthread_mutex_lock(&l_pvt->cache_mutex);
+    dap_chain_block_cache_t *l_ret = a_item->cache;
+    if (l_ret) {
+        if (l_pvt->cache_lru != a_item) {
+            DL_DELETE(l_pvt->cache_lru, a_item);
+            DL_PREPEND(l_pvt->cache_lru, a_item);
+        }
+        a_item->pins++;
+    } else {
+        dap_chain_block_t *l_block = s_block_index_get_block(a_blocks, a_item);
+        l_ret = l_block ? dap_chain_block_cache_new(a_blocks, l_block, a_item->block_size) : NULL;
+        if (l_ret) {
+            a_item->pins++;
+            s_block_cache_put(a_blocks, a_item, l_ret);
+        } else
+            log_it(L_ERROR, "Can't load block at height %"DAP_UINT64_FORMAT_U" from the cell file", a_item->height);
+    }
+    pthread_mutex_unlock(&l_pvt->cache_mutex);
+    return l_ret;
+}
+
+/**
+ * @brief s_block_index_get_atom
+ * @param a_blocks
+ * @param a_item
+ * @param a_block_size
+ * @return Block without parsing it
+ */
+static dap_chain_block_t *s_block_index_get_atom(dap_chain_cs_blocks_t *a_blocks, dap_chain_block_index_item_t *a_item, size_t *a_block_size)
+{
+    // Stored block is given from the cell file, the copy which was added is freed when it's pushed out
+    pthread_mutex_lock(&PVT(a_blocks)->cache_mutex);
+    dap_chain_block_t *l_ret = s_block_index_get_block(a_blocks, a_item);
+    pthread_mutex_unlock(&PVT(a_blocks)->cache_mutex);
+    if (a_block_size)
+        *a_block_size = l_ret ? a_item->block_size : 0;
+    return l_ret;
+}
+
+/**
+ * @brief s_block_index_add
+ * @details Puts block on the top of the main chain. Call it under rwlock
+ * @param a_blocks
+ * @param a_block_cache
+ */
+static void s_block_index_add(dap_chain_cs_blocks_t *a_blocks, dap_chain_block_cache_t *a_block_cache)
+{
+    dap_chain_cs_blocks_pvt_t *l_pvt = PVT(a_blocks);
+    dap_chain_block_index_item_t *l_item = DAP_NEW_Z(dap_chain_block_index_item_t);
+    memcpy(&l_item->block_hash, &a_block_cache->block_hash, sizeof(l_item->block_hash));
+    l_item->block = a_block_cache->block;
+    l_item->block_size = a_block_cache->block_size;
+    l_item->height = l_pvt->blocks_count;
+    if (l_pvt->blocks_count == l_pvt->blocks_by_height_size) {
+        l_pvt->blocks_by_height_size = l_pvt->blocks_by_height_size ? l_pvt->blocks_by_height_size * 2 : 1024;
+        l_pvt->blocks_by_height = DAP_REALLOC(l_pvt->blocks_by_height,
+                                              l_pvt->blocks_by_height_size * sizeof(*l_pvt->blocks_by_height));
+    }
+    l_pvt->blocks_by_height[l_pvt->blocks_count++] = l_item;
+    HASH_ADD(hh, l_pvt->blocks, block_hash, sizeof(l_item->block_hash), l_item);
+    pthread_mutex_lock(&l_pvt->cache_mutex);
+    s_block_cache_put(a_blocks, l_item, a_block_cache);
+    pthread_mutex_unlock(&l_pvt->cache_mutex);
+}
+
+/**
+ * @brief s_block_index_remove_last
+ * @details Cuts off the top of the main chain. Call it under rwlock
+ * @param a_blocks
+ * @return Parsed block that was on the top, caller owns it
+ */
+static dap_chain_block_cache_t *s_block_index_remove_last(dap_chain_cs_blocks_t *a_blocks)
+{
+    dap_chain_cs_blocks_pvt_t *l_pvt = PVT(a_blocks);
+    dap_chain_block_index_item_t *l_item = s_block_index_last(a_blocks);
+    if (!l_item)
+        return NULL;
+    pthread_mutex_lock(&l_pvt->cache_mutex);
+    dap_chain_block_cache_t *l_ret = s_block_cache_take(a_blocks, l_item);
+    pthread_mutex_unlock(&l_pvt->cache_mutex);
+    HASH_DEL(l_pvt->blocks, l_item);
+    l_pvt->blocks_by_height[--l_pvt->blocks_count] = NULL;
+    DAP_DELETE(l_item);
+    return l_ret;
+}
+
 /**
  * @brief dap_chain_block_cs_cache_get_by_hash
+ * @details Evicted blocks are parsed again from the cell file. Returned cache is pinned,
+ * release it with dap_chain_block_cs_cache_release() when it's not needed
  * @param a_blocks
  * @param a_block_hash
  * @return
@@ -254,11 +554,36 @@ dap_chain_block_cache_t * dap_chain_block_cs_cache_get_by_hash(dap_chain_cs_bloc
 {
     dap_chain_block_cache_t * l_ret = NULL;
     pthread_rwlock_rdlock(& PVT(a_blocks)->rwlock);
-    HASH_FIND(hh, PVT(a_blocks)->blocks,a_block_hash, sizeof (*a_block_hash), l_ret );
+    dap_chain_block_index_item_t *l_item = s_block_index_find(a_blocks, a_block_hash);
+    if (l_item)
+        l_ret = s_block_index_get_cache(a_blocks, l_item);
     pthread_rwlock_unlock(& PVT(a_blocks)->rwlock);
     return l_ret;
 }
 
+/**
+ * @brief dap_chain_block_cs_cache_release
+ * @details Unpins block cache returned by dap_chain_block_cs_cache_get_by_hash(), it may be pushed out then
+ * @param a_blocks
+ * @param a_block_cache
+ */
+void dap_chain_block_cs_cache_release(dap_chain_cs_blocks_t * a_blocks, dap_chain_block_cache_t * a_block_cache)
+{
+    if (!a_block_cache)
+        return;
+    dap_chain_cs_blocks_pvt_t *l_pvt = PVT(a_blocks);
+    pthread_rwlock_rdlock(&l_pvt->rwlock);
+    dap_chain_block_index_item_t *l_item = s_block_index_find(a_blocks, &a_block_cache->block_hash);
+    pthread_mutex_lock(&l_pvt->cache_mutex);
+    // Block could be cut off from the main chain meanwhile, its cache isn't linked with the item then
+    if (l_item && l_item->cache == a_block_cache && l_item->pins) {
+        l_item->pins--;
+        s_block_cache_trim(a_blocks);
+    }
+    pthread_mutex_unlock(&l_pvt->cache_mutex);
+    pthread_rwlock_unlock(&l_pvt->rwlock);
+}
+
 /**
  * @brief s_cli_parse_cmd_hash
  * @param a_argv
@@ -381,8 +706,8 @@ static int s_cli_blocks(int a_argc, char ** a_argv, char **a_str_reply)
             pthread_rwlock_wrlock( &PVT(l_blocks)->rwlock );
             if ( l_blocks->block_new )
                 DAP_DELETE( l_blocks->block_new );
-            l_blocks->block_new = dap_chain_block_new(PVT(l_blocks)->block_cache_last ?
-                                                      &PVT(l_blocks)->block_cache_last->block_hash : NULL,
+            dap_chain_block_index_item_t *l_last = s_block_index_last(l_blocks);
+            l_blocks->block_new = dap_chain_block_new(l_last ? &l_last->block_hash : NULL,
                                                       &l_blocks->block_new_size);
             pthread_rwlock_unlock( &PVT(l_blocks)->rwlock );
         } break;
@@ -539,6 +864,7 @@ static int s_cli_blocks(int a_argc, char ** a_argv, char **a_str_reply)
                     }
                     dap_chain_node_cli_set_reply_text(a_str_reply, l_str_tmp->str);
                     dap_string_free(l_str_tmp,false);
+                    dap_chain_block_cs_cache_release(l_blocks, l_block_cache);
                     ret=0;
                 }
             }else {
@@ -552,13 +878,17 @@ static int s_cli_blocks(int a_argc, char ** a_argv, char **a_str_reply)
                 dap_string_t * l_str_tmp = dap_string_new(NULL);
                 dap_string_append_printf(l_str_tmp,"%s.%s: Have %"DAP_UINT64_FORMAT_U" blocks :\n",
                                          l_net->pub.name,l_chain->name,PVT(l_blocks)->blocks_count);
-                dap_chain_block_cache_t * l_block_cache = NULL,*l_block_cache_tmp = NULL;
-
-                HASH_ITER(hh,PVT(l_blocks)->block_cache_first,l_block_cache, l_block_cache_tmp ) {
-                    char l_buf[50];
-                    ctime_r(&l_block_cache->ts_created, l_buf);
-                    dap_string_append_printf(l_str_tmp,"\t%s: ts_create=%s",
-                                             l_block_cache->block_hash_str, l_buf);
+                // Headers are enough here, blocks are not parsed
+                for (uint64_t i = 0; i < PVT(l_blocks)->blocks_count; i++) {
+                    dap_chain_block_index_item_t *l_item = PVT(l_blocks)->blocks_by_height[i];
+                    dap_chain_block_t *l_block = s_block_index_get_atom(l_blocks, l_item, NULL);
+                    if (!l_block)
+                        continue;
+                    char l_buf[50], l_hash_str[DAP_CHAIN_HASH_FAST_STR_SIZE];
+                    time_t l_ts_created = (time_t)l_block->hdr.ts_created;
+                    ctime_r(&l_ts_created, l_buf);
+                    dap_chain_hash_fast_to_str(&l_item->block_hash, l_hash_str, sizeof(l_hash_str));
+                    dap_string_append_printf(l_str_tmp,"\t%s: ts_create=%s", l_hash_str, l_buf);
                 }
                 pthread_rwlock_unlock(&PVT(l_blocks)->rwlock);
 
@@ -591,12 +921,20 @@ static void s_callback_delete(dap_chain_t * a_chain)
         l_blocks->callback_delete(l_blocks);
     if(l_blocks->_inheritor)
         DAP_DELETE(l_blocks->_inheritor);
-    if(l_blocks->_pvt)
-        DAP_DELETE(l_blocks->_pvt);
+    dap_chain_block_index_item_t *l_item = NULL, *l_item_tmp = NULL;
+    HASH_ITER(hh, PVT(l_blocks)->blocks, l_item, l_item_tmp) {
+        HASH_DEL(PVT(l_blocks)->blocks, l_item);
+        if (l_item->cache)
+            dap_chain_block_cache_delete(l_item->cache);
+        DAP_DELETE(l_item);
+    }
+    DAP_DEL_Z(PVT(l_blocks)->blocks_by_height);
     pthread_rwlock_unlock(&PVT(l_blocks)->rwlock);
     pthread_rwlock_destroy(&PVT(l_blocks)->rwlock);
     pthread_rwlock_destroy(&PVT(l_blocks)->datums_lock);
+    pthread_mutex_destroy(&PVT(l_blocks)->cache_mutex);
     dap_chain_block_chunks_delete(PVT(l_blocks)->chunks );
+    DAP_DELETE(l_blocks->_pvt);
     log_it(L_INFO,"callback_delete() called");
 }
 
@@ -683,13 +1021,7 @@ static int s_add_atom_to_blocks(dap_chain_cs_blocks_t * a_blocks, dap_ledger_t *
         }
         //All correct, no matter for result
         pthread_rwlock_wrlock( &PVT(a_blocks)->rwlock );
-        HASH_ADD(hh, PVT(a_blocks)->blocks,block_hash,sizeof (a_block_cache->block_hash), a_block_cache);
-        if (! (PVT(a_blocks)->block_cache_first ) )
-                PVT(a_blocks)->block_cache_first = a_block_cache;
-        if (PVT(a_blocks)->block_cache_last)
-            PVT(a_blocks)->block_cache_last->next = a_block_cache;
-        a_block_cache->prev = PVT(a_blocks)->block_cache_last;
-        PVT(a_blocks)->block_cache_last = a_block_cache;
+        s_block_index_add(a_blocks, a_block_cache);
 
     } else {
         log_it(L_WARNING,"Block %s check failed: code %d", a_block_cache->block_hash_str,  res );
@@ -709,16 +1041,13 @@ static void s_bft_consensus_setup(dap_chain_cs_blocks_t * a_blocks)
     // Compare all chunks with chain's tail
     for(dap_chain_block_chunk_t * l_chunk = PVT(a_blocks)->chunks->chunks_last ; l_chunk; l_chunk=l_chunk->prev ){
         size_t l_chunk_length = HASH_COUNT(l_chunk->block_cache_hash);
-        dap_chain_block_cache_t * l_block_cache_chunk_top_prev = dap_chain_block_cs_cache_get_by_hash(a_blocks,&l_chunk->block_cache_top->prev_hash);
-        dap_chain_block_cache_t * l_block_cache= l_block_cache_chunk_top_prev;
-        if ( l_block_cache ){ // we found prev block in main chain
-            size_t l_tail_length = 0;
-            // Now lets calc tail length
-            for( ;l_block_cache; l_block_cache=l_block_cache->prev){
-                l_tail_length++;
-                if(l_tail_length>l_chunk_length)
-                    break;
-            }
+        pthread_rwlock_rdlock(& PVT(a_blocks)->rwlock);
+        dap_chain_block_index_item_t * l_fork_item = s_block_index_find(a_blocks, &l_chunk->block_cache_top->prev_hash);
+        uint64_t l_fork_height = l_fork_item ? l_fork_item->height : 0;
+        pthread_rwlock_unlock(& PVT(a_blocks)->rwlock);
+        if ( l_fork_item ){ // we found prev block in main chain
+            // Tail is the main chain part above the fork point, heights tell its length
+            size_t l_tail_length = PVT(a_blocks)->blocks_count - l_fork_height - 1;
             if(l_tail_length<l_chunk_length ){ // This generals consensus is bigger than the current one
                 // Cutoff current chank from the list
                 if( l_chunk->next)
@@ -727,18 +1056,19 @@ static void s_bft_consensus_setup(dap_chain_cs_blocks_t * a_blocks)
                     l_chunk->prev->next = l_chunk->next;
 
                 // Pass through all the tail and move it to chunks
-                for(l_block_cache= l_block_cache_chunk_top_prev ;l_block_cache; l_block_cache=l_block_cache->prev){
+                dap_chain_block_cache_t * l_block_cache;
+                for (;;) {
                     pthread_rwlock_wrlock(& PVT(a_blocks)->rwlock);
-                    if(l_block_cache->prev)
-                        l_block_cache->prev->next = l_block_cache->next;
-                    if(l_block_cache->next)
-                        l_block_cache->next->prev = l_block_cache->prev;
-                    HASH_DEL(PVT(a_blocks)->blocks,l_block_cache);
+                    l_block_cache = PVT(a_blocks)->blocks_count > l_fork_height + 1 ? s_block_index_remove_last(a_blocks) : NULL;
                     pthread_rwlock_unlock(& PVT(a_blocks)->rwlock);
+                    if (!l_block_cache)
+                        break;
                     dap_chain_block_chunks_add(PVT(a_blocks)->chunks,l_block_cache);
                 }
                 // Pass through all the chunk and add it to main chain
                 for(l_block_cache= l_chunk->block_cache_top ;l_block_cache; l_block_cache=l_block_cache->prev){
+                    // Main chain owns the block cache from now
+                    HASH_DEL(PVT(a_blocks)->chunks->cache, l_block_cache);
                     int l_check_res = s_add_atom_to_blocks(a_blocks, a_blocks->chain->ledger, l_block_cache);
                     if ( l_check_res != 0 ){
                         log_it(L_WARNING,"Can't move block %s from chunk to main chain - data inside wasn't verified: code %d",
@@ -775,9 +1105,12 @@ static dap_chain_atom_verify_res_t s_callback_atom_add(dap_chain_t * a_chain, da
     dap_chain_hash_fast_t l_block_hash;
     size_t l_block_size = a_atom_size;
     dap_hash_fast(a_atom,a_atom_size, & l_block_hash);
-    dap_chain_block_cache_t * l_block_cache = dap_chain_block_cs_cache_get_by_hash(l_blocks, &l_block_hash);
-    if (l_block_cache ){
-        log_it(L_DEBUG, "... already present in blocks %s",l_block_cache->block_hash_str);
+    dap_chain_block_cache_t * l_block_cache = NULL;
+    pthread_rwlock_rdlock(&PVT(l_blocks)->rwlock);
+    bool l_is_present = s_block_index_find(l_blocks, &l_block_hash);
+    pthread_rwlock_unlock(&PVT(l_blocks)->rwlock);
+    if (l_is_present){
+        log_it(L_DEBUG, "... already present in blocks");
         return ATOM_PASS;
     } else {
         l_block_cache = dap_chain_block_cache_new(l_blocks, l_block, l_block_size);
@@ -813,7 +1146,7 @@ static dap_chain_atom_verify_res_t s_callback_atom_add(dap_chain_t * a_chain, da
         dap_chain_block_chunks_add( PVT(l_blocks)->chunks,l_block_cache);
         dap_chain_block_chunks_sort(PVT(l_blocks)->chunks);
     }else if (ret == ATOM_REJECT ){
-        DAP_DELETE(l_block_cache);
+        dap_chain_block_cache_delete(l_block_cache);
     }
 
     s_bft_consensus_setup(l_blocks);
@@ -866,7 +1199,7 @@ static dap_chain_atom_verify_res_t s_callback_atom_verify(dap_chain_t * a_chain,
     if(res == ATOM_ACCEPT){
         // genesis or seed mode
         if ( l_is_genesis){
-            if( s_seed_mode && ! l_blocks_pvt->blocks ){
+            if( s_seed_mode && ! l_blocks_pvt->blocks_count ){
                 log_it(L_NOTICE,"Accepting new genesis block");
                 return ATOM_ACCEPT;
             }else if(s_seed_mode){
@@ -874,9 +1207,12 @@ static dap_chain_atom_verify_res_t s_callback_atom_verify(dap_chain_t * a_chain,
                 return  ATOM_REJECT;
             }
         }else{
-            if( PVT(l_blocks)->block_cache_last )
-                if (! dap_hash_fast_compare(& PVT(l_blocks)->block_cache_last->block_hash, &l_block_prev_hash) )
+            pthread_rwlock_rdlock(&l_blocks_pvt->rwlock);
+            dap_chain_block_index_item_t *l_last = s_block_index_last(l_blocks);
+            if( l_last )
+                if (! dap_hash_fast_compare(&l_last->block_hash, &l_block_prev_hash) )
                     res = ATOM_MOVE_TO_THRESHOLD ;
+            pthread_rwlock_unlock(&l_blocks_pvt->rwlock);
         }
     }
 
@@ -923,7 +1259,9 @@ static dap_chain_atom_iter_t* s_callback_atom_iter_create_from(dap_chain_t * a_c
         dap_chain_atom_iter_t * l_atom_iter = s_callback_atom_iter_create(a_chain);
         if (l_atom_iter){
             dap_chain_cs_blocks_t *l_blocks = DAP_CHAIN_CS_BLOCKS(a_chain);
-            l_atom_iter->cur_item = ITER_PVT(l_atom_iter)->cache = dap_chain_block_cs_cache_get_by_hash(l_blocks, &l_atom_hash);
+            pthread_rwlock_rdlock(&PVT(l_blocks)->rwlock);
+            l_atom_iter->cur_item = ITER_PVT(l_atom_iter)->item = s_block_index_find(l_blocks, &l_atom_hash);
+            pthread_rwlock_unlock(&PVT(l_blocks)->rwlock);
             l_atom_iter->cur = a_atom;
             l_atom_iter->cur_size = a_atom_size;
             return l_atom_iter;
@@ -945,15 +1283,17 @@ static dap_chain_atom_ptr_t s_callback_atom_iter_find_by_hash(dap_chain_atom_ite
 {
     assert(a_atom_iter);
     dap_chain_atom_ptr_t l_ret = NULL;
-    pthread_rwlock_rdlock(& PVT(ITER_PVT(a_atom_iter)->blocks)->rwlock );
-    dap_chain_block_cache_t * l_block_cache = NULL;
-    HASH_FIND(hh, PVT(ITER_PVT(a_atom_iter)->blocks)->blocks, a_atom_hash,sizeof (*a_atom_hash), l_block_cache);
-    a_atom_iter->cur_item = l_block_cache;
-    if (l_block_cache){
-        l_ret = a_atom_iter->cur = l_block_cache->block;
-        *a_atom_size = a_atom_iter->cur_size = l_block_cache->block_size;
+    dap_chain_cs_blocks_t *l_blocks = ITER_PVT(a_atom_iter)->blocks;
+    pthread_rwlock_rdlock(& PVT(l_blocks)->rwlock );
+    dap_chain_block_index_item_t * l_item = s_block_index_find(l_blocks, a_atom_hash);
+    a_atom_iter->cur_item = l_item;
+    if (l_item){
+        size_t l_block_size = 0;
+        l_ret = a_atom_iter->cur = s_block_index_get_atom(l_blocks, l_item, &l_block_size);
+        *a_atom_size = a_atom_iter->cur_size = l_block_size;
+        a_atom_iter->cur_hash = &l_item->block_hash;
     }
-    pthread_rwlock_unlock(& PVT(ITER_PVT(a_atom_iter)->blocks)->rwlock );
+    pthread_rwlock_unlock(& PVT(l_blocks)->rwlock );
     return l_ret;
 }
 
@@ -967,11 +1307,32 @@ static dap_chain_datum_tx_t* s_callback_atom_iter_find_by_tx_hash(dap_chain_t *
 {
     dap_chain_cs_blocks_t * l_cs_blocks = DAP_CHAIN_CS_BLOCKS(a_chain);
     dap_chain_tx_block_index_t * l_tx_block_index = NULL;
+    dap_chain_hash_fast_t l_block_hash;
+    pthread_rwlock_rdlock(&PVT(l_cs_blocks)->rwlock);
     HASH_FIND(hh, PVT(l_cs_blocks)->tx_block_index,a_tx_hash, sizeof (*a_tx_hash), l_tx_block_index);
+    if (l_tx_block_index)
+        memcpy(&l_block_hash, &l_tx_block_index->block_hash, sizeof(l_block_hash));
+    pthread_rwlock_unlock(&PVT(l_cs_blocks)->rwlock);
     if (l_tx_block_index){
-        dap_chain_block_cache_t *l_block_cache = dap_chain_block_cs_cache_get_by_hash(l_cs_blocks, &l_tx_block_index->block_hash);
+        dap_chain_block_cache_t *l_block_cache = dap_chain_block_cs_cache_get_by_hash(l_cs_blocks, &l_block_hash);
         if ( l_block_cache){
-            return dap_chain_block_cache_get_tx_by_hash(l_block_cache, a_tx_hash);
+            dap_chain_datum_tx_t *l_tx = dap_chain_block_cache_get_tx_by_hash(l_block_cache, a_tx_hash);
+            // Transaction points into the block itself, so it outlives the block cache. The copy of block
+            // which was added is freed when it's pushed out, so point into the cell file if block is there
+            dap_chain_block_t *l_block = NULL;
+            if (l_tx) {
+                pthread_rwlock_rdlock(&PVT(l_cs_blocks)->rwlock);
+                dap_chain_block_index_item_t *l_item = s_block_index_find(l_cs_blocks, &l_block_hash);
+                pthread_mutex_lock(&PVT(l_cs_blocks)->cache_mutex);
+                if (l_item && s_block_index_locate(l_cs_blocks, l_item))
+                    l_block = s_block_index_get_stored(l_cs_blocks, l_item);
+                pthread_mutex_unlock(&PVT(l_cs_blocks)->cache_mutex);
+                pthread_rwlock_unlock(&PVT(l_cs_blocks)->rwlock);
+            }
+            if (l_block)
+                l_tx = (dap_chain_datum_tx_t *)((byte_t *)l_block + ((byte_t *)l_tx - (byte_t *)l_block_cache->block));
+            dap_chain_block_cs_cache_release(l_cs_blocks, l_block_cache);
+            return l_tx;
         }else
             return NULL;
     }else
@@ -1006,9 +1367,14 @@ static dap_chain_atom_ptr_t s_callback_atom_iter_get_first( dap_chain_atom_iter_
     dap_chain_cs_blocks_t * l_blocks = DAP_CHAIN_CS_BLOCKS(a_atom_iter->chain);
     dap_chain_cs_blocks_pvt_t *l_blocks_pvt = l_blocks ? PVT(l_blocks) : NULL;
     assert(l_blocks_pvt);
-    a_atom_iter->cur_item = l_blocks_pvt->block_cache_last ;
-    a_atom_iter->cur = l_blocks_pvt->block_cache_last ?  l_blocks_pvt->block_cache_last->block : NULL  ;
-    a_atom_iter->cur_size = l_blocks_pvt->block_cache_first ? l_blocks_pvt->block_cache_first->block_size : 0;
+    pthread_rwlock_rdlock(&l_blocks_pvt->rwlock);
+    dap_chain_block_index_item_t *l_item = l_blocks_pvt->blocks_count ? l_blocks_pvt->blocks_by_height[0] : NULL;
+    size_t l_block_size = 0;
+    a_atom_iter->cur_item = l_item;
+    a_atom_iter->cur = l_item ? s_block_index_get_atom(l_blocks, l_item, &l_block_size) : NULL;
+    a_atom_iter->cur_size = l_block_size;
+    a_atom_iter->cur_hash = l_item ? &l_item->block_hash : NULL;
+    pthread_rwlock_unlock(&l_blocks_pvt->rwlock);
 
 //    a_atom_iter->cur =  a_atom_iter->cur ?
 //                (dap_chain_cs_dag_event_t*) PVT (DAP_CHAIN_CS_DAG( a_atom_iter->chain) )->events->event : NULL;
@@ -1029,14 +1395,17 @@ static dap_chain_atom_ptr_t s_callback_atom_iter_get_next( dap_chain_atom_iter_t
     assert(a_atom_iter);
     assert(a_atom_size);
     assert(a_atom_iter->cur_item);
-    dap_chain_block_cache_t * l_cur_cache =(dap_chain_block_cache_t *) a_atom_iter->cur_item;
-    a_atom_iter->cur_item = l_cur_cache = l_cur_cache->next;
-    if (l_cur_cache){
-        a_atom_iter->cur = l_cur_cache->block;
-        *a_atom_size=a_atom_iter->cur_size = l_cur_cache->block_size;
-        return l_cur_cache->block;
-    }else
-        return NULL;
+    dap_chain_cs_blocks_t * l_blocks = ITER_PVT(a_atom_iter)->blocks;
+    dap_chain_block_index_item_t * l_item = (dap_chain_block_index_item_t *) a_atom_iter->cur_item;
+    pthread_rwlock_rdlock(&PVT(l_blocks)->rwlock);
+    l_item = l_item->height + 1 < PVT(l_blocks)->blocks_count ? PVT(l_blocks)->blocks_by_height[l_item->height + 1] : NULL;
+    a_atom_iter->cur_item = l_item;
+    size_t l_block_size = 0;
+    a_atom_iter->cur = l_item ? s_block_index_get_atom(l_blocks, l_item, &l_block_size) : NULL;
+    *a_atom_size = a_atom_iter->cur_size = l_block_size;
+    a_atom_iter->cur_hash = l_item ? &l_item->block_hash : NULL;
+    pthread_rwlock_unlock(&PVT(l_blocks)->rwlock);
+    return a_atom_iter->cur;
 }
 
 /**
@@ -1052,21 +1421,26 @@ static dap_chain_atom_ptr_t *s_callback_atom_iter_get_links( dap_chain_atom_iter
     assert(a_links_size);
     assert(a_links_size_ptr);
     if (a_atom_iter->cur_item){
-        dap_chain_block_cache_t * l_block_cache =(dap_chain_block_cache_t *) a_atom_iter->cur_item;
-        if (l_block_cache->links_hash_count){
+        dap_chain_cs_blocks_t *l_cs_blocks = ITER_PVT(a_atom_iter)->blocks;
+        dap_chain_block_cache_t * l_block_cache = dap_chain_block_cs_cache_get_by_hash(l_cs_blocks,
+                                                    &((dap_chain_block_index_item_t *)a_atom_iter->cur_item)->block_hash);
+        if (l_block_cache && l_block_cache->links_hash_count){
             *a_links_size_ptr = DAP_NEW_Z_SIZE( size_t, l_block_cache->links_hash_count*sizeof (size_t));
             *a_links_size = l_block_cache->links_hash_count;
             dap_chain_atom_ptr_t * l_ret = DAP_NEW_Z_SIZE(dap_chain_atom_ptr_t, l_block_cache->links_hash_count *sizeof (dap_chain_atom_ptr_t) );
+            pthread_rwlock_rdlock(&PVT(l_cs_blocks)->rwlock);
             for (size_t i = 0; i< l_block_cache->links_hash_count; i ++){
-                dap_chain_cs_blocks_t *l_cs_blocks = (dap_chain_cs_blocks_t *)l_block_cache->_inheritor;
-                dap_chain_block_cache_t *l_link =  dap_chain_block_cs_cache_get_by_hash(l_cs_blocks, &l_block_cache->links_hash[i]);
+                dap_chain_block_index_item_t *l_link = s_block_index_find(l_cs_blocks, &l_block_cache->links_hash[i]);
                 assert(l_link);
-                (*a_links_size_ptr)[i] = l_link->block_size;
-                l_ret[i] = l_link->block;
+                l_ret[i] = s_block_index_get_atom(l_cs_blocks, l_link, &(*a_links_size_ptr)[i]);
             }
+            pthread_rwlock_unlock(&PVT(l_cs_blocks)->rwlock);
+            dap_chain_block_cs_cache_release(l_cs_blocks, l_block_cache);
             return l_ret;
-        }else
+        }else {
+            dap_chain_block_cs_cache_release(l_cs_blocks, l_block_cache);
             return NULL;
+        }
     }else
         return NULL;
 }
@@ -1084,13 +1458,18 @@ static dap_chain_atom_ptr_t *s_callback_atom_iter_get_lasts( dap_chain_atom_iter
     assert(a_links_size);
     assert(a_links_size);
 
-    dap_chain_block_cache_t * l_block_cache_last = PVT(ITER_PVT(a_atom_iter)->blocks)->block_cache_last;
-    if ( l_block_cache_last  ){
+    dap_chain_cs_blocks_t * l_blocks = ITER_PVT(a_atom_iter)->blocks;
+    pthread_rwlock_rdlock(&PVT(l_blocks)->rwlock);
+    dap_chain_block_index_item_t * l_item_last = s_block_index_last(l_blocks);
+    size_t l_block_size = 0;
+    dap_chain_block_t * l_block_last = l_item_last ? s_block_index_get_atom(l_blocks, l_item_last, &l_block_size) : NULL;
+    pthread_rwlock_unlock(&PVT(l_blocks)->rwlock);
+    if ( l_block_last  ){
         *a_links_size = 1;
         *a_lasts_size_ptr = DAP_NEW_Z_SIZE(size_t,sizeof (size_t)*1  );
         dap_chain_atom_ptr_t * l_ret = DAP_NEW_Z_SIZE(dap_chain_atom_ptr_t, sizeof (dap_chain_atom_ptr_t)*1);
-        (*a_lasts_size_ptr)[0] = l_block_cache_last->block_size;
-        l_ret[0] = l_block_cache_last->block;
+        (*a_lasts_size_ptr)[0] = l_block_size;
+        l_ret[0] = l_block_last;
         return l_ret;
     }else{
         return NULL;
@@ -1120,7 +1499,11 @@ static int s_new_block_complete(dap_chain_cs_blocks_t *a_blocks)
         return -1;
     }
     dap_chain_atom_verify_res_t l_res = s_callback_atom_add(a_blocks->chain, a_blocks->block_new, a_blocks->block_new_size);
-    DAP_DEL_Z(a_blocks->block_new);
+    // Chain owns added block, also when it's kept in treshold
+    if (l_res == ATOM_ACCEPT || l_res == ATOM_MOVE_TO_THRESHOLD)
+        a_blocks->block_new = NULL;
+    else
+        DAP_DEL_Z(a_blocks->block_new);
     if (l_res == ATOM_ACCEPT)
         return 0;
     return -2;
@@ -1150,7 +1533,10 @@ static size_t s_callback_add_datums(dap_chain_t *a_chain, dap_chain_datum_t **a_
     // IMPORTANT - all datums on input should be checked before for curruption because datum size is taken from datum's header
     pthread_rwlock_wrlock(&l_blocks_pvt->datums_lock);
     if (!l_blocks->block_new) {
-        l_blocks->block_new = dap_chain_block_new(&l_blocks_pvt->block_cache_last->block_hash, &l_blocks->block_new_size);
+        pthread_rwlock_rdlock(&l_blocks_pvt->rwlock);
+        dap_chain_block_index_item_t *l_last = s_block_index_last(l_blocks);
+        l_blocks->block_new = dap_chain_block_new(l_last ? &l_last->block_hash : NULL, &l_blocks->block_new_size);
+        pthread_rwlock_unlock(&l_blocks_pvt->rwlock);
         dap_chain_net_t *l_net = dap_chain_net_by_id(l_blocks->chain->net_id);
         l_blocks->block_new->hdr.cell_id.uint64 = l_net->pub.cell_id.uint64;
         l_blocks->block_new->hdr.chain_id.uint64 = l_blocks->chain->id.uint64;
@@ -64,3 +64,6 @@ void dap_chain_cs_blocks_deinit();
 
 int dap_chain_cs_blocks_new(dap_chain_t * a_chain, dap_config_t * a_chain_config);
 void dap_chain_cs_blocks_delete(dap_chain_t * a_chain);
+
+dap_chain_block_cache_t * dap_chain_block_cs_cache_get_by_hash(dap_chain_cs_blocks_t * a_blocks, dap_chain_hash_fast_t *a_block_hash);
+void dap_chain_block_cs_cache_release(dap_chain_cs_blocks_t * a_blocks, dap_chain_block_cache_t * a_block_cache);
@@ -60,28 +60,74 @@ typedef struct dap_chain_cs_dag_event_item {
     time_t ts_added;
     dap_chain_cs_dag_event_t *event;
     size_t event_size;
+    size_t links_missing; // Threshold event links absent in the main events table
+    bool is_conflicted;
+    struct dap_chain_cs_dag_event_item *prev, *next; // Threshold events ready to be added
     UT_hash_handle hh;
 } dap_chain_cs_dag_event_item_t;
 
+/**
+ * @brief Threshold events waiting for the absent event
+ */
+typedef struct dap_chain_cs_dag_treshold_link {
+    dap_chain_hash_fast_t hash; // Absent event hash
+    dap_list_t *events; // Threshold events linked with it
+    UT_hash_handle hh;
+} dap_chain_cs_dag_treshold_link_t;
+
+
+/**
+ * @brief Event of the new round, cached from its group so it isn't reloaded and rehashed
+ */
+typedef struct dap_chain_cs_dag_round_event {
+    char *key; // Event key in the new round group
+    dap_chain_hash_fast_t hash;
+    uint16_t signs_count;
+    uint64_t ts_update;
+    struct dap_chain_cs_dag_round *round;
+    struct dap_chain_cs_dag_round_event *prev, *next; // Events of the same round
+    UT_hash_handle hh;
+} dap_chain_cs_dag_round_event_t;
+
+typedef struct dap_chain_cs_dag_round {
+    dap_chain_hash_fast_t first_event_hash; // Round id
+    dap_chain_cs_dag_round_event_t *events;
+    size_t events_count;
+    UT_hash_handle hh;
+} dap_chain_cs_dag_round_t;
 
 typedef struct dap_chain_cs_dag_pvt {
     dap_enc_key_t* datum_add_sign_key;
 
 
+    // Each index has its own lock. When several are needed take them in order:
+    // treshold_rwlock, events_rwlock, events_lasts_rwlock, tx_events_rwlock
     pthread_rwlock_t events_rwlock;
+    pthread_rwlock_t tx_events_rwlock;
+    pthread_rwlock_t treshold_rwlock; // events_treshold, events_treshold_conflicted, treshold_links and events_treshold_ready
+    pthread_rwlock_t events_lasts_rwlock;
 
     dap_chain_cs_dag_event_item_t * events;
 
     dap_chain_cs_dag_event_item_t * tx_events;
     dap_chain_cs_dag_event_item_t * events_treshold;
     dap_chain_cs_dag_event_item_t * events_treshold_conflicted;
+    dap_chain_cs_dag_treshold_link_t * treshold_links; // Threshold events by absent links
+    dap_chain_cs_dag_event_item_t * events_treshold_ready; // Threshold events with all links present, in order to add
     dap_chain_cs_dag_event_item_t * events_lasts_unlinked;
 
+    // New round state, kept in sync with its group by the GDB notifier
+    pthread_rwlock_t rounds_rwlock;
+    dap_chain_cs_dag_round_t * rounds; // By first event hash
+    dap_chain_cs_dag_round_event_t * round_events; // By key
+    bool rounds_loaded;
 } dap_chain_cs_dag_pvt_t;
 
 #define PVT(a) ((dap_chain_cs_dag_pvt_t *) a->_pvt )
 
 static void s_dap_chain_cs_dag_purge(dap_chain_t *a_chain);
+static void s_dag_treshold_add(dap_chain_cs_dag_t *a_dag, dap_chain_cs_dag_event_item_t *a_event_item);
+static void s_dag_treshold_resolve(dap_chain_cs_dag_t *a_dag, dap_chain_hash_fast_t *a_hash);
 dap_chain_cs_dag_event_item_t* dap_chain_cs_dag_proc_treshold(dap_chain_cs_dag_t * a_dag, dap_ledger_t * a_ledger);
 
 // Atomic element organization callbacks
@@ -168,6 +214,198 @@ void dap_chain_cs_dag_deinit(void)
 
 }
 
+/**
+ * @brief s_dag_round_event_remove
+ * @details Call it under rounds_rwlock
+ * @param a_dag
+ * @param a_key
+ */
+static void s_dag_round_event_remove(dap_chain_cs_dag_t *a_dag, const char *a_key)
+{
+    dap_chain_cs_dag_pvt_t *l_dag_pvt = PVT(a_dag);
+    dap_chain_cs_dag_round_event_t *l_round_event = NULL;
+    HASH_FIND_STR(l_dag_pvt->round_events, a_key, l_round_event);
+    if (!l_round_event)
+        return;
+    dap_chain_cs_dag_round_t *l_round = l_round_event->round;
+    DL_DELETE(l_round->events, l_round_event);
+    if (!--l_round->events_count) {
+        HASH_DEL(l_dag_pvt->rounds, l_round);
+        DAP_DELETE(l_round);
+    }
+    HASH_DEL(l_dag_pvt->round_events, l_round_event);
+    DAP_DELETE(l_round_event->key);
+    DAP_DELETE(l_round_event);
+}
+
+/**
+ * @brief s_dag_round_event_add
+ * @details Caches event hash, signs count and round of the new round group object. Call it under rounds_rwlock
+ * @param a_dag
+ * @param a_key
+ * @param a_value dap_chain_cs_dag_event_round_item_t object
+ * @param a_value_size
+ */
+static void s_dag_round_event_add(dap_chain_cs_dag_t *a_dag, const char *a_key, const void *a_value, size_t a_value_size)
+{
+    dap_chain_cs_dag_pvt_t *l_dag_pvt = PVT(a_dag);
+    dap_chain_cs_dag_event_round_item_t *l_round_item = (dap_chain_cs_dag_event_round_item_t *)a_value;
+    if (!a_key || !l_round_item || a_value_size < sizeof(*l_round_item)
+            || a_value_size < dap_chain_cs_dag_event_round_item_get_size(l_round_item)
+            || l_round_item->event_size < sizeof(dap_chain_cs_dag_event_t)) {
+        log_it(L_WARNING, "Corrupted object \"%s\" in the new round", a_key ? a_key : "(null)");
+        return;
+    }
+    if (dap_strlen(a_key) >= DAP_CHAIN_HASH_FAST_STR_SIZE) {
+        log_it(L_WARNING, "Wrong event key \"%s\" in the new round", a_key);
+        return;
+    }
+    s_dag_round_event_remove(a_dag, a_key);
+    dap_chain_cs_dag_event_t *l_event = (dap_chain_cs_dag_event_t *)l_round_item->event;
+    dap_chain_cs_dag_round_event_t *l_round_event = DAP_NEW_Z(dap_chain_cs_dag_round_event_t);
+    l_round_event->key = dap_strdup(a_key);
+    dap_chain_cs_dag_event_calc_hash(l_event, l_round_item->event_size, &l_round_event->hash);
+    l_round_event->signs_count = l_event->header.signs_count;
+    l_round_event->ts_update = l_round_item->cfg.ts_update;
+    dap_chain_cs_dag_round_t *l_round = NULL;
+    HASH_FIND(hh, l_dag_pvt->rounds, &l_round_item->cfg.first_event_hash, sizeof(dap_chain_hash_fast_t), l_round);
+    if (!l_round) {
+        l_round = DAP_NEW_Z(dap_chain_cs_dag_round_t);
+        memcpy(&l_round->first_event_hash, &l_round_item->cfg.first_event_hash, sizeof(dap_chain_hash_fast_t));
+        HASH_ADD(hh, l_dag_pvt->rounds, first_event_hash, sizeof(l_round->first_event_hash), l_round);
+    }
+    l_round_event->round = l_round;
+    DL_APPEND(l_round->events, l_round_event);
+    l_round->events_count++;
+    HASH_ADD_KEYPTR(hh, l_dag_pvt->round_events, l_round_event->key, strlen(l_round_event->key), l_round_event);
+}
+
+/**
+ * @brief s_dag_rounds_load
+ * @details Fills the new round state from its group once, then the notifier keeps it actual. Call it under rounds_rwlock
+ * @param a_dag
+ */
+static void s_dag_rounds_load(dap_chain_cs_dag_t *a_dag)
+{
+    dap_chain_cs_dag_pvt_t *l_dag_pvt = PVT(a_dag);
+    if (l_dag_pvt->rounds_loaded)
+        return;
+    l_dag_pvt->rounds_loaded = true;
+    size_t l_objs_count = 0;
+    dap_global_db_obj_t *l_objs = dap_chain_global_db_gr_load(a_dag->gdb_group_events_round_new, &l_objs_count);
+    for (size_t i = 0; i < l_objs_count; i++)
+        s_dag_round_event_add(a_dag, l_objs[i].key, l_objs[i].value, l_objs[i].value_len);
+    dap_chain_global_db_objs_delete(l_objs, l_objs_count);
+}
+
+/**
+ * @brief s_dag_rounds_clear
+ * @param a_dag
+ */
+static void s_dag_rounds_clear(dap_chain_cs_dag_t *a_dag)
+{
+    dap_chain_cs_dag_pvt_t *l_dag_pvt = PVT(a_dag);
+    pthread_rwlock_wrlock(&l_dag_pvt->rounds_rwlock);
+    dap_chain_cs_dag_round_event_t *l_round_event, *l_round_event_tmp;
+    HASH_ITER(hh, l_dag_pvt->round_events, l_round_event, l_round_event_tmp) {
+        HASH_DEL(l_dag_pvt->round_events, l_round_event);
+        DAP_DELETE(l_round_event->key);
+        DAP_DELETE(l_round_event);
+    }
+    dap_chain_cs_dag_round_t *l_round, *l_round_tmp;
+    HASH_ITER(hh, l_dag_pvt->rounds, l_round, l_round_tmp) {
+        HASH_DEL(l_dag_pvt->rounds, l_round);
+        DAP_DELETE(l_round);
+    }
+    l_dag_pvt->rounds_loaded = false;
+    pthread_rwlock_unlock(&l_dag_pvt->rounds_rwlock);
+}
+
+/**
+ * @brief s_dag_round_hashes_get
+ * @param a_dag
+ * @param a_count
+ * @return hashes of all events in the new round, cached by round state
+ */
+static dap_chain_hash_fast_t *s_dag_round_hashes_get(dap_chain_cs_dag_t *a_dag, size_t *a_count)
+{
+    dap_chain_cs_dag_pvt_t *l_dag_pvt = PVT(a_dag);
+    pthread_rwlock_wrlock(&l_dag_pvt->rounds_rwlock);
+    s_dag_rounds_load(a_dag);
+    size_t l_count = HASH_COUNT(l_dag_pvt->round_events);
+    dap_chain_hash_fast_t *l_hashes = l_count ? DAP_NEW_SIZE(dap_chain_hash_fast_t, l_count * sizeof(dap_chain_hash_fast_t)) : NULL;
+    size_t i = 0;
+    for (dap_chain_cs_dag_round_event_t *l_round_event = l_dag_pvt->round_events; l_round_event; l_round_event = l_round_event->hh.next)
+        memcpy(&l_hashes[i++], &l_round_event->hash, sizeof(dap_chain_hash_fast_t));
+    pthread_rwlock_unlock(&l_dag_pvt->rounds_rwlock);
+    *a_count = l_count;
+    return l_hashes;
+}
+
+/**
+ * @brief s_dag_round_events_get_all
+ * @param a_dag
+ * @param a_events_count
+ * @return all events of the new round, cached by round state. Free it with DAP_DELETE
+ */
+static dap_chain_cs_dag_round_event_info_t *s_dag_round_events_get_all(dap_chain_cs_dag_t *a_dag, size_t *a_events_count)
+{
+    dap_chain_cs_dag_pvt_t *l_dag_pvt = PVT(a_dag);
+    pthread_rwlock_wrlock(&l_dag_pvt->rounds_rwlock);
+    s_dag_rounds_load(a_dag);
+    size_t l_count = HASH_COUNT(l_dag_pvt->round_events);
+    dap_chain_cs_dag_round_event_info_t *l_ret = l_count
+            ? DAP_NEW_Z_SIZE(dap_chain_cs_dag_round_event_info_t, l_count * sizeof(dap_chain_cs_dag_round_event_info_t)) : NULL;
+    size_t i = 0;
+    for (dap_chain_cs_dag_round_event_t *l_round_event = l_dag_pvt->round_events; l_round_event; l_round_event = l_round_event->hh.next) {
+        strncpy(l_ret[i].key, l_round_event->key, sizeof(l_ret[i].key) - 1);
+        memcpy(&l_ret[i].hash, &l_round_event->hash, sizeof(dap_chain_hash_fast_t));
+        l_ret[i].signs_count = l_round_event->signs_count;
+        l_ret[i].ts_update = l_round_event->ts_update;
+        i++;
+    }
+    pthread_rwlock_unlock(&l_dag_pvt->rounds_rwlock);
+    *a_events_count = l_count;
+    return l_ret;
+}
+
+/**
+ * @brief dap_chain_cs_dag_round_events_get
+ * @details Costs O(events in the round), new round group isn't read
+ * @param a_dag
+ * @param a_key key of any event in the round
+ * @param a_events_count
+ * @return events of the same round as a_key one, NULL if there is no such event. Free it with DAP_DELETE
+ */
+dap_chain_cs_dag_round_event_info_t *dap_chain_cs_dag_round_events_get(dap_chain_cs_dag_t *a_dag, const char *a_key,
+                                                                        size_t *a_events_count)
+{
+    dap_chain_cs_dag_pvt_t *l_dag_pvt = PVT(a_dag);
+    dap_chain_cs_dag_round_event_info_t *l_ret = NULL;
+    *a_events_count = 0;
+    if (!a_key)
+        return NULL;
+    pthread_rwlock_wrlock(&l_dag_pvt->rounds_rwlock);
+    s_dag_rounds_load(a_dag);
+    dap_chain_cs_dag_round_event_t *l_round_event = NULL;
+    HASH_FIND_STR(l_dag_pvt->round_events, a_key, l_round_event);
+    if (l_round_event) {
+        dap_chain_cs_dag_round_t *l_round = l_round_event->round;
+        l_ret = DAP_NEW_Z_SIZE(dap_chain_cs_dag_round_event_info_t, l_round->events_count * sizeof(dap_chain_cs_dag_round_event_info_t));
+        size_t i = 0;
+        DL_FOREACH(l_round->events, l_round_event) {
+            strncpy(l_ret[i].key, l_round_event->key, sizeof(l_ret[i].key) - 1);
+            memcpy(&l_ret[i].hash, &l_round_event->hash, sizeof(dap_chain_hash_fast_t));
+            l_ret[i].signs_count = l_round_event->signs_count;
+            l_ret[i].ts_update = l_round_event->ts_update;
+            i++;
+        }
+        *a_events_count = i;
+    }
+    pthread_rwlock_unlock(&l_dag_pvt->rounds_rwlock);
+    return l_ret;
+}
+
 /**
  * @brief callback during round verification, calling from dap_global_db_obj_track_history (l_sync_group_item->callback_notify)
  *
@@ -186,6 +424,16 @@ static void s_history_callback_round_notify(void * a_arg, const char a_op_code,
         dap_chain_net_t *l_net = dap_chain_net_by_id( l_dag->chain->net_id);
         log_it(L_DEBUG,"%s.%s: op_code='%c' group=\"%s\" key=\"%s\" value_size=%zu",
             l_net->pub.name, l_dag->chain->name, a_op_code, a_group, a_key, a_value_size);
+        if (!dap_strcmp(a_group, l_dag->gdb_group_events_round_new)) {
+            pthread_rwlock_wrlock(&PVT(l_dag)->rounds_rwlock);
+            if (PVT(l_dag)->rounds_loaded) {
+                if (a_op_code == 'a' && a_value)
+                    s_dag_round_event_add(l_dag, a_key, a_value, a_value_size);
+                else if (a_op_code == 'd')
+                    s_dag_round_event_remove(l_dag, a_key);
+            }
+            pthread_rwlock_unlock(&PVT(l_dag)->rounds_rwlock);
+        }
         if (l_dag->callback_cs_event_round_sync) {
             l_dag->callback_cs_event_round_sync(l_dag, a_op_code, a_group, a_key, a_value, a_value_size);
         }
@@ -205,6 +453,10 @@ int dap_chain_cs_dag_new(dap_chain_t * a_chain, dap_config_t * a_chain_cfg)
     l_dag->chain = a_chain;
 
     pthread_rwlock_init(& PVT(l_dag)->events_rwlock,NULL);
+    pthread_rwlock_init(& PVT(l_dag)->tx_events_rwlock,NULL);
+    pthread_rwlock_init(& PVT(l_dag)->treshold_rwlock,NULL);
+    pthread_rwlock_init(& PVT(l_dag)->events_lasts_rwlock,NULL);
+    pthread_rwlock_init(& PVT(l_dag)->rounds_rwlock,NULL);
 
     a_chain->callback_delete = dap_chain_cs_dag_delete;
     a_chain->callback_purge = s_dap_chain_cs_dag_purge;
@@ -304,7 +556,10 @@ static void s_dag_chain_cs_set_event_round_cfg(dap_chain_cs_dag_t * a_dag, dap_c
 static void s_dap_chain_cs_dag_purge(dap_chain_t *a_chain)
 {
     dap_chain_cs_dag_pvt_t *l_dag_pvt = PVT(DAP_CHAIN_CS_DAG(a_chain));
+    pthread_rwlock_wrlock(&l_dag_pvt->treshold_rwlock);
     pthread_rwlock_wrlock(&l_dag_pvt->events_rwlock);
+    pthread_rwlock_wrlock(&l_dag_pvt->events_lasts_rwlock);
+    pthread_rwlock_wrlock(&l_dag_pvt->tx_events_rwlock);
     dap_chain_cs_dag_event_item_t *l_event_current, *l_event_tmp;
     HASH_ITER(hh, l_dag_pvt->events, l_event_current, l_event_tmp) {
         HASH_DEL(l_dag_pvt->events, l_event_current);
@@ -326,7 +581,18 @@ static void s_dap_chain_cs_dag_purge(dap_chain_t *a_chain)
         HASH_DEL(l_dag_pvt->tx_events, l_event_current);
         DAP_DELETE(l_event_current);
     }
+    dap_chain_cs_dag_treshold_link_t *l_link_current, *l_link_tmp;
+    HASH_ITER(hh, l_dag_pvt->treshold_links, l_link_current, l_link_tmp) {
+        HASH_DEL(l_dag_pvt->treshold_links, l_link_current);
+        dap_list_free(l_link_current->events);
+        DAP_DELETE(l_link_current);
+    }
+    l_dag_pvt->events_treshold_ready = NULL;
+    pthread_rwlock_unlock(&l_dag_pvt->tx_events_rwlock);
+    pthread_rwlock_unlock(&l_dag_pvt->events_lasts_rwlock);
     pthread_rwlock_unlock(&l_dag_pvt->events_rwlock);
+    pthread_rwlock_unlock(&l_dag_pvt->treshold_rwlock);
+    s_dag_rounds_clear(DAP_CHAIN_CS_DAG(a_chain));
     dap_chain_cell_t *l_cell_cur, *l_cell_tmp;
     HASH_ITER(hh, a_chain->cells, l_cell_cur, l_cell_tmp) {
         dap_chain_cell_close(l_cell_cur);
@@ -343,6 +609,10 @@ void dap_chain_cs_dag_delete(dap_chain_t * a_chain)
     s_dap_chain_cs_dag_purge(a_chain);
     dap_chain_cs_dag_t * l_dag = DAP_CHAIN_CS_DAG ( a_chain );
     pthread_rwlock_destroy(& PVT(l_dag)->events_rwlock);
+    pthread_rwlock_destroy(& PVT(l_dag)->tx_events_rwlock);
+    pthread_rwlock_destroy(& PVT(l_dag)->treshold_rwlock);
+    pthread_rwlock_destroy(& PVT(l_dag)->events_lasts_rwlock);
+    pthread_rwlock_destroy(& PVT(l_dag)->rounds_rwlock);
 
     if(l_dag->callback_delete )
         l_dag->callback_delete(l_dag);
@@ -356,7 +626,6 @@ void dap_chain_cs_dag_delete(dap_chain_t * a_chain)
 static int s_dap_chain_add_atom_to_ledger(dap_chain_cs_dag_t * a_dag, dap_ledger_t * a_ledger, dap_chain_cs_dag_event_item_t * a_event_item)
 {
     dap_chain_datum_t *l_datum = (dap_chain_datum_t*) dap_chain_cs_dag_event_get_datum(a_event_item->event, a_event_item->event_size);
-    pthread_rwlock_t * l_events_rwlock = &PVT(a_dag)->events_rwlock;
     switch (l_datum->header.type_id) {
         case DAP_CHAIN_DATUM_TOKEN_DECL: {
             dap_chain_datum_token_t *l_token = (dap_chain_datum_token_t*) l_datum->data;
@@ -372,7 +641,7 @@ static int s_dap_chain_add_atom_to_ledger(dap_chain_cs_dag_t * a_dag, dap_ledger
             unsigned l_hash_item_hashv;
             HASH_VALUE(&l_tx_hash, sizeof(l_tx_hash), l_hash_item_hashv);
             dap_chain_cs_dag_event_item_t *l_tx_event;
-            int l_err = pthread_rwlock_wrlock(l_events_rwlock);
+            pthread_rwlock_wrlock(&PVT(a_dag)->tx_events_rwlock);
             HASH_FIND_BYHASHVALUE(hh, PVT(a_dag)->tx_events, &l_tx_hash, sizeof(l_tx_event->hash),
                                   l_hash_item_hashv, l_tx_event);
             if (!l_tx_event) {
@@ -384,8 +653,7 @@ static int s_dap_chain_add_atom_to_ledger(dap_chain_cs_dag_t * a_dag, dap_ledger
                 HASH_ADD_BYHASHVALUE(hh, PVT(a_dag)->tx_events, hash, sizeof(l_tx_event->hash),
                                      l_hash_item_hashv, l_tx_event);
             }
-            if (l_err != EDEADLK)
-                pthread_rwlock_unlock(l_events_rwlock);
+            pthread_rwlock_unlock(&PVT(a_dag)->tx_events_rwlock);
             return l_ret == 1 ? 0 : l_ret;
         }
         case DAP_CHAIN_DATUM_CA:
@@ -432,7 +700,7 @@ static dap_chain_atom_verify_res_t s_chain_callback_atom_add(dap_chain_t * a_cha
     dap_chain_cs_dag_event_t * l_event = (dap_chain_cs_dag_event_t *) a_atom;
 
     dap_chain_cs_dag_event_item_t * l_event_item = DAP_NEW_Z(dap_chain_cs_dag_event_item_t);
-    pthread_rwlock_t * l_events_rwlock = &PVT(l_dag)->events_rwlock;
+    dap_chain_cs_dag_pvt_t * l_dag_pvt = PVT(l_dag);
     l_event_item->event = l_event;
     l_event_item->event_size = a_atom_size;
     l_event_item->ts_added = time(NULL);
@@ -447,11 +715,13 @@ static dap_chain_atom_verify_res_t s_chain_callback_atom_add(dap_chain_t * a_cha
         log_it(L_DEBUG, "Processing event: %s... (size %zd)", l_event_hash_str,a_atom_size);
     }
 
-    pthread_rwlock_rdlock(l_events_rwlock);
-    // check if we already have this event
-    dap_chain_atom_verify_res_t ret = s_dap_chain_check_if_event_is_present(PVT(l_dag)->events, &l_event_item->hash) ||
-            s_dap_chain_check_if_event_is_present(PVT(l_dag)->events_treshold, &l_event_item->hash) ? ATOM_PASS : ATOM_ACCEPT;
-    pthread_rwlock_unlock(l_events_rwlock);
+    // check if we already have this event, both locks are held to not miss it moving from threshold to events
+    pthread_rwlock_rdlock(&l_dag_pvt->treshold_rwlock);
+    pthread_rwlock_rdlock(&l_dag_pvt->events_rwlock);
+    dap_chain_atom_verify_res_t ret = s_dap_chain_check_if_event_is_present(l_dag_pvt->events, &l_event_item->hash) ||
+            s_dap_chain_check_if_event_is_present(l_dag_pvt->events_treshold, &l_event_item->hash) ? ATOM_PASS : ATOM_ACCEPT;
+    pthread_rwlock_unlock(&l_dag_pvt->events_rwlock);
+    pthread_rwlock_unlock(&l_dag_pvt->treshold_rwlock);
 
     // verify hashes and consensus
     switch (ret) {
@@ -474,18 +744,23 @@ static dap_chain_atom_verify_res_t s_chain_callback_atom_add(dap_chain_t * a_cha
 
     switch (ret) {
     case ATOM_MOVE_TO_THRESHOLD:
-        pthread_rwlock_wrlock(l_events_rwlock);
-        HASH_ADD(hh, PVT(l_dag)->events_treshold, hash, sizeof(l_event_item->hash), l_event_item);
-        pthread_rwlock_unlock(l_events_rwlock);
+        pthread_rwlock_wrlock(&l_dag_pvt->treshold_rwlock);
+        s_dag_treshold_add(l_dag, l_event_item);
+        pthread_rwlock_unlock(&l_dag_pvt->treshold_rwlock);
         if(s_debug_more)
             log_it(L_DEBUG, "... added to threshold");
         break;
     case ATOM_ACCEPT: {
         int l_consensus_check = s_dap_chain_add_atom_to_events_table(l_dag, a_chain->ledger, l_event_item);
-        pthread_rwlock_wrlock(l_events_rwlock);
-        HASH_ADD(hh, PVT(l_dag)->events,hash, sizeof(l_event_item->hash), l_event_item);
+        pthread_rwlock_wrlock(&l_dag_pvt->events_rwlock);
+        HASH_ADD(hh, l_dag_pvt->events,hash, sizeof(l_event_item->hash), l_event_item);
+        pthread_rwlock_unlock(&l_dag_pvt->events_rwlock);
+        pthread_rwlock_wrlock(&l_dag_pvt->events_lasts_rwlock);
         s_dag_events_lasts_process_new_last_event(l_dag, l_event_item);
-        pthread_rwlock_unlock(l_events_rwlock);
+        pthread_rwlock_unlock(&l_dag_pvt->events_lasts_rwlock);
+        pthread_rwlock_wrlock(&l_dag_pvt->treshold_rwlock);
+        s_dag_treshold_resolve(l_dag, &l_event_item->hash);
+        pthread_rwlock_unlock(&l_dag_pvt->treshold_rwlock);
         switch (l_consensus_check) {
         case 0:
             if(s_debug_more)
@@ -545,8 +820,9 @@ static size_t s_chain_callback_datums_pool_proc(dap_chain_t * a_chain, dap_chain
     dap_chain_cs_dag_t * l_dag = DAP_CHAIN_CS_DAG(a_chain);
     size_t l_datum_processed =0;
     size_t l_events_round_new_size = 0;
-    // Load current events new round pool
-    dap_global_db_obj_t * l_events_round_new = dap_chain_global_db_gr_load(l_dag->gdb_group_events_round_new, &l_events_round_new_size );
+    // Current events new round pool hashes
+    dap_chain_hash_fast_t * l_events_round_new = s_dag_round_hashes_get(l_dag, &l_events_round_new_size);
+    size_t l_events_round_linked = 0;
     // Prepare hashes
     size_t l_hashes_int_size = min(l_events_round_new_size + a_datums_count, l_dag->datum_add_hashes_count);
 //            ( l_events_round_new_size + a_datums_count ) > l_dag->datum_add_hashes_count ?
@@ -582,57 +858,30 @@ static size_t s_chain_callback_datums_pool_proc(dap_chain_t * a_chain, dap_chain
 
         // Prepare round
         if ( l_hashes_int_size && l_events_round_new_size){
-            // Linking randomly with current new round set
-            size_t l_rnd_steps;
-            // Linking events inside round
-            l_rnd_steps = 0;
-            do{
-                int l_index = rand() % (int) l_events_round_new_size;
+            // Linking randomly with current new round set, partial shuffle picks distinct events
+            while (l_events_round_linked < l_events_round_new_size && l_hashes_linked < l_hashes_int_size) {
+                size_t l_index = l_events_round_linked + (size_t)rand() % (l_events_round_new_size - l_events_round_linked);
                 dap_chain_hash_fast_t l_hash;
-                // dap_chain_cs_dag_event_t * l_event = (dap_chain_cs_dag_event_t *) l_events_round_new[l_index].value;
-                // size_t l_event_size = l_events_round_new[l_index].value_len;
-                dap_chain_cs_dag_event_t * l_event = (dap_chain_cs_dag_event_t *)
-                                ((dap_chain_cs_dag_event_round_item_t *)l_events_round_new[l_index].value)->event;
-                size_t l_event_size = ((dap_chain_cs_dag_event_round_item_t *)l_events_round_new[l_index].value)->event_size;
-                dap_hash_fast(l_event, l_event_size,&l_hash);
-
-                bool l_is_already_in_event = false;
-                for (uint16_t i=0; i<l_hashes_linked;i++ ){ // check if we already added it
-                    if (l_hashes && memcmp(&l_hashes[i],&l_hash,sizeof (l_hash) )==0 ){
-                        l_is_already_in_event = true;
-                        break;
-                    }
-                }
-
-                if ( ! l_is_already_in_event ){
-                    if(l_hashes_linked < l_hashes_size) {
-                        memcpy(&l_hashes[l_hashes_linked], &l_hash, sizeof(l_hash));
-                        l_hashes_linked++;
-                    }
-                }
-                l_rnd_steps++;
-                if (l_rnd_steps > 100) // Too many attempts
-                    break;
-            } while (l_hashes_linked <(l_events_round_new_size) );
-
-            // Check if we have enought hash links
-            if (l_hashes_linked<l_events_round_new_size ){
-                log_it(L_ERROR,"Can't link new events randomly for 100 attempts");
-                break;
+                memcpy(&l_hash, &l_events_round_new[l_index], sizeof(l_hash));
+                memcpy(&l_events_round_new[l_index], &l_events_round_new[l_events_round_linked], sizeof(l_hash));
+                memcpy(&l_events_round_new[l_events_round_linked], &l_hash, sizeof(l_hash));
+                l_events_round_linked++;
+                memcpy(&l_hashes[l_hashes_linked], &l_hash, sizeof(l_hash));
+                l_hashes_linked++;
             }
         }
         // Now link with ext events
         dap_chain_cs_dag_event_item_t *l_event_ext_item = NULL;
         // is_single_line - only one link inside
         if(!l_dag->is_single_line || !l_hashes_linked){
-            pthread_rwlock_rdlock(&PVT(l_dag)->events_rwlock);
+            pthread_rwlock_rdlock(&PVT(l_dag)->events_lasts_rwlock);
             if( PVT(l_dag)->events_lasts_unlinked && l_hashes_linked < l_hashes_size) { // Take then the first one if any events_lasts are present
                     l_event_ext_item = PVT(l_dag)->events_lasts_unlinked;
                     if(l_hashes)
                         memcpy(&l_hashes[l_hashes_linked], &l_event_ext_item->hash, sizeof(l_event_ext_item->hash));
                     l_hashes_linked++;
                 }
-            pthread_rwlock_unlock(&PVT(l_dag)->events_rwlock);
+            pthread_rwlock_unlock(&PVT(l_dag)->events_lasts_rwlock);
         }
 
         if (l_hashes_linked || s_seed_mode ) {
@@ -708,14 +957,14 @@ static size_t s_chain_callback_datums_pool_proc(dap_chain_t * a_chain, dap_chain
                         l_event_unlinked_item->event = l_event;
                         l_event_unlinked_item->event_size = l_event_size;
                         l_event_unlinked_item->ts_added = (time_t) l_event->header.ts_created;
-                        pthread_rwlock_wrlock(&PVT(l_dag)->events_rwlock);
+                        pthread_rwlock_wrlock(&PVT(l_dag)->events_lasts_rwlock);
                         HASH_ADD(hh, PVT(l_dag)->events_lasts_unlinked, hash, sizeof(l_event_unlinked_item->hash),
                                 l_event_unlinked_item);
                         if(l_event_ext_item) {
                             HASH_DEL(PVT(l_dag)->events_lasts_unlinked, l_event_ext_item);
                             DAP_DELETE(l_event_ext_item);
                         }
-                        pthread_rwlock_unlock(&PVT(l_dag)->events_rwlock);
+                        pthread_rwlock_unlock(&PVT(l_dag)->events_lasts_rwlock);
 
                         l_datum_processed++;
                     }else {
@@ -730,7 +979,7 @@ static size_t s_chain_callback_datums_pool_proc(dap_chain_t * a_chain, dap_chain
         }
     }
     DAP_DELETE(l_hashes);
-    dap_chain_global_db_objs_delete(l_events_round_new, l_events_round_new_size);
+    DAP_DELETE(l_events_round_new);
     return  l_datum_processed;
 }
 
@@ -911,91 +1160,155 @@ void s_dag_events_lasts_process_new_last_event(dap_chain_cs_dag_t * a_dag, dap_c
 }
 
 
-typedef enum{
-  DAP_THRESHOLD_OK = 0,
-  DAP_THRESHOLD_NO_HASHES,
-  DAP_THRESHOLD_NO_HASHES_IN_MAIN,
-  DAP_THRESHOLD_CONFLICTING
-} dap_dag_threshold_verification_res_t;
-
-int dap_chain_cs_dag_event_verify_hashes_with_treshold(dap_chain_cs_dag_t * a_dag, dap_chain_cs_dag_event_t * a_event)
+/**
+ * @brief s_dag_treshold_conflict
+ * @details Moves threshold event to the conflicted ones with all the events waiting for it. Call it under treshold_rwlock
+ * @param a_dag
+ * @param a_event_item
+ */
+static void s_dag_treshold_conflict(dap_chain_cs_dag_t *a_dag, dap_chain_cs_dag_event_item_t *a_event_item)
 {
-    bool l_is_events_all_hashes = true;
-    bool l_is_events_main_hashes = true;
+    dap_chain_cs_dag_pvt_t *l_dag_pvt = PVT(a_dag);
+    a_event_item->is_conflicted = true;
+    dap_list_t *l_conflicted = dap_list_prepend(NULL, a_event_item);
+    while (l_conflicted) {
+        dap_chain_cs_dag_event_item_t *l_event_item = (dap_chain_cs_dag_event_item_t *)l_conflicted->data;
+        l_conflicted = dap_list_delete_link(l_conflicted, l_conflicted);
+        HASH_DEL(l_dag_pvt->events_treshold, l_event_item);
+        HASH_ADD(hh, l_dag_pvt->events_treshold_conflicted, hash, sizeof(l_event_item->hash), l_event_item);
+        // Events linked to the conflicting one are conflicting too
+        dap_chain_cs_dag_treshold_link_t *l_link = NULL;
+        HASH_FIND(hh, l_dag_pvt->treshold_links, &l_event_item->hash, sizeof(l_event_item->hash), l_link);
+        if (!l_link)
+            continue;
+        for (dap_list_t *l_item = l_link->events; l_item; l_item = l_item->next) {
+            dap_chain_cs_dag_event_item_t *l_waiting = (dap_chain_cs_dag_event_item_t *)l_item->data;
+            if (!l_waiting->is_conflicted) {
+                l_waiting->is_conflicted = true;
+                l_conflicted = dap_list_prepend(l_conflicted, l_waiting);
+            }
+        }
+        HASH_DEL(l_dag_pvt->treshold_links, l_link);
+        dap_list_free(l_link->events);
+        DAP_DELETE(l_link);
+    }
+}
 
-    if (a_event->header.hash_count == 0) {
+/**
+ * @brief s_dag_treshold_add
+ * @details Puts event to threshold and indexes it by the links absent in the main events table.
+ * Call it under treshold_rwlock
+ * @param a_dag
+ * @param a_event_item
+ */
+static void s_dag_treshold_add(dap_chain_cs_dag_t *a_dag, dap_chain_cs_dag_event_item_t *a_event_item)
+{
+    dap_chain_cs_dag_pvt_t *l_dag_pvt = PVT(a_dag);
+    dap_chain_cs_dag_event_t *l_event = a_event_item->event;
+    HASH_ADD(hh, l_dag_pvt->events_treshold, hash, sizeof(a_event_item->hash), a_event_item);
+    if (l_event->header.hash_count == 0) {
         //looks like an alternative genesis event
-        return DAP_THRESHOLD_CONFLICTING;
+        s_dag_treshold_conflict(a_dag, a_event_item);
+        return;
     }
-    dap_dag_threshold_verification_res_t ret = DAP_THRESHOLD_OK;
-    for (size_t i = 0; i< a_event->header.hash_count; i++) {
-        dap_chain_hash_fast_t * l_hash =  ((dap_chain_hash_fast_t *) a_event->hashes_n_datum_n_signs) + i;
-        dap_chain_cs_dag_event_item_t * l_event_search = NULL;
-        HASH_FIND(hh, PVT(a_dag)->events_treshold_conflicted,l_hash ,sizeof (*l_hash),  l_event_search);
-        if ( l_event_search ){
-          //event is linked to event we consider conflicting
-          ret = DAP_THRESHOLD_CONFLICTING;
-          break;
+    dap_chain_hash_fast_t *l_hashes = (dap_chain_hash_fast_t *)l_event->hashes_n_datum_n_signs;
+    for (size_t i = 0; i < l_event->header.hash_count; i++) {
+        if (s_dap_chain_check_if_event_is_present(l_dag_pvt->events_treshold_conflicted, &l_hashes[i])) {
+            //event is linked to event we consider conflicting
+            s_dag_treshold_conflict(a_dag, a_event_item);
+            return;
         }
-        HASH_FIND(hh, PVT(a_dag)->events ,l_hash ,sizeof (*l_hash),  l_event_search);
-        if ( l_event_search == NULL ){ // If not found in events - search in treshhold
-            l_is_events_main_hashes = false;
-            HASH_FIND(hh, PVT(a_dag)->events_treshold ,l_hash ,sizeof (*l_hash),  l_event_search);
-            if( l_event_search == NULL ){ // Hash is not in events or treshold table, keep the current item where it is
-                l_is_events_all_hashes = false;
-                break;
-            }
+        pthread_rwlock_rdlock(&l_dag_pvt->events_rwlock);
+        bool l_is_present = s_dap_chain_check_if_event_is_present(l_dag_pvt->events, &l_hashes[i]);
+        pthread_rwlock_unlock(&l_dag_pvt->events_rwlock);
+        if (l_is_present)
+            continue;
+        bool l_is_counted = false;
+        for (size_t j = 0; j < i && !l_is_counted; j++)
+            l_is_counted = !memcmp(&l_hashes[j], &l_hashes[i], sizeof(*l_hashes));
+        if (l_is_counted)
+            continue;
+        dap_chain_cs_dag_treshold_link_t *l_link = NULL;
+        HASH_FIND(hh, l_dag_pvt->treshold_links, &l_hashes[i], sizeof(*l_hashes), l_link);
+        if (!l_link) {
+            l_link = DAP_NEW_Z(dap_chain_cs_dag_treshold_link_t);
+            memcpy(&l_link->hash, &l_hashes[i], sizeof(l_link->hash));
+            HASH_ADD(hh, l_dag_pvt->treshold_links, hash, sizeof(l_link->hash), l_link);
         }
+        l_link->events = dap_list_prepend(l_link->events, a_event_item);
+        a_event_item->links_missing++;
     }
-    if (ret == DAP_THRESHOLD_CONFLICTING)
-        return ret;
-    return l_is_events_all_hashes ?
-                (l_is_events_main_hashes ?
-                    DAP_THRESHOLD_OK :
-                DAP_THRESHOLD_NO_HASHES_IN_MAIN) :
-            DAP_THRESHOLD_NO_HASHES;
+    if (!a_event_item->links_missing)
+        DL_APPEND(l_dag_pvt->events_treshold_ready, a_event_item);
+}
+
+/**
+ * @brief s_dag_treshold_resolve
+ * @details Event is added to the main events table, so threshold events waiting only for it are ready now.
+ * Call it under treshold_rwlock
+ * @param a_dag
+ * @param a_hash
+ */
+static void s_dag_treshold_resolve(dap_chain_cs_dag_t *a_dag, dap_chain_hash_fast_t *a_hash)
+{
+    dap_chain_cs_dag_pvt_t *l_dag_pvt = PVT(a_dag);
+    dap_chain_cs_dag_treshold_link_t *l_link = NULL;
+    HASH_FIND(hh, l_dag_pvt->treshold_links, a_hash, sizeof(*a_hash), l_link);
+    if (!l_link)
+        return;
+    for (dap_list_t *l_item = l_link->events; l_item; l_item = l_item->next) {
+        dap_chain_cs_dag_event_item_t *l_waiting = (dap_chain_cs_dag_event_item_t *)l_item->data;
+        if (!l_waiting->is_conflicted && !--l_waiting->links_missing)
+            DL_APPEND(l_dag_pvt->events_treshold_ready, l_waiting);
+    }
+    HASH_DEL(l_dag_pvt->treshold_links, l_link);
+    dap_list_free(l_link->events);
+    DAP_DELETE(l_link);
 }
 
 /**
  * @brief dap_chain_cs_dag_proc_treshold
+ * @details Adds the first threshold event with all links present. Its dependents that become complete
+ * are queued after it, so repeated calls add threshold events in topological order
  * @param a_dag
- * @returns true if some atoms were moved from threshold to events
+ * @returns event item moved from threshold to events or NULL if there are no ready ones
  */
 dap_chain_cs_dag_event_item_t* dap_chain_cs_dag_proc_treshold(dap_chain_cs_dag_t * a_dag, dap_ledger_t * a_ledger)
 {
-    bool res = false;
-    dap_chain_cs_dag_event_item_t * l_event_item = NULL, * l_event_item_tmp = NULL;
-    pthread_rwlock_wrlock(&PVT(a_dag)->events_rwlock);
-    // !!!
-    int l_count = HASH_COUNT(PVT(a_dag)->events_treshold);
-    log_it(L_DEBUG, "*** %d events in threshold", l_count);
-    HASH_ITER(hh, PVT(a_dag)->events_treshold, l_event_item, l_event_item_tmp) {
-        dap_dag_threshold_verification_res_t ret = dap_chain_cs_dag_event_verify_hashes_with_treshold(a_dag, l_event_item->event);
-        if (ret == DAP_THRESHOLD_OK) {
-            if (s_debug_more) {
-                char * l_event_hash_str = dap_chain_hash_fast_to_str_new(&l_event_item->hash);
-                log_it(L_DEBUG, "Processing event (threshold): %s...", l_event_hash_str);
-                DAP_DELETE(l_event_hash_str);
-            }
-            int l_add_res = s_dap_chain_add_atom_to_events_table(a_dag, a_ledger, l_event_item);
-            HASH_DEL(PVT(a_dag)->events_treshold, l_event_item);
-            HASH_ADD(hh, PVT(a_dag)->events, hash, sizeof(l_event_item->hash), l_event_item);
-            s_dag_events_lasts_process_new_last_event(a_dag, l_event_item);
-            res = true;
-            if(s_debug_more) {
-                if (!l_add_res)
-                    log_it(L_INFO, "... moved from treshold to main chains");
-                else
-                    log_it(L_WARNING, "... moved with ledger code %d", l_add_res);
-            }
-            break;
-        } else if (ret == DAP_THRESHOLD_CONFLICTING) {
-            HASH_DEL(PVT(a_dag)->events_treshold, l_event_item);
-            HASH_ADD(hh, PVT(a_dag)->events_treshold_conflicted, hash, sizeof (l_event_item->hash), l_event_item);
-        }
+    dap_chain_cs_dag_pvt_t *l_dag_pvt = PVT(a_dag);
+    pthread_rwlock_wrlock(&l_dag_pvt->treshold_rwlock);
+    dap_chain_cs_dag_event_item_t * l_event_item = l_dag_pvt->events_treshold_ready;
+    if (s_debug_more)
+        log_it(L_DEBUG, "*** %u events in threshold", HASH_COUNT(l_dag_pvt->events_treshold));
+    if (l_event_item)
+        DL_DELETE(l_dag_pvt->events_treshold_ready, l_event_item);
+    pthread_rwlock_unlock(&l_dag_pvt->treshold_rwlock);
+    if (!l_event_item)
+        return NULL;
+    if (s_debug_more) {
+        char * l_event_hash_str = dap_chain_hash_fast_to_str_new(&l_event_item->hash);
+        log_it(L_DEBUG, "Processing event (threshold): %s...", l_event_hash_str);
+        DAP_DELETE(l_event_hash_str);
     }
-    pthread_rwlock_unlock(&PVT(a_dag)->events_rwlock);
-    return res ? l_event_item : NULL;
+    // Event stays in threshold table while ledger processes it, so duplicates are still recognized
+    int l_add_res = s_dap_chain_add_atom_to_events_table(a_dag, a_ledger, l_event_item);
+    pthread_rwlock_wrlock(&l_dag_pvt->treshold_rwlock);
+    pthread_rwlock_wrlock(&l_dag_pvt->events_rwlock);
+    HASH_DEL(l_dag_pvt->events_treshold, l_event_item);
+    HASH_ADD(hh, l_dag_pvt->events, hash, sizeof(l_event_item->hash), l_event_item);
+    pthread_rwlock_unlock(&l_dag_pvt->events_rwlock);
+    pthread_rwlock_wrlock(&l_dag_pvt->events_lasts_rwlock);
+    s_dag_events_lasts_process_new_last_event(a_dag, l_event_item);
+    pthread_rwlock_unlock(&l_dag_pvt->events_lasts_rwlock);
+    s_dag_treshold_resolve(a_dag, &l_event_item->hash);
+    pthread_rwlock_unlock(&l_dag_pvt->treshold_rwlock);
+    if(s_debug_more) {
+        if (!l_add_res)
+            log_it(L_INFO, "... moved from treshold to main chains");
+        else
+            log_it(L_WARNING, "... moved with ledger code %d", l_add_res);
+    }
+    return l_event_item;
 }
 
 /**
@@ -1026,10 +1339,13 @@ static dap_chain_atom_iter_t* s_chain_callback_atom_iter_create_from(dap_chain_t
         dap_chain_hash_fast_t l_atom_hash;
         dap_hash_fast(a_atom, a_atom_size, &l_atom_hash );
 
+        dap_chain_cs_dag_pvt_t *l_dag_pvt = PVT(DAP_CHAIN_CS_DAG(a_chain));
         dap_chain_cs_dag_event_item_t  * l_atom_item;
-        HASH_FIND(hh, PVT(DAP_CHAIN_CS_DAG(a_chain))->events, &l_atom_hash, sizeof(l_atom_hash),l_atom_item );
+        pthread_rwlock_rdlock(&l_dag_pvt->events_rwlock);
+        HASH_FIND(hh, l_dag_pvt->events, &l_atom_hash, sizeof(l_atom_hash),l_atom_item );
+        pthread_rwlock_unlock(&l_dag_pvt->events_rwlock);
         l_atom_iter->cur_item = l_atom_item;
-        l_atom_iter->cur_hash = &l_atom_item->hash;
+        l_atom_iter->cur_hash = l_atom_item ? &l_atom_item->hash : NULL;
     }
     return l_atom_iter;
 
@@ -1037,6 +1353,9 @@ static dap_chain_atom_iter_t* s_chain_callback_atom_iter_create_from(dap_chain_t
 
 /**
  * @brief s_chain_callback_atom_iter_create Create atomic element iterator
+ * @details Iterator holds no lock between calls. Events are appended to the end of iteration order
+ * and their items aren't freed while the chain is alive, so each step locks events table only to
+ * read the next item and long iterations don't block events insertion
  * @param a_chain
  * @return
  */
@@ -1044,7 +1363,6 @@ static dap_chain_atom_iter_t* s_chain_callback_atom_iter_create(dap_chain_t * a_
 {
     dap_chain_atom_iter_t * l_atom_iter = DAP_NEW_Z(dap_chain_atom_iter_t);
     l_atom_iter->chain = a_chain;
-    pthread_rwlock_rdlock(&a_chain->atoms_rwlock);
 #ifdef WIN32
     log_it(L_DEBUG, "! Create caller id %lu", GetThreadId(GetCurrentThread()));
 #endif
@@ -1088,7 +1406,9 @@ static dap_chain_atom_ptr_t s_chain_callback_atom_iter_get_first(dap_chain_atom_
     assert(l_dag);
     dap_chain_cs_dag_pvt_t *l_dag_pvt = PVT(l_dag);
     assert(l_dag_pvt);
+    pthread_rwlock_rdlock(&l_dag_pvt->events_rwlock);
     a_atom_iter->cur_item = l_dag_pvt->events;
+    pthread_rwlock_unlock(&l_dag_pvt->events_rwlock);
     if ( a_atom_iter->cur_item ){
         a_atom_iter->cur = ((dap_chain_cs_dag_event_item_t*) a_atom_iter->cur_item)->event;
         a_atom_iter->cur_size = ((dap_chain_cs_dag_event_item_t*) a_atom_iter->cur_item)->event_size;
@@ -1115,7 +1435,7 @@ static dap_chain_atom_ptr_t* s_chain_callback_atom_iter_get_lasts( dap_chain_ato
 {
     dap_chain_cs_dag_t * l_dag = DAP_CHAIN_CS_DAG( a_atom_iter->chain );
     dap_chain_atom_ptr_t * l_ret = NULL;
-    pthread_rwlock_rdlock(&PVT(l_dag)->events_rwlock);
+    pthread_rwlock_rdlock(&PVT(l_dag)->events_lasts_rwlock);
     size_t l_lasts_size = HASH_COUNT( PVT(l_dag)->events_lasts_unlinked );
     if ( l_lasts_size > 0 ) {
         if( a_lasts_size)
@@ -1130,7 +1450,7 @@ static dap_chain_atom_ptr_t* s_chain_callback_atom_iter_get_lasts( dap_chain_ato
             i++;
         }
     }
-    pthread_rwlock_unlock(&PVT(l_dag)->events_rwlock);
+    pthread_rwlock_unlock(&PVT(l_dag)->events_lasts_rwlock);
     return l_ret;
 }
 
@@ -1219,9 +1539,9 @@ static dap_chain_datum_tx_t* s_chain_callback_atom_find_by_tx_hash(dap_chain_t *
 {
     dap_chain_cs_dag_t * l_dag = DAP_CHAIN_CS_DAG( a_chain );
     dap_chain_cs_dag_event_item_t * l_event_item = NULL;
-    pthread_rwlock_rdlock(&PVT(l_dag)->events_rwlock);
+    pthread_rwlock_rdlock(&PVT(l_dag)->tx_events_rwlock);
     HASH_FIND(hh, PVT(l_dag)->tx_events, a_tx_hash, sizeof(*a_tx_hash), l_event_item);
-    pthread_rwlock_unlock(&PVT(l_dag)->events_rwlock);
+    pthread_rwlock_unlock(&PVT(l_dag)->tx_events_rwlock);
     if ( l_event_item ){
         dap_chain_datum_t *l_datum = dap_chain_cs_dag_event_get_datum(l_event_item->event, l_event_item->event_size);
         return l_datum ? l_datum->header.data_size ? (dap_chain_datum_tx_t*) l_datum->data : NULL :NULL;
@@ -1237,9 +1557,11 @@ static dap_chain_datum_tx_t* s_chain_callback_atom_find_by_tx_hash(dap_chain_t *
 static dap_chain_atom_ptr_t s_chain_callback_atom_iter_get_next( dap_chain_atom_iter_t * a_atom_iter,size_t * a_atom_size )
 {
     if (a_atom_iter->cur ){
-        //dap_chain_cs_dag_pvt_t* l_dag_pvt = PVT(DAP_CHAIN_CS_DAG(a_atom_iter->chain));
+        dap_chain_cs_dag_pvt_t* l_dag_pvt = PVT(DAP_CHAIN_CS_DAG(a_atom_iter->chain));
         dap_chain_cs_dag_event_item_t * l_event_item = (dap_chain_cs_dag_event_item_t*) a_atom_iter->cur_item;
+        pthread_rwlock_rdlock(&l_dag_pvt->events_rwlock);
         a_atom_iter->cur_item = l_event_item->hh.next;
+        pthread_rwlock_unlock(&l_dag_pvt->events_rwlock);
         l_event_item = (dap_chain_cs_dag_event_item_t*) a_atom_iter->cur_item;
         // if l_event_item=NULL then items are over
         a_atom_iter->cur = l_event_item ? l_event_item->event : NULL;
@@ -1259,7 +1581,6 @@ static dap_chain_atom_ptr_t s_chain_callback_atom_iter_get_next( dap_chain_atom_
  */
 static void s_chain_callback_atom_iter_delete(dap_chain_atom_iter_t * a_atom_iter )
 {
-    pthread_rwlock_unlock(&a_atom_iter->chain->atoms_rwlock);
 #ifdef WIN32
     log_it(L_DEBUG, "! Delete caller id %lu", GetThreadId(GetCurrentThread()));
 #endif
@@ -1364,8 +1685,9 @@ static int s_cli_dag(int argc, char ** argv, char **a_str_reply)
             }
             log_it(L_NOTICE,"Round complete command accepted, forming new events");
 
+            // Events are taken by the keys of the round state, the whole group isn't loaded
             size_t l_objs_size=0;
-            dap_global_db_obj_t * l_objs = dap_chain_global_db_gr_load(l_dag->gdb_group_events_round_new,&l_objs_size);
+            dap_chain_cs_dag_round_event_info_t *l_objs = s_dag_round_events_get_all(l_dag, &l_objs_size);
 
             dap_string_t *l_str_ret_tmp= l_objs_size>0 ? dap_string_new("Completing round:\n") : dap_string_new("Completing round: no data");
 
@@ -1374,18 +1696,24 @@ static int s_cli_dag(int argc, char ** argv, char **a_str_reply)
 
             // Check if its ready or not
             for (size_t i = 0; i< l_objs_size; i++ ){
-                // dap_chain_cs_dag_event_t * l_event = (dap_chain_cs_dag_event_t*) l_objs[i].value;
-                // size_t l_event_size = l_objs[i].value_len;
-                dap_chain_cs_dag_event_t * l_event = (dap_chain_cs_dag_event_t *)
-                                ((dap_chain_cs_dag_event_round_item_t *)l_objs[i].value)->event;
-                size_t l_event_size = ((dap_chain_cs_dag_event_round_item_t *)l_objs[i].value)->event_size;
-                l_dag->callback_cs_set_event_round_cfg(l_dag, &((dap_chain_cs_dag_event_round_item_t *)l_objs[i].value)->cfg);
+                size_t l_round_item_size = 0;
+                dap_chain_cs_dag_event_round_item_t *l_round_item = (dap_chain_cs_dag_event_round_item_t *)
+                        dap_chain_global_db_gr_get(l_objs[i].key, &l_round_item_size, l_dag->gdb_group_events_round_new);
+                if (!l_round_item || l_round_item_size < sizeof(*l_round_item)
+                        || l_round_item_size < dap_chain_cs_dag_event_round_item_get_size(l_round_item)) {
+                    DAP_DEL_Z(l_round_item);
+                    continue; // Removed from the round in the meantime
+                }
+                dap_chain_cs_dag_event_t * l_event = (dap_chain_cs_dag_event_t *)l_round_item->event;
+                size_t l_event_size = l_round_item->event_size;
+                l_dag->callback_cs_set_event_round_cfg(l_dag, &l_round_item->cfg);
                 int l_ret_event_verify;
                 if ( ( l_ret_event_verify = l_dag->callback_cs_verify (l_dag,l_event,l_event_size) ) !=0 ){// if consensus accept the event
                     dap_string_append_printf( l_str_ret_tmp,
                             "Error! Event %s is not passing consensus verification, ret code %d\n",
                                               l_objs[i].key, l_ret_event_verify );
                     ret = -30;
+                    DAP_DELETE(l_round_item);
                     break;
                 }else {
                     dap_string_append_printf( l_str_ret_tmp, "Event %s verification passed\n", l_objs[i].key);
@@ -1405,6 +1733,7 @@ static int s_cli_dag(int argc, char ** argv, char **a_str_reply)
                         }
                     }
                 }
+                DAP_DELETE(l_round_item);
             }
             // write events to file and delete events from db
             if(l_list_to_del) {
@@ -1430,7 +1759,7 @@ static int s_cli_dag(int argc, char ** argv, char **a_str_reply)
             }
 
             // Cleaning up
-            dap_chain_global_db_objs_delete(l_objs, l_objs_size);
+            DAP_DEL_Z(l_objs);
             dap_chain_node_cli_set_reply_text(a_str_reply,l_str_ret_tmp->str);
             dap_string_free(l_str_ret_tmp,false);
 
@@ -1604,9 +1933,9 @@ static int s_cli_dag(int argc, char ** argv, char **a_str_reply)
 
                     }else if ( strcmp(l_from_events_str,"events_lasts") == 0){
                         dap_chain_cs_dag_event_item_t * l_event_item = NULL;
-                        pthread_rwlock_rdlock(&PVT(l_dag)->events_rwlock);
+                        pthread_rwlock_rdlock(&PVT(l_dag)->events_lasts_rwlock);
                         HASH_FIND(hh,PVT(l_dag)->events_lasts_unlinked,&l_event_hash,sizeof(l_event_hash),l_event_item);
-                        pthread_rwlock_unlock(&PVT(l_dag)->events_rwlock);
+                        pthread_rwlock_unlock(&PVT(l_dag)->events_lasts_rwlock);
                         if ( l_event_item )
                             l_event = l_event_item->event;
                         else {
@@ -1806,7 +2135,9 @@ static int s_cli_dag(int argc, char ** argv, char **a_str_reply)
 
 static size_t s_dap_chain_callback_get_count_tx(dap_chain_t *a_chain){
     dap_chain_cs_dag_t *l_dag = DAP_CHAIN_CS_DAG(a_chain);
+    pthread_rwlock_rdlock(&PVT(l_dag)->tx_events_rwlock);
     size_t l_count = HASH_COUNT(PVT(l_dag)->tx_events);
+    pthread_rwlock_unlock(&PVT(l_dag)->tx_events_rwlock);
     return l_count;
 }
 static dap_list_t *s_dap_chain_callback_get_txs(dap_chain_t *a_chain, size_t a_count, size_t a_page){
@@ -1821,6 +2152,7 @@ static dap_list_t *s_dap_chain_callback_get_txs(dap_chain_t *a_chain, size_t a_c
     dap_list_t *l_list = NULL;
     size_t l_counter = 0;
     size_t l_end = l_offset + a_count;
+    pthread_rwlock_rdlock(&PVT(l_dag)->tx_events_rwlock);
     for (dap_chain_cs_dag_event_item_t *ptr = PVT(l_dag)->tx_events; ptr != NULL && l_counter < l_end; ptr = ptr->hh.next){
         if (l_counter >= l_offset){
             dap_chain_datum_t *l_datum = dap_chain_cs_dag_event_get_datum(ptr->event, ptr->event_size);
@@ -1829,6 +2161,7 @@ static dap_list_t *s_dap_chain_callback_get_txs(dap_chain_t *a_chain, size_t a_c
         }
         l_counter++;
     }
+    pthread_rwlock_unlock(&PVT(l_dag)->tx_events_rwlock);
     return l_list;
 }
 
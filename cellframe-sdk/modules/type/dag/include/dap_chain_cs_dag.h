@@ -42,6 +42,16 @@ typedef void (*dap_chain_cs_dag_callback_set_event_round_cfg_t)(dap_chain_cs_dag
 typedef int (*dap_chain_cs_dag_callback_event_round_sync_t)(dap_chain_cs_dag_t * a_dag, const char a_op_code, const char *a_group,
                                                 const char *a_key, const void *a_value, const size_t a_value_size);
 
+/**
+ * @brief Cached state of the event in the new round
+ */
+typedef struct dap_chain_cs_dag_round_event_info {
+    char key[DAP_CHAIN_HASH_FAST_STR_SIZE]; // Event key in the new round group
+    dap_chain_hash_fast_t hash;
+    uint16_t signs_count;
+    uint64_t ts_update;
+} dap_chain_cs_dag_round_event_info_t;
+
 typedef struct dap_chain_cs_dag_hal_item {
     dap_chain_hash_fast_t hash;
     UT_hash_handle hh;
@@ -87,3 +97,5 @@ void dap_chain_cs_dag_proc_event_round_new(dap_chain_cs_dag_t *a_dag);
 
 dap_chain_cs_dag_event_t* dap_chain_cs_dag_find_event_by_hash(dap_chain_cs_dag_t * a_dag,
                                                               dap_chain_hash_fast_t * a_hash);
+dap_chain_cs_dag_round_event_info_t *dap_chain_cs_dag_round_events_get(dap_chain_cs_dag_t *a_dag, const char *a_key,
+                                                                        size_t *a_events_count);
@@ -43,6 +43,14 @@ listen_port={NOTIFY_SRV_PORT}
 #preferred_encryption=SALSA2012 
 # Debug stream protocol
 #debug=true
+# Offer zstd compression of stream packets to the remote side (needs build with BUILD_WITH_ZSTD),
+# packets smaller than threshold are sent as is
+#compress=false
+#compress_threshold=256
+#compress_level=1
+# Dictionary trained with "zstd --train" on channel traffic, it's used only if the remote side has the same one
+#compress_dict={PREFIX}/share/stream.dict
+#compress_dict_channels=C
 
 # Build in DNS client (need for bootstraping)
 [dns_client]
@@ -57,6 +65,20 @@ listen_port={NOTIFY_SRV_PORT}
 [ledger]
 # More debug output
 # debug_more=true
+# Max items waiting for missing parents, the oldest are evicted on overflow
+# treshold_txs_max=10000
+# treshold_emissions_max=1000
+
+# Chain files loading
+[chain]
+# Threads preparing atoms while they are loaded in order, 0 means by CPU count
+# load_threads=0
+# Sync appended atoms to disk after so many atoms and/or milliseconds, 0 is off
+# sync_atoms=0
+# sync_period_ms=0
+# Write new and rewritten cell files compressed with zstd (needs build with BUILD_WITH_ZSTD)
+# cell_compress=false
+# cell_compress_level=3
 
 # DAG defaults
 [dag]
@@ -51,6 +51,7 @@
 #include "dap_enc_ks.h"
 #include "dap_enc_http.h"
 #include "dap_chain.h"
+#include "dap_chain_cell.h"
 #include "dap_chain_wallet.h"
 
 #include "dap_cert.h"
@@ -365,6 +366,19 @@ int main(int argc, const char **argv)
      s_help();
      exit(-1000);
    }
+ } else if (strcmp(argv[1], "cell") == 0) {
+   // cell convert <src cell file> <dst cell file> raw|compressed
+   if (argc < 6 || strcmp(argv[2], "convert") || (strcmp(argv[5], "raw") && strcmp(argv[5], "compressed"))) {
+     log_it(L_ERROR, "Wrong 'cell' command params");
+     s_help();
+     exit(-4000);
+   }
+   int l_count = dap_chain_cell_file_convert(argv[3], argv[4], !strcmp(argv[5], "compressed"));
+   if (l_count < 0) {
+     log_it(L_ERROR, "Can't convert cell file \"%s\", code %d", argv[3], l_count);
+     exit(-4001);
+   }
+   log_it(L_INFO, "Converted %d atoms to \"%s\"\n", l_count, argv[4]);
  }else {
    log_it(L_ERROR,"Wrong params");
    s_help();
@@ -456,4 +470,7 @@ static void s_help()
 
     printf(" * Add metadata item to <cert name>\n");
     printf("\t%s cert add_metadata <cert name> <key:type:length:value>\n\n", l_tool_appname);
+
+    printf(" * Convert cell file to raw or compressed format, node must be stopped\n");
+    printf("\t%s cell convert <src cell file> <dst cell file> raw|compressed\n\n", l_tool_appname);
 }
@@ -10,6 +10,9 @@
 #include "dap_global_db_test.h"
 
 #define DB_FILE "./base.tmp"
+// no '_' in the name, sqlite keeps groups as tables with '.' replaced by '_'
+#define CONFORMANCE_GROUP "local.conformance"
+#define CONFORMANCE_COUNT 10
 
 static void test_create_db(const char *db_type)
 {
@@ -27,6 +30,19 @@ static void test_create_db(const char *db_type)
     dap_assert(!res, l_str);
     DAP_DELETE(l_str);
 }
+/**
+ * @brief Adds copies of records, the driver takes ownership of key and value
+ */
+static int s_driver_add_copy(dap_store_obj_t *a_store_obj, size_t a_store_count)
+{
+    dap_store_obj_t *l_store_obj = dap_store_obj_copy(a_store_obj, a_store_count);
+    int l_ret = dap_chain_global_db_driver_add(l_store_obj, a_store_count);
+    for(size_t i = 0; i < a_store_count; i++)
+        DAP_DELETE(l_store_obj[i].group);
+    DAP_DELETE(l_store_obj);
+    return l_ret;
+}
+
 static void test_write_read_one(void)
 {
     dap_store_obj_t *l_store_obj = DAP_NEW_Z(dap_store_obj_t);
@@ -35,12 +51,12 @@ static void test_write_read_one(void)
     l_store_obj->key = dap_strdup("key");
     l_store_obj->group = dap_strdup("section.1");
     l_store_obj->timestamp = time(NULL);
-    l_store_obj->value_len = rand() % 100;
+    l_store_obj->value_len = 1 + rand() % 100;
     l_store_obj->value = DAP_NEW_SIZE(uint8_t, l_store_obj->value_len);
     for(size_t i = 0; i < l_store_obj->value_len; i++) {
         l_store_obj->value[i] = rand();
     }
-    int ret = dap_chain_global_db_driver_add(l_store_obj, l_store_count);
+    int ret = s_driver_add_copy(l_store_obj, l_store_count);
 
     dap_store_obj_t *l_store_obj2 = dap_chain_global_db_driver_read(l_store_obj->group, l_store_obj->key, NULL);
 
@@ -64,6 +80,100 @@ static void test_write_read_one(void)
 
 }
 
+/**
+ * @brief Applies one record, the driver takes ownership of key and value
+ */
+static int s_conformance_apply(char a_type, const char *a_key, const char *a_value)
+{
+    dap_store_obj_t l_obj = {
+        .type = a_type,
+        .group = CONFORMANCE_GROUP,
+        .key = dap_strdup(a_key),
+        .timestamp = time(NULL),
+        .value = a_value ? (uint8_t*) dap_strdup(a_value) : NULL,
+        .value_len = a_value ? strlen(a_value) + 1 : 0
+    };
+    return a_type == 'a' ? dap_chain_global_db_driver_add(&l_obj, 1) : dap_chain_global_db_driver_delete(&l_obj, 1);
+}
+
+static bool s_conformance_check(dap_store_obj_t *a_obj, const char *a_key, const char *a_value)
+{
+    return a_obj && !dap_strcmp(a_obj->key, a_key) && a_obj->value_len == strlen(a_value) + 1
+            && !memcmp(a_obj->value, a_value, a_obj->value_len);
+}
+
+/**
+ * @brief The same checks for every driver: the contract of dap_db_driver_callbacks_t
+ */
+static void test_conformance(const char *a_db_type)
+{
+    char l_key[32], l_value[32];
+    // clean group, ids start anew
+    s_conformance_apply('d', NULL, NULL);
+    for(int i = 0; i < CONFORMANCE_COUNT; i++) {
+        dap_snprintf(l_key, sizeof(l_key), "key_%d", i);
+        dap_snprintf(l_value, sizeof(l_value), "value_%d", i);
+        dap_assert_PIF(!s_conformance_apply('a', l_key, l_value), "Add record");
+    }
+    for(int i = 0; i < CONFORMANCE_COUNT; i++) {
+        dap_snprintf(l_key, sizeof(l_key), "key_%d", i);
+        dap_snprintf(l_value, sizeof(l_value), "value_%d", i);
+        dap_store_obj_t *l_obj = dap_chain_global_db_driver_read(CONFORMANCE_GROUP, l_key, NULL);
+        dap_assert_PIF(s_conformance_check(l_obj, l_key, l_value), "Read record by key");
+        dap_assert_PIF(dap_chain_global_db_driver_is(CONFORMANCE_GROUP, l_key), "Record is present");
+        dap_store_obj_free(l_obj, 1);
+    }
+    dap_assert_PIF(dap_chain_global_db_driver_count(CONFORMANCE_GROUP, 0) == CONFORMANCE_COUNT, "Count records");
+
+    // whole group and the tail from some id, both ordered by id
+    size_t l_count = 0;
+    dap_store_obj_t *l_objs = dap_chain_global_db_driver_read(CONFORMANCE_GROUP, NULL, &l_count);
+    dap_assert_PIF(l_objs && l_count == CONFORMANCE_COUNT, "Read whole group");
+    for(size_t i = 1; i < l_count; i++)
+        dap_assert_PIF(l_objs[i].id > l_objs[i - 1].id, "Records are ordered by id");
+    uint64_t l_id_half = l_objs[CONFORMANCE_COUNT / 2].id;
+    dap_store_obj_free(l_objs, l_count);
+    l_count = 0;
+    l_objs = dap_chain_global_db_driver_cond_read(CONFORMANCE_GROUP, l_id_half, &l_count);
+    dap_assert_PIF(l_objs && l_count == CONFORMANCE_COUNT - CONFORMANCE_COUNT / 2, "Read records from id");
+    dap_assert_PIF(l_objs[0].id == l_id_half, "First record from id");
+    dap_assert_PIF(dap_chain_global_db_driver_count(CONFORMANCE_GROUP, l_id_half) == l_count, "Count records from id");
+    dap_store_obj_free(l_objs, l_count);
+    l_count = 2;
+    l_objs = dap_chain_global_db_driver_cond_read(CONFORMANCE_GROUP, l_id_half, &l_count);
+    dap_assert_PIF(l_objs && l_count == 2 && l_objs[0].id == l_id_half, "Read limited records from id");
+    dap_store_obj_free(l_objs, l_count);
+
+    // overwritten record gets the new value and the last id
+    dap_assert_PIF(!s_conformance_apply('a', "key_0", "value_new"), "Overwrite record");
+    dap_store_obj_t *l_obj = dap_chain_global_db_driver_read(CONFORMANCE_GROUP, "key_0", NULL);
+    dap_assert_PIF(s_conformance_check(l_obj, "key_0", "value_new"), "Read overwritten record");
+    dap_store_obj_free(l_obj, 1);
+    l_obj = dap_chain_global_db_driver_read_last(CONFORMANCE_GROUP);
+    dap_assert_PIF(s_conformance_check(l_obj, "key_0", "value_new"), "Read last record");
+    dap_store_obj_free(l_obj, 1);
+    dap_assert_PIF(dap_chain_global_db_driver_count(CONFORMANCE_GROUP, 0) == CONFORMANCE_COUNT, "Count after overwrite");
+
+    dap_list_t *l_groups = dap_chain_global_db_driver_get_groups_by_mask("local.conform*");
+    bool l_group_found = false;
+    for(dap_list_t *l_item = l_groups; l_item; l_item = dap_list_next(l_item))
+        l_group_found |= !dap_strcmp(l_item->data, CONFORMANCE_GROUP);
+    dap_list_free_full(l_groups, free);
+    dap_assert_PIF(l_group_found, "Get groups by mask");
+
+    dap_assert_PIF(!s_conformance_apply('d', "key_1", NULL), "Delete record");
+    l_obj = dap_chain_global_db_driver_read(CONFORMANCE_GROUP, "key_1", NULL);
+    dap_assert_PIF(!l_obj, "Deleted record is absent");
+    dap_assert_PIF(!dap_chain_global_db_driver_is(CONFORMANCE_GROUP, "key_1"), "Deleted record is not present");
+
+    s_conformance_apply('d', NULL, NULL);
+    dap_assert_PIF(!dap_chain_global_db_driver_count(CONFORMANCE_GROUP, 0), "Group is cleaned");
+
+    char *l_str = dap_strdup_printf("Test %s global_db driver conformance", a_db_type);
+    dap_assert(1, l_str);
+    DAP_DELETE(l_str);
+}
+
 static void test_close_db(void)
 {
     dap_db_driver_deinit(); //dap_chain_global_db_deinit();
@@ -88,7 +198,7 @@ static void test_write_db_count(void)
         }
     }
     //dap_test_msg("Start test write dap_global_db %d record", a_count);
-    int ret = dap_chain_global_db_driver_add(l_store_obj, a_count);
+    int ret = s_driver_add_copy(l_store_obj, a_count);
 
     //dap_test_msg("Read first record");
     dap_store_obj_t *l_store_obj2 = dap_chain_global_db_driver_read(l_store_obj->group, l_store_obj->key, NULL);
@@ -124,18 +234,29 @@ void dap_global_db_tests_run(void)
 
     // cdb
     test_create_db("cdb");
+    test_conformance("cdb");
     test_write_read_one();
     benchmark_mgs_time("Read and Write in cdb 20000 records",
             benchmark_test_time(test_write_db_count, 1));
 
     // sqlite
     test_create_db("sqlite");
+    test_conformance("sqlite");
     test_write_read_one();
 //    test_write_db_count(1000000);
 
     benchmark_mgs_time("Read and Write in sqlite 20000 records",
             benchmark_test_time(test_write_db_count, 1));
 
+#ifdef DAP_CHAIN_GDB_ENGINE_MDBX
+    // mdbx
+    test_create_db("mdbx");
+    test_conformance("mdbx");
+    test_write_read_one();
+    benchmark_mgs_time("Read and Write in mdbx 20000 records",
+            benchmark_test_time(test_write_db_count, 1));
+#endif
+
 
 
     //test_close_db();